@@ -0,0 +1,120 @@
+#ifndef BIG_ENDIAN_READER_H
+#define BIG_ENDIAN_READER_H
+
+#include <SDL3/SDL.h>
+#include <cstddef>
+#include <string>
+
+// Non-owning cursor over big-endian font data. It never copies or allocates;
+// the caller keeps the underlying bytes alive for as long as the reader is used.
+class BigEndianReader {
+
+public:
+
+    BigEndianReader(const Uint8* data, size_t size, size_t position = 0)
+        : data(data), size(size), position(position) {}
+
+    const Uint8* get_data() const { return data; }
+    size_t get_size() const { return size; }
+    size_t get_position() const { return position; }
+    const Uint8* get_current() const { return data + position; }
+
+    void seek(size_t location) { position = location; }
+    void skip(size_t byte_count) { position += byte_count; }
+
+    // A reader over [offset, offset + length) of this one, positioned at its start.
+    BigEndianReader sub_reader(size_t offset, size_t length) const {
+        return BigEndianReader(data + offset, length);
+    }
+
+    Uint8 read_u8() {
+        return data[position++];
+    }
+
+    Sint8 read_s8() {
+        return static_cast<Sint8>(read_u8());
+    }
+
+    Uint16 read_u16() {
+        Uint16 value = peek_u16(position);
+        position += 2;
+        return value;
+    }
+
+    Sint16 read_s16() {
+        return static_cast<Sint16>(read_u16());
+    }
+
+    Uint32 read_u32() {
+        Uint32 value = peek_u32(position);
+        position += 4;
+        return value;
+    }
+
+    Sint32 read_s32() {
+        return static_cast<Sint32>(read_u32());
+    }
+
+    // Tags are kept in file order, so 'glyf' reads as 0x676C7966.
+    Uint32 read_tag() {
+        return read_u32();
+    }
+
+    void read_u16_array(Uint16* destination, size_t count) {
+        for (size_t i = 0; i < count; i++) {
+            destination[i] = peek_u16(position + 2 * i);
+        }
+        position += 2 * count;
+    }
+
+    void read_s16_array(Sint16* destination, size_t count) {
+        for (size_t i = 0; i < count; i++) {
+            destination[i] = static_cast<Sint16>(peek_u16(position + 2 * i));
+        }
+        position += 2 * count;
+    }
+
+    void read_u32_array(Uint32* destination, size_t count) {
+        for (size_t i = 0; i < count; i++) {
+            destination[i] = peek_u32(position + 4 * i);
+        }
+        position += 4 * count;
+    }
+
+    Uint8 peek_u8(size_t location) const {
+        return data[location];
+    }
+
+    Uint16 peek_u16(size_t location) const {
+        return
+            (static_cast<Uint16>(data[location]) << 8) |
+            static_cast<Uint16>(data[location + 1])
+        ;
+    }
+
+    Uint32 peek_u32(size_t location) const {
+        return
+            (static_cast<Uint32>(data[location]) << 24) |
+            (static_cast<Uint32>(data[location + 1]) << 16) |
+            (static_cast<Uint32>(data[location + 2]) << 8) |
+            static_cast<Uint32>(data[location + 3])
+        ;
+    }
+
+    static std::string tag_to_string(Uint32 tag) {
+        std::string text(4, ' ');
+        text[0] = static_cast<char>((tag >> 24) & 0xFF);
+        text[1] = static_cast<char>((tag >> 16) & 0xFF);
+        text[2] = static_cast<char>((tag >> 8) & 0xFF);
+        text[3] = static_cast<char>(tag & 0xFF);
+        return text;
+    }
+
+private:
+
+    const Uint8* data;
+    size_t size;
+    size_t position;
+};
+
+#endif
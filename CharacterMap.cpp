@@ -0,0 +1,366 @@
+#include "CharacterMap.h"
+
+#include "BigEndianReader.h"
+
+#include <cstring>
+
+namespace {
+    // Encoding records are tried best first: full-repertoire Unicode, Windows
+    // ahead of the Unicode platform, then BMP-only Unicode, then Windows
+    // symbol fonts.
+    int get_subtable_preference(Uint16 platform_id, Uint16 encoding_id, Uint16 format) {
+        bool is_unicode = platform_id == 0 || (platform_id == 3 && (encoding_id == 1 || encoding_id == 10));
+        if (format == 12 && platform_id == 3 && encoding_id == 10) {
+            return 4;
+        }
+        if (format == 12 && is_unicode) {
+            return 3;
+        }
+        if (format == 4 && is_unicode) {
+            return 2;
+        }
+        if (format == 4 && platform_id == 3 && encoding_id == 0) {
+            return 1;
+        }
+
+        return 0;
+    }
+}
+
+// --------------------------------------------------------------------------
+
+CharacterMap::CharacterMap() {
+    clear();
+}
+
+// --------------------------------------------------------------------------
+
+void CharacterMap::clear() {
+    page_table.assign(PAGE_TABLE_SIZE, 0);
+    pages.assign(PAGE_SIZE, 0);
+    codepoint_offsets.clear();
+    codepoints_by_glyph.clear();
+}
+
+// --------------------------------------------------------------------------
+
+void CharacterMap::initialize(const Uint8* cmap_data, size_t cmap_length, Uint16 glyph_count) {
+    clear();
+
+    if (cmap_data != nullptr && cmap_length >= 4) {
+        BigEndianReader reader(cmap_data, cmap_length);
+        reader.skip(2);
+        Uint16 num_subtables = reader.read_u16();
+        if (4 + static_cast<size_t>(num_subtables) * 8 > cmap_length) {
+            num_subtables = static_cast<Uint16>((cmap_length - 4) / 8);
+        }
+
+        struct Candidate {
+            int preference;
+            Uint32 offset;
+        };
+
+        std::vector<Candidate> candidates;
+        for (Uint16 i = 0; i < num_subtables; i++) {
+            Uint16 platform_id = reader.read_u16();
+            Uint16 encoding_id = reader.read_u16();
+            Uint32 offset = reader.read_u32();
+            if (static_cast<size_t>(offset) + 2 > cmap_length) {
+                continue;
+            }
+
+            int preference = get_subtable_preference(platform_id, encoding_id, reader.peek_u16(offset));
+            if (preference > 0) {
+                candidates.push_back({preference, offset});
+            }
+        }
+
+        std::stable_sort(candidates.begin(), candidates.end(), [](const Candidate& a, const Candidate& b) {
+            return a.preference > b.preference;
+        });
+
+        for (const Candidate& candidate : candidates) {
+            const Uint8* subtable = cmap_data + candidate.offset;
+            size_t subtable_length = cmap_length - candidate.offset;
+            Uint16 format = reader.peek_u16(candidate.offset);
+
+            bool is_read = format == 12
+                ? read_format_12(subtable, subtable_length, glyph_count)
+                : read_format_4(subtable, subtable_length, glyph_count);
+            if (is_read) {
+                break;
+            }
+
+            clear();
+        }
+    }
+
+    build_reverse_index(glyph_count);
+}
+
+// --------------------------------------------------------------------------
+
+void CharacterMap::map_codepoint(Uint32 codepoint, Uint32 glyph_index, Uint16 glyph_count) {
+    if (glyph_index == 0 || glyph_index >= glyph_count || codepoint > MAX_CODEPOINT) {
+        return;
+    }
+
+    Uint16& page = page_table[codepoint >> PAGE_BITS];
+    if (page == 0) {
+        page = static_cast<Uint16>(pages.size() >> PAGE_BITS);
+        pages.resize(pages.size() + PAGE_SIZE, 0);
+    }
+
+    // Overlapping ranges keep whichever mapping came first.
+    Uint16& entry = pages[(static_cast<size_t>(page) << PAGE_BITS) | (codepoint & PAGE_MASK)];
+    if (entry == 0) {
+        entry = static_cast<Uint16>(glyph_index);
+    }
+}
+
+// --------------------------------------------------------------------------
+
+// Segment mapping to delta values: parallel arrays of segment end codes,
+// start codes, deltas and offsets into a trailing glyph index array.
+bool CharacterMap::read_format_4(const Uint8* subtable, size_t subtable_length, Uint16 glyph_count) {
+    if (subtable_length < 14) {
+        return false;
+    }
+
+    BigEndianReader reader(subtable, subtable_length);
+    size_t segment_count = reader.peek_u16(6) / 2;
+    size_t end_codes = 14;
+    size_t start_codes = end_codes + 2 * segment_count + 2;
+    size_t id_deltas = start_codes + 2 * segment_count;
+    size_t id_range_offsets = id_deltas + 2 * segment_count;
+    if (id_range_offsets + 2 * segment_count > subtable_length) {
+        return false;
+    }
+
+    for (size_t segment = 0; segment < segment_count; segment++) {
+        Uint32 end_code = reader.peek_u16(end_codes + 2 * segment);
+        Uint32 start_code = reader.peek_u16(start_codes + 2 * segment);
+        Uint16 id_delta = reader.peek_u16(id_deltas + 2 * segment);
+        size_t id_range_offset_location = id_range_offsets + 2 * segment;
+        Uint16 id_range_offset = reader.peek_u16(id_range_offset_location);
+
+        // The final 0xFFFF segment only terminates the table.
+        if (start_code == 0xFFFF) {
+            continue;
+        }
+
+        for (Uint32 codepoint = start_code; codepoint <= end_code; codepoint++) {
+            Uint32 glyph_index;
+            if (id_range_offset == 0) {
+                glyph_index = (codepoint + id_delta) & 0xFFFF;
+            } else {
+                // idRangeOffset counts bytes from its own location.
+                size_t location = id_range_offset_location + id_range_offset + 2 * (codepoint - start_code);
+                if (location + 2 > subtable_length) {
+                    break;
+                }
+
+                glyph_index = reader.peek_u16(location);
+                if (glyph_index != 0) {
+                    glyph_index = (glyph_index + id_delta) & 0xFFFF;
+                }
+            }
+
+            map_codepoint(codepoint, glyph_index, glyph_count);
+        }
+    }
+
+    return true;
+}
+
+// --------------------------------------------------------------------------
+
+// Segmented coverage: sorted groups of consecutive codepoints mapped to
+// consecutive glyphs.
+bool CharacterMap::read_format_12(const Uint8* subtable, size_t subtable_length, Uint16 glyph_count) {
+    if (subtable_length < 16) {
+        return false;
+    }
+
+    BigEndianReader reader(subtable, subtable_length);
+    size_t group_count = reader.peek_u32(12);
+    if (group_count > (subtable_length - 16) / 12) {
+        return false;
+    }
+
+    for (size_t group = 0; group < group_count; group++) {
+        size_t location = 16 + 12 * group;
+        Uint32 start_code = reader.peek_u32(location);
+        Uint32 end_code = std::min(reader.peek_u32(location + 4), static_cast<Uint32>(MAX_CODEPOINT));
+        Uint32 start_glyph_index = reader.peek_u32(location + 8);
+
+        for (Uint32 codepoint = start_code; codepoint <= end_code; codepoint++) {
+            Uint32 glyph_index = start_glyph_index + (codepoint - start_code);
+            if (glyph_index >= glyph_count) {
+                break;
+            }
+
+            map_codepoint(codepoint, glyph_index, glyph_count);
+        }
+    }
+
+    return true;
+}
+
+// --------------------------------------------------------------------------
+
+void CharacterMap::build_reverse_index(Uint16 glyph_count) {
+    codepoint_offsets.assign(static_cast<size_t>(glyph_count) + 1, 0);
+
+    // Count, turn the counts into offsets, then fill. Walking the pages in
+    // codepoint order leaves each glyph's codepoints sorted.
+    for (int pass = 0; pass < 2; pass++) {
+        for (Uint32 page_number = 0; page_number + 1 < PAGE_TABLE_SIZE; page_number++) {
+            size_t page = page_table[page_number];
+            if (page == 0) {
+                continue;
+            }
+
+            const Uint16* entries = pages.data() + (page << PAGE_BITS);
+            for (Uint32 low_byte = 0; low_byte < PAGE_SIZE; low_byte++) {
+                Uint16 glyph_index = entries[low_byte];
+                if (glyph_index == 0) {
+                    continue;
+                }
+
+                if (pass == 0) {
+                    codepoint_offsets[glyph_index + 1]++;
+                } else {
+                    codepoints_by_glyph[codepoint_offsets[glyph_index]++] = (page_number << PAGE_BITS) | low_byte;
+                }
+            }
+        }
+
+        if (pass == 0) {
+            for (size_t i = 0; i < glyph_count; i++) {
+                codepoint_offsets[i + 1] += codepoint_offsets[i];
+            }
+
+            codepoints_by_glyph.resize(codepoint_offsets[glyph_count]);
+        } else {
+            // Filling advanced every offset to the start of the next glyph.
+            for (size_t i = glyph_count; i > 0; i--) {
+                codepoint_offsets[i] = codepoint_offsets[i - 1];
+            }
+            codepoint_offsets[0] = 0;
+        }
+    }
+}
+
+// --------------------------------------------------------------------------
+
+size_t CharacterMap::get_codepoint_count(Uint16 glyph_index) const {
+    if (static_cast<size_t>(glyph_index) + 1 >= codepoint_offsets.size()) {
+        return 0;
+    }
+
+    return codepoint_offsets[glyph_index + 1] - codepoint_offsets[glyph_index];
+}
+
+// --------------------------------------------------------------------------
+
+const Uint32* CharacterMap::get_codepoints(Uint16 glyph_index) const {
+    if (get_codepoint_count(glyph_index) == 0) {
+        return nullptr;
+    }
+
+    return codepoints_by_glyph.data() + codepoint_offsets[glyph_index];
+}
+
+// --------------------------------------------------------------------------
+
+size_t CharacterMap::get_mapped_codepoint_count() const {
+    return codepoints_by_glyph.size();
+}
+
+// --------------------------------------------------------------------------
+
+void CharacterMap::map_utf32(const Uint32* codepoints, size_t count, Uint16* glyph_indices) const {
+    for (size_t i = 0; i < count; i++) {
+        glyph_indices[i] = get_glyph_index(codepoints[i]);
+    }
+}
+
+// --------------------------------------------------------------------------
+
+size_t CharacterMap::map_utf8(const char* text, size_t length, Uint16* glyph_indices) const {
+    const Uint8* bytes = reinterpret_cast<const Uint8*>(text);
+    const Uint16* ascii_page = pages.data() + (static_cast<size_t>(page_table[0]) << PAGE_BITS);
+
+    size_t glyph_count = 0;
+    size_t i = 0;
+    while (i < length) {
+        // Runs of ASCII are the common case, so take eight bytes at a time
+        // while none of them has the high bit set.
+        if (i + 8 <= length) {
+            Uint64 chunk;
+            std::memcpy(&chunk, bytes + i, sizeof(chunk));
+            if ((chunk & 0x8080808080808080ULL) == 0) {
+                for (size_t k = 0; k < 8; k++) {
+                    glyph_indices[glyph_count + k] = ascii_page[bytes[i + k]];
+                }
+
+                glyph_count += 8;
+                i += 8;
+                continue;
+            }
+        }
+
+        Uint8 lead = bytes[i];
+        if (lead < 0x80) {
+            glyph_indices[glyph_count++] = ascii_page[lead];
+            i++;
+            continue;
+        }
+
+        // Lead bytes that can't start a valid sequence (continuations, the
+        // overlong 0xC0 and 0xC1, and anything past 0xF4) fall through with
+        // a sequence length of 0.
+        size_t sequence_length = 0;
+        Uint32 codepoint = 0;
+        Uint32 min_codepoint = 0;
+        if (lead >= 0xC2 && lead <= 0xDF) {
+            sequence_length = 2;
+            codepoint = lead & 0x1F;
+            min_codepoint = 0x80;
+        } else if (lead >= 0xE0 && lead <= 0xEF) {
+            sequence_length = 3;
+            codepoint = lead & 0x0F;
+            min_codepoint = 0x800;
+        } else if (lead >= 0xF0 && lead <= 0xF4) {
+            sequence_length = 4;
+            codepoint = lead & 0x07;
+            min_codepoint = 0x10000;
+        }
+
+        bool is_valid = sequence_length > 0 && i + sequence_length <= length;
+        for (size_t k = 1; is_valid && k < sequence_length; k++) {
+            Uint8 continuation = bytes[i + k];
+            is_valid = (continuation & 0xC0) == 0x80;
+            codepoint = (codepoint << 6) | (continuation & 0x3F);
+        }
+
+        bool is_surrogate = codepoint >= 0xD800 && codepoint <= 0xDFFF;
+        if (!is_valid || codepoint < min_codepoint || codepoint > MAX_CODEPOINT || is_surrogate) {
+            codepoint = REPLACEMENT_CHARACTER;
+            sequence_length = 1;
+        }
+
+        glyph_indices[glyph_count++] = get_glyph_index(codepoint);
+        i += sequence_length;
+    }
+
+    return glyph_count;
+}
+
+// --------------------------------------------------------------------------
+
+void CharacterMap::map_utf8(const std::string& text, std::vector<Uint16>& glyph_indices) const {
+    glyph_indices.resize(text.size());
+    glyph_indices.resize(map_utf8(text.data(), text.size(), glyph_indices.data()));
+}
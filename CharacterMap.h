@@ -0,0 +1,76 @@
+#ifndef CHARACTER_MAP_H
+#define CHARACTER_MAP_H
+
+#include <SDL3/SDL.h>
+#include <algorithm>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// Unicode codepoint to glyph index mapping, compiled from the font's cmap
+// table (format 4 or 12) when the font loads. Lookups go through a two-level
+// page table: the high bits of a codepoint pick a 256-entry page and the low
+// byte indexes into it. Pages with no mapped codepoints all share one page of
+// zeros, so a lookup is two loads and never branches on the codepoint.
+class CharacterMap {
+
+public:
+
+    static const Uint32 MAX_CODEPOINT = 0x10FFFF;
+    static const Uint32 REPLACEMENT_CHARACTER = 0xFFFD;
+
+    CharacterMap();
+
+    // cmap_data points at the cmap table. Leaves the map empty, with every
+    // codepoint on glyph 0, if no Unicode subtable it understands is found.
+    void initialize(const Uint8* cmap_data, size_t cmap_length, Uint16 glyph_count);
+
+    // 0 (.notdef) for unmapped codepoints, including anything past
+    // MAX_CODEPOINT.
+    Uint16 get_glyph_index(Uint32 codepoint) const {
+        Uint32 page = page_table[std::min(codepoint >> PAGE_BITS, PAGE_TABLE_SIZE - 1)];
+        return pages[(page << PAGE_BITS) | (codepoint & PAGE_MASK)];
+    }
+
+    // Every codepoint that maps to glyph_index, in ascending order.
+    size_t get_codepoint_count(Uint16 glyph_index) const;
+    const Uint32* get_codepoints(Uint16 glyph_index) const;
+
+    size_t get_mapped_codepoint_count() const;
+
+    // Look up count codepoints at once. glyph_indices must hold count entries.
+    void map_utf32(const Uint32* codepoints, size_t count, Uint16* glyph_indices) const;
+
+    // Decode UTF-8 text and look up each codepoint. Malformed sequences come
+    // out as REPLACEMENT_CHARACTER, one per offending byte. glyph_indices must
+    // hold length entries; returns how many were written.
+    size_t map_utf8(const char* text, size_t length, Uint16* glyph_indices) const;
+    void map_utf8(const std::string& text, std::vector<Uint16>& glyph_indices) const;
+
+private:
+
+    static const Uint32 PAGE_BITS = 8;
+    static const Uint32 PAGE_SIZE = 1 << PAGE_BITS;
+    static const Uint32 PAGE_MASK = PAGE_SIZE - 1;
+
+    // One entry per page of the Unicode range plus a final one that
+    // out-of-range codepoints are clamped onto, which always stays empty.
+    static const Uint32 PAGE_TABLE_SIZE = (MAX_CODEPOINT >> PAGE_BITS) + 2;
+
+    // Page 0 of pages is the shared empty page.
+    std::vector<Uint16> page_table;
+    std::vector<Uint16> pages;
+
+    // Reverse index: glyph g's codepoints are
+    // codepoints_by_glyph[codepoint_offsets[g]] up to codepoint_offsets[g + 1].
+    std::vector<Uint32> codepoint_offsets;
+    std::vector<Uint32> codepoints_by_glyph;
+
+    void clear();
+    void map_codepoint(Uint32 codepoint, Uint32 glyph_index, Uint16 glyph_count);
+    bool read_format_4(const Uint8* subtable, size_t subtable_length, Uint16 glyph_count);
+    bool read_format_12(const Uint8* subtable, size_t subtable_length, Uint16 glyph_count);
+    void build_reverse_index(Uint16 glyph_count);
+};
+
+#endif
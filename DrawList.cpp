@@ -0,0 +1,178 @@
+#include "DrawList.h"
+
+#include <cmath>
+
+#include "Profiler.h"
+
+DrawList::DrawList()
+    : active_batch_count(0),
+      renderer_call_count(0) {
+}
+
+// --------------------------------------------------------------------------
+
+void DrawList::clear() {
+    textured_rects.clear();
+
+    for (size_t i = 0; i < active_batch_count; i++) {
+        batches[i].rects.clear();
+        batches[i].line_vertices.clear();
+        batches[i].line_indices.clear();
+        batches[i].polyline_points.clear();
+        batches[i].polyline_ends.clear();
+    }
+
+    active_batch_count = 0;
+}
+
+// --------------------------------------------------------------------------
+
+DrawList::Batch& DrawList::get_batch(const SDL_Color& color) {
+    // A frame only ever uses a couple of colors, so a linear scan wins.
+    for (size_t i = 0; i < active_batch_count; i++) {
+        const SDL_Color& batch_color = batches[i].color;
+        if (batch_color.r == color.r && batch_color.g == color.g && batch_color.b == color.b && batch_color.a == color.a) {
+            return batches[i];
+        }
+    }
+
+    if (active_batch_count == batches.size()) {
+        batches.emplace_back();
+    }
+
+    Batch& batch = batches[active_batch_count++];
+    batch.color = color;
+    return batch;
+}
+
+// --------------------------------------------------------------------------
+
+void DrawList::add_point(float x, float y, const SDL_Color& color) {
+    SDL_FRect point_rect;
+    point_rect.x = x - 1;
+    point_rect.y = y - 1;
+    point_rect.w = 3;
+    point_rect.h = 3;
+
+    get_batch(color).rects.push_back(point_rect);
+}
+
+// --------------------------------------------------------------------------
+
+void DrawList::add_line(float x1, float y1, float x2, float y2, const SDL_Color& color) {
+    Batch& batch = get_batch(color);
+
+    // Loose lines are drawn as one-pixel-wide quads so that any number of
+    // them can go out in a single geometry call.
+    float dx = x2 - x1;
+    float dy = y2 - y1;
+    float length = std::sqrt(dx * dx + dy * dy);
+    float nx = length > 0.0f ? -dy / length * 0.5f : 0.5f;
+    float ny = length > 0.0f ? dx / length * 0.5f : 0.0f;
+
+    SDL_FColor vertex_color;
+    vertex_color.r = color.r / 255.0f;
+    vertex_color.g = color.g / 255.0f;
+    vertex_color.b = color.b / 255.0f;
+    vertex_color.a = color.a / 255.0f;
+
+    int first_vertex = static_cast<int>(batch.line_vertices.size());
+    batch.line_vertices.push_back({{x1 + nx, y1 + ny}, vertex_color, {0.0f, 0.0f}});
+    batch.line_vertices.push_back({{x1 - nx, y1 - ny}, vertex_color, {0.0f, 0.0f}});
+    batch.line_vertices.push_back({{x2 - nx, y2 - ny}, vertex_color, {0.0f, 0.0f}});
+    batch.line_vertices.push_back({{x2 + nx, y2 + ny}, vertex_color, {0.0f, 0.0f}});
+
+    const int quad_indices[] = {0, 1, 2, 0, 2, 3};
+    for (int index : quad_indices) {
+        batch.line_indices.push_back(first_vertex + index);
+    }
+}
+
+// --------------------------------------------------------------------------
+
+void DrawList::add_polyline(const SDL_FPoint* points, size_t point_count, const SDL_Color& color) {
+    if (point_count < 2) {
+        return;
+    }
+
+    Batch& batch = get_batch(color);
+    batch.polyline_points.insert(batch.polyline_points.end(), points, points + point_count);
+    batch.polyline_ends.push_back(batch.polyline_points.size());
+}
+
+// --------------------------------------------------------------------------
+
+void DrawList::add_polyline(const SDL_FPoint* points, size_t point_count, float offset_x, float offset_y, const SDL_Color& color) {
+    if (point_count < 2) {
+        return;
+    }
+
+    Batch& batch = get_batch(color);
+    for (size_t i = 0; i < point_count; i++) {
+        batch.polyline_points.push_back({points[i].x + offset_x, points[i].y + offset_y});
+    }
+    batch.polyline_ends.push_back(batch.polyline_points.size());
+}
+
+// --------------------------------------------------------------------------
+
+void DrawList::add_texture(SDL_Texture* texture, const SDL_FRect& destination) {
+    textured_rects.push_back({texture, destination});
+}
+
+// --------------------------------------------------------------------------
+
+void DrawList::submit(SDL_Renderer* renderer) {
+    PROFILE_SCOPE(SUBMIT);
+    renderer_call_count = 0;
+
+    Uint8 draw_r, draw_g, draw_b, draw_a;
+    SDL_GetRenderDrawColor(renderer, &draw_r, &draw_g, &draw_b, &draw_a);
+
+    for (const TexturedRect& textured_rect : textured_rects) {
+        SDL_RenderTexture(renderer, textured_rect.texture, nullptr, &textured_rect.destination);
+        renderer_call_count++;
+    }
+
+    for (size_t i = 0; i < active_batch_count; i++) {
+        const Batch& batch = batches[i];
+
+        SDL_SetRenderDrawColor(renderer, batch.color.r, batch.color.g, batch.color.b, batch.color.a);
+        renderer_call_count++;
+
+        if (!batch.rects.empty()) {
+            SDL_RenderRects(renderer, batch.rects.data(), static_cast<int>(batch.rects.size()));
+            renderer_call_count++;
+        }
+
+        if (!batch.line_indices.empty()) {
+            SDL_RenderGeometry(
+                renderer,
+                nullptr,
+                batch.line_vertices.data(),
+                static_cast<int>(batch.line_vertices.size()),
+                batch.line_indices.data(),
+                static_cast<int>(batch.line_indices.size())
+            );
+            renderer_call_count++;
+        }
+
+        size_t polyline_start = 0;
+        for (size_t polyline_end : batch.polyline_ends) {
+            SDL_RenderLines(renderer, batch.polyline_points.data() + polyline_start, static_cast<int>(polyline_end - polyline_start));
+            renderer_call_count++;
+
+            polyline_start = polyline_end;
+        }
+    }
+
+    SDL_SetRenderDrawColor(renderer, draw_r, draw_g, draw_b, draw_a);
+
+    PROFILE_COUNT(RENDERER_CALLS, renderer_call_count);
+}
+
+// --------------------------------------------------------------------------
+
+int DrawList::get_renderer_call_count() const {
+    return renderer_call_count;
+}
@@ -0,0 +1,59 @@
+#ifndef DRAW_LIST_H
+#define DRAW_LIST_H
+
+#include <SDL3/SDL.h>
+#include <vector>
+
+// Collects a frame's worth of textures, points, lines and polylines and
+// submits them to SDL in as few calls as possible: textures go first, then
+// everything of one color goes out together, rects in one SDL_RenderRects
+// call, loose lines as a single SDL_RenderGeometry call and each polyline as
+// one SDL_RenderLines call.
+// Buffers are kept between frames, so a warmed-up list doesn't allocate.
+class DrawList {
+
+public:
+
+    DrawList();
+
+    void clear();
+
+    // A 3x3 pixel outlined square centered on (x, y).
+    void add_point(float x, float y, const SDL_Color& color);
+    void add_line(float x1, float y1, float x2, float y2, const SDL_Color& color);
+    void add_polyline(const SDL_FPoint* points, size_t point_count, const SDL_Color& color);
+    void add_polyline(const SDL_FPoint* points, size_t point_count, float offset_x, float offset_y, const SDL_Color& color);
+
+    // The texture is not owned and must stay alive until the list is cleared.
+    void add_texture(SDL_Texture* texture, const SDL_FRect& destination);
+
+    void submit(SDL_Renderer* renderer);
+
+    // Renderer calls made by the most recent submit().
+    int get_renderer_call_count() const;
+
+private:
+
+    struct Batch {
+        SDL_Color color;
+        std::vector<SDL_FRect> rects;
+        std::vector<SDL_Vertex> line_vertices;
+        std::vector<int> line_indices;
+        std::vector<SDL_FPoint> polyline_points;
+        std::vector<size_t> polyline_ends;
+    };
+
+    struct TexturedRect {
+        SDL_Texture* texture;
+        SDL_FRect destination;
+    };
+
+    std::vector<TexturedRect> textured_rects;
+    std::vector<Batch> batches;
+    size_t active_batch_count;
+    int renderer_call_count;
+
+    Batch& get_batch(const SDL_Color& color);
+};
+
+#endif
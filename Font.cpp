@@ -1,252 +1,740 @@
 #include "Font.h"
 
-#include <fstream>
+#include "BigEndianReader.h"
+#include "OutlineKernels.h"
+#include "Profiler.h"
+
+#include <algorithm>
+#include <cmath>
 #include <iostream>
+#include <utility>
+#include <vector>
+
+namespace {
+    // The composites being decoded on this thread, outermost first, so a
+    // component that refers back to one of them is left out instead of
+    // recursing until the depth limit.
+    thread_local std::vector<Uint16> composite_chain;
+    thread_local int component_load_count = 0;
+
+    // Counts components left out for a cycle, the depth limit or the load
+    // budget. A decode during which it went up depends on where the glyph
+    // was reached from, so it isn't cached.
+    thread_local Uint64 skipped_component_count = 0;
+}
 
-Font::Font(const std::string& font_file_name) {
-    initialize(font_file_name);
+Glyph::Glyph()
+    : min_extents{0, 0},
+      max_extents{0, 0},
+      num_end_point_indices(0),
+      end_point_indices(nullptr),
+      num_points(0),
+      x_coordinates(nullptr),
+      y_coordinates(nullptr),
+      on_curve_bits(nullptr),
+      arena(nullptr),
+      storage(nullptr),
+      storage_size(0) {
 }
 
 // --------------------------------------------------------------------------
 
-Font::~Font() {
-    delete[] glyph_offsets;
+Glyph::~Glyph() {
+    release();
 }
 
 // --------------------------------------------------------------------------
-Uint32 Font::read_uint32_from_big_endian_file(const std::vector<Uint8> file_contents, int location) {
-    return
-        (static_cast<Uint32>(file_contents[location]) << 24) |
-        (static_cast<Uint32>(file_contents[location + 1]) << 16) |
-        (static_cast<Uint32>(file_contents[location + 2]) << 8) |
-        static_cast<Uint32>(file_contents[location + 3])
-    ;
+
+Glyph::Glyph(Glyph&& other)
+    : Glyph() {
+    *this = std::move(other);
 }
 
 // --------------------------------------------------------------------------
 
-Uint16 Font::read_uint16_from_big_endian_file(const std::vector<Uint8> file_contents, int location) {
-    return
-        (static_cast<Uint16>(file_contents[location]) << 8) |
-        static_cast<Uint16>(file_contents[location + 1])
-    ;
+Glyph& Glyph::operator=(Glyph&& other) {
+    if (this != &other) {
+        release();
+
+        min_extents = other.min_extents;
+        max_extents = other.max_extents;
+        num_end_point_indices = other.num_end_point_indices;
+        end_point_indices = other.end_point_indices;
+        num_points = other.num_points;
+        x_coordinates = other.x_coordinates;
+        y_coordinates = other.y_coordinates;
+        on_curve_bits = other.on_curve_bits;
+        arena = other.arena;
+        storage = other.storage;
+        storage_size = other.storage_size;
+
+        other.num_end_point_indices = 0;
+        other.end_point_indices = nullptr;
+        other.num_points = 0;
+        other.x_coordinates = nullptr;
+        other.y_coordinates = nullptr;
+        other.on_curve_bits = nullptr;
+        other.arena = nullptr;
+        other.storage = nullptr;
+        other.storage_size = 0;
+    }
+
+    return *this;
 }
 
 // --------------------------------------------------------------------------
 
-void Font::initialize(const std::string& font_file_name) {
-    std::ifstream file(font_file_name, std::ifstream::binary);
-    file.unsetf(std::ios::skipws);
+void Glyph::allocate(GlyphArena* arena, Uint16 num_end_point_indices, Uint16 num_points) {
+    release();
+
+    // Coordinate arrays go first so they stay 2-byte aligned, then the end
+    // points, then the bitset.
+    size_t coordinates_size = sizeof(Sint16) * num_points;
+    size_t end_point_indices_size = sizeof(Uint16) * num_end_point_indices;
+    size_t on_curve_bits_size = (static_cast<size_t>(num_points) + 7) / 8;
+
+    this->arena = arena;
+    storage_size = 2 * coordinates_size + end_point_indices_size + on_curve_bits_size;
+    storage = arena->allocate(storage_size);
+
+    this->num_points = num_points;
+    x_coordinates = reinterpret_cast<Sint16*>(storage);
+    y_coordinates = reinterpret_cast<Sint16*>(storage + coordinates_size);
+    this->num_end_point_indices = num_end_point_indices;
+    end_point_indices = reinterpret_cast<Uint16*>(storage + 2 * coordinates_size);
+    on_curve_bits = storage + 2 * coordinates_size + end_point_indices_size;
+}
 
-    file.seekg(0, std::ios::end);
-    std::streampos file_size = file.tellg();
-    file.seekg(0, std::ios::beg);
+// --------------------------------------------------------------------------
 
-    font_file_contents.resize(file_size);
-    file.read((char*)font_file_contents.data(), font_file_contents.size());
+size_t Glyph::get_memory_size() const {
+    return sizeof(Glyph) + storage_size;
+}
 
-    int file_location = 0;
+// --------------------------------------------------------------------------
 
-    Offset_subtable offset_subtable;
-    offset_subtable.scaler_type = read_uint32_from_big_endian_file(font_file_contents, file_location);
-    file_location += 4;
-    offset_subtable.num_tables = read_uint16_from_big_endian_file(font_file_contents, file_location);
-    file_location += 2;
-    offset_subtable.search_range = read_uint16_from_big_endian_file(font_file_contents, file_location);
-    file_location += 2;
-    offset_subtable.entry_selector = read_uint16_from_big_endian_file(font_file_contents, file_location);
-    file_location += 2;
-    offset_subtable.range_shift = read_uint16_from_big_endian_file(font_file_contents, file_location);
-    file_location += 2;
+void Glyph::release() {
+    if (arena != nullptr) {
+        arena->release(storage, storage_size);
+    }
 
-    Table* tables = new Table[offset_subtable.num_tables];
-    for (int i = 0; i < offset_subtable.num_tables; i++) {
-        char tag[] = "XXXX";
-        for (int j = 0; j < 4; j++) {
-            tag[j] = font_file_contents[file_location++];
-        }
+    num_end_point_indices = 0;
+    end_point_indices = nullptr;
+    num_points = 0;
+    x_coordinates = nullptr;
+    y_coordinates = nullptr;
+    on_curve_bits = nullptr;
+    arena = nullptr;
+    storage = nullptr;
+    storage_size = 0;
+}
 
-        tables[i].tag = tag;
-        tables[i].checksum = read_uint32_from_big_endian_file(font_file_contents, file_location);
-        file_location += 4;
-        tables[i].offset = read_uint32_from_big_endian_file(font_file_contents, file_location);
-        file_location += 4;
-        tables[i].length = read_uint32_from_big_endian_file(font_file_contents, file_location);
-        file_location += 4;
+// --------------------------------------------------------------------------
 
-        table_name_to_offset[tables[i].tag] = tables[i].offset;
+Font::Font(const std::string& font_file_name, LoadMode load_mode, LocaTable::Mode loca_mode)
+    : Font(FontFile::open(font_file_name, load_mode), 0, loca_mode) {
+    if (file == nullptr) {
+        std::cerr << "[ERROR] Could not read font file: " << font_file_name << std::endl;
     }
+}
+
+// --------------------------------------------------------------------------
+
+Font::Font(std::shared_ptr<FontFile> file, int face_index, LocaTable::Mode loca_mode)
+    : file(std::move(file)),
+      face_index(face_index),
+      font_data(nullptr),
+      font_data_size(0),
+      is_trusted_font(false),
+      glyph_count(0),
+      units_per_em(0),
+      glyf_table_offset(0),
+      glyf_table_length(0),
+      character_map(std::make_shared<CharacterMap>()),
+      horizontal_metrics(std::make_shared<HorizontalMetrics>()),
+      kerning_table(std::make_shared<KerningTable>()),
+      is_component_cache_enabled(true),
+      component_cache_hit_count(0),
+      component_cache_miss_count(0) {
+    initialize(loca_mode);
+}
+
+// --------------------------------------------------------------------------
+
+void Font::initialize(LocaTable::Mode loca_mode) {
+    PROFILE_SCOPE(FONT_LOAD);
+
+    if (file == nullptr) {
+        return;
+    }
+
+    if (face_index < 0 || face_index >= file->get_face_count()) {
+        std::cerr << "[ERROR] Font file has no face " << face_index << " (it has " << file->get_face_count() << ")" << std::endl;
+        return;
+    }
+
+    font_data = file->get_data();
+    font_data_size = file->get_size();
+
+    // Everything below reads tables straight out of the file, so nothing
+    // happens until the directory is known to be sound.
+    validation_report = file->get_validation_report(face_index);
+    is_trusted_font = validation_report.is_trusted();
 
-    print_table_metadata(offset_subtable, tables);
+    double validation_ms = file->get_validation_ms();
+    std::cout << "Validation: " << (is_trusted_font ? "trusted" : "untrusted") << ", ";
+    std::cout << validation_report.checksum_mismatch_count << " checksum mismatches, ";
+    std::cout << validation_report.invalid_glyph_count << " invalid glyphs, ";
+    std::cout << validation_ms << " ms for the file (" << validation_ms / (font_data_size / 1048576.0) << " ms/MB)" << std::endl;
+
+    if (!validation_report.is_directory_valid) {
+        std::cerr << "[ERROR] Font table directory is damaged or missing required tables (face " << face_index << ")" << std::endl;
+        return;
+    }
+
+    const TableDirectory& directory = file->get_table_directory(face_index);
+
+    if (file->is_collection()) {
+        std::cout << "Collection face " << face_index << " of " << file->get_face_count() << std::endl;
+    }
+    print_table_metadata(directory);
     std::cout << "--------------------------------------------------------------------------" << std::endl;
 
-    Uint32 maxp_offset = table_name_to_offset["maxp"];
-    glyph_count = read_uint16_from_big_endian_file(font_file_contents, maxp_offset + 4);
+    BigEndianReader reader(font_data, font_data_size);
+
+    const TableDirectory::Entry* maxp = directory.find(TableTag::MAXP);
+    glyph_count = reader.peek_u16(maxp->offset + 4);
     std::cout << "Number of glyphs: " << glyph_count << std::endl;
 
-    Uint32 head_offset = table_name_to_offset["head"];
-    Sint16 index_to_loc_format = read_uint16_from_big_endian_file(font_file_contents, head_offset + 50);
+    const TableDirectory::Entry* head = directory.find(TableTag::HEAD);
+    units_per_em = reader.peek_u16(head->offset + 18);
+    Sint16 index_to_loc_format = static_cast<Sint16>(reader.peek_u16(head->offset + 50));
     bool are_offsets_short = index_to_loc_format == 0;
-    Uint32 loca_offset_stride = are_offsets_short ? 2 : 4;
-
-    Uint32 loca_table_offset = table_name_to_offset["loca"];
-    glyph_offsets = new Uint32[glyph_count];
-    for (Uint32 glyph_index = 0; glyph_index < glyph_count; glyph_index++) {
-        Uint32 glyph_offset_file_location = loca_table_offset + loca_offset_stride * glyph_index;
-        if (are_offsets_short) {
-            glyph_offsets[glyph_index] = static_cast<Uint32>(read_uint16_from_big_endian_file(font_file_contents, glyph_offset_file_location) * 2);
+
+    // A short loca table would have lookups read past its end, so only
+    // glyphs it actually has entries for are exposed.
+    const TableDirectory::Entry* loca = directory.find(TableTag::LOCA);
+    size_t loca_entry_count = loca->length / (are_offsets_short ? 2 : 4);
+    glyph_count = static_cast<Uint16>(std::min<size_t>(glyph_count, loca_entry_count > 0 ? loca_entry_count - 1 : 0));
+
+    const TableDirectory::Entry* glyf = directory.find(TableTag::GLYF);
+    glyf_table_offset = glyf->offset;
+    glyf_table_length = glyf->length;
+
+    loca_table.initialize(font_data + loca->offset, glyph_count, are_offsets_short, loca_mode);
+
+    // Faces of a collection that share these tables share the parsed result.
+    character_map = file->get_character_map(directory.find(TableTag::CMAP), glyph_count);
+    kerning_table = file->get_kerning_table(directory.find(TableTag::KERN));
+    horizontal_metrics = file->get_horizontal_metrics(directory.find(TableTag::HHEA), directory.find(TableTag::HMTX), glyph_count);
+
+    std::cout << "Mapped codepoints: " << character_map->get_mapped_codepoint_count() << std::endl;
+    std::cout << "Kerning pairs: " << kerning_table->get_pair_count() << std::endl;
+}
+
+// --------------------------------------------------------------------------
+
+Uint16 Font::get_glyph_count() {
+    return glyph_count;
+}
+
+// --------------------------------------------------------------------------
+
+Uint16 Font::get_units_per_em() {
+    return units_per_em;
+}
+
+// --------------------------------------------------------------------------
+
+Uint16 Font::get_glyph_index(Uint32 codepoint) {
+    return character_map->get_glyph_index(codepoint);
+}
+
+// --------------------------------------------------------------------------
+
+const CharacterMap& Font::get_character_map() {
+    return *character_map;
+}
+
+// --------------------------------------------------------------------------
+
+Sint16 Font::get_ascender() {
+    return horizontal_metrics->get_ascender();
+}
+
+// --------------------------------------------------------------------------
+
+Sint16 Font::get_descender() {
+    return horizontal_metrics->get_descender();
+}
+
+// --------------------------------------------------------------------------
+
+Sint16 Font::get_line_gap() {
+    return horizontal_metrics->get_line_gap();
+}
+
+// --------------------------------------------------------------------------
+
+Uint16 Font::get_advance_width(Uint16 glyph_index) {
+    return horizontal_metrics->get_advance_width(glyph_index);
+}
+
+// --------------------------------------------------------------------------
+
+Sint16 Font::get_left_side_bearing(Uint16 glyph_index) {
+    return horizontal_metrics->get_left_side_bearing(glyph_index);
+}
+
+// --------------------------------------------------------------------------
+
+Sint16 Font::get_kerning(Uint16 left_glyph_index, Uint16 right_glyph_index) {
+    return kerning_table->get_kerning(left_glyph_index, right_glyph_index);
+}
+
+// --------------------------------------------------------------------------
+
+size_t Font::get_kerning_pair_count() {
+    return kerning_table->get_pair_count();
+}
+
+// --------------------------------------------------------------------------
+
+bool Font::is_trusted() {
+    return is_trusted_font;
+}
+
+// --------------------------------------------------------------------------
+
+const FontValidationReport& Font::get_validation_report() {
+    return validation_report;
+}
+
+// --------------------------------------------------------------------------
+
+Uint64 Font::get_content_hash() {
+    if (file == nullptr) {
+        return 0;
+    }
+
+    // Faces after the first fold their index into the file's hash so that
+    // each face of a collection gets its own caches.
+    Uint64 hash = file->get_content_hash();
+    if (face_index > 0) {
+        hash ^= static_cast<Uint64>(face_index);
+        hash *= 0x100000001B3ULL;
+    }
+
+    return hash;
+}
+
+// --------------------------------------------------------------------------
+
+int Font::get_face_index() {
+    return face_index;
+}
+
+// --------------------------------------------------------------------------
+
+const std::shared_ptr<FontFile>& Font::get_file() {
+    return file;
+}
+
+// --------------------------------------------------------------------------
+
+void Font::read_coordinate_deltas(
+    BigEndianReader& reader,
+    const Uint8* flags,
+    Uint16 num_points,
+    Uint8 is_short_flag,
+    Uint8 is_same_or_positive_flag,
+    Sint16* deltas
+) {
+    // Walk a raw pointer rather than the reader so the cursor stays in a
+    // register across the loop.
+    const Uint8* start = reader.get_current();
+    const Uint8* cursor = start;
+
+    for (int i = 0; i < num_points; i++) {
+        Uint8 flag = flags[i];
+
+        if (flag & is_short_flag) {
+            Sint16 delta = *cursor++;
+            deltas[i] = (flag & is_same_or_positive_flag) ? delta : -delta;
+        } else if (flag & is_same_or_positive_flag) {
+            deltas[i] = 0;
         } else {
-            glyph_offsets[glyph_index] = read_uint32_from_big_endian_file(font_file_contents, glyph_offset_file_location);
+            deltas[i] = static_cast<Sint16>((cursor[0] << 8) | cursor[1]);
+            cursor += 2;
         }
     }
 
-    delete[] tables;
+    reader.skip(cursor - start);
 }
 
 // --------------------------------------------------------------------------
 
-Uint16 Font::get_glyph_count() {
-    return glyph_count;
+GlyphArena& Font::get_glyph_arena() {
+    return glyph_arena;
 }
 
 // --------------------------------------------------------------------------
 
 Glyph Font::get_glyph(Uint16 glyph_index) {
+    PROFILE_SCOPE(GET_GLYPH);
+    return decode_glyph(glyph_index, 0);
+}
+
+// --------------------------------------------------------------------------
+
+const Uint8* Font::get_glyph_data(Uint16 glyph_index, Uint32& length) {
+    length = 0;
+
+    // Glyphs without outlines (e.g. space) have no data at all in glyf.
+    Uint32 glyph_length = glyph_index < glyph_count ? loca_table.get_glyph_length(glyph_index) : 0;
+    if (glyph_length == 0) {
+        return nullptr;
+    }
+
+    // Everything in a trusted font was checked when it was opened. Otherwise
+    // check this glyph's record now, before the unchecked decoder reads it.
+    Uint32 glyph_offset = loca_table.get_glyph_offset(glyph_index);
+    const Uint8* glyph_data = font_data + glyf_table_offset + glyph_offset;
+    if (!is_trusted_font) {
+        bool is_in_glyf_table = glyph_offset <= glyf_table_length && glyph_length <= glyf_table_length - glyph_offset;
+        if (!is_in_glyf_table || !validate_glyph(glyph_data, glyph_length, glyph_count)) {
+            return nullptr;
+        }
+    }
+
+    length = glyph_length;
+    return glyph_data;
+}
+
+// --------------------------------------------------------------------------
+
+Glyph Font::decode_glyph(Uint16 glyph_index, int composite_depth) {
     Glyph glyph;
 
-    Uint32 glyf_table_offset = table_name_to_offset["glyf"];
-    Uint32 file_location = glyf_table_offset + glyph_offsets[glyph_index];
+    Uint32 glyph_length = 0;
+    const Uint8* glyph_data = get_glyph_data(glyph_index, glyph_length);
+    if (glyph_data == nullptr) {
+        return glyph;
+    }
 
-    Sint16 num_contours = static_cast<Sint16>(read_uint16_from_big_endian_file(font_file_contents, file_location));
-    file_location += 2;
-    Sint16 x_min = static_cast<Sint16>(read_uint16_from_big_endian_file(font_file_contents, file_location));
-    file_location += 2;
-    Sint16 y_min = static_cast<Sint16>(read_uint16_from_big_endian_file(font_file_contents, file_location));
-    file_location += 2;
-    Sint16 x_max = static_cast<Sint16>(read_uint16_from_big_endian_file(font_file_contents, file_location));
-    file_location += 2;
-    Sint16 y_max = static_cast<Sint16>(read_uint16_from_big_endian_file(font_file_contents, file_location));
-    file_location += 2;
+    BigEndianReader reader(font_data, font_data_size, glyph_data - font_data);
 
-    glyph.min_extents.x = x_min;
-    glyph.min_extents.y = y_min;
-    glyph.max_extents.x = x_max;
-    glyph.max_extents.y = y_max;
+    Sint16 num_contours = reader.read_s16();
+    glyph.min_extents.x = reader.read_s16();
+    glyph.min_extents.y = reader.read_s16();
+    glyph.max_extents.x = reader.read_s16();
+    glyph.max_extents.y = reader.read_s16();
 
-    glyph.num_end_point_indices = num_contours;
-    glyph.end_point_indices = new Uint32[num_contours];
+    if (num_contours > 0) {
+        decode_simple_glyph(reader, num_contours, glyph);
+    } else if (num_contours < 0) {
+        if (composite_depth == 0) {
+            component_load_count = 0;
+        }
 
-    Uint16 max_contour_end_point_index = 0;
-    for (int i = 0; i < num_contours; i++) {
-        Uint16 contour_end_point_index = read_uint16_from_big_endian_file(font_file_contents, file_location);
-        file_location += 2;
+        composite_chain.push_back(glyph_index);
+        decode_composite_glyph(reader, composite_depth, glyph);
+        composite_chain.pop_back();
+    }
 
-        glyph.end_point_indices[i] = contour_end_point_index;
+    return glyph;
+}
 
+// --------------------------------------------------------------------------
+
+void Font::decode_simple_glyph(BigEndianReader& reader, Sint16 num_contours, Glyph& glyph) {
+    // Contour end points are needed to size the outline, so peek at them
+    // before allocating and read them into place afterwards.
+    size_t end_points_location = reader.get_position();
+    Uint16 max_contour_end_point_index = 0;
+    for (int i = 0; i < num_contours; i++) {
+        Uint16 contour_end_point_index = reader.read_u16();
         if (contour_end_point_index > max_contour_end_point_index) {
             max_contour_end_point_index = contour_end_point_index;
         }
     }
 
     Uint16 num_points = max_contour_end_point_index + 1;
-    glyph.num_points = num_points;
-    glyph.points = new GlyphPoint[num_points];
+    glyph.allocate(&glyph_arena, num_contours, num_points);
+
+    reader.seek(end_points_location);
+    for (int i = 0; i < num_contours; i++) {
+        glyph.end_point_indices[i] = reader.read_u16();
+    }
 
-    Uint16 instruction_length = read_uint16_from_big_endian_file(font_file_contents, file_location);
-    file_location += 2;
+    // The glyph program is only needed for hinting, where GlyphHinter reads
+    // it out of get_glyph_data itself.
+    Uint16 instruction_length = reader.read_u16();
+    reader.skip(instruction_length);
 
-    // We'll skip instructions for now.
-    file_location += instruction_length;
+    // Reused across calls so that steady-state decoding doesn't allocate.
+    thread_local std::vector<Uint8> flags;
+    flags.resize(num_points);
 
-    std::vector<Uint8> flags;
     for (int i = 0; i < num_points; i++) {
-        Uint8 flag = font_file_contents[file_location++];
-        flags.push_back(flag);
-
-        glyph.points[i].is_on_curve = (flag & 0x01) != 0;
+        Uint8 flag = reader.read_u8();
+        flags[i] = flag;
 
         if (flag & 0x08) {
-            Uint16 additional_times_flag_is_repeated = font_file_contents[file_location++];
-            for (int j = 0; j < additional_times_flag_is_repeated; j++) {
-                flags.push_back(flag);
-
-                i++;
-                glyph.points[i].is_on_curve = (flag & 0x01) != 0;
+            Uint16 additional_times_flag_is_repeated = reader.read_u8();
+            for (int j = 0; j < additional_times_flag_is_repeated && i + 1 < num_points; j++) {
+                flags[++i] = flag;
             }
         }
     }
 
-    for (int i = 0; i < num_points; i++) {
-        Uint8 flag = flags[i];
+    pack_on_curve_bits(flags.data(), glyph.on_curve_bits, num_points);
 
-        Sint16 x_coordinate;
-        if (flag & 0x02) {
-            x_coordinate = font_file_contents[file_location++];
+    // Coordinates are stored as deltas from the previous point. Read the
+    // deltas first and turn them into absolute positions in one pass.
+    read_coordinate_deltas(reader, flags.data(), num_points, 0x02, 0x10, glyph.x_coordinates);
+    read_coordinate_deltas(reader, flags.data(), num_points, 0x04, 0x20, glyph.y_coordinates);
 
-            if ((flag & 0x10) == 0) {
-                x_coordinate = -x_coordinate;
-            }
+    prefix_sum_int16(glyph.x_coordinates, num_points);
+    prefix_sum_int16(glyph.y_coordinates, num_points);
+}
+
+// --------------------------------------------------------------------------
+
+void Font::decode_composite_glyph(BigEndianReader& reader, int composite_depth, Glyph& glyph) {
+    // Composites can nest, but not this deep in any real font. Cycles are
+    // caught below; this bounds a long chain of distinct glyphs.
+    if (composite_depth >= MAX_COMPOSITE_DEPTH) {
+        skipped_component_count++;
+        return;
+    }
+
+    struct Component {
+        std::shared_ptr<const Glyph> outline;
+        Uint16 flags;
+        Sint32 argument_1;
+        Sint32 argument_2;
+        float xx;
+        float xy;
+        float yx;
+        float yy;
+    };
+
+    // Components are gathered first so the outline can be sized before any
+    // storage is taken from the arena.
+    thread_local std::vector<Component> components_scratch;
+    size_t first_component = components_scratch.size();
+
+    int total_points = 0;
+    int total_contours = 0;
+
+    Uint16 flags;
+    do {
+        Component component;
+        flags = reader.read_u16();
+        Uint16 component_glyph_index = reader.read_u16();
+
+        bool are_arguments_words = (flags & COMPOSITE_ARG_1_AND_2_ARE_WORDS) != 0;
+        bool are_arguments_offsets = (flags & COMPOSITE_ARGS_ARE_XY_VALUES) != 0;
+        if (are_arguments_words) {
+            component.argument_1 = are_arguments_offsets ? reader.read_s16() : reader.read_u16();
+            component.argument_2 = are_arguments_offsets ? reader.read_s16() : reader.read_u16();
         } else {
-            if ((flag & 0x10)) {
-                x_coordinate = 0;
-            } else {
-                x_coordinate = read_uint16_from_big_endian_file(font_file_contents, file_location);
-                file_location += 2;
-            }
+            component.argument_1 = are_arguments_offsets ? reader.read_s8() : reader.read_u8();
+            component.argument_2 = are_arguments_offsets ? reader.read_s8() : reader.read_u8();
         }
 
-        if (i == 0) {
-            glyph.points[i].x = x_coordinate;
-        } else {
-            glyph.points[i].x = glyph.points[i - 1].x + x_coordinate;
+        component.xx = 1.0f;
+        component.xy = 0.0f;
+        component.yx = 0.0f;
+        component.yy = 1.0f;
+        if (flags & COMPOSITE_WE_HAVE_A_SCALE) {
+            component.xx = read_f2dot14(reader);
+            component.yy = component.xx;
+        } else if (flags & COMPOSITE_WE_HAVE_AN_X_AND_Y_SCALE) {
+            component.xx = read_f2dot14(reader);
+            component.yy = read_f2dot14(reader);
+        } else if (flags & COMPOSITE_WE_HAVE_A_TWO_BY_TWO) {
+            component.xx = read_f2dot14(reader);
+            component.xy = read_f2dot14(reader);
+            component.yx = read_f2dot14(reader);
+            component.yy = read_f2dot14(reader);
+        }
+
+        component.flags = flags;
+
+        bool is_cycle = std::find(composite_chain.begin(), composite_chain.end(), component_glyph_index) != composite_chain.end();
+        if (is_cycle || component_load_count >= MAX_COMPONENT_LOADS) {
+            skipped_component_count++;
+            continue;
         }
+
+        component_load_count++;
+        component.outline = get_component_glyph(component_glyph_index, composite_depth + 1);
+
+        total_points += component.outline->num_points;
+        total_contours += component.outline->num_end_point_indices;
+        components_scratch.push_back(std::move(component));
+    } while (flags & COMPOSITE_MORE_COMPONENTS);
+
+    // Composite instructions follow the last component; like a simple
+    // glyph's they are left to GlyphHinter.
+
+    if (total_points > 0xFFFF || total_contours > 0xFFFF) {
+        total_points = 0;
+        total_contours = 0;
     }
 
-    for (int i = 0; i < num_points; i++) {
-        Uint8 flag = flags[i];
+    glyph.allocate(&glyph_arena, total_contours, total_points);
+
+    thread_local std::vector<Uint8> flags_scratch;
+    flags_scratch.assign(total_points, 0);
+
+    int point_offset = 0;
+    int contour_offset = 0;
+    for (size_t i = first_component; i < components_scratch.size() && total_points > 0; i++) {
+        const Component& component = components_scratch[i];
+        const Glyph& outline = *component.outline;
+
+        bool has_transform = component.xx != 1.0f || component.xy != 0.0f || component.yx != 0.0f || component.yy != 1.0f;
 
-        Sint16 y_coordinate;
-        if (flag & 0x04) {
-            y_coordinate = font_file_contents[file_location++];
+        float offset_x = 0.0f;
+        float offset_y = 0.0f;
+        if (component.flags & COMPOSITE_ARGS_ARE_XY_VALUES) {
+            offset_x = static_cast<float>(component.argument_1);
+            offset_y = static_cast<float>(component.argument_2);
 
-            if ((flag & 0x20) == 0) {
-                y_coordinate = -y_coordinate;
+            // Apple-style fonts scale the offset along with the outline.
+            if (has_transform && (component.flags & COMPOSITE_SCALED_COMPONENT_OFFSET) && !(component.flags & COMPOSITE_UNSCALED_COMPONENT_OFFSET)) {
+                float scaled_x = component.xx * offset_x + component.yx * offset_y;
+                float scaled_y = component.xy * offset_x + component.yy * offset_y;
+                offset_x = scaled_x;
+                offset_y = scaled_y;
             }
         } else {
-            if ((flag & 0x20)) {
-                y_coordinate = 0;
-            } else {
-                y_coordinate = read_uint16_from_big_endian_file(font_file_contents, file_location);
-                file_location += 2;
+            // Point matching: line up a point already placed in this glyph
+            // with a point of the transformed component.
+            int parent_point = component.argument_1;
+            int child_point = component.argument_2;
+            if (parent_point < point_offset && child_point < outline.num_points) {
+                float child_x = component.xx * outline.x_coordinates[child_point] + component.yx * outline.y_coordinates[child_point];
+                float child_y = component.xy * outline.x_coordinates[child_point] + component.yy * outline.y_coordinates[child_point];
+                offset_x = glyph.x_coordinates[parent_point] - child_x;
+                offset_y = glyph.y_coordinates[parent_point] - child_y;
             }
         }
 
-        if (i == 0) {
-            glyph.points[i].y = y_coordinate;
-        } else {
-            glyph.points[i].y = glyph.points[i - 1].y + y_coordinate;
+        for (int j = 0; j < outline.num_points; j++) {
+            float x = outline.x_coordinates[j];
+            float y = outline.y_coordinates[j];
+            if (has_transform) {
+                float transformed_x = component.xx * x + component.yx * y;
+                float transformed_y = component.xy * x + component.yy * y;
+                x = transformed_x;
+                y = transformed_y;
+            }
+
+            glyph.x_coordinates[point_offset + j] = static_cast<Sint16>(std::floor(x + offset_x + 0.5f));
+            glyph.y_coordinates[point_offset + j] = static_cast<Sint16>(std::floor(y + offset_y + 0.5f));
+            flags_scratch[point_offset + j] = outline.is_on_curve(j) ? 0x01 : 0x00;
         }
+
+        for (int j = 0; j < outline.num_end_point_indices; j++) {
+            glyph.end_point_indices[contour_offset + j] = static_cast<Uint16>(outline.end_point_indices[j] + point_offset);
+        }
+
+        point_offset += outline.num_points;
+        contour_offset += outline.num_end_point_indices;
     }
 
-    return glyph;
+    pack_on_curve_bits(flags_scratch.data(), glyph.on_curve_bits, total_points);
+
+    components_scratch.resize(first_component);
+}
+
+// --------------------------------------------------------------------------
+
+float Font::read_f2dot14(BigEndianReader& reader) {
+    return reader.read_s16() / 16384.0f;
+}
+
+// --------------------------------------------------------------------------
+
+std::shared_ptr<const Glyph> Font::get_component_glyph(Uint16 glyph_index, int composite_depth) {
+    bool should_cache;
+    {
+        std::lock_guard<std::mutex> lock(component_cache_mutex);
+
+        should_cache = is_component_cache_enabled;
+        if (should_cache) {
+            auto cached_component = component_cache.find(glyph_index);
+            if (cached_component != component_cache.end()) {
+                component_cache_hit_count++;
+                return cached_component->second;
+            }
+
+            component_cache_miss_count++;
+        }
+    }
+
+    Uint64 skipped_before = skipped_component_count;
+    std::shared_ptr<const Glyph> component = std::make_shared<Glyph>(decode_glyph(glyph_index, composite_depth));
+
+    // The cache may have been turned off while this was decoding. A decode
+    // that left components out isn't the glyph's full outline.
+    if (should_cache && skipped_component_count == skipped_before) {
+        std::lock_guard<std::mutex> lock(component_cache_mutex);
+        if (is_component_cache_enabled) {
+            component_cache.emplace(glyph_index, component);
+        }
+    }
+
+    return component;
+}
+
+// --------------------------------------------------------------------------
+
+void Font::set_component_cache_enabled(bool is_enabled) {
+    std::lock_guard<std::mutex> lock(component_cache_mutex);
+
+    is_component_cache_enabled = is_enabled;
+    if (!is_enabled) {
+        component_cache.clear();
+    }
+}
+
+// --------------------------------------------------------------------------
+
+Uint64 Font::get_component_cache_hit_count() {
+    std::lock_guard<std::mutex> lock(component_cache_mutex);
+    return component_cache_hit_count;
+}
+
+// --------------------------------------------------------------------------
+
+Uint64 Font::get_component_cache_miss_count() {
+    std::lock_guard<std::mutex> lock(component_cache_mutex);
+    return component_cache_miss_count;
 }
 
 // --------------------------------------------------------------------------
 
-void Font::print_table_metadata(const Offset_subtable& offset_subtable, const Table* tables) {
+void Font::print_table_metadata(const TableDirectory& directory) {
+    const TableDirectory::Header& header = directory.get_header();
     std::cout << "Font directory:" << std::endl;
-    std::cout << "Scalar type: " << offset_subtable.scaler_type << std::endl;
-    std::cout << "Number of tables: " << offset_subtable.num_tables << std::endl;
-    std::cout << "Search range: " << offset_subtable.search_range << std::endl;
-    std::cout << "Entry selector: " << offset_subtable.entry_selector << std::endl;
-    std::cout << "Range shift: " << offset_subtable.range_shift << std::endl;
+    std::cout << "Scalar type: " << header.scaler_type << std::endl;
+    std::cout << "Number of tables: " << header.num_tables << std::endl;
+    std::cout << "Search range: " << header.search_range << std::endl;
+    std::cout << "Entry selector: " << header.entry_selector << std::endl;
+    std::cout << "Range shift: " << header.range_shift << std::endl;
     std::cout << "--------------------------------------------------------------------------" << std::endl;
 
-    for (int i = 0; i < offset_subtable.num_tables; i++) {
+    const std::vector<TableDirectory::Entry>& entries = directory.get_entries();
+    for (size_t i = 0; i < entries.size(); i++) {
         std::cout << "Table " << i + 1 << ": ";
-        std::cout << "Tag: " << tables[i].tag << "    ";
-        std::cout << "Checksum: " << tables[i].checksum << "    ";
-        std::cout << "Offset: " << tables[i].offset << "    ";
-        std::cout << "Length: " << tables[i].length << std::endl;
+        std::cout << "Tag: " << BigEndianReader::tag_to_string(entries[i].tag) << "    ";
+        std::cout << "Checksum: " << entries[i].checksum << "    ";
+        std::cout << "Offset: " << entries[i].offset << "    ";
+        std::cout << "Length: " << entries[i].length << std::endl;
     }
 }
@@ -4,7 +4,20 @@
 #include <SDL3/SDL.h>
 #include <string>
 #include <vector>
-#include <map>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+#include "CharacterMap.h"
+#include "FontFile.h"
+#include "FontValidation.h"
+#include "GlyphArena.h"
+#include "HorizontalMetrics.h"
+#include "KerningTable.h"
+#include "LocaTable.h"
+#include "TableDirectory.h"
+
+class BigEndianReader;
 
 struct Coordinate {
     Sint16 x;
@@ -17,18 +30,47 @@ struct GlyphPoint {
     bool is_on_curve;
 };
 
+// Outlines are stored as structure-of-arrays: x and y coordinates in their own
+// contiguous Sint16 arrays and the on-curve flags packed one bit per point.
+// Storage is borrowed from the font's GlyphArena and handed back when the glyph
+// is destroyed, so a Glyph must not outlive the Font it came from.
 struct Glyph {
     Coordinate min_extents;
     Coordinate max_extents;
     Uint16 num_end_point_indices;
-    Uint32* end_point_indices;
+    Uint16* end_point_indices;
     Uint16 num_points;
-    GlyphPoint* points;
+    Sint16* x_coordinates;
+    Sint16* y_coordinates;
+    Uint8* on_curve_bits;
+
+    Glyph();
+    ~Glyph();
+
+    Glyph(Glyph&& other);
+    Glyph& operator=(Glyph&& other);
+
+    Glyph(const Glyph&) = delete;
+    Glyph& operator=(const Glyph&) = delete;
+
+    void allocate(GlyphArena* arena, Uint16 num_end_point_indices, Uint16 num_points);
+    void release();
+
+    size_t get_memory_size() const;
+
+    bool is_on_curve(int point_index) const {
+        return ((on_curve_bits[point_index >> 3] >> (point_index & 7)) & 0x01) != 0;
+    }
 
-    void destroy() {
-        delete[] end_point_indices;
-        delete[] points;
+    GlyphPoint get_point(int point_index) const {
+        return {x_coordinates[point_index], y_coordinates[point_index], is_on_curve(point_index)};
     }
+
+private:
+
+    GlyphArena* arena;
+    Uint8* storage;
+    size_t storage_size;
 };
 
 // --------------------------------------------------------------------------
@@ -37,39 +79,128 @@ class Font {
 
 public:
 
-    Font(const std::string& font_file_name);
-    ~Font();
+    using LoadMode = FontFile::LoadMode;
+
+    // Opens the first face of the file.
+    Font(
+        const std::string& font_file_name,
+        LoadMode load_mode = LoadMode::MEMORY_MAPPED,
+        LocaTable::Mode loca_mode = LocaTable::Mode::LAZY
+    );
+
+    // Opens one face of an already open file, typically one of several faces
+    // of a collection that all share it.
+    Font(std::shared_ptr<FontFile> file, int face_index, LocaTable::Mode loca_mode = LocaTable::Mode::LAZY);
+
+    int get_face_index();
+    const std::shared_ptr<FontFile>& get_file();
 
     Uint16 get_glyph_count();
+    Uint16 get_units_per_em();
     Glyph get_glyph(Uint16 glyph_index);
 
+    // The glyph's raw glyf record, checked the same way get_glyph checks it,
+    // or nullptr with length 0 if it has none or it failed the check. The
+    // bytes live as long as the font's file.
+    const Uint8* get_glyph_data(Uint16 glyph_index, Uint32& length);
+
+    // Glyph for a Unicode codepoint through the font's cmap, 0 if unmapped.
+    Uint16 get_glyph_index(Uint32 codepoint);
+    const CharacterMap& get_character_map();
+
+    // Horizontal metrics from hhea, hmtx and kern, all in font units.
+    // Descender is negative below the baseline.
+    Sint16 get_ascender();
+    Sint16 get_descender();
+    Sint16 get_line_gap();
+    Uint16 get_advance_width(Uint16 glyph_index);
+    Sint16 get_left_side_bearing(Uint16 glyph_index);
+    Sint16 get_kerning(Uint16 left_glyph_index, Uint16 right_glyph_index);
+    size_t get_kerning_pair_count();
+
+    // Whether the font passed validation when it was opened. Glyphs of a
+    // trusted font are decoded without bounds checks; anything else has each
+    // glyph record checked first and gets an empty glyph if it fails.
+    bool is_trusted();
+    const FontValidationReport& get_validation_report();
+
+    // 64-bit hash of the whole font file, computed on first use, with
+    // the face index folded in for faces after the first. Used to key
+    // on-disk caches derived from the font.
+    Uint64 get_content_hash();
+
+    GlyphArena& get_glyph_arena();
+
+    // Components of composite glyphs are decoded once and shared by every
+    // composite that references them. Turning the cache off also empties it.
+    // It isn't bounded: it holds at most one outline per glyph some composite
+    // references, which is a fraction of the glyphs, each no bigger than the
+    // glyph's own decoded points.
+    void set_component_cache_enabled(bool is_enabled);
+    Uint64 get_component_cache_hit_count();
+    Uint64 get_component_cache_miss_count();
+
 private:
 
-    struct Table {
-        std::string tag;
-        Uint32 checksum;
-        Uint32 offset;
-        Uint32 length;
-    };
+    std::shared_ptr<FontFile> file;
+    int face_index;
 
-    struct Offset_subtable {
-        Uint32 scaler_type;
-        Uint16 num_tables;
-        Uint16 search_range;
-        Uint16 entry_selector;
-        Uint16 range_shift;
-    };
+    // The file's data, cached here for the decoder.
+    const Uint8* font_data;
+    size_t font_data_size;
 
-    std::vector<Uint8> font_file_contents;
-    std::map<std::string, Uint32> table_name_to_offset;
+    FontValidationReport validation_report;
+    bool is_trusted_font;
 
     Uint16 glyph_count;
-    Uint32* glyph_offsets;
-
-    void initialize(const std::string& font_file_name);
-    Uint32 read_uint32_from_big_endian_file(const std::vector<Uint8> file_contents, int location);
-    Uint16 read_uint16_from_big_endian_file(const std::vector<Uint8> file_contents, int location);
-    void print_table_metadata(const Offset_subtable& offset_subtable, const Table* tables);
+    Uint16 units_per_em;
+    Uint32 glyf_table_offset;
+    Uint32 glyf_table_length;
+    LocaTable loca_table;
+
+    // Shared with any other face of the same file that uses the same tables.
+    std::shared_ptr<const CharacterMap> character_map;
+    std::shared_ptr<const HorizontalMetrics> horizontal_metrics;
+    std::shared_ptr<const KerningTable> kerning_table;
+
+    GlyphArena glyph_arena;
+
+    std::mutex component_cache_mutex;
+    std::unordered_map<Uint16, std::shared_ptr<const Glyph>> component_cache;
+    bool is_component_cache_enabled;
+    Uint64 component_cache_hit_count;
+    Uint64 component_cache_miss_count;
+
+    static const int MAX_COMPOSITE_DEPTH = 8;
+
+    // Components decoded for one top-level glyph, cached or not, after which
+    // the rest are left out. Real composites need a handful.
+    static const int MAX_COMPONENT_LOADS = 1024;
+
+    static const Uint16 COMPOSITE_ARG_1_AND_2_ARE_WORDS = 0x0001;
+    static const Uint16 COMPOSITE_ARGS_ARE_XY_VALUES = 0x0002;
+    static const Uint16 COMPOSITE_WE_HAVE_A_SCALE = 0x0008;
+    static const Uint16 COMPOSITE_MORE_COMPONENTS = 0x0020;
+    static const Uint16 COMPOSITE_WE_HAVE_AN_X_AND_Y_SCALE = 0x0040;
+    static const Uint16 COMPOSITE_WE_HAVE_A_TWO_BY_TWO = 0x0080;
+    static const Uint16 COMPOSITE_SCALED_COMPONENT_OFFSET = 0x0800;
+    static const Uint16 COMPOSITE_UNSCALED_COMPONENT_OFFSET = 0x1000;
+
+    void initialize(LocaTable::Mode loca_mode);
+    Glyph decode_glyph(Uint16 glyph_index, int composite_depth);
+    void decode_simple_glyph(BigEndianReader& reader, Sint16 num_contours, Glyph& glyph);
+    void decode_composite_glyph(BigEndianReader& reader, int composite_depth, Glyph& glyph);
+    std::shared_ptr<const Glyph> get_component_glyph(Uint16 glyph_index, int composite_depth);
+    static float read_f2dot14(BigEndianReader& reader);
+    static void read_coordinate_deltas(
+        BigEndianReader& reader,
+        const Uint8* flags,
+        Uint16 num_points,
+        Uint8 is_short_flag,
+        Uint8 is_same_or_positive_flag,
+        Sint16* deltas
+    );
+    void print_table_metadata(const TableDirectory& directory);
 };
 
 #endif
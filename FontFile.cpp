@@ -0,0 +1,279 @@
+#include "FontFile.h"
+
+#include "BigEndianReader.h"
+
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <utility>
+
+namespace {
+    const Uint64 HASH_PRIME_1 = 0x9E3779B185EBCA87ULL;
+    const Uint64 HASH_PRIME_2 = 0xC2B2AE3D27D4EB4FULL;
+    const Uint64 HASH_PRIME_3 = 0x165667B19E3779F9ULL;
+    const Uint64 HASH_PRIME_4 = 0x85EBCA77C2B2AE63ULL;
+
+    Uint64 rotate_left(Uint64 value, int bits) {
+        return (value << bits) | (value >> (64 - bits));
+    }
+
+    Uint64 mix_word(Uint64 lane, Uint64 word) {
+        return rotate_left(lane + word * HASH_PRIME_2, 31) * HASH_PRIME_1;
+    }
+
+    Uint64 avalanche(Uint64 hash) {
+        hash ^= hash >> 33;
+        hash *= HASH_PRIME_2;
+        hash ^= hash >> 29;
+        hash *= HASH_PRIME_3;
+        hash ^= hash >> 32;
+        return hash;
+    }
+
+    Uint64 read_word(const Uint8* bytes) {
+        Uint64 word;
+        std::memcpy(&word, bytes, sizeof(word));
+        return word;
+    }
+
+    // Four independent lanes of 8-byte words, so the multiplies overlap
+    // instead of waiting on each other a byte at a time, then folded together
+    // and avalanched. Words are read in host byte order; the hash only keys
+    // caches on this machine.
+    Uint64 calculate_content_hash(const Uint8* data, size_t size) {
+        Uint64 lanes[4] = {
+            HASH_PRIME_1 + HASH_PRIME_2,
+            HASH_PRIME_2,
+            0,
+            0 - HASH_PRIME_1,
+        };
+
+        size_t position = 0;
+        for (; position + 32 <= size; position += 32) {
+            lanes[0] = mix_word(lanes[0], read_word(data + position));
+            lanes[1] = mix_word(lanes[1], read_word(data + position + 8));
+            lanes[2] = mix_word(lanes[2], read_word(data + position + 16));
+            lanes[3] = mix_word(lanes[3], read_word(data + position + 24));
+        }
+
+        Uint64 hash = rotate_left(lanes[0], 1) + rotate_left(lanes[1], 7) + rotate_left(lanes[2], 12) + rotate_left(lanes[3], 18);
+        hash += static_cast<Uint64>(size);
+
+        for (; position + 8 <= size; position += 8) {
+            hash = rotate_left(hash ^ mix_word(0, read_word(data + position)), 27) * HASH_PRIME_1 + HASH_PRIME_4;
+        }
+
+        for (; position < size; position++) {
+            hash = rotate_left(hash ^ (data[position] * HASH_PRIME_3), 11) * HASH_PRIME_1;
+        }
+
+        return avalanche(hash);
+    }
+}
+
+FontFile::FontFile()
+    : data(nullptr),
+      size(0),
+      is_ttc(false),
+      validation_ms(0.0),
+      content_hash(0),
+      cache_key(0) {
+}
+
+// --------------------------------------------------------------------------
+
+std::shared_ptr<FontFile> FontFile::open(const std::string& file_name, LoadMode load_mode) {
+    std::shared_ptr<FontFile> file(new FontFile());
+
+    if (!file->contents.open(file_name, load_mode == LoadMode::MEMORY_MAPPED)) {
+        return nullptr;
+    }
+
+    file->read_table_directories();
+
+    std::error_code error;
+    std::filesystem::file_time_type modification_time = std::filesystem::last_write_time(file_name, error);
+    file->cache_key = file->calculate_cache_key(error ? 0 : static_cast<Sint64>(modification_time.time_since_epoch().count()));
+
+    return file;
+}
+
+// --------------------------------------------------------------------------
+
+std::shared_ptr<FontFile> FontFile::open(std::vector<Uint8> contents) {
+    std::shared_ptr<FontFile> file(new FontFile());
+
+    if (!file->contents.open(std::move(contents))) {
+        return nullptr;
+    }
+
+    file->read_table_directories();
+    file->cache_key = file->calculate_cache_key(0);
+
+    return file;
+}
+
+// --------------------------------------------------------------------------
+
+void FontFile::read_table_directories() {
+    data = contents.get_data();
+    size = contents.get_size();
+
+    is_ttc = size >= 4 && BigEndianReader(data, size).peek_u32(0) == TableTag::TTCF;
+
+    std::vector<Uint32> face_offsets = TableDirectory::read_face_offsets(data, size);
+    table_directories.resize(face_offsets.size());
+    for (size_t i = 0; i < face_offsets.size(); i++) {
+        table_directories[i].read(data, size, face_offsets[i]);
+    }
+}
+
+// --------------------------------------------------------------------------
+
+void FontFile::validate() {
+    std::call_once(validation_flag, [this]() {
+        auto validation_start = std::chrono::steady_clock::now();
+        validation_reports = validate_font_file(data, size);
+        validation_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - validation_start).count();
+    });
+}
+
+// --------------------------------------------------------------------------
+
+const Uint8* FontFile::get_data() const {
+    return data;
+}
+
+// --------------------------------------------------------------------------
+
+size_t FontFile::get_size() const {
+    return size;
+}
+
+// --------------------------------------------------------------------------
+
+bool FontFile::is_collection() const {
+    return is_ttc;
+}
+
+// --------------------------------------------------------------------------
+
+int FontFile::get_face_count() const {
+    return static_cast<int>(table_directories.size());
+}
+
+// --------------------------------------------------------------------------
+
+const TableDirectory& FontFile::get_table_directory(int face_index) const {
+    return table_directories[face_index];
+}
+
+// --------------------------------------------------------------------------
+
+const FontValidationReport& FontFile::get_validation_report(int face_index) {
+    validate();
+    return validation_reports[face_index];
+}
+
+// --------------------------------------------------------------------------
+
+double FontFile::get_validation_ms() {
+    validate();
+    return validation_ms;
+}
+
+// --------------------------------------------------------------------------
+
+Uint64 FontFile::calculate_cache_key(Sint64 modification_time) const {
+    Uint64 hash = mix_word(HASH_PRIME_4, static_cast<Uint64>(size));
+    hash = mix_word(hash, static_cast<Uint64>(modification_time));
+
+    for (const TableDirectory& table_directory : table_directories) {
+        for (const TableDirectory::Entry& entry : table_directory.get_entries()) {
+            hash = mix_word(hash, (static_cast<Uint64>(entry.tag) << 32) | entry.checksum);
+            hash = mix_word(hash, (static_cast<Uint64>(entry.offset) << 32) | entry.length);
+        }
+
+        // Tools that edit a font without touching its directory still
+        // rewrite head's checksum adjustment.
+        const TableDirectory::Entry* head = table_directory.find(TableTag::HEAD);
+        if (head != nullptr && head->length >= 12 && static_cast<size_t>(head->offset) + 12 <= size) {
+            hash = mix_word(hash, BigEndianReader(data, size).peek_u32(head->offset + 8));
+        }
+    }
+
+    return avalanche(hash);
+}
+
+// --------------------------------------------------------------------------
+
+Uint64 FontFile::get_cache_key() const {
+    return cache_key;
+}
+
+// --------------------------------------------------------------------------
+
+Uint64 FontFile::get_content_hash() {
+    std::call_once(content_hash_flag, [this]() {
+        content_hash = calculate_content_hash(data, size);
+    });
+
+    return content_hash;
+}
+
+// --------------------------------------------------------------------------
+
+std::shared_ptr<const CharacterMap> FontFile::get_character_map(const TableDirectory::Entry* cmap, Uint16 glyph_count) {
+    std::lock_guard<std::mutex> lock(shared_tables_mutex);
+
+    std::pair<Uint32, Uint16> key(cmap != nullptr ? cmap->offset : 0, glyph_count);
+    std::shared_ptr<const CharacterMap>& character_map = character_maps[key];
+    if (character_map == nullptr) {
+        std::shared_ptr<CharacterMap> new_character_map = std::make_shared<CharacterMap>();
+        if (cmap != nullptr) {
+            new_character_map->initialize(data + cmap->offset, cmap->length, glyph_count);
+        }
+        character_map = new_character_map;
+    }
+
+    return character_map;
+}
+
+// --------------------------------------------------------------------------
+
+std::shared_ptr<const KerningTable> FontFile::get_kerning_table(const TableDirectory::Entry* kern) {
+    std::lock_guard<std::mutex> lock(shared_tables_mutex);
+
+    std::shared_ptr<const KerningTable>& kerning_table = kerning_tables[kern != nullptr ? kern->offset : 0];
+    if (kerning_table == nullptr) {
+        std::shared_ptr<KerningTable> new_kerning_table = std::make_shared<KerningTable>();
+        if (kern != nullptr) {
+            new_kerning_table->initialize(data + kern->offset, kern->length);
+        }
+        kerning_table = new_kerning_table;
+    }
+
+    return kerning_table;
+}
+
+// --------------------------------------------------------------------------
+
+std::shared_ptr<const HorizontalMetrics> FontFile::get_horizontal_metrics(const TableDirectory::Entry* hhea, const TableDirectory::Entry* hmtx, Uint16 glyph_count) {
+    std::lock_guard<std::mutex> lock(shared_tables_mutex);
+
+    std::tuple<Uint32, Uint32, Uint16> key(hhea != nullptr ? hhea->offset : 0, hmtx != nullptr ? hmtx->offset : 0, glyph_count);
+    std::shared_ptr<const HorizontalMetrics>& metrics = horizontal_metrics[key];
+    if (metrics == nullptr) {
+        std::shared_ptr<HorizontalMetrics> new_metrics = std::make_shared<HorizontalMetrics>();
+        new_metrics->initialize(
+            hhea != nullptr ? data + hhea->offset : nullptr,
+            hhea != nullptr ? hhea->length : 0,
+            hmtx != nullptr ? data + hmtx->offset : nullptr,
+            hmtx != nullptr ? hmtx->length : 0,
+            glyph_count
+        );
+        metrics = new_metrics;
+    }
+
+    return metrics;
+}
@@ -0,0 +1,102 @@
+#ifndef FONT_FILE_H
+#define FONT_FILE_H
+
+#include <SDL3/SDL.h>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "CharacterMap.h"
+#include "FontValidation.h"
+#include "HorizontalMetrics.h"
+#include "KerningTable.h"
+#include "MappedFile.h"
+#include "TableDirectory.h"
+
+// The bytes of a font file, either a single font or a TrueType collection,
+// and everything about them that doesn't depend on which face is open. Every
+// face of a collection is read through the one mapping. Opening a file only
+// reads its table directories; it is validated once, the first time a face
+// asks for its report. Tables that faces share are parsed once and the
+// result is handed to every face that asks for the same bytes.
+class FontFile {
+
+public:
+
+    enum LoadMode {
+        MEMORY_MAPPED,
+        BUFFERED,
+    };
+
+    // Null if the file can't be read.
+    static std::shared_ptr<FontFile> open(const std::string& file_name, LoadMode load_mode = LoadMode::MEMORY_MAPPED);
+
+    // Opens a font that is already in memory. Its cache key has no
+    // modification time to go on. Null if contents is empty.
+    static std::shared_ptr<FontFile> open(std::vector<Uint8> contents);
+
+    FontFile(const FontFile&) = delete;
+    FontFile& operator=(const FontFile&) = delete;
+
+    const Uint8* get_data() const;
+    size_t get_size() const;
+
+    bool is_collection() const;
+    int get_face_count() const;
+    const TableDirectory& get_table_directory(int face_index) const;
+
+    // Validates the whole file on first use.
+    const FontValidationReport& get_validation_report(int face_index);
+    double get_validation_ms();
+
+    // 64-bit hash of the whole file, computed on first use. It reads every
+    // page of the file.
+    Uint64 get_content_hash();
+
+    // A cheap stand-in for the content hash, worked out when the file is
+    // opened from its size, its modification time and the table directories'
+    // checksums, including head's checksum adjustment. Keys on-disk caches
+    // that have to be found before the rest of the file is paged in.
+    Uint64 get_cache_key() const;
+
+    // Parsed tables, shared by every face whose directory points at the same
+    // table. Missing tables come back empty rather than null.
+    std::shared_ptr<const CharacterMap> get_character_map(const TableDirectory::Entry* cmap, Uint16 glyph_count);
+    std::shared_ptr<const KerningTable> get_kerning_table(const TableDirectory::Entry* kern);
+    std::shared_ptr<const HorizontalMetrics> get_horizontal_metrics(const TableDirectory::Entry* hhea, const TableDirectory::Entry* hmtx, Uint16 glyph_count);
+
+private:
+
+    MappedFile contents;
+    const Uint8* data;
+    size_t size;
+
+    bool is_ttc;
+    std::vector<TableDirectory> table_directories;
+
+    std::once_flag validation_flag;
+    std::vector<FontValidationReport> validation_reports;
+    double validation_ms;
+
+    std::once_flag content_hash_flag;
+    Uint64 content_hash;
+    Uint64 cache_key;
+
+    // Keyed by table offset, plus the glyph count where that changes the
+    // result.
+    std::mutex shared_tables_mutex;
+    std::map<std::pair<Uint32, Uint16>, std::shared_ptr<const CharacterMap>> character_maps;
+    std::map<Uint32, std::shared_ptr<const KerningTable>> kerning_tables;
+    std::map<std::tuple<Uint32, Uint32, Uint16>, std::shared_ptr<const HorizontalMetrics>> horizontal_metrics;
+
+    FontFile();
+
+    void read_table_directories();
+    void validate();
+    Uint64 calculate_cache_key(Sint64 modification_time) const;
+};
+
+#endif
@@ -0,0 +1,350 @@
+#include "FontValidation.h"
+
+#include "BigEndianReader.h"
+#include "TableDirectory.h"
+
+#include <map>
+#include <tuple>
+#include <utility>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+namespace {
+    const size_t GLYPH_HEADER_SIZE = 10;
+
+    const Uint16 COMPOSITE_ARG_1_AND_2_ARE_WORDS = 0x0001;
+    const Uint16 COMPOSITE_WE_HAVE_A_SCALE = 0x0008;
+    const Uint16 COMPOSITE_MORE_COMPONENTS = 0x0020;
+    const Uint16 COMPOSITE_WE_HAVE_AN_X_AND_Y_SCALE = 0x0040;
+    const Uint16 COMPOSITE_WE_HAVE_A_TWO_BY_TWO = 0x0080;
+
+    struct GlyphDataKey {
+        Uint32 loca_offset;
+        Uint32 loca_length;
+        Uint32 glyf_offset;
+        Uint32 glyf_length;
+        Uint16 glyph_count;
+        bool are_offsets_short;
+
+        bool operator<(const GlyphDataKey& other) const {
+            return
+                std::tie(loca_offset, loca_length, glyf_offset, glyf_length, glyph_count, are_offsets_short) <
+                std::tie(other.loca_offset, other.loca_length, other.glyf_offset, other.glyf_length, other.glyph_count, other.are_offsets_short)
+            ;
+        }
+    };
+
+    bool validate_simple_glyph(BigEndianReader& reader, Sint16 num_contours) {
+        size_t length = reader.get_size();
+        if (reader.get_position() + 2 * static_cast<size_t>(num_contours) + 2 > length) {
+            return false;
+        }
+
+        // End points must be strictly increasing, and the last one defines
+        // the point count, which has to fit in a Uint16.
+        Sint32 previous_end_point_index = -1;
+        for (int i = 0; i < num_contours; i++) {
+            Sint32 end_point_index = reader.read_u16();
+            if (end_point_index <= previous_end_point_index) {
+                return false;
+            }
+            previous_end_point_index = end_point_index;
+        }
+
+        if (previous_end_point_index >= 0xFFFF) {
+            return false;
+        }
+
+        size_t num_points = static_cast<size_t>(previous_end_point_index) + 1;
+
+        Uint16 instruction_length = reader.read_u16();
+        if (reader.get_position() + instruction_length > length) {
+            return false;
+        }
+        reader.skip(instruction_length);
+
+        // Walk the flags the same way the decoder does and add up how many
+        // coordinate bytes they call for.
+        size_t coordinate_byte_count = 0;
+        for (size_t i = 0; i < num_points; i++) {
+            if (reader.get_position() >= length) {
+                return false;
+            }
+
+            Uint8 flag = reader.read_u8();
+            size_t repeat_count = 1;
+            if (flag & 0x08) {
+                if (reader.get_position() >= length) {
+                    return false;
+                }
+
+                repeat_count += reader.read_u8();
+                if (repeat_count > num_points - i) {
+                    repeat_count = num_points - i;
+                }
+            }
+
+            size_t x_size = (flag & 0x02) ? 1 : ((flag & 0x10) ? 0 : 2);
+            size_t y_size = (flag & 0x04) ? 1 : ((flag & 0x20) ? 0 : 2);
+            coordinate_byte_count += (x_size + y_size) * repeat_count;
+            i += repeat_count - 1;
+        }
+
+        return reader.get_position() + coordinate_byte_count <= length;
+    }
+
+    bool validate_composite_glyph(BigEndianReader& reader, Uint16 glyph_count) {
+        size_t length = reader.get_size();
+
+        Uint16 flags;
+        do {
+            if (reader.get_position() + 4 > length) {
+                return false;
+            }
+
+            flags = reader.read_u16();
+            Uint16 component_glyph_index = reader.read_u16();
+            if (component_glyph_index >= glyph_count) {
+                return false;
+            }
+
+            size_t record_size = (flags & COMPOSITE_ARG_1_AND_2_ARE_WORDS) ? 4 : 2;
+            if (flags & COMPOSITE_WE_HAVE_A_SCALE) {
+                record_size += 2;
+            } else if (flags & COMPOSITE_WE_HAVE_AN_X_AND_Y_SCALE) {
+                record_size += 4;
+            } else if (flags & COMPOSITE_WE_HAVE_A_TWO_BY_TWO) {
+                record_size += 8;
+            }
+
+            if (reader.get_position() + record_size > length) {
+                return false;
+            }
+            reader.skip(record_size);
+        } while (flags & COMPOSITE_MORE_COMPONENTS);
+
+        return true;
+    }
+
+    // loca must have an entry for every glyph plus one, with offsets that
+    // never go backwards or past the end of glyf. Returns false if it
+    // doesn't; otherwise counts the glyph records that fail validation.
+    bool validate_glyph_data(
+        const Uint8* font_data,
+        const TableDirectory::Entry& loca,
+        const TableDirectory::Entry& glyf,
+        Uint16 glyph_count,
+        bool are_offsets_short,
+        Uint32& invalid_glyph_count
+    ) {
+        invalid_glyph_count = 0;
+
+        size_t entry_size = are_offsets_short ? 2 : 4;
+        size_t entry_count = static_cast<size_t>(glyph_count) + 1;
+        if (loca.length < entry_count * entry_size) {
+            return false;
+        }
+
+        BigEndianReader reader(font_data + loca.offset, loca.length);
+        auto read_loca_entry = [&](size_t entry_index) -> size_t {
+            if (are_offsets_short) {
+                return static_cast<size_t>(reader.peek_u16(entry_index * 2)) * 2;
+            }
+            return reader.peek_u32(entry_index * 4);
+        };
+
+        size_t glyph_offset = read_loca_entry(0);
+        for (size_t i = 0; i < glyph_count; i++) {
+            size_t next_glyph_offset = read_loca_entry(i + 1);
+            if (next_glyph_offset < glyph_offset || next_glyph_offset > glyf.length) {
+                return false;
+            }
+
+            const Uint8* glyph_data = font_data + glyf.offset + glyph_offset;
+            if (!validate_glyph(glyph_data, next_glyph_offset - glyph_offset, glyph_count)) {
+                invalid_glyph_count++;
+            }
+
+            glyph_offset = next_glyph_offset;
+        }
+
+        return true;
+    }
+}
+
+// --------------------------------------------------------------------------
+
+FontValidationReport::FontValidationReport()
+    : is_directory_valid(false),
+      table_count(0),
+      checksum_mismatch_count(0),
+      is_loca_valid(false),
+      glyph_count(0),
+      invalid_glyph_count(0) {
+}
+
+// --------------------------------------------------------------------------
+
+bool FontValidationReport::is_trusted() const {
+    return is_directory_valid && checksum_mismatch_count == 0 && is_loca_valid && invalid_glyph_count == 0;
+}
+
+// --------------------------------------------------------------------------
+
+std::vector<FontValidationReport> validate_font_file(const Uint8* font_data, size_t font_data_size) {
+    std::vector<Uint32> face_offsets = TableDirectory::read_face_offsets(font_data, font_data_size);
+    std::vector<FontValidationReport> reports(face_offsets.size());
+
+    // Faces of a collection usually point at the same tables, so each
+    // table's checksum and each glyph set's walk is only done once.
+    std::map<std::pair<Uint32, Uint32>, Uint32> table_checksums;
+    std::map<GlyphDataKey, std::pair<bool, Uint32>> glyph_data_results;
+
+    for (size_t face_index = 0; face_index < face_offsets.size(); face_index++) {
+        FontValidationReport& report = reports[face_index];
+
+        TableDirectory directory;
+        bool is_directory_readable = directory.read(font_data, font_data_size, face_offsets[face_index]);
+        report.table_count = directory.get_header().num_tables;
+        if (!is_directory_readable) {
+            continue;
+        }
+
+        for (const TableDirectory::Entry& entry : directory.get_entries()) {
+            std::pair<Uint32, Uint32> extent(entry.offset, entry.length);
+            auto cached_checksum = table_checksums.find(extent);
+            if (cached_checksum == table_checksums.end()) {
+                cached_checksum = table_checksums.emplace(extent, calculate_table_checksum(font_data + entry.offset, entry.length)).first;
+            }
+
+            // head's checksum is taken with its checkSumAdjustment field zeroed.
+            Uint32 actual_checksum = cached_checksum->second;
+            if (entry.tag == TableTag::HEAD && entry.length >= 12) {
+                actual_checksum -= BigEndianReader(font_data, font_data_size).peek_u32(entry.offset + 8);
+            }
+
+            if (actual_checksum != entry.checksum) {
+                report.checksum_mismatch_count++;
+            }
+        }
+
+        const TableDirectory::Entry* head = directory.find(TableTag::HEAD);
+        const TableDirectory::Entry* maxp = directory.find(TableTag::MAXP);
+        const TableDirectory::Entry* loca = directory.find(TableTag::LOCA);
+        const TableDirectory::Entry* glyf = directory.find(TableTag::GLYF);
+
+        report.is_directory_valid = directory.get_out_of_bounds_entry_count() == 0 &&
+            head != nullptr && head->length >= 54 &&
+            maxp != nullptr && maxp->length >= 6 &&
+            loca != nullptr && glyf != nullptr;
+        if (!report.is_directory_valid) {
+            continue;
+        }
+
+        BigEndianReader reader(font_data, font_data_size);
+        report.glyph_count = reader.peek_u16(maxp->offset + 4);
+        bool are_offsets_short = static_cast<Sint16>(reader.peek_u16(head->offset + 50)) == 0;
+
+        GlyphDataKey key = {loca->offset, loca->length, glyf->offset, glyf->length, report.glyph_count, are_offsets_short};
+        auto cached_result = glyph_data_results.find(key);
+        if (cached_result == glyph_data_results.end()) {
+            std::pair<bool, Uint32> result;
+            result.first = validate_glyph_data(font_data, *loca, *glyf, report.glyph_count, are_offsets_short, result.second);
+            cached_result = glyph_data_results.emplace(key, result).first;
+        }
+
+        report.is_loca_valid = cached_result->second.first;
+        report.invalid_glyph_count = cached_result->second.second;
+    }
+
+    return reports;
+}
+
+// --------------------------------------------------------------------------
+
+bool validate_glyph(const Uint8* glyph_data, size_t glyph_length, Uint16 glyph_count) {
+    if (glyph_length == 0) {
+        return true;
+    }
+
+    if (glyph_length < GLYPH_HEADER_SIZE) {
+        return false;
+    }
+
+    BigEndianReader reader(glyph_data, glyph_length);
+    Sint16 num_contours = reader.read_s16();
+    reader.skip(GLYPH_HEADER_SIZE - 2);
+
+    if (num_contours > 0) {
+        return validate_simple_glyph(reader, num_contours);
+    } else if (num_contours < 0) {
+        return validate_composite_glyph(reader, glyph_count);
+    }
+
+    return true;
+}
+
+// --------------------------------------------------------------------------
+
+Uint32 calculate_table_checksum(const Uint8* table_data, size_t length) {
+    size_t i = 0;
+    Uint32 checksum = 0;
+
+    // Byte-swap each word into native order and add four (or eight) lanes
+    // at a time; wrapping lane sums add up to the same wrapped total.
+#if defined(__AVX2__)
+    const __m256i swap_bytes = _mm256_setr_epi8(
+        3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12,
+        3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12
+    );
+    __m256i sums = _mm256_setzero_si256();
+    for (; i + 32 <= length; i += 32) {
+        __m256i words = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(table_data + i));
+        sums = _mm256_add_epi32(sums, _mm256_shuffle_epi8(words, swap_bytes));
+    }
+
+    alignas(32) Uint32 lanes[8];
+    _mm256_store_si256(reinterpret_cast<__m256i*>(lanes), sums);
+    for (Uint32 lane : lanes) {
+        checksum += lane;
+    }
+#elif defined(__SSE2__)
+    __m128i sums = _mm_setzero_si128();
+    for (; i + 16 <= length; i += 16) {
+        __m128i words = _mm_loadu_si128(reinterpret_cast<const __m128i*>(table_data + i));
+        words = _mm_or_si128(_mm_slli_epi16(words, 8), _mm_srli_epi16(words, 8));
+        words = _mm_shufflehi_epi16(_mm_shufflelo_epi16(words, 0xB1), 0xB1);
+        sums = _mm_add_epi32(sums, words);
+    }
+
+    alignas(16) Uint32 lanes[4];
+    _mm_store_si128(reinterpret_cast<__m128i*>(lanes), sums);
+    for (Uint32 lane : lanes) {
+        checksum += lane;
+    }
+#elif defined(__ARM_NEON)
+    uint32x4_t sums = vdupq_n_u32(0);
+    for (; i + 16 <= length; i += 16) {
+        sums = vaddq_u32(sums, vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(table_data + i))));
+    }
+
+    checksum = vgetq_lane_u32(sums, 0) + vgetq_lane_u32(sums, 1) + vgetq_lane_u32(sums, 2) + vgetq_lane_u32(sums, 3);
+#endif
+
+    BigEndianReader reader(table_data, length);
+    for (; i + 4 <= length; i += 4) {
+        checksum += reader.peek_u32(i);
+    }
+
+    for (int shift = 24; i < length; i++, shift -= 8) {
+        checksum += static_cast<Uint32>(table_data[i]) << shift;
+    }
+
+    return checksum;
+}
@@ -0,0 +1,44 @@
+#ifndef FONT_VALIDATION_H
+#define FONT_VALIDATION_H
+
+#include <SDL3/SDL.h>
+#include <cstddef>
+#include <vector>
+
+// Result of the one-off structural check a font gets when it is opened. A
+// font that passes every check is trusted, and its glyphs are decoded without
+// any bounds checks.
+struct FontValidationReport {
+    // The face's offset table and directory fit in the file, every table lies
+    // inside it, and head, maxp, loca and glyf are all present.
+    bool is_directory_valid;
+    Uint16 table_count;
+    Uint16 checksum_mismatch_count;
+
+    // loca has an entry for every glyph plus one, its offsets never go
+    // backwards and none of them point past the end of glyf.
+    bool is_loca_valid;
+    Uint16 glyph_count;
+    Uint32 invalid_glyph_count;
+
+    FontValidationReport();
+
+    bool is_trusted() const;
+};
+
+// One report per face: a single font has one, a collection one per entry in
+// its 'ttcf' header. Tables and glyph data that several faces of a
+// collection share are only checked once.
+std::vector<FontValidationReport> validate_font_file(const Uint8* font_data, size_t font_data_size);
+
+// Check one glyf record: its contour end points, instructions, flags and
+// coordinates, or its component records, must all fit in glyph_length bytes,
+// and components must refer to glyphs below glyph_count. An empty record is
+// valid.
+bool validate_glyph(const Uint8* glyph_data, size_t glyph_length, Uint16 glyph_count);
+
+// The sfnt table checksum: the table summed as big-endian Uint32s, with the
+// last one padded out with zeros.
+Uint32 calculate_table_checksum(const Uint8* table_data, size_t length);
+
+#endif
@@ -0,0 +1,88 @@
+#include "GlyphArena.h"
+
+GlyphArena::GlyphArena()
+    : heap_allocation_count(0),
+      reused_block_count(0) {
+}
+
+// --------------------------------------------------------------------------
+
+GlyphArena::~GlyphArena() {
+    for (int size_class = 0; size_class < NUM_SIZE_CLASSES; size_class++) {
+        for (Uint8* block : free_blocks[size_class]) {
+            delete[] block;
+        }
+    }
+}
+
+// --------------------------------------------------------------------------
+
+int GlyphArena::get_size_class(size_t byte_count) {
+    int size_class = 0;
+    size_t class_size = static_cast<size_t>(1) << MIN_SIZE_CLASS_SHIFT;
+    while (class_size < byte_count) {
+        class_size <<= 1;
+        size_class++;
+    }
+
+    return size_class;
+}
+
+// --------------------------------------------------------------------------
+
+Uint8* GlyphArena::allocate(size_t byte_count) {
+    if (byte_count == 0) {
+        return nullptr;
+    }
+
+    int size_class = get_size_class(byte_count);
+
+    std::lock_guard<std::mutex> lock(mutex);
+
+    if (size_class >= NUM_SIZE_CLASSES) {
+        heap_allocation_count++;
+        return new Uint8[byte_count];
+    }
+
+    std::vector<Uint8*>& blocks = free_blocks[size_class];
+    if (!blocks.empty()) {
+        Uint8* block = blocks.back();
+        blocks.pop_back();
+        reused_block_count++;
+        return block;
+    }
+
+    heap_allocation_count++;
+    return new Uint8[static_cast<size_t>(1) << (size_class + MIN_SIZE_CLASS_SHIFT)];
+}
+
+// --------------------------------------------------------------------------
+
+void GlyphArena::release(Uint8* block, size_t byte_count) {
+    if (block == nullptr) {
+        return;
+    }
+
+    int size_class = get_size_class(byte_count);
+    if (size_class >= NUM_SIZE_CLASSES) {
+        delete[] block;
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    free_blocks[size_class].push_back(block);
+}
+
+// --------------------------------------------------------------------------
+
+Uint64 GlyphArena::get_heap_allocation_count() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return heap_allocation_count;
+}
+
+// --------------------------------------------------------------------------
+
+Uint64 GlyphArena::get_reused_block_count() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return reused_block_count;
+}
@@ -0,0 +1,42 @@
+#ifndef GLYPH_ARENA_H
+#define GLYPH_ARENA_H
+
+#include <SDL3/SDL.h>
+#include <cstddef>
+#include <mutex>
+#include <vector>
+
+// Pool of outline storage blocks. Blocks are bucketed into power-of-two size
+// classes and recycled when the owning glyph goes away, so once the pool has
+// warmed up decoding a glyph does not touch the heap.
+class GlyphArena {
+
+public:
+
+    GlyphArena();
+    ~GlyphArena();
+
+    GlyphArena(const GlyphArena&) = delete;
+    GlyphArena& operator=(const GlyphArena&) = delete;
+
+    Uint8* allocate(size_t byte_count);
+    void release(Uint8* block, size_t byte_count);
+
+    Uint64 get_heap_allocation_count();
+    Uint64 get_reused_block_count();
+
+private:
+
+    static const int MIN_SIZE_CLASS_SHIFT = 6;
+    static const int NUM_SIZE_CLASSES = 16;
+
+    std::mutex mutex;
+    std::vector<Uint8*> free_blocks[NUM_SIZE_CLASSES];
+
+    Uint64 heap_allocation_count;
+    Uint64 reused_block_count;
+
+    static int get_size_class(size_t byte_count);
+};
+
+#endif
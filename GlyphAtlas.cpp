@@ -0,0 +1,428 @@
+#include "GlyphAtlas.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <type_traits>
+
+#include "Font.h"
+#include "GlyphDrawing.h"
+#include "GlyphOutline.h"
+#include "GlyphRasterizer.h"
+#include "SkylinePacker.h"
+#include "ThreadPool.h"
+
+namespace {
+    const int DEFAULT_PAGE_SIZE = 1024;
+    const int MAX_PAGE_SIZE = 8192;
+    const int GLYPH_PADDING = 1;
+    const size_t GLYPHS_PER_CHUNK = 32;
+    const float FLATTEN_TOLERANCE = 0.25f;
+
+    static_assert(std::is_trivially_copyable<AtlasGlyph>::value, "AtlasGlyph is written to disk as raw bytes");
+
+    // Pixel bounds of a glyph scaled to the atlas size, in y-down pixels
+    // relative to the pen position on the baseline.
+    struct GlyphPixelBounds {
+        int left;
+        int top;
+        int width;
+        int height;
+    };
+
+    GlyphPixelBounds calculate_pixel_bounds(const Coordinate& min_extents, const Coordinate& max_extents, float scale) {
+        GlyphPixelBounds bounds;
+        bounds.left = static_cast<int>(std::floor(min_extents.x * scale));
+        bounds.top = static_cast<int>(std::floor(-max_extents.y * scale));
+        bounds.width = static_cast<int>(std::ceil(max_extents.x * scale)) - bounds.left;
+        bounds.height = static_cast<int>(std::ceil(-min_extents.y * scale)) - bounds.top;
+        return bounds;
+    }
+
+    template<typename T>
+    bool read_value(std::FILE* file, T& value) {
+        return std::fread(&value, sizeof(T), 1, file) == 1;
+    }
+
+    template<typename T>
+    bool write_value(std::FILE* file, const T& value) {
+        return std::fwrite(&value, sizeof(T), 1, file) == 1;
+    }
+}
+
+// --------------------------------------------------------------------------
+
+GlyphAtlas::GlyphAtlas()
+    : font_hash(0),
+      pixel_size(0),
+      page_size(0),
+      page_count(0) {
+}
+
+// --------------------------------------------------------------------------
+
+std::shared_ptr<const GlyphAtlas> GlyphAtlas::build(Font& font, ThreadPool& thread_pool, int pixel_size) {
+    std::shared_ptr<GlyphAtlas> atlas(new GlyphAtlas());
+    atlas->font_hash = font.get_content_hash();
+    atlas->pixel_size = pixel_size;
+
+    Uint16 glyph_count = font.get_glyph_count();
+    float scale = font.get_units_per_em() > 0 ? static_cast<float>(pixel_size) / font.get_units_per_em() : 0.0f;
+
+    // First pass: decode every glyph just for its size. Decoding is cheap
+    // next to rasterizing, and knowing all the sizes up front lets the glyphs
+    // be packed tallest first and then rasterized straight into their pages.
+    std::vector<GlyphPixelBounds> pixel_bounds(glyph_count, {0, 0, 0, 0});
+    thread_pool.parallel_for(glyph_count, GLYPHS_PER_CHUNK, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            Glyph glyph = font.get_glyph(static_cast<Uint16>(i));
+            if (glyph.num_points == 0 || glyph.max_extents.x <= glyph.min_extents.x || glyph.max_extents.y <= glyph.min_extents.y) {
+                continue;
+            }
+
+            pixel_bounds[i] = calculate_pixel_bounds(glyph.min_extents, glyph.max_extents, scale);
+        }
+    });
+
+    int largest_side = 0;
+    std::vector<Uint16> pack_order;
+    pack_order.reserve(glyph_count);
+    for (Uint32 i = 0; i < glyph_count; i++) {
+        if (pixel_bounds[i].width > 0 && pixel_bounds[i].height > 0) {
+            pack_order.push_back(static_cast<Uint16>(i));
+            largest_side = std::max(largest_side, std::max(pixel_bounds[i].width, pixel_bounds[i].height) + GLYPH_PADDING);
+        }
+    }
+
+    atlas->page_size = DEFAULT_PAGE_SIZE;
+    while (atlas->page_size < largest_side && atlas->page_size < MAX_PAGE_SIZE) {
+        atlas->page_size *= 2;
+    }
+
+    std::stable_sort(pack_order.begin(), pack_order.end(), [&pixel_bounds](Uint16 a, Uint16 b) {
+        if (pixel_bounds[a].height != pixel_bounds[b].height) {
+            return pixel_bounds[a].height > pixel_bounds[b].height;
+        }
+
+        return pixel_bounds[a].width > pixel_bounds[b].width;
+    });
+
+    // Glyphs are padded on the right and bottom so neighbours don't bleed
+    // into each other when a page is sampled with filtering.
+    atlas->glyphs.assign(glyph_count, AtlasGlyph());
+    std::vector<SkylinePacker> packers;
+    for (Uint16 glyph_index : pack_order) {
+        const GlyphPixelBounds& bounds = pixel_bounds[glyph_index];
+        int padded_width = bounds.width + GLYPH_PADDING;
+        int padded_height = bounds.height + GLYPH_PADDING;
+        if (padded_width > atlas->page_size || padded_height > atlas->page_size) {
+            std::cerr << "[ERROR] Glyph " << glyph_index << " is too large for the atlas at " << pixel_size << "px" << std::endl;
+            continue;
+        }
+
+        int x = 0;
+        int y = 0;
+        size_t page = 0;
+        while (page < packers.size() && !packers[page].pack(padded_width, padded_height, x, y)) {
+            page++;
+        }
+
+        if (page == packers.size()) {
+            packers.emplace_back(atlas->page_size, atlas->page_size);
+            packers.back().pack(padded_width, padded_height, x, y);
+        }
+
+        AtlasGlyph& atlas_glyph = atlas->glyphs[glyph_index];
+        atlas_glyph.page = static_cast<Uint16>(page);
+        atlas_glyph.x = static_cast<Uint16>(x);
+        atlas_glyph.y = static_cast<Uint16>(y);
+        atlas_glyph.width = static_cast<Uint16>(bounds.width);
+        atlas_glyph.height = static_cast<Uint16>(bounds.height);
+        atlas_glyph.bearing_x = static_cast<Sint16>(bounds.left);
+        atlas_glyph.bearing_y = static_cast<Sint16>(-bounds.top);
+        atlas_glyph.u0 = static_cast<float>(x) / atlas->page_size;
+        atlas_glyph.v0 = static_cast<float>(y) / atlas->page_size;
+        atlas_glyph.u1 = static_cast<float>(x + bounds.width) / atlas->page_size;
+        atlas_glyph.v1 = static_cast<float>(y + bounds.height) / atlas->page_size;
+    }
+
+    atlas->page_count = static_cast<int>(packers.size());
+    size_t page_area = static_cast<size_t>(atlas->page_size) * atlas->page_size;
+    atlas->page_pixels.assign(page_area * atlas->page_count, 0);
+
+    // Second pass: every glyph owns a disjoint rect of its page, so workers
+    // rasterize straight into the pages without locking.
+    thread_pool.parallel_for(pack_order.size(), GLYPHS_PER_CHUNK, [&](size_t begin, size_t end) {
+        thread_local GlyphRasterizer rasterizer;
+        thread_local GlyphOutline glyph_outline;
+        thread_local FlattenedOutline outline;
+        thread_local std::vector<Uint8> coverage;
+
+        for (size_t i = begin; i < end; i++) {
+            Uint16 glyph_index = pack_order[i];
+            const AtlasGlyph& atlas_glyph = atlas->glyphs[glyph_index];
+            if (atlas_glyph.width == 0) {
+                continue;
+            }
+
+            Glyph glyph = font.get_glyph(glyph_index);
+            glyph_outline.compile(glyph);
+
+            // flatten_glyph_contours fits the extents into a rect, so hand it
+            // the rect the scaled extents occupy inside the bitmap.
+            const GlyphPixelBounds& bounds = pixel_bounds[glyph_index];
+            SDL_FRect glyph_render_bounds;
+            glyph_render_bounds.x = glyph.min_extents.x * scale - bounds.left;
+            glyph_render_bounds.y = -glyph.max_extents.y * scale - bounds.top;
+            glyph_render_bounds.w = (glyph.max_extents.x - glyph.min_extents.x) * scale + 1;
+            glyph_render_bounds.h = (glyph.max_extents.y - glyph.min_extents.y) * scale + 1;
+
+            outline.clear();
+            flatten_glyph_contours(glyph_outline, glyph_render_bounds, FLATTEN_TOLERANCE, outline);
+            rasterizer.rasterize(outline, 0.0f, 0.0f, atlas_glyph.width, atlas_glyph.height, coverage);
+
+            Uint8* page = atlas->page_pixels.data() + page_area * atlas_glyph.page;
+            for (int row = 0; row < atlas_glyph.height; row++) {
+                std::memcpy(
+                    page + static_cast<size_t>(atlas_glyph.y + row) * atlas->page_size + atlas_glyph.x,
+                    coverage.data() + static_cast<size_t>(row) * atlas_glyph.width,
+                    atlas_glyph.width
+                );
+            }
+        }
+    });
+
+    return atlas;
+}
+
+// --------------------------------------------------------------------------
+
+std::shared_ptr<const GlyphAtlas> GlyphAtlas::load_or_build(
+    Font& font,
+    ThreadPool& thread_pool,
+    int pixel_size,
+    const std::string& cache_directory,
+    bool* was_cache_hit
+) {
+    std::string cache_file_name;
+    if (!cache_directory.empty()) {
+        cache_file_name = get_cache_file_name(cache_directory, font.get_content_hash(), pixel_size);
+
+        std::shared_ptr<const GlyphAtlas> cached_atlas = load(cache_file_name, font.get_content_hash(), pixel_size);
+        if (cached_atlas != nullptr && cached_atlas->get_glyph_count() == font.get_glyph_count()) {
+            if (was_cache_hit != nullptr) {
+                *was_cache_hit = true;
+            }
+
+            return cached_atlas;
+        }
+    }
+
+    if (was_cache_hit != nullptr) {
+        *was_cache_hit = false;
+    }
+
+    std::shared_ptr<const GlyphAtlas> atlas = build(font, thread_pool, pixel_size);
+    if (!cache_file_name.empty()) {
+        std::error_code error;
+        std::filesystem::create_directories(cache_directory, error);
+        atlas->save(cache_file_name);
+    }
+
+    return atlas;
+}
+
+// --------------------------------------------------------------------------
+
+std::shared_ptr<const GlyphAtlas> GlyphAtlas::load(const std::string& file_name, Uint64 font_hash, int pixel_size) {
+    std::FILE* file = std::fopen(file_name.c_str(), "rb");
+    if (file == nullptr) {
+        return nullptr;
+    }
+
+    std::shared_ptr<GlyphAtlas> atlas(new GlyphAtlas());
+
+    Uint32 magic = 0;
+    Uint32 version = 0;
+    Uint32 stored_pixel_size = 0;
+    Uint32 glyph_count = 0;
+    Uint32 page_size = 0;
+    Uint32 page_count = 0;
+    bool is_valid =
+        read_value(file, magic) && magic == CACHE_FILE_MAGIC &&
+        read_value(file, version) && version == CACHE_FILE_VERSION &&
+        read_value(file, atlas->font_hash) && atlas->font_hash == font_hash &&
+        read_value(file, stored_pixel_size) && static_cast<int>(stored_pixel_size) == pixel_size &&
+        read_value(file, glyph_count) && glyph_count <= 0x10000 &&
+        read_value(file, page_size) && page_size > 0 && page_size <= MAX_PAGE_SIZE &&
+        read_value(file, page_count) && page_count <= 0x10000;
+
+    if (is_valid) {
+        atlas->pixel_size = pixel_size;
+        atlas->page_size = static_cast<int>(page_size);
+        atlas->page_count = static_cast<int>(page_count);
+        atlas->glyphs.resize(glyph_count);
+        atlas->page_pixels.resize(static_cast<size_t>(page_size) * page_size * page_count);
+
+        is_valid =
+            std::fread(atlas->glyphs.data(), sizeof(AtlasGlyph), glyph_count, file) == glyph_count &&
+            std::fread(atlas->page_pixels.data(), 1, atlas->page_pixels.size(), file) == atlas->page_pixels.size();
+    }
+
+    std::fclose(file);
+
+    if (!is_valid) {
+        return nullptr;
+    }
+
+    // Don't trust a damaged file to keep glyph rects inside their pages.
+    for (const AtlasGlyph& glyph : atlas->glyphs) {
+        if (glyph.width > 0 && (glyph.page >= page_count || glyph.x + glyph.width > page_size || glyph.y + glyph.height > page_size)) {
+            return nullptr;
+        }
+    }
+
+    return atlas;
+}
+
+// --------------------------------------------------------------------------
+
+bool GlyphAtlas::save(const std::string& file_name) const {
+    // Write to a temporary file and rename it into place, so a reader never
+    // sees a half-written atlas.
+    std::string temporary_file_name = file_name + ".tmp";
+    std::FILE* file = std::fopen(temporary_file_name.c_str(), "wb");
+    if (file == nullptr) {
+        std::cerr << "[ERROR] Could not write glyph atlas cache: " << temporary_file_name << std::endl;
+        return false;
+    }
+
+    bool is_written =
+        write_value(file, static_cast<Uint32>(CACHE_FILE_MAGIC)) &&
+        write_value(file, static_cast<Uint32>(CACHE_FILE_VERSION)) &&
+        write_value(file, font_hash) &&
+        write_value(file, static_cast<Uint32>(pixel_size)) &&
+        write_value(file, static_cast<Uint32>(glyphs.size())) &&
+        write_value(file, static_cast<Uint32>(page_size)) &&
+        write_value(file, static_cast<Uint32>(page_count)) &&
+        std::fwrite(glyphs.data(), sizeof(AtlasGlyph), glyphs.size(), file) == glyphs.size() &&
+        std::fwrite(page_pixels.data(), 1, page_pixels.size(), file) == page_pixels.size();
+
+    is_written = std::fclose(file) == 0 && is_written;
+    if (!is_written || std::rename(temporary_file_name.c_str(), file_name.c_str()) != 0) {
+        std::cerr << "[ERROR] Could not write glyph atlas cache: " << file_name << std::endl;
+        std::remove(temporary_file_name.c_str());
+        return false;
+    }
+
+    return true;
+}
+
+// --------------------------------------------------------------------------
+
+std::string GlyphAtlas::get_default_cache_directory() {
+    if (const char* directory = std::getenv("TTF_VIEWER_CACHE_DIR")) {
+        return directory;
+    }
+
+    if (const char* directory = std::getenv("XDG_CACHE_HOME")) {
+        return std::string(directory) + "/ttf-viewer";
+    }
+
+    if (const char* home = std::getenv("HOME")) {
+#ifdef __APPLE__
+        return std::string(home) + "/Library/Caches/ttf-viewer";
+#else
+        return std::string(home) + "/.cache/ttf-viewer";
+#endif
+    }
+
+    return "";
+}
+
+// --------------------------------------------------------------------------
+
+std::string GlyphAtlas::get_cache_file_name(const std::string& cache_directory, Uint64 font_hash, int pixel_size) {
+    char name[64];
+    std::snprintf(name, sizeof(name), "/%016llx-%dpx.atlas", static_cast<unsigned long long>(font_hash), pixel_size);
+    return cache_directory + name;
+}
+
+// --------------------------------------------------------------------------
+
+int GlyphAtlas::get_pixel_size() const {
+    return pixel_size;
+}
+
+// --------------------------------------------------------------------------
+
+int GlyphAtlas::get_page_size() const {
+    return page_size;
+}
+
+// --------------------------------------------------------------------------
+
+int GlyphAtlas::get_page_count() const {
+    return page_count;
+}
+
+// --------------------------------------------------------------------------
+
+const Uint8* GlyphAtlas::get_page_pixels(int page) const {
+    return page_pixels.data() + static_cast<size_t>(page_size) * page_size * page;
+}
+
+// --------------------------------------------------------------------------
+
+size_t GlyphAtlas::get_glyph_count() const {
+    return glyphs.size();
+}
+
+// --------------------------------------------------------------------------
+
+const AtlasGlyph& GlyphAtlas::get_glyph(Uint16 glyph_index) const {
+    return glyphs[glyph_index];
+}
+
+// --------------------------------------------------------------------------
+
+double GlyphAtlas::get_pack_efficiency() const {
+    if (page_count == 0) {
+        return 0.0;
+    }
+
+    double glyph_area = 0.0;
+    for (const AtlasGlyph& glyph : glyphs) {
+        glyph_area += static_cast<double>(glyph.width) * glyph.height;
+    }
+
+    return glyph_area / (static_cast<double>(page_size) * page_size * page_count);
+}
+
+// --------------------------------------------------------------------------
+
+SDL_Texture* GlyphAtlas::create_page_texture(SDL_Renderer* renderer, int page, const SDL_Color& color) const {
+    SDL_Texture* texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA32, SDL_TEXTUREACCESS_STATIC, page_size, page_size);
+    if (texture == nullptr) {
+        std::cerr << "[ERROR] Could not create atlas page texture: " << SDL_GetError() << std::endl;
+        return nullptr;
+    }
+
+    const Uint8* coverage = get_page_pixels(page);
+    size_t pixel_count = static_cast<size_t>(page_size) * page_size;
+    std::vector<Uint8> pixels(pixel_count * 4);
+    for (size_t i = 0; i < pixel_count; i++) {
+        pixels[i * 4 + 0] = color.r;
+        pixels[i * 4 + 1] = color.g;
+        pixels[i * 4 + 2] = color.b;
+        pixels[i * 4 + 3] = static_cast<Uint8>(coverage[i] * color.a / 255);
+    }
+
+    SDL_SetTextureBlendMode(texture, SDL_BLENDMODE_BLEND);
+    SDL_UpdateTexture(texture, nullptr, pixels.data(), page_size * 4);
+    return texture;
+}
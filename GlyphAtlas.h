@@ -0,0 +1,88 @@
+#ifndef GLYPH_ATLAS_H
+#define GLYPH_ATLAS_H
+
+#include <SDL3/SDL.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+class Font;
+class ThreadPool;
+
+// Where one glyph's bitmap sits in the atlas. Glyphs without an outline have
+// a zero-sized rect on page 0. Bearings are in pixels from the pen position
+// on the baseline to the bitmap's top-left corner, with y pointing up.
+struct AtlasGlyph {
+    Uint16 page;
+    Uint16 x;
+    Uint16 y;
+    Uint16 width;
+    Uint16 height;
+    Sint16 bearing_x;
+    Sint16 bearing_y;
+    float u0;
+    float v0;
+    float u1;
+    float v1;
+};
+
+// Every glyph of a font rasterized at one pixel size (per em) and packed into
+// square 8-bit coverage pages. An atlas never changes once built, so it can
+// be shared between threads.
+class GlyphAtlas {
+
+public:
+
+    static std::shared_ptr<const GlyphAtlas> build(Font& font, ThreadPool& thread_pool, int pixel_size);
+
+    // Load the atlas from cache_directory when a cached copy for this font and
+    // size exists, otherwise build it and write it there for next time.
+    // was_cache_hit, if given, reports which happened.
+    static std::shared_ptr<const GlyphAtlas> load_or_build(
+        Font& font,
+        ThreadPool& thread_pool,
+        int pixel_size,
+        const std::string& cache_directory,
+        bool* was_cache_hit = nullptr
+    );
+
+    // Returns nullptr if the file is missing, damaged or was built from a
+    // different font or size.
+    static std::shared_ptr<const GlyphAtlas> load(const std::string& file_name, Uint64 font_hash, int pixel_size);
+    bool save(const std::string& file_name) const;
+
+    // $TTF_VIEWER_CACHE_DIR, else the user's cache directory.
+    static std::string get_default_cache_directory();
+    static std::string get_cache_file_name(const std::string& cache_directory, Uint64 font_hash, int pixel_size);
+
+    int get_pixel_size() const;
+    int get_page_size() const;
+    int get_page_count() const;
+    const Uint8* get_page_pixels(int page) const;
+
+    size_t get_glyph_count() const;
+    const AtlasGlyph& get_glyph(Uint16 glyph_index) const;
+
+    // Glyph bitmap area over total page area.
+    double get_pack_efficiency() const;
+
+    // An RGBA copy of a page with coverage in alpha, drawn in color. The
+    // caller owns the texture.
+    SDL_Texture* create_page_texture(SDL_Renderer* renderer, int page, const SDL_Color& color) const;
+
+private:
+
+    static const Uint32 CACHE_FILE_MAGIC = 0x41465454; // "TTFA"
+    static const Uint32 CACHE_FILE_VERSION = 1;
+
+    Uint64 font_hash;
+    int pixel_size;
+    int page_size;
+    int page_count;
+    std::vector<AtlasGlyph> glyphs;
+    std::vector<Uint8> page_pixels;
+
+    GlyphAtlas();
+};
+
+#endif
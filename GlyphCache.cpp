@@ -0,0 +1,210 @@
+#include "GlyphCache.h"
+
+#include <iterator>
+#include <utility>
+
+GlyphCache::GlyphCache(Font& font, size_t memory_budget, int prefetch_distance)
+    : font(font),
+      memory_budget(memory_budget),
+      prefetch_distance(prefetch_distance),
+      memory_usage(0),
+      hit_count(0),
+      miss_count(0),
+      eviction_count(0),
+      is_stopping(false) {
+    prefetch_thread = std::thread(&GlyphCache::run_prefetcher, this);
+}
+
+// --------------------------------------------------------------------------
+
+GlyphCache::~GlyphCache() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        is_stopping = true;
+    }
+
+    prefetch_condition.notify_all();
+    prefetch_thread.join();
+}
+
+// --------------------------------------------------------------------------
+
+std::shared_ptr<const Glyph> GlyphCache::get_glyph(Uint16 glyph_index) {
+    std::unique_lock<std::mutex> lock(mutex);
+
+    // If the prefetcher is already decoding this glyph, waiting for it is
+    // never slower than starting over.
+    decoded_condition.wait(lock, [&] {
+        return in_flight_glyph_indices.count(glyph_index) == 0;
+    });
+
+    auto entry = entries.find(glyph_index);
+    if (entry != entries.end()) {
+        hit_count++;
+        prefetched_glyph_indices.erase(glyph_index);
+        lru_order.splice(lru_order.begin(), lru_order, entry->second.lru_position);
+        return entry->second.glyph;
+    }
+
+    miss_count++;
+    in_flight_glyph_indices.insert(glyph_index);
+    lock.unlock();
+
+    std::shared_ptr<const Glyph> glyph = std::make_shared<Glyph>(font.get_glyph(glyph_index));
+
+    lock.lock();
+    in_flight_glyph_indices.erase(glyph_index);
+    insert(glyph_index, glyph, true);
+    lock.unlock();
+
+    decoded_condition.notify_all();
+    return glyph;
+}
+
+// --------------------------------------------------------------------------
+
+void GlyphCache::prefetch(Uint16 glyph_index, int direction) {
+    int glyph_count = font.get_glyph_count();
+    if (glyph_count == 0) {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        prefetch_queue.clear();
+        prefetched_glyph_indices.clear();
+
+        // Glyphs this batch wants that are already cached are protected as
+        // well, or a full cache would evict them before they are shown, and
+        // so is glyph_index, which the caller is about to ask for.
+        prefetched_glyph_indices.insert(glyph_index);
+
+        int next_glyph_index = glyph_index;
+        for (int i = 0; i < prefetch_distance && i < glyph_count - 1; i++) {
+            next_glyph_index = (next_glyph_index + direction + glyph_count) % glyph_count;
+            prefetch_queue.push_back(static_cast<Uint16>(next_glyph_index));
+            prefetched_glyph_indices.insert(static_cast<Uint16>(next_glyph_index));
+        }
+    }
+
+    prefetch_condition.notify_one();
+}
+
+// --------------------------------------------------------------------------
+
+void GlyphCache::insert(Uint16 glyph_index, std::shared_ptr<const Glyph> glyph, bool is_most_recent) {
+    auto existing_entry = entries.find(glyph_index);
+    if (existing_entry != entries.end()) {
+        memory_usage -= existing_entry->second.memory_size;
+        lru_order.erase(existing_entry->second.lru_position);
+        entries.erase(existing_entry);
+    }
+
+    Entry entry;
+    entry.memory_size = glyph->get_memory_size();
+    entry.glyph = std::move(glyph);
+
+    if (is_most_recent) {
+        lru_order.push_front(glyph_index);
+        entry.lru_position = lru_order.begin();
+    } else {
+        lru_order.push_back(glyph_index);
+        entry.lru_position = std::prev(lru_order.end());
+    }
+
+    memory_usage += entry.memory_size;
+    entries[glyph_index] = std::move(entry);
+
+    evict_to_budget();
+}
+
+// --------------------------------------------------------------------------
+
+void GlyphCache::evict_to_budget() {
+    // The most recently used glyph is always kept, even if it alone is over
+    // budget, and so are glyphs still waiting to be shown after a prefetch.
+    auto position = lru_order.end();
+    while (memory_usage > memory_budget && lru_order.size() > 1 && position != std::next(lru_order.begin())) {
+        --position;
+
+        Uint16 glyph_index = *position;
+        if (prefetched_glyph_indices.count(glyph_index) != 0) {
+            continue;
+        }
+
+        auto entry = entries.find(glyph_index);
+        memory_usage -= entry->second.memory_size;
+        entries.erase(entry);
+        position = lru_order.erase(position);
+
+        eviction_count++;
+    }
+}
+
+// --------------------------------------------------------------------------
+
+void GlyphCache::run_prefetcher() {
+    std::unique_lock<std::mutex> lock(mutex);
+
+    while (true) {
+        prefetch_condition.wait(lock, [&] {
+            return is_stopping || !prefetch_queue.empty();
+        });
+
+        if (is_stopping) {
+            return;
+        }
+
+        Uint16 glyph_index = prefetch_queue.front();
+        prefetch_queue.pop_front();
+
+        if (entries.count(glyph_index) != 0 || in_flight_glyph_indices.count(glyph_index) != 0) {
+            continue;
+        }
+
+        in_flight_glyph_indices.insert(glyph_index);
+        lock.unlock();
+
+        std::shared_ptr<const Glyph> glyph = std::make_shared<Glyph>(font.get_glyph(glyph_index));
+
+        lock.lock();
+        in_flight_glyph_indices.erase(glyph_index);
+
+        // Prefetched glyphs go in at the cold end, behind every glyph the
+        // user has actually looked at, and evict_to_budget leaves them alone
+        // until they are shown. A prefetch that has been superseded in the
+        // meantime isn't protected any more and is evicted first.
+        insert(glyph_index, glyph, false);
+
+        decoded_condition.notify_all();
+    }
+}
+
+// --------------------------------------------------------------------------
+
+Uint64 GlyphCache::get_hit_count() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return hit_count;
+}
+
+// --------------------------------------------------------------------------
+
+Uint64 GlyphCache::get_miss_count() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return miss_count;
+}
+
+// --------------------------------------------------------------------------
+
+Uint64 GlyphCache::get_eviction_count() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return eviction_count;
+}
+
+// --------------------------------------------------------------------------
+
+size_t GlyphCache::get_memory_usage() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return memory_usage;
+}
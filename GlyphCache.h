@@ -0,0 +1,82 @@
+#ifndef GLYPH_CACHE_H
+#define GLYPH_CACHE_H
+
+#include <SDL3/SDL.h>
+#include <condition_variable>
+#include <deque>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "Font.h"
+
+// Bounded LRU cache in front of Font::get_glyph. Glyphs are handed out as
+// shared pointers so an evicted glyph stays valid for whoever is still drawing
+// it. A background thread decodes the glyphs ahead of the navigation direction
+// so that stepping through the font rarely has to decode on the UI thread.
+//
+// Glyphs wanted by the latest prefetch aren't evicted until they have been
+// shown or a later prefetch no longer wants them, so the cache can go over
+// budget by up to prefetch_distance + 1 glyphs.
+class GlyphCache {
+
+public:
+
+    GlyphCache(Font& font, size_t memory_budget, int prefetch_distance);
+    ~GlyphCache();
+
+    GlyphCache(const GlyphCache&) = delete;
+    GlyphCache& operator=(const GlyphCache&) = delete;
+
+    std::shared_ptr<const Glyph> get_glyph(Uint16 glyph_index);
+
+    // Queue the next prefetch_distance glyphs after glyph_index, stepping by
+    // direction (+1 or -1) and wrapping around the ends of the font. Anything
+    // still queued from an earlier call is dropped. Call it before getting
+    // glyph_index itself, which it keeps from being evicted until then.
+    void prefetch(Uint16 glyph_index, int direction);
+
+    Uint64 get_hit_count();
+    Uint64 get_miss_count();
+    Uint64 get_eviction_count();
+    size_t get_memory_usage();
+
+private:
+
+    struct Entry {
+        std::shared_ptr<const Glyph> glyph;
+        size_t memory_size;
+        std::list<Uint16>::iterator lru_position;
+    };
+
+    Font& font;
+    size_t memory_budget;
+    int prefetch_distance;
+
+    std::mutex mutex;
+    std::condition_variable prefetch_condition;
+    std::condition_variable decoded_condition;
+
+    std::unordered_map<Uint16, Entry> entries;
+    std::list<Uint16> lru_order;
+    std::unordered_set<Uint16> in_flight_glyph_indices;
+    std::unordered_set<Uint16> prefetched_glyph_indices;
+    std::deque<Uint16> prefetch_queue;
+    size_t memory_usage;
+
+    Uint64 hit_count;
+    Uint64 miss_count;
+    Uint64 eviction_count;
+
+    bool is_stopping;
+    std::thread prefetch_thread;
+
+    void insert(Uint16 glyph_index, std::shared_ptr<const Glyph> glyph, bool is_most_recent);
+    void evict_to_budget();
+    void run_prefetcher();
+};
+
+#endif
@@ -0,0 +1,424 @@
+#include "GlyphDrawing.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+#include "GlyphAtlas.h"
+#include "GlyphRasterizer.h"
+#include "Profiler.h"
+#include "ThreadPool.h"
+
+namespace {
+    // Glyph and OutlineView share field names, so the point drawing works
+    // on either.
+    template<typename GlyphType>
+    void map_points(const GlyphType& glyph, const SDL_FRect& glyph_render_bounds, std::vector<SDL_FPoint>& mapped_points) {
+        mapped_points.resize(glyph.num_points);
+
+        float x_scale = (glyph_render_bounds.w - 1) / (glyph.max_extents.x - glyph.min_extents.x);
+        float y_scale = (glyph_render_bounds.h - 1) / (glyph.min_extents.y - glyph.max_extents.y);
+        for (int i = 0; i < glyph.num_points; i++) {
+            mapped_points[i].x = x_scale * (glyph.x_coordinates[i] - glyph.min_extents.x) + glyph_render_bounds.x;
+            mapped_points[i].y = y_scale * (glyph.y_coordinates[i] - glyph.max_extents.y) + glyph_render_bounds.y;
+        }
+    }
+
+    template<typename GlyphType>
+    void draw_points(DrawList& draw_list, const GlyphType& glyph, int window_width, int window_height, int padding, const SDL_Color& color) {
+        SDL_FRect glyph_render_bounds;
+        calculate_glyph_render_bounds(glyph.min_extents, glyph.max_extents, window_width, window_height, padding, glyph_render_bounds);
+
+        thread_local std::vector<SDL_FPoint> mapped_points;
+        map_points(glyph, glyph_render_bounds, mapped_points);
+
+        for (int i = 0; i < glyph.num_points; i++) {
+            const SDL_Color& point_color = glyph.is_on_curve(i) ? color : OFF_CURVE_POINT_COLOR;
+            draw_list.add_point(mapped_points[i].x, mapped_points[i].y, point_color);
+        }
+    }
+}
+
+// --------------------------------------------------------------------------
+
+// Linearly remap an input x in [a, b] to [u, v].
+float linear_remap(float x, float a, float b, float u, float v) {
+    return (v - u) / (b - a) * (x - a) + u;
+}
+
+// --------------------------------------------------------------------------
+
+void fit_rect_inside_another_rect(const SDL_FRect& inner_rect, const SDL_FRect& outer_rect, SDL_FRect& fitted_rect) {
+    float inner_width_to_height_ratio = inner_rect.w / inner_rect.h;
+    float inner_width_when_inner_height_is_maximized = inner_width_to_height_ratio * outer_rect.h;
+    if (inner_width_when_inner_height_is_maximized <= outer_rect.w) {
+        fitted_rect.w = inner_width_when_inner_height_is_maximized;
+        fitted_rect.h = outer_rect.h;
+
+        fitted_rect.x = outer_rect.x + (outer_rect.w - fitted_rect.w) / 2.0f;
+        fitted_rect.y = outer_rect.y;
+    } else {
+        fitted_rect.w = outer_rect.w;
+        fitted_rect.h = outer_rect.w / inner_width_to_height_ratio;
+
+        fitted_rect.x = outer_rect.x;
+        fitted_rect.y = outer_rect.y + (outer_rect.h - fitted_rect.h) / 2.0f;
+    }
+}
+
+// --------------------------------------------------------------------------
+
+void calculate_glyph_render_bounds(const Coordinate& min_extents, const Coordinate& max_extents, int window_width, int window_height, int padding, SDL_FRect& glyph_render_bounds) {
+    SDL_FRect window_rect;
+    window_rect.x = padding;
+    window_rect.y = padding;
+    window_rect.w = window_width - 2 * padding + 1;
+    window_rect.h = window_height - 2 * padding + 1;
+
+    SDL_FRect glyph_rect;
+    glyph_rect.x = min_extents.x;
+    glyph_rect.y = max_extents.y;
+    glyph_rect.w = max_extents.x - min_extents.x + 1;
+    glyph_rect.h = max_extents.y - min_extents.y + 1;
+
+    fit_rect_inside_another_rect(glyph_rect, window_rect, glyph_render_bounds);
+}
+
+// --------------------------------------------------------------------------
+
+void calculate_glyph_render_bounds(const Glyph& glyph, int window_width, int window_height, int padding, SDL_FRect& glyph_render_bounds) {
+    calculate_glyph_render_bounds(glyph.min_extents, glyph.max_extents, window_width, window_height, padding, glyph_render_bounds);
+}
+
+// --------------------------------------------------------------------------
+
+void calculate_glyph_render_bounds(const GlyphOutline& outline, int window_width, int window_height, int padding, SDL_FRect& glyph_render_bounds) {
+    calculate_glyph_render_bounds(outline.min_extents, outline.max_extents, window_width, window_height, padding, glyph_render_bounds);
+}
+
+// --------------------------------------------------------------------------
+
+void map_glyph_points(const Glyph& glyph, const SDL_FRect& glyph_render_bounds, std::vector<SDL_FPoint>& mapped_points) {
+    map_points(glyph, glyph_render_bounds, mapped_points);
+}
+
+// --------------------------------------------------------------------------
+
+void map_outline_points(const GlyphOutline& outline, const SDL_FRect& glyph_render_bounds, std::vector<SDL_FPoint>& mapped_points) {
+    mapped_points.resize(outline.points.size());
+
+    float x_scale = (glyph_render_bounds.w - 1) / (outline.max_extents.x - outline.min_extents.x);
+    float y_scale = (glyph_render_bounds.h - 1) / (outline.min_extents.y - outline.max_extents.y);
+    for (size_t i = 0; i < outline.points.size(); i++) {
+        mapped_points[i].x = x_scale * (outline.points[i].x - outline.min_extents.x) + glyph_render_bounds.x;
+        mapped_points[i].y = y_scale * (outline.points[i].y - outline.max_extents.y) + glyph_render_bounds.y;
+    }
+}
+
+// --------------------------------------------------------------------------
+
+void draw_glyph_points(DrawList& draw_list, const Glyph& glyph, int window_width, int window_height, int padding, const SDL_Color& color) {
+    PROFILE_SCOPE(DRAW_POINTS);
+    draw_points(draw_list, glyph, window_width, window_height, padding, color);
+}
+
+// --------------------------------------------------------------------------
+
+void draw_glyph_points(DrawList& draw_list, const OutlineView& outline, int window_width, int window_height, int padding, const SDL_Color& color) {
+    PROFILE_SCOPE(DRAW_POINTS);
+    draw_points(draw_list, outline, window_width, window_height, padding, color);
+}
+
+// --------------------------------------------------------------------------
+
+void draw_glyph_lines(DrawList& draw_list, const GlyphOutline& outline, int window_width, int window_height, int padding, const SDL_Color& color) {
+    PROFILE_SCOPE(DRAW_LINES);
+    PROFILE_COUNT(SEGMENTS, outline.points.size() - outline.contour_ends.size());
+
+    SDL_FRect glyph_render_bounds;
+    calculate_glyph_render_bounds(outline, window_width, window_height, padding, glyph_render_bounds);
+
+    thread_local std::vector<SDL_FPoint> mapped_points;
+    map_outline_points(outline, glyph_render_bounds, mapped_points);
+
+    // Every contour is already closed, so its points in order are the
+    // control polygon. Implied midpoints sit on the line between their two
+    // control points and don't change what is drawn.
+    size_t contour_start = 0;
+    for (size_t contour_end : outline.contour_ends) {
+        draw_list.add_polyline(mapped_points.data() + contour_start, contour_end - contour_start, color);
+        contour_start = contour_end;
+    }
+}
+
+// --------------------------------------------------------------------------
+
+void FlattenedOutline::clear() {
+    points.clear();
+    contour_ends.clear();
+}
+
+// --------------------------------------------------------------------------
+
+size_t FlattenedOutline::get_segment_count() const {
+    return points.size() - contour_ends.size();
+}
+
+// --------------------------------------------------------------------------
+
+void append_quadratic_bezier_curve(const SDL_FPoint& p1, const SDL_FPoint& p2, const SDL_FPoint& p3, float tolerance, std::vector<SDL_FPoint>& points) {
+    // Writing the curve as B(t) = p1 + b t + a t^2, a chord over a span of
+    // length h differs from the curve by a (t - t0)(t - t1), which peaks at
+    // |a| h^2 / 4. An n-way split therefore strays at most |a| / (4 n^2), so
+    // that fixes the number of segments needed to stay within tolerance.
+    float ax = p1.x - 2.0f * p2.x + p3.x;
+    float ay = p1.y - 2.0f * p2.y + p3.y;
+    float bx = 2.0f * (p2.x - p1.x);
+    float by = 2.0f * (p2.y - p1.y);
+
+    float deviation = std::sqrt(ax * ax + ay * ay);
+    int segment_count = static_cast<int>(std::ceil(std::sqrt(deviation / (4.0f * tolerance))));
+    segment_count = std::clamp(segment_count, 1, MAX_SEGMENTS_PER_CURVE);
+
+    // Forward differencing: each step is two additions per axis.
+    float step = 1.0f / segment_count;
+    float step_squared = step * step;
+    float x = p1.x;
+    float y = p1.y;
+    float dx = bx * step + ax * step_squared;
+    float dy = by * step + ay * step_squared;
+    float ddx = 2.0f * ax * step_squared;
+    float ddy = 2.0f * ay * step_squared;
+
+    for (int i = 1; i < segment_count; i++) {
+        x += dx;
+        y += dy;
+        dx += ddx;
+        dy += ddy;
+        points.push_back({x, y});
+    }
+
+    // Land exactly on the end point rather than wherever rounding drifted to.
+    points.push_back(p3);
+}
+
+// --------------------------------------------------------------------------
+
+void flatten_glyph_contours(const GlyphOutline& glyph_outline, const SDL_FRect& glyph_render_bounds, float tolerance, FlattenedOutline& outline) {
+    PROFILE_SCOPE(FLATTEN);
+
+    // Map every point to screen space once up front; curve evaluation
+    // happens after mapping, which is affine.
+    thread_local std::vector<SDL_FPoint> mapped_points;
+    map_outline_points(glyph_outline, glyph_render_bounds, mapped_points);
+
+    size_t point_index = 0;
+    for (Uint8 verb : glyph_outline.verbs) {
+        if (verb == GlyphOutline::MOVE_TO) {
+            if (point_index > 0) {
+                outline.contour_ends.push_back(outline.points.size());
+            }
+
+            outline.points.push_back(mapped_points[point_index++]);
+        } else if (verb == GlyphOutline::LINE_TO) {
+            outline.points.push_back(mapped_points[point_index++]);
+        } else {
+            SDL_FPoint start_point = outline.points.back();
+            append_quadratic_bezier_curve(start_point, mapped_points[point_index], mapped_points[point_index + 1], tolerance, outline.points);
+            point_index += 2;
+        }
+    }
+
+    if (point_index > 0) {
+        outline.contour_ends.push_back(outline.points.size());
+    }
+}
+
+// --------------------------------------------------------------------------
+
+void draw_glyph_contours(DrawList& draw_list, const GlyphOutline& glyph_outline, int window_width, int window_height, int padding, float tolerance, const SDL_Color& color) {
+    PROFILE_SCOPE(DRAW_CONTOURS);
+
+    SDL_FRect glyph_render_bounds;
+    calculate_glyph_render_bounds(glyph_outline, window_width, window_height, padding, glyph_render_bounds);
+
+    // Reused from frame to frame so drawing doesn't allocate.
+    thread_local FlattenedOutline outline;
+    outline.clear();
+    flatten_glyph_contours(glyph_outline, glyph_render_bounds, tolerance, outline);
+    PROFILE_COUNT(SEGMENTS, outline.get_segment_count());
+
+    size_t contour_start = 0;
+    for (size_t contour_end : outline.contour_ends) {
+        draw_list.add_polyline(outline.points.data() + contour_start, contour_end - contour_start, color);
+        contour_start = contour_end;
+    }
+}
+
+// --------------------------------------------------------------------------
+
+void draw_glyph_filled(DrawList& draw_list, SDL_Renderer* renderer, GlyphRasterizer& rasterizer, ThreadPool& thread_pool, SDL_Texture*& frame_texture, const GlyphOutline& glyph_outline, int window_width, int window_height, int padding, float tolerance, const SDL_Color& color) {
+    PROFILE_SCOPE(DRAW_FILLED);
+
+    if (window_width <= 0 || window_height <= 0) {
+        return;
+    }
+
+    float texture_width = 0.0f;
+    float texture_height = 0.0f;
+    if (frame_texture != nullptr) {
+        SDL_GetTextureSize(frame_texture, &texture_width, &texture_height);
+    }
+
+    if (frame_texture != nullptr && (texture_width != window_width || texture_height != window_height)) {
+        SDL_DestroyTexture(frame_texture);
+        frame_texture = nullptr;
+    }
+
+    if (frame_texture == nullptr) {
+        frame_texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA32, SDL_TEXTUREACCESS_STREAMING, window_width, window_height);
+        if (frame_texture == nullptr) {
+            std::cerr << "[ERROR] Could not create frame texture: " << SDL_GetError() << std::endl;
+            return;
+        }
+
+        SDL_SetTextureBlendMode(frame_texture, SDL_BLENDMODE_BLEND);
+    }
+
+    SDL_FRect glyph_render_bounds;
+    calculate_glyph_render_bounds(glyph_outline, window_width, window_height, padding, glyph_render_bounds);
+
+    thread_local FlattenedOutline outline;
+    outline.clear();
+    flatten_glyph_contours(glyph_outline, glyph_render_bounds, tolerance, outline);
+    PROFILE_COUNT(SEGMENTS, outline.get_segment_count());
+
+    thread_local std::vector<Uint8> coverage;
+    rasterizer.rasterize_tiled(outline, 0.0f, 0.0f, window_width, window_height, thread_pool, coverage);
+
+    // Coverage goes into alpha so the glyph blends onto the background. At
+    // 4K this is a few million pixels, so it is split across the pool too.
+    thread_local std::vector<Uint8> pixels;
+    pixels.resize(coverage.size() * 4);
+    Uint8* pixel_data = pixels.data();
+    const Uint8* coverage_data = coverage.data();
+    size_t row_length = static_cast<size_t>(window_width);
+    thread_pool.parallel_for(window_height, GlyphRasterizer::TILE_SIZE, [&](size_t begin, size_t end) {
+        for (size_t i = begin * row_length; i < end * row_length; i++) {
+            pixel_data[i * 4 + 0] = color.r;
+            pixel_data[i * 4 + 1] = color.g;
+            pixel_data[i * 4 + 2] = color.b;
+            pixel_data[i * 4 + 3] = static_cast<Uint8>(coverage_data[i] * color.a / 255);
+        }
+    });
+
+    SDL_UpdateTexture(frame_texture, nullptr, pixel_data, window_width * 4);
+
+    SDL_FRect frame_rect = {0.0f, 0.0f, static_cast<float>(window_width), static_cast<float>(window_height)};
+    draw_list.add_texture(frame_texture, frame_rect);
+}
+
+// --------------------------------------------------------------------------
+
+void draw_glyph_hinted(DrawList& draw_list, SDL_Renderer* renderer, GlyphRasterizer& rasterizer, SDL_Texture*& hinted_texture, const GlyphOutline& pixel_outline, int window_width, int window_height, int padding, float tolerance, const SDL_Color& color) {
+    PROFILE_SCOPE(DRAW_FILLED);
+
+    int bitmap_width = pixel_outline.max_extents.x - pixel_outline.min_extents.x;
+    int bitmap_height = pixel_outline.max_extents.y - pixel_outline.min_extents.y;
+    if (bitmap_width <= 0 || bitmap_height <= 0 || window_width <= 0 || window_height <= 0) {
+        return;
+    }
+
+    float texture_width = 0.0f;
+    float texture_height = 0.0f;
+    if (hinted_texture != nullptr) {
+        SDL_GetTextureSize(hinted_texture, &texture_width, &texture_height);
+    }
+
+    if (hinted_texture != nullptr && (texture_width != bitmap_width || texture_height != bitmap_height)) {
+        SDL_DestroyTexture(hinted_texture);
+        hinted_texture = nullptr;
+    }
+
+    if (hinted_texture == nullptr) {
+        hinted_texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA32, SDL_TEXTUREACCESS_STREAMING, bitmap_width, bitmap_height);
+        if (hinted_texture == nullptr) {
+            std::cerr << "[ERROR] Could not create hinted glyph texture: " << SDL_GetError() << std::endl;
+            return;
+        }
+
+        SDL_SetTextureBlendMode(hinted_texture, SDL_BLENDMODE_BLEND);
+        SDL_SetTextureScaleMode(hinted_texture, SDL_SCALEMODE_NEAREST);
+    }
+
+    // Bounds one pixel larger than the extents make the mapping an exact
+    // 1:1 flip into bitmap space, so grid-fitted edges stay on pixel edges.
+    SDL_FRect bitmap_bounds = {0.0f, 0.0f, static_cast<float>(bitmap_width + 1), static_cast<float>(bitmap_height + 1)};
+
+    thread_local FlattenedOutline outline;
+    outline.clear();
+    flatten_glyph_contours(pixel_outline, bitmap_bounds, tolerance, outline);
+    PROFILE_COUNT(SEGMENTS, outline.get_segment_count());
+
+    thread_local std::vector<Uint8> coverage;
+    rasterizer.rasterize(outline, 0.0f, 0.0f, bitmap_width, bitmap_height, coverage);
+
+    thread_local std::vector<Uint8> pixels;
+    pixels.resize(coverage.size() * 4);
+    for (size_t i = 0; i < coverage.size(); i++) {
+        pixels[i * 4 + 0] = color.r;
+        pixels[i * 4 + 1] = color.g;
+        pixels[i * 4 + 2] = color.b;
+        pixels[i * 4 + 3] = static_cast<Uint8>(coverage[i] * color.a / 255);
+    }
+
+    SDL_UpdateTexture(hinted_texture, nullptr, pixels.data(), bitmap_width * 4);
+
+    SDL_FRect window_rect;
+    window_rect.x = padding;
+    window_rect.y = padding;
+    window_rect.w = window_width - 2 * padding;
+    window_rect.h = window_height - 2 * padding;
+
+    SDL_FRect bitmap_rect = {0.0f, 0.0f, static_cast<float>(bitmap_width), static_cast<float>(bitmap_height)};
+    SDL_FRect fitted_bitmap_rect;
+    fit_rect_inside_another_rect(bitmap_rect, window_rect, fitted_bitmap_rect);
+    draw_list.add_texture(hinted_texture, fitted_bitmap_rect);
+}
+
+// --------------------------------------------------------------------------
+
+void draw_atlas_page(DrawList& draw_list, SDL_Texture* page_texture, const GlyphAtlas& atlas, Uint16 glyph_index, int window_width, int window_height, int padding, const SDL_Color& highlight_color) {
+    PROFILE_SCOPE(DRAW_ATLAS);
+
+    SDL_FRect window_rect;
+    window_rect.x = padding;
+    window_rect.y = padding;
+    window_rect.w = window_width - 2 * padding;
+    window_rect.h = window_height - 2 * padding;
+
+    SDL_FRect page_rect = {0.0f, 0.0f, static_cast<float>(atlas.get_page_size()), static_cast<float>(atlas.get_page_size())};
+    SDL_FRect fitted_page_rect;
+    fit_rect_inside_another_rect(page_rect, window_rect, fitted_page_rect);
+
+    if (page_texture != nullptr) {
+        draw_list.add_texture(page_texture, fitted_page_rect);
+    }
+
+    if (glyph_index >= atlas.get_glyph_count()) {
+        return;
+    }
+
+    const AtlasGlyph& glyph = atlas.get_glyph(glyph_index);
+    if (glyph.width == 0) {
+        return;
+    }
+
+    float left = fitted_page_rect.x + glyph.u0 * fitted_page_rect.w;
+    float top = fitted_page_rect.y + glyph.v0 * fitted_page_rect.h;
+    float right = fitted_page_rect.x + glyph.u1 * fitted_page_rect.w;
+    float bottom = fitted_page_rect.y + glyph.v1 * fitted_page_rect.h;
+
+    const SDL_FPoint highlight[] = {{left, top}, {right, top}, {right, bottom}, {left, bottom}, {left, top}};
+    draw_list.add_polyline(highlight, 5, highlight_color);
+}
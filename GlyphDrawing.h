@@ -0,0 +1,77 @@
+#ifndef GLYPH_DRAWING_H
+#define GLYPH_DRAWING_H
+
+#include <SDL3/SDL.h>
+#include <vector>
+
+#include "DrawList.h"
+#include "Font.h"
+#include "GlyphOutline.h"
+#include "OutlineDatabase.h"
+
+class GlyphAtlas;
+class GlyphRasterizer;
+class ThreadPool;
+
+const SDL_Color OFF_CURVE_POINT_COLOR = {255, 0, 0, 255};
+
+// Linearly remap an input x in [a, b] to [u, v].
+float linear_remap(float x, float a, float b, float u, float v);
+
+void fit_rect_inside_another_rect(const SDL_FRect& inner_rect, const SDL_FRect& outer_rect, SDL_FRect& fitted_rect);
+void calculate_glyph_render_bounds(const Coordinate& min_extents, const Coordinate& max_extents, int window_width, int window_height, int padding, SDL_FRect& glyph_render_bounds);
+void calculate_glyph_render_bounds(const Glyph& glyph, int window_width, int window_height, int padding, SDL_FRect& glyph_render_bounds);
+void calculate_glyph_render_bounds(const GlyphOutline& outline, int window_width, int window_height, int padding, SDL_FRect& glyph_render_bounds);
+
+// Map every glyph or outline point from font units into glyph_render_bounds.
+void map_glyph_points(const Glyph& glyph, const SDL_FRect& glyph_render_bounds, std::vector<SDL_FPoint>& mapped_points);
+void map_outline_points(const GlyphOutline& outline, const SDL_FRect& glyph_render_bounds, std::vector<SDL_FPoint>& mapped_points);
+
+// Screen-space polylines for a glyph, one closed polyline per contour.
+// contour_ends holds one past the last point of each contour.
+struct FlattenedOutline {
+    std::vector<SDL_FPoint> points;
+    std::vector<size_t> contour_ends;
+
+    void clear();
+    size_t get_segment_count() const;
+};
+
+const int MAX_SEGMENTS_PER_CURVE = 256;
+
+// Append a quadratic Bezier as line segments to points, excluding p1 itself.
+// The segment count is chosen so the polyline stays within tolerance of the
+// true curve, in the same units as the points.
+void append_quadratic_bezier_curve(const SDL_FPoint& p1, const SDL_FPoint& p2, const SDL_FPoint& p3, float tolerance, std::vector<SDL_FPoint>& points);
+
+// Append glyph_outline's contours, mapped into glyph_render_bounds, to outline.
+// tolerance is the largest allowed distance in pixels between a curve and
+// the line segments that approximate it.
+void flatten_glyph_contours(const GlyphOutline& glyph_outline, const SDL_FRect& glyph_render_bounds, float tolerance, FlattenedOutline& outline);
+
+// These add the glyph to draw_list; nothing reaches the renderer until the
+// list is submitted. Off-curve points are always drawn in
+// OFF_CURVE_POINT_COLOR.
+void draw_glyph_points(DrawList& draw_list, const Glyph& glyph, int window_width, int window_height, int padding, const SDL_Color& color);
+void draw_glyph_points(DrawList& draw_list, const OutlineView& outline, int window_width, int window_height, int padding, const SDL_Color& color);
+void draw_glyph_lines(DrawList& draw_list, const GlyphOutline& outline, int window_width, int window_height, int padding, const SDL_Color& color);
+void draw_glyph_contours(DrawList& draw_list, const GlyphOutline& glyph_outline, int window_width, int window_height, int padding, float tolerance, const SDL_Color& color);
+
+// Rasterize the glyph with anti-aliasing, tile by tile across thread_pool,
+// into a window-sized frame texture and add it to draw_list. frame_texture
+// is reused while the window size stays the same and replaced when it
+// changes. The caller owns it and destroys it with SDL_DestroyTexture.
+void draw_glyph_filled(DrawList& draw_list, SDL_Renderer* renderer, GlyphRasterizer& rasterizer, ThreadPool& thread_pool, SDL_Texture*& frame_texture, const GlyphOutline& glyph_outline, int window_width, int window_height, int padding, float tolerance, const SDL_Color& color);
+
+// Rasterize a glyph outline in pixels, as compiled from a HintedGlyph, at
+// its actual size, one bitmap pixel per outline unit, and add it to
+// draw_list scaled up to fit the window without filtering so every pixel
+// stays visible. hinted_texture is reused while the glyph's bitmap size
+// stays the same; the caller owns it as with draw_glyph_filled.
+void draw_glyph_hinted(DrawList& draw_list, SDL_Renderer* renderer, GlyphRasterizer& rasterizer, SDL_Texture*& hinted_texture, const GlyphOutline& pixel_outline, int window_width, int window_height, int padding, float tolerance, const SDL_Color& color);
+
+// Show the atlas page texture holding glyph_index, fitted to the window,
+// with that glyph's cell outlined in highlight_color.
+void draw_atlas_page(DrawList& draw_list, SDL_Texture* page_texture, const GlyphAtlas& atlas, Uint16 glyph_index, int window_width, int window_height, int padding, const SDL_Color& highlight_color);
+
+#endif
@@ -0,0 +1,248 @@
+#include "GlyphGridView.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "Profiler.h"
+
+namespace {
+    // Fraction of the fling velocity kept after one second, and the speed
+    // below which the view comes to rest.
+    const float FLING_RETAINED_PER_SECOND = 0.05f;
+    const float FLING_STOP_VELOCITY = 20.0f;
+
+    const float FLATTEN_TOLERANCE = 0.25f;
+}
+
+// --------------------------------------------------------------------------
+
+GlyphGridView::GlyphGridView(Font& font, int cell_size)
+    : font(font),
+      cell_size(cell_size),
+      viewport_width(0),
+      viewport_height(0),
+      scroll_offset(0.0f),
+      scroll_velocity(0.0f),
+      scroll_direction(1),
+      cells_decoded(0),
+      cells_drawn(0) {
+}
+
+// --------------------------------------------------------------------------
+
+void GlyphGridView::set_viewport_size(int width, int height) {
+    viewport_width = width;
+    viewport_height = height;
+    set_scroll_offset(scroll_offset);
+}
+
+// --------------------------------------------------------------------------
+
+int GlyphGridView::get_column_count() const {
+    return std::max(1, viewport_width / cell_size);
+}
+
+// --------------------------------------------------------------------------
+
+int GlyphGridView::get_row_count() const {
+    int column_count = get_column_count();
+    return (font.get_glyph_count() + column_count - 1) / column_count;
+}
+
+// --------------------------------------------------------------------------
+
+float GlyphGridView::get_max_scroll_offset() const {
+    return std::max(0.0f, static_cast<float>(get_row_count() * cell_size - viewport_height));
+}
+
+// --------------------------------------------------------------------------
+
+void GlyphGridView::set_scroll_offset(float offset) {
+    float clamped_offset = std::clamp(offset, 0.0f, get_max_scroll_offset());
+    if (clamped_offset != scroll_offset) {
+        scroll_direction = clamped_offset > scroll_offset ? 1 : -1;
+    }
+
+    scroll_offset = clamped_offset;
+}
+
+// --------------------------------------------------------------------------
+
+void GlyphGridView::scroll_by(float pixels) {
+    set_scroll_offset(scroll_offset + pixels);
+}
+
+// --------------------------------------------------------------------------
+
+void GlyphGridView::fling(float velocity) {
+    scroll_velocity += velocity;
+}
+
+// --------------------------------------------------------------------------
+
+bool GlyphGridView::advance(float seconds) {
+    if (!is_moving()) {
+        return false;
+    }
+
+    float previous_offset = scroll_offset;
+    scroll_by(scroll_velocity * seconds);
+    scroll_velocity *= std::pow(FLING_RETAINED_PER_SECOND, seconds);
+
+    // Hitting either end of the font stops the fling dead.
+    if (std::fabs(scroll_velocity) < FLING_STOP_VELOCITY || scroll_offset == previous_offset) {
+        scroll_velocity = 0.0f;
+    }
+
+    return is_moving();
+}
+
+// --------------------------------------------------------------------------
+
+bool GlyphGridView::is_moving() const {
+    return scroll_velocity != 0.0f;
+}
+
+// --------------------------------------------------------------------------
+
+void GlyphGridView::scroll_to_glyph(Uint16 glyph_index) {
+    float cell_top = static_cast<float>(glyph_index / get_column_count() * cell_size);
+    if (cell_top < scroll_offset) {
+        set_scroll_offset(cell_top);
+    } else if (cell_top + cell_size > scroll_offset + viewport_height) {
+        set_scroll_offset(cell_top + cell_size - viewport_height);
+    }
+
+    scroll_velocity = 0.0f;
+}
+
+// --------------------------------------------------------------------------
+
+const FlattenedOutline& GlyphGridView::get_cell(Uint16 glyph_index) {
+    auto found = cells.find(glyph_index);
+    if (found != cells.end()) {
+        return found->second;
+    }
+
+    FlattenedOutline& cell = cells[glyph_index];
+
+    Glyph glyph = font.get_glyph(glyph_index);
+    glyph_outline.compile(glyph);
+
+    SDL_FRect glyph_render_bounds;
+    calculate_glyph_render_bounds(glyph_outline, cell_size, cell_size, CELL_PADDING, glyph_render_bounds);
+    flatten_glyph_contours(glyph_outline, glyph_render_bounds, FLATTEN_TOLERANCE, cell);
+
+    cells_decoded++;
+    return cell;
+}
+
+// --------------------------------------------------------------------------
+
+void GlyphGridView::evict_cells_outside(int first_row, int last_row) {
+    int column_count = get_column_count();
+    size_t kept_cell_limit = static_cast<size_t>(last_row - first_row + 1) * column_count * 2;
+    if (cells.size() <= kept_cell_limit) {
+        return;
+    }
+
+    for (auto it = cells.begin(); it != cells.end();) {
+        int row = it->first / column_count;
+        if (row < first_row || row > last_row) {
+            it = cells.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+// --------------------------------------------------------------------------
+
+void GlyphGridView::draw(DrawList& draw_list, Uint16 highlighted_glyph_index, const SDL_Color& color, const SDL_Color& highlight_color) {
+    PROFILE_SCOPE(DRAW_GRID);
+    cells_decoded = 0;
+    cells_drawn = 0;
+
+    int column_count = get_column_count();
+    int row_count = get_row_count();
+    int glyph_count = font.get_glyph_count();
+    if (row_count == 0 || viewport_height <= 0) {
+        return;
+    }
+
+    float left_margin = (viewport_width - column_count * cell_size) / 2.0f;
+    int first_visible_row = static_cast<int>(scroll_offset) / cell_size;
+    int last_visible_row = std::min(row_count - 1, static_cast<int>(scroll_offset + viewport_height - 1) / cell_size);
+
+    for (int row = first_visible_row; row <= last_visible_row; row++) {
+        float cell_y = row * cell_size - scroll_offset;
+
+        for (int column = 0; column < column_count; column++) {
+            int glyph_index = row * column_count + column;
+            if (glyph_index >= glyph_count) {
+                break;
+            }
+
+            float cell_x = left_margin + column * cell_size;
+            const FlattenedOutline& cell = get_cell(static_cast<Uint16>(glyph_index));
+            PROFILE_COUNT(SEGMENTS, cell.get_segment_count());
+
+            size_t contour_start = 0;
+            for (size_t contour_end : cell.contour_ends) {
+                draw_list.add_polyline(cell.points.data() + contour_start, contour_end - contour_start, cell_x, cell_y, color);
+                contour_start = contour_end;
+            }
+
+            if (glyph_index == highlighted_glyph_index) {
+                float right = cell_x + cell_size - 1;
+                float bottom = cell_y + cell_size - 1;
+                const SDL_FPoint highlight[] = {{cell_x, cell_y}, {right, cell_y}, {right, bottom}, {cell_x, bottom}, {cell_x, cell_y}};
+                draw_list.add_polyline(highlight, 5, highlight_color);
+            }
+
+            cells_drawn++;
+        }
+    }
+
+    // Get a few rows ahead in the scroll direction ready, a handful of cells
+    // per frame so that a fast scroll doesn't turn into one long frame.
+    int prefetched_cell_count = 0;
+    for (int step = 1; step <= OVERSCAN_ROWS && prefetched_cell_count < MAX_PREFETCHED_CELLS_PER_FRAME; step++) {
+        int row = scroll_direction > 0 ? last_visible_row + step : first_visible_row - step;
+        if (row < 0 || row >= row_count) {
+            break;
+        }
+
+        for (int column = 0; column < column_count && prefetched_cell_count < MAX_PREFETCHED_CELLS_PER_FRAME; column++) {
+            int glyph_index = row * column_count + column;
+            if (glyph_index >= glyph_count) {
+                break;
+            }
+
+            if (cells.find(static_cast<Uint16>(glyph_index)) == cells.end()) {
+                get_cell(static_cast<Uint16>(glyph_index));
+                prefetched_cell_count++;
+            }
+        }
+    }
+
+    evict_cells_outside(first_visible_row - OVERSCAN_ROWS, last_visible_row + OVERSCAN_ROWS);
+}
+
+// --------------------------------------------------------------------------
+
+int GlyphGridView::get_cells_decoded() const {
+    return cells_decoded;
+}
+
+// --------------------------------------------------------------------------
+
+int GlyphGridView::get_cells_drawn() const {
+    return cells_drawn;
+}
+
+// --------------------------------------------------------------------------
+
+size_t GlyphGridView::get_cached_cell_count() const {
+    return cells.size();
+}
@@ -0,0 +1,71 @@
+#ifndef GLYPH_GRID_VIEW_H
+#define GLYPH_GRID_VIEW_H
+
+#include <SDL3/SDL.h>
+#include <unordered_map>
+
+#include "DrawList.h"
+#include "Font.h"
+#include "GlyphDrawing.h"
+#include "GlyphOutline.h"
+
+// Scrollable grid of every glyph in the font, one square cell per glyph.
+// Only cells in or just past the viewport are ever decoded and flattened,
+// and each cell's geometry is kept in cell-local coordinates so scrolling
+// only translates it. Cells that fall far out of view are dropped again.
+class GlyphGridView {
+
+public:
+
+    GlyphGridView(Font& font, int cell_size);
+
+    void set_viewport_size(int width, int height);
+    int get_column_count() const;
+
+    void scroll_by(float pixels);
+
+    // Start scrolling at velocity pixels per second, slowing down under
+    // friction; advance() moves the view on and returns whether it is still
+    // moving.
+    void fling(float velocity);
+    bool advance(float seconds);
+    bool is_moving() const;
+
+    // Scroll as little as needed to bring the glyph's cell into view.
+    void scroll_to_glyph(Uint16 glyph_index);
+
+    void draw(DrawList& draw_list, Uint16 highlighted_glyph_index, const SDL_Color& color, const SDL_Color& highlight_color);
+
+    // Counters for the most recent draw().
+    int get_cells_decoded() const;
+    int get_cells_drawn() const;
+    size_t get_cached_cell_count() const;
+
+private:
+
+    static const int OVERSCAN_ROWS = 2;
+    static const int MAX_PREFETCHED_CELLS_PER_FRAME = 16;
+    static const int CELL_PADDING = 6;
+
+    Font& font;
+    int cell_size;
+    int viewport_width;
+    int viewport_height;
+    float scroll_offset;
+    float scroll_velocity;
+    int scroll_direction;
+
+    // Flattened glyph outlines in cell-local coordinates.
+    std::unordered_map<Uint16, FlattenedOutline> cells;
+    GlyphOutline glyph_outline;
+    int cells_decoded;
+    int cells_drawn;
+
+    int get_row_count() const;
+    float get_max_scroll_offset() const;
+    void set_scroll_offset(float offset);
+    const FlattenedOutline& get_cell(Uint16 glyph_index);
+    void evict_cells_outside(int first_row, int last_row);
+};
+
+#endif
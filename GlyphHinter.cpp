@@ -0,0 +1,557 @@
+#include "GlyphHinter.h"
+
+#include <algorithm>
+#include <iostream>
+
+#include "BigEndianReader.h"
+#include "Profiler.h"
+
+namespace {
+    // Font units to 26.6 pixels as 16.16 fixed point, rounded.
+    Sint32 get_scale(int pixel_size, Uint16 units_per_em) {
+        Sint64 scale = ((static_cast<Sint64>(pixel_size) * 64 << 16) + units_per_em / 2) / units_per_em;
+        return scale > 0x7FFFFFFF ? 0x7FFFFFFF : static_cast<Sint32>(scale);
+    }
+
+    Sint32 round_to_pixel(Sint32 value) {
+        return (value + 32) & -64;
+    }
+
+    // Glyph programs start from whole-pixel metrics. Only the current
+    // phantom points are rounded; the original ones stay where scaling put
+    // them.
+    void round_phantom_points(HintingZone& zone) {
+        size_t first_point = zone.get_point_count() - 4;
+        zone.current[first_point].x = round_to_pixel(zone.current[first_point].x);
+        zone.current[first_point + 1].x = round_to_pixel(zone.current[first_point + 1].x);
+        zone.current[first_point + 2].y = round_to_pixel(zone.current[first_point + 2].y);
+        zone.current[first_point + 3].y = round_to_pixel(zone.current[first_point + 3].y);
+    }
+
+    // value times a 2.14 factor, rounded.
+    Sint32 multiply_2dot14(Sint32 value, Sint32 factor) {
+        Sint64 product = static_cast<Sint64>(value) * factor;
+        return static_cast<Sint32>((product + (product < 0 ? 0x1FFF : 0x2000)) >> 14);
+    }
+
+    struct ComponentTransform {
+        Sint32 xx;
+        Sint32 xy;
+        Sint32 yx;
+        Sint32 yy;
+
+        bool is_identity() const {
+            return xx == 0x4000 && xy == 0 && yx == 0 && yy == 0x4000;
+        }
+
+        HintingVector apply(const HintingVector& point) const {
+            if (is_identity()) {
+                return point;
+            }
+            return {
+                multiply_2dot14(point.x, xx) + multiply_2dot14(point.y, yx),
+                multiply_2dot14(point.x, xy) + multiply_2dot14(point.y, yy),
+            };
+        }
+    };
+}
+
+// --------------------------------------------------------------------------
+
+HintedGlyph::HintedGlyph()
+    : glyph_index(0),
+      pixel_size(0),
+      is_hinted(false),
+      advance_width(0.0f) {
+}
+
+// --------------------------------------------------------------------------
+
+// One thread's scratch for loading glyphs, reused from glyph to glyph so
+// steady-state hinting doesn't allocate. state is the size's state copied
+// in at the start of each glyph, since glyph programs may change it.
+// glyph_chain holds the glyph being loaded at each depth, so a component
+// that refers back to one of them can be left out.
+struct GlyphHinter::LoadContext {
+    const HintingSize* size;
+    Sint32 scale;
+    bool should_hint;
+
+    HintingInterpreter interpreter;
+    HintingState state;
+    HintingZone zones[MAX_COMPOSITE_DEPTH + 1];
+    Uint16 glyph_chain[MAX_COMPOSITE_DEPTH + 1];
+    int component_load_count;
+};
+
+// --------------------------------------------------------------------------
+
+GlyphHinter::GlyphHinter(Font& font)
+    : font(font),
+      units_per_em(font.get_units_per_em()),
+      font_program(nullptr),
+      font_program_length(0),
+      control_value_program(nullptr),
+      control_value_program_length(0),
+      vertical_ascender(font.get_ascender()),
+      vertical_descender(font.get_descender()),
+      has_maximum_profile(false),
+      max_stack_depth(0),
+      storage_size(0),
+      twilight_point_count(0),
+      failed_program_count(0) {
+    const std::shared_ptr<FontFile>& file = font.get_file();
+    if (file == nullptr || font.get_face_index() >= file->get_face_count() || units_per_em == 0) {
+        return;
+    }
+
+    const TableDirectory& directory = file->get_table_directory(font.get_face_index());
+    BigEndianReader reader(file->get_data(), file->get_size());
+
+    // Only a version 1.0 maxp has the sizes the interpreter needs; a 0.5
+    // one belongs to a font without TrueType outlines.
+    const TableDirectory::Entry* maxp = directory.find(TableTag::MAXP);
+    if (maxp == nullptr || maxp->length < 32 || reader.peek_u32(maxp->offset) != 0x00010000) {
+        return;
+    }
+
+    has_maximum_profile = true;
+    twilight_point_count = reader.peek_u16(maxp->offset + 16) + 4;
+    storage_size = reader.peek_u16(maxp->offset + 18);
+
+    // Plenty of fonts need a few more stack entries than they declare.
+    max_stack_depth = reader.peek_u16(maxp->offset + 24) + 32;
+
+    const TableDirectory::Entry* fpgm = directory.find(TableTag::FPGM);
+    if (fpgm != nullptr) {
+        font_program = file->get_data() + fpgm->offset;
+        font_program_length = fpgm->length;
+    }
+
+    const TableDirectory::Entry* prep = directory.find(TableTag::PREP);
+    if (prep != nullptr) {
+        control_value_program = file->get_data() + prep->offset;
+        control_value_program_length = prep->length;
+    }
+
+    const TableDirectory::Entry* os2 = directory.find(TableTag::OS2);
+    if (os2 != nullptr && os2->length >= 72) {
+        vertical_ascender = static_cast<Sint16>(reader.peek_u16(os2->offset + 68));
+        vertical_descender = static_cast<Sint16>(reader.peek_u16(os2->offset + 70));
+    }
+
+    const TableDirectory::Entry* cvt = directory.find(TableTag::CVT);
+    if (cvt != nullptr) {
+        control_value_units.resize(cvt->length / 2);
+        reader.seek(cvt->offset);
+        reader.read_s16_array(control_value_units.data(), control_value_units.size());
+    }
+}
+
+// --------------------------------------------------------------------------
+
+bool GlyphHinter::has_instructions() const {
+    return has_maximum_profile;
+}
+
+// --------------------------------------------------------------------------
+
+bool GlyphHinter::prepare_size(int pixel_size) {
+    if (!has_maximum_profile || pixel_size <= 0) {
+        return false;
+    }
+
+    return get_size(pixel_size)->is_hinting_enabled;
+}
+
+// --------------------------------------------------------------------------
+
+bool GlyphHinter::load_glyph(Uint16 glyph_index, int pixel_size, bool should_hint, HintedGlyph& hinted_glyph) {
+    PROFILE_SCOPE(HINT_GLYPH);
+
+    hinted_glyph.glyph_index = glyph_index;
+    hinted_glyph.pixel_size = pixel_size;
+    hinted_glyph.is_hinted = false;
+    hinted_glyph.advance_width = 0.0f;
+    hinted_glyph.x_coordinates.clear();
+    hinted_glyph.y_coordinates.clear();
+    hinted_glyph.on_curve_flags.clear();
+    hinted_glyph.end_point_indices.clear();
+
+    if (pixel_size <= 0 || units_per_em == 0) {
+        return false;
+    }
+
+    // Held for the whole load so the size can't go away underneath it.
+    std::shared_ptr<const HintingSize> size;
+    if (should_hint && has_maximum_profile) {
+        size = get_size(pixel_size);
+    }
+
+    thread_local LoadContext context;
+    context.size = size.get();
+    context.scale = get_scale(pixel_size, units_per_em);
+    context.should_hint = size != nullptr && size->is_hinting_enabled;
+
+    if (context.should_hint) {
+        context.state = size->state;
+    }
+
+    context.component_load_count = 0;
+    load_zone(glyph_index, 0, context);
+
+    // The outline is moved so the hinted left side bearing point is the
+    // origin, and the advance is the hinted distance between the two
+    // horizontal phantom points, rounded to whole pixels.
+    const HintingZone& zone = context.zones[0];
+    size_t point_count = zone.get_point_count() - 4;
+    Sint32 origin_x = zone.current[point_count].x;
+    Sint32 advance_width = zone.current[point_count + 1].x - origin_x;
+    if (context.should_hint) {
+        advance_width = round_to_pixel(advance_width);
+    }
+    hinted_glyph.advance_width = advance_width / 64.0f;
+
+    hinted_glyph.x_coordinates.resize(point_count);
+    hinted_glyph.y_coordinates.resize(point_count);
+    hinted_glyph.on_curve_flags.resize(point_count);
+    for (size_t i = 0; i < point_count; i++) {
+        hinted_glyph.x_coordinates[i] = (zone.current[i].x - origin_x) / 64.0f;
+        hinted_glyph.y_coordinates[i] = zone.current[i].y / 64.0f;
+        hinted_glyph.on_curve_flags[i] = zone.flags[i] & HintingZone::ON_CURVE;
+    }
+    hinted_glyph.end_point_indices = zone.end_point_indices;
+
+    hinted_glyph.is_hinted = context.should_hint;
+    return hinted_glyph.is_hinted;
+}
+
+// --------------------------------------------------------------------------
+
+size_t GlyphHinter::get_prepared_size_count() {
+    std::lock_guard<std::mutex> lock(sizes_mutex);
+    return sizes.size();
+}
+
+// --------------------------------------------------------------------------
+
+Uint64 GlyphHinter::get_failed_program_count() const {
+    return failed_program_count.load();
+}
+
+// --------------------------------------------------------------------------
+
+std::shared_ptr<const GlyphHinter::HintingSize> GlyphHinter::get_size(int pixel_size) {
+    // Sizes are few and prep is quick, so a size is created under the lock
+    // and anyone else wanting it waits rather than running prep twice.
+    std::lock_guard<std::mutex> lock(sizes_mutex);
+
+    auto found_size = sizes.find(pixel_size);
+    if (found_size != sizes.end()) {
+        return found_size->second;
+    }
+
+    std::shared_ptr<const HintingSize> size = create_size(pixel_size);
+    sizes.emplace(pixel_size, size);
+    return size;
+}
+
+// --------------------------------------------------------------------------
+
+std::shared_ptr<const GlyphHinter::HintingSize> GlyphHinter::create_size(int pixel_size) {
+    std::shared_ptr<HintingSize> size = std::make_shared<HintingSize>();
+    size->pixel_size = pixel_size;
+    size->is_hinting_enabled = false;
+
+    HintingState& state = size->state;
+    state.ppem = pixel_size;
+    state.scale = get_scale(pixel_size, units_per_em);
+    state.units_scale = state.scale;
+    state.storage.assign(storage_size, 0);
+    state.twilight_zone.resize(twilight_point_count);
+
+    state.control_values.resize(control_value_units.size());
+    for (size_t i = 0; i < control_value_units.size(); i++) {
+        state.control_values[i] = HintingInterpreter::scale_font_units(control_value_units[i], state.scale);
+    }
+
+    // fpgm runs at each size rather than once per font because it may look
+    // at the size, but either way it only defines functions and storage.
+    HintingInterpreter interpreter;
+    HintingZone glyph_zone;
+    if (font_program_length > 0) {
+        if (!interpreter.execute(font_program, font_program_length, HintingInterpreter::Program::FONT, max_stack_depth, size->functions, &size->functions, state, glyph_zone)) {
+            std::cerr << "[ERROR] Font program failed at " << pixel_size << " px, glyphs will not be hinted: " << interpreter.get_error() << std::endl;
+            return size;
+        }
+    }
+
+    state.graphics_state = HintingGraphicsState();
+    if (control_value_program_length > 0) {
+        if (!interpreter.execute(control_value_program, control_value_program_length, HintingInterpreter::Program::CONTROL_VALUE, max_stack_depth, size->functions, &size->functions, state, glyph_zone)) {
+            std::cerr << "[ERROR] Control value program failed at " << pixel_size << " px, glyphs will not be hinted: " << interpreter.get_error() << std::endl;
+            return size;
+        }
+    }
+
+    // Whatever prep leaves in the graphics state becomes every glyph's
+    // default, except for what each glyph program starts over anyway.
+    state.graphics_state.reset_for_glyph();
+
+    // Bit 0 of INSTCTRL turns glyph programs off at this size.
+    size->is_hinting_enabled = (state.graphics_state.instruct_control & 0x01) == 0;
+    return size;
+}
+
+// --------------------------------------------------------------------------
+
+void GlyphHinter::load_zone(Uint16 glyph_index, int depth, LoadContext& context) {
+    HintingZone& zone = context.zones[depth];
+    zone.clear();
+    context.glyph_chain[depth] = glyph_index;
+
+    const Uint8* program = nullptr;
+    size_t program_length = 0;
+    bool is_composite = false;
+
+    Uint32 glyph_length = 0;
+    const Uint8* glyph_data = font.get_glyph_data(glyph_index, glyph_length);
+    if (glyph_data == nullptr) {
+        append_phantom_points(glyph_index, 0, context, zone);
+    } else if (static_cast<Sint16>((glyph_data[0] << 8) | glyph_data[1]) >= 0) {
+        load_simple_zone(glyph_index, glyph_data, glyph_length, context, zone, program, program_length);
+    } else {
+        is_composite = true;
+        load_composite_zone(glyph_index, glyph_data, glyph_length, depth, context, zone, program, program_length);
+    }
+
+    if (!context.should_hint || program_length == 0) {
+        return;
+    }
+
+    // Every program, a component's or the composite's, starts from the
+    // size's graphics state; bit 1 of INSTCTRL has glyphs ignore the one
+    // prep set up.
+    HintingState& state = context.state;
+    if (context.size->state.graphics_state.instruct_control & 0x02) {
+        state.graphics_state = HintingGraphicsState();
+    } else {
+        state.graphics_state = context.size->state.graphics_state;
+    }
+    state.units_scale = is_composite ? 0x10000 : context.scale;
+
+    if (!context.interpreter.execute(program, program_length, HintingInterpreter::Program::GLYPH, max_stack_depth, context.size->functions, nullptr, state, zone)) {
+        failed_program_count++;
+        zone.current = zone.original;
+    }
+}
+
+// --------------------------------------------------------------------------
+
+void GlyphHinter::load_simple_zone(Uint16 glyph_index, const Uint8* glyph_data, Uint32 glyph_length, LoadContext& context, HintingZone& zone, const Uint8*& program, size_t& program_length) {
+    BigEndianReader reader(glyph_data, glyph_length);
+    Sint16 num_contours = reader.read_s16();
+    Sint16 min_x = reader.read_s16();
+
+    Glyph glyph = font.get_glyph(glyph_index);
+
+    zone.resize(glyph.num_points);
+    for (int i = 0; i < glyph.num_points; i++) {
+        HintingVector units = {glyph.x_coordinates[i], glyph.y_coordinates[i]};
+        zone.original_units[i] = units;
+        zone.original[i].x = HintingInterpreter::scale_font_units(units.x, context.scale);
+        zone.original[i].y = HintingInterpreter::scale_font_units(units.y, context.scale);
+        zone.current[i] = zone.original[i];
+        zone.flags[i] = glyph.is_on_curve(i) ? HintingZone::ON_CURVE : 0;
+    }
+    zone.end_point_indices.assign(glyph.end_point_indices, glyph.end_point_indices + glyph.num_end_point_indices);
+
+    append_phantom_points(glyph_index, min_x, context, zone);
+    if (context.should_hint) {
+        round_phantom_points(zone);
+    }
+
+    // The instructions sit between the contour end points and the flags,
+    // and get_glyph_data has already checked they fit.
+    if (num_contours > 0) {
+        reader.seek(10 + 2 * static_cast<size_t>(num_contours));
+        program_length = reader.read_u16();
+        program = reader.get_current();
+    }
+}
+
+// --------------------------------------------------------------------------
+
+void GlyphHinter::load_composite_zone(Uint16 glyph_index, const Uint8* glyph_data, Uint32 glyph_length, int depth, LoadContext& context, HintingZone& zone, const Uint8*& program, size_t& program_length) {
+    BigEndianReader reader(glyph_data, glyph_length);
+    reader.skip(2);
+    Sint16 min_x = reader.read_s16();
+    reader.seek(10);
+
+    // With USE_MY_METRICS the composite takes a component's phantom points,
+    // as hinted with that component.
+    bool has_component_metrics = false;
+    HintingVector metrics_units[4];
+    HintingVector metrics[4];
+
+    Uint16 flags;
+    do {
+        flags = reader.read_u16();
+        Uint16 component_glyph_index = reader.read_u16();
+
+        Sint32 argument_1;
+        Sint32 argument_2;
+        bool are_arguments_words = (flags & COMPOSITE_ARG_1_AND_2_ARE_WORDS) != 0;
+        bool are_arguments_offsets = (flags & COMPOSITE_ARGS_ARE_XY_VALUES) != 0;
+        if (are_arguments_words) {
+            argument_1 = are_arguments_offsets ? reader.read_s16() : reader.read_u16();
+            argument_2 = are_arguments_offsets ? reader.read_s16() : reader.read_u16();
+        } else {
+            argument_1 = are_arguments_offsets ? reader.read_s8() : reader.read_u8();
+            argument_2 = are_arguments_offsets ? reader.read_s8() : reader.read_u8();
+        }
+
+        ComponentTransform transform = {0x4000, 0, 0, 0x4000};
+        if (flags & COMPOSITE_WE_HAVE_A_SCALE) {
+            transform.xx = reader.read_s16();
+            transform.yy = transform.xx;
+        } else if (flags & COMPOSITE_WE_HAVE_AN_X_AND_Y_SCALE) {
+            transform.xx = reader.read_s16();
+            transform.yy = reader.read_s16();
+        } else if (flags & COMPOSITE_WE_HAVE_A_TWO_BY_TWO) {
+            transform.xx = reader.read_s16();
+            transform.xy = reader.read_s16();
+            transform.yx = reader.read_s16();
+            transform.yy = reader.read_s16();
+        }
+
+        // Composites can nest, but not this deep in any real font, and never
+        // back into a glyph that is still loading. The load budget bounds
+        // the work a wide, deep tree of distinct glyphs can cause.
+        if (depth >= MAX_COMPOSITE_DEPTH || context.component_load_count >= MAX_COMPONENT_LOADS) {
+            continue;
+        }
+
+        Uint16* chain_end = context.glyph_chain + depth + 1;
+        if (std::find(context.glyph_chain, chain_end, component_glyph_index) != chain_end) {
+            continue;
+        }
+
+        context.component_load_count++;
+        load_zone(component_glyph_index, depth + 1, context);
+        const HintingZone& component = context.zones[depth + 1];
+        size_t component_point_count = component.get_point_count() - 4;
+        size_t first_point = zone.get_point_count();
+        if (first_point + component_point_count > 0xFFFF) {
+            continue;
+        }
+
+        // Offsets are scaled like any other distance and, if the component
+        // asks, rounded so hinting inside the component isn't undone.
+        HintingVector offset_units = {0, 0};
+        HintingVector offset = {0, 0};
+        if (are_arguments_offsets) {
+            offset_units = {argument_1, argument_2};
+            if (!transform.is_identity() && (flags & COMPOSITE_SCALED_COMPONENT_OFFSET) && !(flags & COMPOSITE_UNSCALED_COMPONENT_OFFSET)) {
+                offset_units = transform.apply(offset_units);
+            }
+
+            offset.x = HintingInterpreter::scale_font_units(offset_units.x, context.scale);
+            offset.y = HintingInterpreter::scale_font_units(offset_units.y, context.scale);
+            if (context.should_hint && (flags & COMPOSITE_ROUND_XY_TO_GRID)) {
+                offset.x = round_to_pixel(offset.x);
+                offset.y = round_to_pixel(offset.y);
+            }
+        } else {
+            // Point matching lines up the hinted points, so the component
+            // lands wherever hinting put the point it attaches to.
+            size_t parent_point = static_cast<size_t>(argument_1);
+            size_t child_point = static_cast<size_t>(argument_2);
+            if (parent_point < first_point && child_point < component_point_count) {
+                HintingVector child = transform.apply(component.current[child_point]);
+                HintingVector child_units = transform.apply(component.original_units[child_point]);
+                offset = {zone.current[parent_point].x - child.x, zone.current[parent_point].y - child.y};
+                offset_units = {zone.original_units[parent_point].x - child_units.x, zone.original_units[parent_point].y - child_units.y};
+            }
+        }
+
+        zone.resize(first_point + component_point_count);
+        for (size_t i = 0; i < component_point_count; i++) {
+            HintingVector units = transform.apply(component.original_units[i]);
+            HintingVector point = transform.apply(component.current[i]);
+            zone.original_units[first_point + i] = {units.x + offset_units.x, units.y + offset_units.y};
+            zone.current[first_point + i] = {point.x + offset.x, point.y + offset.y};
+            zone.original[first_point + i] = zone.current[first_point + i];
+            zone.flags[first_point + i] = component.flags[i] & HintingZone::ON_CURVE;
+        }
+
+        for (Uint16 end_point_index : component.end_point_indices) {
+            zone.end_point_indices.push_back(static_cast<Uint16>(first_point + end_point_index));
+        }
+
+        if (flags & COMPOSITE_USE_MY_METRICS) {
+            has_component_metrics = true;
+            for (int i = 0; i < 4; i++) {
+                metrics_units[i] = component.original_units[component_point_count + i];
+                metrics[i] = component.current[component_point_count + i];
+            }
+        }
+    } while (flags & COMPOSITE_MORE_COMPONENTS);
+
+    append_phantom_points(glyph_index, min_x, context, zone);
+    if (has_component_metrics) {
+        size_t phantom_point = zone.get_point_count() - 4;
+        for (int i = 0; i < 4; i++) {
+            zone.original_units[phantom_point + i] = metrics_units[i];
+            zone.original[phantom_point + i] = metrics[i];
+            zone.current[phantom_point + i] = metrics[i];
+        }
+    }
+
+    // The composite's own program follows the last component; validation
+    // doesn't cover it, so it is checked here. It sees the hinted
+    // components as its original outline, in font units too, with nothing
+    // touched yet. Without one the phantom points aren't rounded, as in
+    // FreeType.
+    if (!context.should_hint || !(flags & COMPOSITE_WE_HAVE_INSTRUCTIONS) || reader.get_position() + 2 > glyph_length) {
+        return;
+    }
+
+    size_t instruction_length = reader.read_u16();
+    if (reader.get_position() + instruction_length > glyph_length) {
+        return;
+    }
+
+    program = reader.get_current();
+    program_length = instruction_length;
+
+    for (size_t i = 0; i < zone.get_point_count(); i++) {
+        zone.original[i] = zone.current[i];
+        zone.original_units[i] = zone.current[i];
+        zone.flags[i] &= HintingZone::ON_CURVE;
+    }
+    round_phantom_points(zone);
+}
+
+// --------------------------------------------------------------------------
+
+void GlyphHinter::append_phantom_points(Uint16 glyph_index, Sint16 min_x, LoadContext& context, HintingZone& zone) {
+    Sint32 left_side_bearing_x = min_x - font.get_left_side_bearing(glyph_index);
+    HintingVector phantom_points[4] = {
+        {left_side_bearing_x, 0},
+        {left_side_bearing_x + font.get_advance_width(glyph_index), 0},
+        {0, vertical_ascender},
+        {0, vertical_descender},
+    };
+
+    size_t first_point = zone.get_point_count();
+    zone.resize(first_point + 4);
+    for (int i = 0; i < 4; i++) {
+        HintingVector& point = zone.original[first_point + i];
+        zone.original_units[first_point + i] = phantom_points[i];
+        point.x = HintingInterpreter::scale_font_units(phantom_points[i].x, context.scale);
+        point.y = HintingInterpreter::scale_font_units(phantom_points[i].y, context.scale);
+        zone.current[first_point + i] = point;
+        zone.flags[first_point + i] = 0;
+    }
+}
@@ -0,0 +1,143 @@
+#ifndef GLYPH_HINTER_H
+#define GLYPH_HINTER_H
+
+#include <SDL3/SDL.h>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "Font.h"
+#include "HintingInterpreter.h"
+
+// A glyph scaled to a pixel size, grid-fitted by its TrueType instructions
+// when is_hinted is set. Coordinates are in pixels, y up, with the origin
+// on the baseline at the hinted left side bearing point.
+struct HintedGlyph {
+    Uint16 glyph_index;
+    int pixel_size;
+    bool is_hinted;
+    float advance_width;
+
+    std::vector<float> x_coordinates;
+    std::vector<float> y_coordinates;
+    std::vector<Uint8> on_curve_flags;
+    std::vector<Uint16> end_point_indices;
+
+    HintedGlyph();
+
+    size_t get_point_count() const { return x_coordinates.size(); }
+};
+
+// Runs a font's TrueType programs. The font program (fpgm) and control value
+// program (prep) only depend on the pixel size, so the first glyph at each
+// size runs them and keeps what they leave behind: the functions they
+// defined, the scaled and adjusted control values, storage, the twilight
+// zone and the graphics state defaults. Every glyph at that size starts from
+// a copy of that, so hinting a glyph only costs its own program.
+//
+// load_glyph can be called from several threads at once; each thread keeps
+// its own interpreter and scratch zones.
+class GlyphHinter {
+
+public:
+
+    explicit GlyphHinter(Font& font);
+
+    GlyphHinter(const GlyphHinter&) = delete;
+    GlyphHinter& operator=(const GlyphHinter&) = delete;
+
+    // False if the font has no version 1.0 maxp table, without which it
+    // can't carry instructions.
+    bool has_instructions() const;
+
+    // Run the font and control value programs for pixel_size now rather
+    // than on the first glyph at that size. Returns whether glyphs at that
+    // size will be hinted, which they aren't if either program failed or
+    // the control value program turned instructions off.
+    bool prepare_size(int pixel_size);
+
+    // Scale glyph_index to pixel_size into hinted_glyph, running its
+    // instructions if should_hint is set and the size allows it. Returns
+    // whether it was hinted. A glyph program that fails leaves its points
+    // where scaling put them.
+    bool load_glyph(Uint16 glyph_index, int pixel_size, bool should_hint, HintedGlyph& hinted_glyph);
+
+    size_t get_prepared_size_count();
+    Uint64 get_failed_program_count() const;
+
+private:
+
+    // The state fpgm and prep left behind at one pixel size. functions is
+    // this size's own table since prep may define functions too.
+    struct HintingSize {
+        int pixel_size;
+        bool is_hinting_enabled;
+        HintingFunctionTable functions;
+        HintingState state;
+    };
+
+    struct LoadContext;
+
+    static const int MAX_COMPOSITE_DEPTH = 8;
+
+    // Components loaded for one glyph, after which the rest are left out.
+    static const int MAX_COMPONENT_LOADS = 1024;
+
+    static const Uint16 COMPOSITE_ARG_1_AND_2_ARE_WORDS = 0x0001;
+    static const Uint16 COMPOSITE_ARGS_ARE_XY_VALUES = 0x0002;
+    static const Uint16 COMPOSITE_ROUND_XY_TO_GRID = 0x0004;
+    static const Uint16 COMPOSITE_WE_HAVE_A_SCALE = 0x0008;
+    static const Uint16 COMPOSITE_MORE_COMPONENTS = 0x0020;
+    static const Uint16 COMPOSITE_WE_HAVE_AN_X_AND_Y_SCALE = 0x0040;
+    static const Uint16 COMPOSITE_WE_HAVE_A_TWO_BY_TWO = 0x0080;
+    static const Uint16 COMPOSITE_WE_HAVE_INSTRUCTIONS = 0x0100;
+    static const Uint16 COMPOSITE_USE_MY_METRICS = 0x0200;
+    static const Uint16 COMPOSITE_SCALED_COMPONENT_OFFSET = 0x0800;
+    static const Uint16 COMPOSITE_UNSCALED_COMPONENT_OFFSET = 0x1000;
+
+    Font& font;
+    Uint16 units_per_em;
+
+    // Straight out of the font file; empty if the font lacks them.
+    const Uint8* font_program;
+    size_t font_program_length;
+    const Uint8* control_value_program;
+    size_t control_value_program_length;
+    std::vector<Sint16> control_value_units;
+
+    // Where the vertical phantom points go: the typographic ascender and
+    // descender from OS/2, or hhea's without one. vmtx isn't read.
+    Sint16 vertical_ascender;
+    Sint16 vertical_descender;
+
+    bool has_maximum_profile;
+    int max_stack_depth;
+    size_t storage_size;
+    size_t twilight_point_count;
+
+    std::mutex sizes_mutex;
+    std::unordered_map<int, std::shared_ptr<const HintingSize>> sizes;
+
+    std::atomic<Uint64> failed_program_count;
+
+    std::shared_ptr<const HintingSize> get_size(int pixel_size);
+    std::shared_ptr<const HintingSize> create_size(int pixel_size);
+
+    // Fill context's zone at depth with glyph_index's points in 26.6,
+    // followed by its four phantom points, and hint it. Components of a
+    // composite are loaded, and hinted, one depth further down.
+    void load_zone(Uint16 glyph_index, int depth, LoadContext& context);
+
+    // These leave the glyph's own program, if it has one, for load_zone to
+    // run once the zone is complete.
+    void load_simple_zone(Uint16 glyph_index, const Uint8* glyph_data, Uint32 glyph_length, LoadContext& context, HintingZone& zone, const Uint8*& program, size_t& program_length);
+    void load_composite_zone(Uint16 glyph_index, const Uint8* glyph_data, Uint32 glyph_length, int depth, LoadContext& context, HintingZone& zone, const Uint8*& program, size_t& program_length);
+
+    // Append the phantom points: the left side bearing and advance points
+    // on the baseline, then the vertical ascender and descender points.
+    void append_phantom_points(Uint16 glyph_index, Sint16 min_x, LoadContext& context, HintingZone& zone);
+};
+
+#endif
@@ -0,0 +1,191 @@
+#include "GlyphLoader.h"
+
+#include <utility>
+
+#include "GlyphCache.h"
+#include "OutlineCache.h"
+#include "ThreadPool.h"
+
+GlyphLoader::GlyphLoader(GlyphCache& glyph_cache, std::shared_ptr<const OutlineCache> outline_cache, ThreadPool& thread_pool, std::function<void()> on_ready)
+    : glyph_cache(glyph_cache),
+      outline_cache(std::move(outline_cache)),
+      thread_pool(thread_pool),
+      on_ready(std::move(on_ready)),
+      request_sequence(0),
+      requested_glyph_index(0),
+      has_pending_request(false),
+      posted_request(0),
+      ready_glyph(nullptr),
+      is_job_scheduled(false),
+      handled_request(0),
+      is_stopping(false),
+      running_job_count(0),
+      loaded_count(0),
+      cancelled_count(0),
+      skipped_count(0) {
+}
+
+// --------------------------------------------------------------------------
+
+GlyphLoader::~GlyphLoader() {
+    is_stopping = true;
+
+    {
+        std::unique_lock<std::mutex> lock(job_mutex);
+        job_condition.wait(lock, [&] {
+            return running_job_count == 0;
+        });
+    }
+
+    delete ready_glyph.exchange(nullptr);
+}
+
+// --------------------------------------------------------------------------
+
+std::unique_ptr<GlyphLoader::LoadedGlyph> GlyphLoader::load(Uint16 glyph_index) {
+    std::unique_ptr<LoadedGlyph> loaded(new LoadedGlyph());
+    prepare(glyph_index, 1, 0, *loaded);
+    return loaded;
+}
+
+// --------------------------------------------------------------------------
+
+void GlyphLoader::request(Uint16 glyph_index, int direction) {
+    request_sequence++;
+    requested_glyph_index = glyph_index;
+    has_pending_request = true;
+
+    Uint64 request = (request_sequence << REQUEST_SEQUENCE_SHIFT) | (direction < 0 ? REQUEST_BACKWARD_BIT : 0) | glyph_index;
+    posted_request.store(request);
+
+    // A job already looping will find the new request on its next pass.
+    if (is_job_scheduled.exchange(true)) {
+        return;
+    }
+
+    running_job_count++;
+    thread_pool.submit([this] {
+        run_requests();
+    });
+}
+
+// --------------------------------------------------------------------------
+
+std::unique_ptr<GlyphLoader::LoadedGlyph> GlyphLoader::take_ready() {
+    std::unique_ptr<LoadedGlyph> loaded(ready_glyph.exchange(nullptr, std::memory_order_acquire));
+    if (loaded == nullptr) {
+        return nullptr;
+    }
+
+    // A glyph finished just before a newer request went out is still newer
+    // than the one on screen, so it is handed over while the job carries on.
+    if (loaded->glyph_index == requested_glyph_index) {
+        has_pending_request = false;
+    }
+
+    loaded_count++;
+    return loaded;
+}
+
+// --------------------------------------------------------------------------
+
+bool GlyphLoader::is_pending() const {
+    return has_pending_request;
+}
+
+// --------------------------------------------------------------------------
+
+Uint64 GlyphLoader::get_loaded_count() const {
+    return loaded_count.load();
+}
+
+// --------------------------------------------------------------------------
+
+Uint64 GlyphLoader::get_cancelled_count() const {
+    return cancelled_count.load();
+}
+
+// --------------------------------------------------------------------------
+
+Uint64 GlyphLoader::get_skipped_count() const {
+    return skipped_count.load();
+}
+
+// --------------------------------------------------------------------------
+
+bool GlyphLoader::is_superseded(Uint64 request) const {
+    return request != 0 && (is_stopping.load(std::memory_order_relaxed) || posted_request.load(std::memory_order_relaxed) != request);
+}
+
+// --------------------------------------------------------------------------
+
+bool GlyphLoader::prepare(Uint16 glyph_index, int direction, Uint64 request, LoadedGlyph& loaded) {
+    loaded.glyph_index = glyph_index;
+
+    if (outline_cache != nullptr && outline_cache->find_compiled_outline(glyph_index, loaded.outline)) {
+        loaded.glyph = nullptr;
+        return true;
+    }
+
+    // Start the prefetcher on the glyphs after this one before decoding it,
+    // so while the user holds a key the two decode side by side.
+    glyph_cache.prefetch(glyph_index, direction);
+    loaded.glyph = glyph_cache.get_glyph(glyph_index);
+
+    // Decoding can't be interrupted, but compiling a glyph nobody wants any
+    // more can be skipped.
+    if (is_superseded(request)) {
+        return false;
+    }
+
+    loaded.outline.compile(*loaded.glyph);
+    return true;
+}
+
+// --------------------------------------------------------------------------
+
+void GlyphLoader::run_requests() {
+    while (!is_stopping.load(std::memory_order_relaxed)) {
+        Uint64 request = posted_request.load(std::memory_order_acquire);
+        if (request != handled_request) {
+            skipped_count += (request >> REQUEST_SEQUENCE_SHIFT) - (handled_request >> REQUEST_SEQUENCE_SHIFT) - 1;
+            handled_request = request;
+
+            Uint16 glyph_index = static_cast<Uint16>(request & 0xFFFF);
+            int direction = (request & REQUEST_BACKWARD_BIT) != 0 ? -1 : 1;
+
+            std::unique_ptr<LoadedGlyph> loaded(new LoadedGlyph());
+            if (!prepare(glyph_index, direction, request, *loaded)) {
+                cancelled_count++;
+                continue;
+            }
+
+            // Only this job publishes, so anything still in the slot is an
+            // older glyph the UI thread never picked up.
+            LoadedGlyph* unclaimed = ready_glyph.exchange(loaded.release(), std::memory_order_acq_rel);
+            if (unclaimed != nullptr) {
+                cancelled_count++;
+                delete unclaimed;
+            }
+
+            if (on_ready) {
+                on_ready();
+            }
+            continue;
+        }
+
+        // Hand the loop back. A request posted between the load above and
+        // clearing the flag sees the flag still set and schedules nothing,
+        // so look once more and take the loop back if one came in. Once the
+        // flag is clear a new job may own handled_request, so read it first.
+        Uint64 last_handled_request = handled_request;
+        is_job_scheduled.store(false);
+        if (posted_request.load() == last_handled_request || is_job_scheduled.exchange(true)) {
+            break;
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(job_mutex);
+    running_job_count--;
+    job_condition.notify_all();
+}
@@ -0,0 +1,118 @@
+#ifndef GLYPH_LOADER_H
+#define GLYPH_LOADER_H
+
+#include <SDL3/SDL.h>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+
+#include "GlyphOutline.h"
+
+class GlyphCache;
+class OutlineCache;
+class ThreadPool;
+
+// Gets glyphs ready to draw on the thread pool instead of the UI thread. The
+// UI thread posts the glyph it wants with request() and picks the result up
+// with take_ready() once a frame. Neither waits on the loader: take_ready()
+// is one atomic swap and request() one atomic store, plus handing the pool a
+// job, which briefly locks its queue, when no job is looping already.
+//
+// Only the newest request matters. A single job works through requests one
+// at a time, always taking the latest, so glyphs the user navigated past
+// while another was being decoded are skipped without being decoded, and a
+// glyph superseded while it was being decoded is dropped before it is
+// compiled. Finished glyphs are published by swapping a pointer into a
+// one-slot mailbox, and each one replaces any the UI thread hasn't taken.
+class GlyphLoader {
+
+public:
+
+    struct LoadedGlyph {
+        Uint16 glyph_index;
+
+        // The decoded points, or nullptr if the outline came from the
+        // outline cache, where the points can be looked up directly.
+        std::shared_ptr<const Glyph> glyph;
+        GlyphOutline outline;
+    };
+
+    // on_ready is called on a worker thread each time a glyph has been
+    // published, so a sleeping UI loop can be woken up. outline_cache may be
+    // nullptr.
+    GlyphLoader(GlyphCache& glyph_cache, std::shared_ptr<const OutlineCache> outline_cache, ThreadPool& thread_pool, std::function<void()> on_ready);
+
+    // Waits for a job that is still running to notice it is stopping.
+    ~GlyphLoader();
+
+    GlyphLoader(const GlyphLoader&) = delete;
+    GlyphLoader& operator=(const GlyphLoader&) = delete;
+
+    // Prepare glyph_index on the calling thread, as at startup when there is
+    // no previous glyph to keep showing.
+    std::unique_ptr<LoadedGlyph> load(Uint16 glyph_index);
+
+    // Supersede any earlier request. direction (+1 or -1) is where the glyph
+    // cache prefetches next.
+    void request(Uint16 glyph_index, int direction);
+
+    // The newest glyph finished since the last call, otherwise nullptr. While
+    // the user keeps navigating this can be a glyph they have already moved
+    // past; it is still closer than the one on screen.
+    std::unique_ptr<LoadedGlyph> take_ready();
+
+    // True from a request until the glyph it asked for has been taken.
+    bool is_pending() const;
+
+    // Glyphs handed over by take_ready, glyphs dropped because they were
+    // superseded partway through or replaced before the UI thread took them,
+    // and requests superseded before any work on them started.
+    Uint64 get_loaded_count() const;
+    Uint64 get_cancelled_count() const;
+    Uint64 get_skipped_count() const;
+
+private:
+
+    // A request packs a sequence number, the prefetch direction and the
+    // glyph index into one word so it can be posted with a single store.
+    static const int REQUEST_SEQUENCE_SHIFT = 17;
+    static const Uint64 REQUEST_BACKWARD_BIT = 1 << 16;
+
+    GlyphCache& glyph_cache;
+    std::shared_ptr<const OutlineCache> outline_cache;
+    ThreadPool& thread_pool;
+    std::function<void()> on_ready;
+
+    // Touched by the UI thread only.
+    Uint64 request_sequence;
+    Uint16 requested_glyph_index;
+    bool has_pending_request;
+
+    std::atomic<Uint64> posted_request;
+    std::atomic<LoadedGlyph*> ready_glyph;
+
+    // Set while a job owns the request loop; the job that sets it is the
+    // only one that reads or writes handled_request.
+    std::atomic<bool> is_job_scheduled;
+    Uint64 handled_request;
+
+    // Counted up by request() without a lock; jobs count down under
+    // job_mutex so the destructor can't miss the last one finishing.
+    std::atomic<bool> is_stopping;
+    std::mutex job_mutex;
+    std::condition_variable job_condition;
+    std::atomic<int> running_job_count;
+
+    std::atomic<Uint64> loaded_count;
+    std::atomic<Uint64> cancelled_count;
+    std::atomic<Uint64> skipped_count;
+
+    // A request of 0 is never superseded.
+    bool is_superseded(Uint64 request) const;
+    bool prepare(Uint16 glyph_index, int direction, Uint64 request, LoadedGlyph& loaded);
+    void run_requests();
+};
+
+#endif
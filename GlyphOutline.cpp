@@ -0,0 +1,149 @@
+#include "GlyphOutline.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "GlyphHinter.h"
+
+namespace {
+    SDL_FPoint midpoint(const SDL_FPoint& p1, const SDL_FPoint& p2) {
+        return {(p1.x + p2.x) / 2.0f, (p1.y + p2.y) / 2.0f};
+    }
+
+    int wrap(int value, int min, int max) {
+        if (value < min) {
+            int delta = value - min;
+            return max + delta + 1;
+        } else if (value > max) {
+            int delta = value - max;
+            return min + delta - 1;
+        } else {
+            return value;
+        }
+    }
+}
+
+// --------------------------------------------------------------------------
+
+GlyphOutline::GlyphOutline()
+    : min_extents({0, 0}),
+      max_extents({0, 0}) {
+}
+
+// --------------------------------------------------------------------------
+
+void GlyphOutline::clear() {
+    min_extents = {0, 0};
+    max_extents = {0, 0};
+    verbs.clear();
+    points.clear();
+    contour_ends.clear();
+}
+
+// --------------------------------------------------------------------------
+
+void GlyphOutline::compile(const Glyph& glyph) {
+    clear();
+
+    min_extents = glyph.min_extents;
+    max_extents = glyph.max_extents;
+
+    compile_contours(
+        glyph.num_end_point_indices,
+        glyph.end_point_indices,
+        glyph.num_points,
+        [&glyph](int point_index) {
+            return glyph.is_on_curve(point_index);
+        },
+        [&glyph](int point_index) -> SDL_FPoint {
+            return {static_cast<float>(glyph.x_coordinates[point_index]), static_cast<float>(glyph.y_coordinates[point_index])};
+        }
+    );
+}
+
+// --------------------------------------------------------------------------
+
+void GlyphOutline::compile(const HintedGlyph& hinted_glyph) {
+    clear();
+
+    int num_points = static_cast<int>(hinted_glyph.get_point_count());
+    compile_contours(
+        static_cast<int>(hinted_glyph.end_point_indices.size()),
+        hinted_glyph.end_point_indices.data(),
+        num_points,
+        [&hinted_glyph](int point_index) {
+            return hinted_glyph.on_curve_flags[point_index] != 0;
+        },
+        [&hinted_glyph](int point_index) -> SDL_FPoint {
+            return {hinted_glyph.x_coordinates[point_index], hinted_glyph.y_coordinates[point_index]};
+        }
+    );
+
+    // Extents are whole pixels around the points, which for a hinted glyph
+    // is the bitmap it covers.
+    if (num_points > 0) {
+        float min_x = hinted_glyph.x_coordinates[0];
+        float min_y = hinted_glyph.y_coordinates[0];
+        float max_x = min_x;
+        float max_y = min_y;
+        for (int i = 1; i < num_points; i++) {
+            min_x = std::min(min_x, hinted_glyph.x_coordinates[i]);
+            min_y = std::min(min_y, hinted_glyph.y_coordinates[i]);
+            max_x = std::max(max_x, hinted_glyph.x_coordinates[i]);
+            max_y = std::max(max_y, hinted_glyph.y_coordinates[i]);
+        }
+
+        min_extents = {static_cast<Sint16>(std::floor(min_x)), static_cast<Sint16>(std::floor(min_y))};
+        max_extents = {static_cast<Sint16>(std::ceil(max_x)), static_cast<Sint16>(std::ceil(max_y))};
+    }
+}
+
+// --------------------------------------------------------------------------
+
+template<typename IsOnCurve, typename GetPoint>
+void GlyphOutline::compile_contours(int num_end_point_indices, const Uint16* end_point_indices, int num_points, IsOnCurve is_on_curve, GetPoint get_point) {
+    int lower_index = 0;
+    for (int endpoint_index = 0; endpoint_index < num_end_point_indices; endpoint_index++) {
+        int upper_index = end_point_indices[endpoint_index];
+        if (upper_index < lower_index || upper_index >= num_points) {
+            break;
+        }
+
+        // Start on the curve: the first point if it is on it, otherwise the
+        // last point, otherwise the implied point between the two.
+        verbs.push_back(MOVE_TO);
+        if (is_on_curve(lower_index)) {
+            points.push_back(get_point(lower_index));
+        } else if (is_on_curve(upper_index)) {
+            points.push_back(get_point(upper_index));
+        } else {
+            points.push_back(midpoint(get_point(upper_index), get_point(lower_index)));
+        }
+
+        for (int i = lower_index; i <= upper_index; i++) {
+            int next_index = wrap(i + 1, lower_index, upper_index);
+
+            if (is_on_curve(i)) {
+                // Curves are emitted from their off-curve control point, so
+                // an on-curve point only contributes a straight line.
+                if (is_on_curve(next_index)) {
+                    verbs.push_back(LINE_TO);
+                    points.push_back(get_point(next_index));
+                }
+            } else {
+                verbs.push_back(QUAD_TO);
+                points.push_back(get_point(i));
+                points.push_back(is_on_curve(next_index) ? get_point(next_index) : midpoint(get_point(i), get_point(next_index)));
+            }
+        }
+
+        contour_ends.push_back(points.size());
+        lower_index = upper_index + 1;
+    }
+}
+
+// --------------------------------------------------------------------------
+
+size_t GlyphOutline::get_contour_count() const {
+    return contour_ends.size();
+}
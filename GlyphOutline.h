@@ -0,0 +1,50 @@
+#ifndef GLYPH_OUTLINE_H
+#define GLYPH_OUTLINE_H
+
+#include <SDL3/SDL.h>
+#include <vector>
+
+#include "Font.h"
+
+struct HintedGlyph;
+
+// A glyph's contours compiled once into an explicit segment list, so drawing
+// and rasterizing are a linear walk instead of re-deriving the outline from
+// the raw TrueType points every frame. Implied on-curve midpoints between
+// two off-curve points are resolved, and every contour is closed explicitly:
+// it starts with MOVE_TO and its last segment ends back on that point.
+//
+// Points are in font units, or in pixels when compiled from a HintedGlyph,
+// whose extents are then the whole pixels it covers. MOVE_TO and LINE_TO
+// each take one point from points; QUAD_TO takes two, the control point and
+// then the end point.
+struct GlyphOutline {
+    enum Verb : Uint8 {
+        MOVE_TO,
+        LINE_TO,
+        QUAD_TO,
+    };
+
+    Coordinate min_extents;
+    Coordinate max_extents;
+    std::vector<Uint8> verbs;
+    std::vector<SDL_FPoint> points;
+
+    // One past the last point of each contour.
+    std::vector<size_t> contour_ends;
+
+    GlyphOutline();
+
+    void clear();
+    void compile(const Glyph& glyph);
+    void compile(const HintedGlyph& hinted_glyph);
+
+    size_t get_contour_count() const;
+
+private:
+
+    template<typename IsOnCurve, typename GetPoint>
+    void compile_contours(int num_end_point_indices, const Uint16* end_point_indices, int num_points, IsOnCurve is_on_curve, GetPoint get_point);
+};
+
+#endif
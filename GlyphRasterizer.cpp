@@ -0,0 +1,341 @@
+#include "GlyphRasterizer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "OutlineKernels.h"
+#include "ThreadPool.h"
+
+namespace {
+    // Add the signed area a segment covers to each pixel of a width x height
+    // accumulation buffer whose rows are stride floats apart.
+    void accumulate_line(float* accumulation, int stride, int width, int height, SDL_FPoint p0, SDL_FPoint p1) {
+        if (p0.y == p1.y) {
+            return;
+        }
+
+        // Downward segments add coverage and upward ones take it away.
+        float direction = 1.0f;
+        if (p0.y > p1.y) {
+            std::swap(p0, p1);
+            direction = -1.0f;
+        }
+
+        // Keep x inside the row so every write lands within [0, width].
+        float max_x = width - 0.001f;
+        p0.x = std::clamp(p0.x, 0.0f, max_x);
+        p1.x = std::clamp(p1.x, 0.0f, max_x);
+
+        float dxdy = (p1.x - p0.x) / (p1.y - p0.y);
+        float x = p0.x;
+        if (p0.y < 0.0f) {
+            x -= p0.y * dxdy;
+        }
+
+        int first_row = std::max(0, static_cast<int>(std::floor(p0.y)));
+        int last_row = std::min(height, static_cast<int>(std::ceil(p1.y)));
+
+        for (int y = first_row; y < last_row; y++) {
+            float* row = accumulation + static_cast<size_t>(y) * stride;
+
+            float dy = std::min(static_cast<float>(y + 1), p1.y) - std::max(static_cast<float>(y), p0.y);
+            // Rounding can step a hair past either end of the row.
+            float next_x = std::clamp(x + dxdy * dy, 0.0f, max_x);
+            float d = dy * direction;
+
+            float left_x = std::min(x, next_x);
+            float right_x = std::max(x, next_x);
+            float left_floor = std::floor(left_x);
+            int left_index = static_cast<int>(left_floor);
+            float right_ceil = std::ceil(right_x);
+            int right_index = static_cast<int>(right_ceil);
+
+            if (right_index <= left_index + 1) {
+                // The segment stays within one pixel column on this row:
+                // split its coverage between that pixel and the one to its
+                // right.
+                float mid_fraction = 0.5f * (x + next_x) - left_floor;
+                row[left_index] += d - d * mid_fraction;
+                row[left_index + 1] += d * mid_fraction;
+            } else {
+                // Spanning several columns, the area under the segment
+                // grows quadratically in the first and last pixel and
+                // linearly between.
+                float inverse_width = 1.0f / (right_x - left_x);
+                float left_fraction = left_x - left_floor;
+                float first_area = 0.5f * inverse_width * (1.0f - left_fraction) * (1.0f - left_fraction);
+                float right_fraction = right_x - right_ceil + 1.0f;
+                float last_area = 0.5f * inverse_width * right_fraction * right_fraction;
+
+                row[left_index] += d * first_area;
+
+                if (right_index == left_index + 2) {
+                    row[left_index + 1] += d * (1.0f - first_area - last_area);
+                } else {
+                    float second_area = inverse_width * (1.5f - left_fraction);
+                    row[left_index + 1] += d * (second_area - first_area);
+
+                    for (int column = left_index + 2; column < right_index - 1; column++) {
+                        row[column] += d * inverse_width;
+                    }
+
+                    float covered_area = second_area + (right_index - left_index - 3) * inverse_width;
+                    row[right_index - 1] += d * (1.0f - covered_area - last_area);
+                }
+
+                row[right_index] += d * last_area;
+            }
+
+            x = next_x;
+        }
+    }
+
+    // ----------------------------------------------------------------------
+
+    // accumulate_line() for a segment that may run past the left or right
+    // side of the buffer. Whatever lies left of it still winds every pixel
+    // in those rows, so it is moved onto the left edge; whatever lies right
+    // of it can't reach any pixel and is dropped.
+    void accumulate_clipped_line(float* accumulation, int stride, int width, int height, SDL_FPoint p0, SDL_FPoint p1) {
+        float right = static_cast<float>(width);
+        if (p0.x >= right && p1.x >= right) {
+            return;
+        }
+
+        if (p0.x >= 0.0f && p1.x >= 0.0f && p0.x <= right && p1.x <= right) {
+            accumulate_line(accumulation, stride, width, height, p0, p1);
+            return;
+        }
+
+        // Split at the crossings of both sides and handle each piece on its
+        // own.
+        float crossings[4] = {0.0f, 1.0f, 1.0f, 1.0f};
+        int crossing_count = 1;
+        float dx = p1.x - p0.x;
+        if (dx != 0.0f) {
+            for (float side : {0.0f, right}) {
+                float t = (side - p0.x) / dx;
+                if (t > 0.0f && t < 1.0f) {
+                    crossings[crossing_count++] = t;
+                }
+            }
+        }
+        if (crossing_count == 3 && crossings[1] > crossings[2]) {
+            std::swap(crossings[1], crossings[2]);
+        }
+        crossings[crossing_count++] = 1.0f;
+
+        for (int i = 0; i + 1 < crossing_count; i++) {
+            float t0 = crossings[i];
+            float t1 = crossings[i + 1];
+            SDL_FPoint start = {p0.x + dx * t0, p0.y + (p1.y - p0.y) * t0};
+            SDL_FPoint end = {p0.x + dx * t1, p0.y + (p1.y - p0.y) * t1};
+
+            float mid_x = 0.5f * (start.x + end.x);
+            if (mid_x >= right) {
+                continue;
+            }
+
+            if (mid_x < 0.0f) {
+                start.x = 0.0f;
+                end.x = 0.0f;
+            }
+
+            accumulate_line(accumulation, stride, width, height, start, end);
+        }
+    }
+
+    // ----------------------------------------------------------------------
+
+    int floor_to_tile(float value) {
+        return static_cast<int>(std::floor(value / GlyphRasterizer::TILE_SIZE));
+    }
+}
+
+// --------------------------------------------------------------------------
+
+GlyphRasterizer::GlyphRasterizer() {
+}
+
+// --------------------------------------------------------------------------
+
+void GlyphRasterizer::rasterize(const FlattenedOutline& outline, float origin_x, float origin_y, int width, int height, std::vector<Uint8>& coverage) {
+    if (width <= 0 || height <= 0) {
+        coverage.clear();
+        return;
+    }
+
+    // A segment touching the right edge of the last row writes one cell past
+    // the end, so the buffer carries a little slack.
+    accumulation.assign(static_cast<size_t>(width) * height + 2, 0.0f);
+
+    size_t contour_start = 0;
+    for (size_t contour_end : outline.contour_ends) {
+        for (size_t i = contour_start + 1; i < contour_end; i++) {
+            SDL_FPoint p0 = {outline.points[i - 1].x - origin_x, outline.points[i - 1].y - origin_y};
+            SDL_FPoint p1 = {outline.points[i].x - origin_x, outline.points[i].y - origin_y};
+            accumulate_line(accumulation.data(), width, width, height, p0, p1);
+        }
+
+        contour_start = contour_end;
+    }
+
+    // Contours are closed, so every row's deltas sum to zero and the whole
+    // buffer can be summed in one pass without resetting at row starts.
+    coverage.resize(static_cast<size_t>(width) * height);
+    accumulate_coverage(accumulation.data(), coverage.data(), coverage.size());
+}
+
+// --------------------------------------------------------------------------
+
+void GlyphRasterizer::rasterize_tiled(const FlattenedOutline& outline, float origin_x, float origin_y, int width, int height, ThreadPool& thread_pool, std::vector<Uint8>& coverage) {
+    if (width <= 0 || height <= 0) {
+        coverage.clear();
+        return;
+    }
+
+    int tile_columns = (width + TILE_SIZE - 1) / TILE_SIZE;
+    int tile_rows = (height + TILE_SIZE - 1) / TILE_SIZE;
+    size_t tile_count = static_cast<size_t>(tile_columns) * tile_rows;
+
+    // Keep only the segments that cross some bitmap row, in bitmap space.
+    edges.clear();
+    size_t contour_start = 0;
+    for (size_t contour_end : outline.contour_ends) {
+        for (size_t i = contour_start + 1; i < contour_end; i++) {
+            Edge edge;
+            edge.p0 = {outline.points[i - 1].x - origin_x, outline.points[i - 1].y - origin_y};
+            edge.p1 = {outline.points[i].x - origin_x, outline.points[i].y - origin_y};
+
+            float min_y = std::min(edge.p0.y, edge.p1.y);
+            float max_y = std::max(edge.p0.y, edge.p1.y);
+            if (min_y == max_y || max_y <= 0.0f || min_y >= height) {
+                continue;
+            }
+
+            edges.push_back(edge);
+        }
+
+        contour_start = contour_end;
+    }
+
+    // Bin every edge into each tile its bounding box overlaps, counting
+    // first so the bins can share one flat array. Along the way, each edge
+    // leaves its per-row winding in the first tile column to its right.
+    tile_edge_offsets.assign(tile_count + 1, 0);
+    tile_backdrops.assign(static_cast<size_t>(height) * tile_columns, 0.0f);
+
+    for (int pass = 0; pass < 2; pass++) {
+        for (size_t edge_index = 0; edge_index < edges.size(); edge_index++) {
+            const Edge& edge = edges[edge_index];
+            float min_y = std::min(edge.p0.y, edge.p1.y);
+            float max_y = std::max(edge.p0.y, edge.p1.y);
+            float min_x = std::min(edge.p0.x, edge.p1.x);
+            float max_x = std::max(edge.p0.x, edge.p1.x);
+
+            int first_tile_row = std::max(0, floor_to_tile(min_y));
+            int last_tile_row = std::min(tile_rows - 1, static_cast<int>(std::ceil(max_y / TILE_SIZE)) - 1);
+            int first_tile_column = std::max(0, floor_to_tile(min_x));
+            int last_tile_column = std::min(tile_columns - 1, floor_to_tile(max_x));
+
+            for (int tile_row = first_tile_row; tile_row <= last_tile_row; tile_row++) {
+                for (int tile_column = first_tile_column; tile_column <= last_tile_column; tile_column++) {
+                    size_t tile_index = static_cast<size_t>(tile_row) * tile_columns + tile_column;
+                    if (pass == 0) {
+                        tile_edge_offsets[tile_index + 1]++;
+                    } else {
+                        tile_edges[tile_edge_offsets[tile_index]++] = static_cast<Uint32>(edge_index);
+                    }
+                }
+            }
+
+            int backdrop_column = std::max(0, floor_to_tile(max_x) + 1);
+            if (pass == 1 || backdrop_column >= tile_columns) {
+                continue;
+            }
+
+            float direction = edge.p0.y < edge.p1.y ? 1.0f : -1.0f;
+            int first_row = std::max(0, static_cast<int>(std::floor(min_y)));
+            int last_row = std::min(height, static_cast<int>(std::ceil(max_y)));
+            for (int y = first_row; y < last_row; y++) {
+                float dy = std::min(static_cast<float>(y + 1), max_y) - std::max(static_cast<float>(y), min_y);
+                tile_backdrops[static_cast<size_t>(y) * tile_columns + backdrop_column] += dy * direction;
+            }
+        }
+
+        if (pass == 0) {
+            for (size_t tile_index = 0; tile_index < tile_count; tile_index++) {
+                tile_edge_offsets[tile_index + 1] += tile_edge_offsets[tile_index];
+            }
+
+            tile_edges.resize(tile_edge_offsets[tile_count]);
+        } else {
+            // Filling advanced every offset to the start of the next bin.
+            for (size_t tile_index = tile_count; tile_index > 0; tile_index--) {
+                tile_edge_offsets[tile_index] = tile_edge_offsets[tile_index - 1];
+            }
+            tile_edge_offsets[0] = 0;
+        }
+    }
+
+    for (int y = 0; y < height; y++) {
+        float* row_backdrops = tile_backdrops.data() + static_cast<size_t>(y) * tile_columns;
+        for (int tile_column = 1; tile_column < tile_columns; tile_column++) {
+            row_backdrops[tile_column] += row_backdrops[tile_column - 1];
+        }
+    }
+
+    coverage.resize(static_cast<size_t>(width) * height);
+
+    thread_pool.parallel_for(tile_count, 1, [&](size_t begin, size_t end) {
+        // One extra column per row takes writes landing on the right edge.
+        const int stride = TILE_SIZE + 1;
+        thread_local std::vector<float> tile_accumulation;
+        tile_accumulation.resize(static_cast<size_t>(stride) * TILE_SIZE);
+
+        for (size_t tile_index = begin; tile_index < end; tile_index++) {
+            int tile_x = static_cast<int>(tile_index % tile_columns) * TILE_SIZE;
+            int tile_y = static_cast<int>(tile_index / tile_columns) * TILE_SIZE;
+            int tile_width = std::min(static_cast<int>(TILE_SIZE), width - tile_x);
+            int tile_height = std::min(static_cast<int>(TILE_SIZE), height - tile_y);
+            int tile_column = static_cast<int>(tile_index % tile_columns);
+
+            Uint32 first_edge = tile_edge_offsets[tile_index];
+            Uint32 last_edge = tile_edge_offsets[tile_index + 1];
+
+            if (first_edge == last_edge) {
+                // Nothing crosses the tile, so each row is a flat fill.
+                for (int y = 0; y < tile_height; y++) {
+                    float backdrop = tile_backdrops[static_cast<size_t>(tile_y + y) * tile_columns + tile_column];
+                    Uint8 value;
+                    accumulate_coverage(&backdrop, &value, 1);
+                    std::memset(coverage.data() + static_cast<size_t>(tile_y + y) * width + tile_x, value, tile_width);
+                }
+                continue;
+            }
+
+            std::fill(tile_accumulation.begin(), tile_accumulation.end(), 0.0f);
+            for (int y = 0; y < tile_height; y++) {
+                tile_accumulation[static_cast<size_t>(y) * stride] = tile_backdrops[static_cast<size_t>(tile_y + y) * tile_columns + tile_column];
+            }
+
+            for (Uint32 i = first_edge; i < last_edge; i++) {
+                const Edge& edge = edges[tile_edges[i]];
+                SDL_FPoint p0 = {edge.p0.x - tile_x, edge.p0.y - tile_y};
+                SDL_FPoint p1 = {edge.p1.x - tile_x, edge.p1.y - tile_y};
+                accumulate_clipped_line(tile_accumulation.data(), stride, tile_width, tile_height, p0, p1);
+            }
+
+            // Unlike rasterize(), a tile's rows don't sum to zero, so each
+            // one is summed on its own.
+            for (int y = 0; y < tile_height; y++) {
+                accumulate_coverage(
+                    tile_accumulation.data() + static_cast<size_t>(y) * stride,
+                    coverage.data() + static_cast<size_t>(tile_y + y) * width + tile_x,
+                    tile_width
+                );
+            }
+        }
+    });
+}
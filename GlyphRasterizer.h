@@ -0,0 +1,57 @@
+#ifndef GLYPH_RASTERIZER_H
+#define GLYPH_RASTERIZER_H
+
+#include <SDL3/SDL.h>
+#include <vector>
+
+#include "GlyphDrawing.h"
+
+class ThreadPool;
+
+// Anti-aliased scanline rasterizer for flattened outlines. Every line
+// segment adds the exact signed area it covers in each pixel to an
+// accumulation buffer; a running sum along each row then gives the winding
+// integral per pixel, and |sum| clamped to 1 is the coverage. Overlapping
+// contours that wind the same way clamp to full coverage and holes cancel
+// out, which is non-zero filling for the outlines TrueType fonts contain.
+class GlyphRasterizer {
+
+public:
+
+    GlyphRasterizer();
+
+    // Rasterize the closed polylines in outline into a width x height 8-bit
+    // coverage bitmap, row-major with no padding. An outline point (x, y)
+    // lands on bitmap position (x - origin_x, y - origin_y); anything outside
+    // the bitmap horizontally is clamped onto its edge.
+    void rasterize(const FlattenedOutline& outline, float origin_x, float origin_y, int width, int height, std::vector<Uint8>& coverage);
+
+    // Same result as rasterize(), for bitmaps the size of a window. Segments
+    // are binned into TILE_SIZE square tiles, which are then filled in
+    // parallel on thread_pool; each tile starts every row from the winding
+    // carried in by segments entirely to its left, and tiles no segment
+    // touches are filled with that value directly.
+    void rasterize_tiled(const FlattenedOutline& outline, float origin_x, float origin_y, int width, int height, ThreadPool& thread_pool, std::vector<Uint8>& coverage);
+
+    static const int TILE_SIZE = 64;
+
+private:
+
+    struct Edge {
+        SDL_FPoint p0;
+        SDL_FPoint p1;
+    };
+
+    std::vector<float> accumulation;
+
+    // Binning state for rasterize_tiled. Tile t's edges are
+    // tile_edges[tile_edge_offsets[t]] up to tile_edge_offsets[t + 1], and
+    // tile_backdrops holds, per bitmap row and tile column, the winding
+    // entering that tile from the left.
+    std::vector<Edge> edges;
+    std::vector<Uint32> tile_edge_offsets;
+    std::vector<Uint32> tile_edges;
+    std::vector<float> tile_backdrops;
+};
+
+#endif
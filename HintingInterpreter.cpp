@@ -0,0 +1,1868 @@
+#include "HintingInterpreter.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <utility>
+
+namespace {
+    const size_t MAX_CALL_DEPTH = 64;
+
+    // A program still running after this many instructions is taken to be
+    // stuck in a loop. Real glyph programs run a few thousand at most.
+    const Uint32 MAX_INSTRUCTION_COUNT = 1000000;
+
+    const Sint32 ONE_2DOT14 = 0x4000;
+
+    // Arguments popped (high nibble) and results pushed (low nibble) by each
+    // opcode. The pushes, CINDEX, MINDEX, the DELTAs and everything that
+    // honours the loop count take the rest of their arguments themselves.
+    constexpr Uint8 get_stack_effect(int opcode) {
+        if (opcode >= 0xE0) {
+            return 0x20;
+        }
+        if (opcode >= 0xC0) {
+            return 0x10;
+        }
+
+        switch (opcode) {
+            case 0x0C: case 0x0D: case 0x24: case 0x4B: case 0x4C:
+                return 0x01;
+            case 0x10: case 0x11: case 0x12: case 0x13: case 0x14: case 0x15: case 0x16: case 0x17:
+            case 0x1A: case 0x1C: case 0x1D: case 0x1E: case 0x1F: case 0x21: case 0x26: case 0x29:
+            case 0x2B: case 0x2C: case 0x2E: case 0x2F: case 0x34: case 0x35: case 0x36: case 0x37:
+            case 0x38: case 0x4F: case 0x58: case 0x5D: case 0x5E: case 0x5F: case 0x71: case 0x72:
+            case 0x73: case 0x74: case 0x75: case 0x76: case 0x77: case 0x7E: case 0x7F: case 0x85:
+            case 0x89: case 0x8D:
+                return 0x10;
+            case 0x25: case 0x43: case 0x45: case 0x46: case 0x47: case 0x56: case 0x57: case 0x5C:
+            case 0x64: case 0x65: case 0x66: case 0x67: case 0x68: case 0x69: case 0x6A: case 0x6B:
+            case 0x6C: case 0x6D: case 0x6E: case 0x6F: case 0x88:
+                return 0x11;
+            case 0x20:
+                return 0x12;
+            case 0x06: case 0x07: case 0x08: case 0x09: case 0x0A: case 0x0B: case 0x27: case 0x2A:
+            case 0x3A: case 0x3B: case 0x3E: case 0x3F: case 0x42: case 0x44: case 0x48: case 0x70:
+            case 0x78: case 0x79: case 0x81: case 0x82: case 0x86: case 0x87: case 0x8E:
+                return 0x20;
+            case 0x49: case 0x4A: case 0x50: case 0x51: case 0x52: case 0x53: case 0x54: case 0x55:
+            case 0x5A: case 0x5B: case 0x60: case 0x61: case 0x62: case 0x63: case 0x8B: case 0x8C:
+                return 0x21;
+            case 0x23:
+                return 0x22;
+            case 0x8A:
+                return 0x33;
+            case 0x0F:
+                return 0x50;
+            default:
+                return 0x00;
+        }
+    }
+
+    struct StackEffectTable {
+        Uint8 effects[256];
+
+        constexpr StackEffectTable()
+            : effects() {
+            for (int opcode = 0; opcode < 256; opcode++) {
+                effects[opcode] = get_stack_effect(opcode);
+            }
+        }
+    };
+
+    constexpr StackEffectTable STACK_EFFECTS;
+
+    // How many bytes the instruction at position takes, inline data
+    // included, or 0 if it runs past the end of the code.
+    size_t get_instruction_length(const Uint8* code, size_t code_length, size_t position) {
+        Uint8 opcode = code[position];
+        size_t length = 1;
+        if (opcode == 0x40 || opcode == 0x41) {
+            if (position + 1 >= code_length) {
+                return 0;
+            }
+            length = 2 + static_cast<size_t>(code[position + 1]) * (opcode == 0x41 ? 2 : 1);
+        } else if (opcode >= 0xB0 && opcode <= 0xB7) {
+            length = 1 + (opcode - 0xAF);
+        } else if (opcode >= 0xB8 && opcode <= 0xBF) {
+            length = 1 + 2 * (opcode - 0xB7);
+        }
+
+        return position + length <= code_length ? length : 0;
+    }
+
+    Sint32 clamp_to_sint32(Sint64 value) {
+        if (value > 0x7FFFFFFF) {
+            return 0x7FFFFFFF;
+        }
+        if (value < -0x7FFFFFFF) {
+            return -0x7FFFFFFF;
+        }
+        return static_cast<Sint32>(value);
+    }
+
+    // a * b / c with 64-bit intermediates, rounded half away from zero.
+    Sint32 mul_div(Sint32 a, Sint32 b, Sint32 c) {
+        Sint64 product = static_cast<Sint64>(a) * b;
+        if (c == 0) {
+            return product < 0 ? -0x7FFFFFFF : 0x7FFFFFFF;
+        }
+
+        bool is_negative = (product < 0) != (c < 0);
+        Sint64 numerator = product < 0 ? -product : product;
+        Sint64 denominator = c < 0 ? -static_cast<Sint64>(c) : c;
+        Sint64 quotient = (numerator + denominator / 2) / denominator;
+        return clamp_to_sint32(is_negative ? -quotient : quotient);
+    }
+
+    Sint32 mul_div_no_round(Sint32 a, Sint32 b, Sint32 c) {
+        Sint64 product = static_cast<Sint64>(a) * b;
+        return clamp_to_sint32(product / c);
+    }
+
+    Sint32 add_wrapping(Sint32 a, Sint32 b) {
+        return static_cast<Sint32>(static_cast<Uint32>(a) + static_cast<Uint32>(b));
+    }
+
+    Sint32 subtract_wrapping(Sint32 a, Sint32 b) {
+        return static_cast<Sint32>(static_cast<Uint32>(a) - static_cast<Uint32>(b));
+    }
+
+    // A 2.14 unit vector pointing the same way as (x, y). This is FreeType's
+    // fixed-point Newton iteration rather than a square root, because
+    // diagonal moves land a unit off wherever the two disagree in the last
+    // bit. False, leaving vector alone, for a zero vector.
+    bool normalize(Sint32 x, Sint32 y, HintingVector& vector) {
+        if (x == 0 && y == 0) {
+            return false;
+        }
+
+        Sint32 sign_x = x < 0 ? -1 : 1;
+        Sint32 sign_y = y < 0 ? -1 : 1;
+        Uint32 abs_x = static_cast<Uint32>(std::abs(static_cast<Sint64>(x)));
+        Uint32 abs_y = static_cast<Uint32>(std::abs(static_cast<Sint64>(y)));
+        if (abs_x == 0) {
+            vector = {0, sign_y * 0x4000};
+            return true;
+        }
+        if (abs_y == 0) {
+            vector = {sign_x * 0x4000, 0};
+            return true;
+        }
+
+        // Scale so the estimated length is between 2/3 and 4/3 in 16.16.
+        Uint32 length = abs_x > abs_y ? abs_x + (abs_y >> 1) : abs_y + (abs_x >> 1);
+        int most_significant_bit = 31;
+        while (!(length & (1u << most_significant_bit))) {
+            most_significant_bit--;
+        }
+        int shift = 31 - most_significant_bit;
+        shift -= 15 + (length >= (0xAAAAAAAAu >> shift) ? 1 : 0);
+        if (shift > 0) {
+            abs_x <<= shift;
+            abs_y <<= shift;
+            length = abs_x > abs_y ? abs_x + (abs_y >> 1) : abs_y + (abs_x >> 1);
+        } else {
+            abs_x >>= -shift;
+            abs_y >>= -shift;
+            length >>= -shift;
+        }
+
+        Sint32 reciprocal = 0x10000 - static_cast<Sint32>(length);
+        Sint32 scaled_x = static_cast<Sint32>(abs_x);
+        Sint32 scaled_y = static_cast<Sint32>(abs_y);
+        Uint32 u;
+        Uint32 v;
+        Sint32 correction;
+        do {
+            u = static_cast<Uint32>(scaled_x + (scaled_x * reciprocal >> 16));
+            v = static_cast<Uint32>(scaled_y + (scaled_y * reciprocal >> 16));
+            correction = -static_cast<Sint32>(u * u + v * v) / 0x200;
+            correction = correction * ((0x10000 + reciprocal) >> 8) / 0x10000;
+            reciprocal += correction;
+        } while (correction > 0);
+
+        vector.x = sign_x * static_cast<Sint32>(u) / 4;
+        vector.y = sign_y * static_cast<Sint32>(v) / 4;
+        return true;
+    }
+
+    // value times a 2.14 factor, rounding halves up.
+    Sint32 mul_2dot14(Sint32 value, Sint32 factor) {
+        Sint64 product = static_cast<Sint64>(value) * factor;
+        return static_cast<Sint32>((product + 0x2000 + (product < 0 ? -1 : 0)) >> 14);
+    }
+
+    bool is_valid_point(const HintingZone& zone, Sint32 point) {
+        return point >= 0 && static_cast<size_t>(point) < zone.get_point_count();
+    }
+}
+
+// --------------------------------------------------------------------------
+
+void HintingZone::clear() {
+    original_units.clear();
+    original.clear();
+    current.clear();
+    flags.clear();
+    end_point_indices.clear();
+}
+
+// --------------------------------------------------------------------------
+
+void HintingZone::resize(size_t point_count) {
+    original_units.resize(point_count);
+    original.resize(point_count);
+    current.resize(point_count);
+    flags.resize(point_count);
+}
+
+// --------------------------------------------------------------------------
+
+HintingGraphicsState::HintingGraphicsState()
+    : projection_vector{ONE_2DOT14, 0},
+      freedom_vector{ONE_2DOT14, 0},
+      dual_projection_vector{ONE_2DOT14, 0},
+      reference_points{0, 0, 0},
+      zone_pointers{1, 1, 1},
+      loop(1),
+      round_state(HintingRoundState::TO_GRID),
+      round_period(64),
+      round_phase(0),
+      round_threshold(32),
+      minimum_distance(64),
+      control_value_cut_in(68),
+      single_width_cut_in(0),
+      single_width_value(0),
+      delta_base(9),
+      delta_shift(3),
+      auto_flip(true),
+      instruct_control(0) {
+}
+
+// --------------------------------------------------------------------------
+
+void HintingGraphicsState::reset_for_glyph() {
+    projection_vector = {ONE_2DOT14, 0};
+    freedom_vector = projection_vector;
+    dual_projection_vector = projection_vector;
+
+    for (int i = 0; i < 3; i++) {
+        reference_points[i] = 0;
+        zone_pointers[i] = 1;
+    }
+
+    loop = 1;
+    round_state = HintingRoundState::TO_GRID;
+}
+
+// --------------------------------------------------------------------------
+
+HintingInterpreter::HintingInterpreter()
+    : error(nullptr),
+      program(Program::GLYPH),
+      functions(nullptr),
+      writable_functions(nullptr),
+      state(nullptr),
+      graphics_state(nullptr),
+      zones{nullptr, nullptr},
+      freedom_dot_projection(ONE_2DOT14) {
+}
+
+// --------------------------------------------------------------------------
+
+bool HintingInterpreter::execute(
+    const Uint8* code,
+    size_t code_length,
+    Program program,
+    int max_stack_depth,
+    const HintingFunctionTable& function_table,
+    HintingFunctionTable* writable_function_table,
+    HintingState& hinting_state,
+    HintingZone& glyph_zone
+) {
+    this->program = program;
+    functions = writable_function_table != nullptr ? writable_function_table : &function_table;
+    writable_functions = writable_function_table;
+    state = &hinting_state;
+    graphics_state = &hinting_state.graphics_state;
+    zones[0] = &hinting_state.twilight_zone;
+    zones[1] = &glyph_zone;
+
+    stack.resize(max_stack_depth > 0 ? max_stack_depth : 0);
+    call_stack.clear();
+    error = nullptr;
+
+    update_freedom_dot_projection();
+    return run(code, code_length);
+}
+
+// --------------------------------------------------------------------------
+
+const char* HintingInterpreter::get_error() const {
+    return error != nullptr ? error : "";
+}
+
+// --------------------------------------------------------------------------
+
+Sint32 HintingInterpreter::scale_font_units(Sint32 value, Sint32 scale) {
+    return mul_div(value, scale, 0x10000);
+}
+
+// --------------------------------------------------------------------------
+
+bool HintingInterpreter::fail(const char* message) {
+    error = message;
+    return false;
+}
+
+// --------------------------------------------------------------------------
+
+bool HintingInterpreter::run(const Uint8* code, size_t code_length) {
+    HintingGraphicsState& gs = *graphics_state;
+    Sint32* stack_base = stack.data();
+    size_t stack_capacity = stack.size();
+    size_t stack_top = 0;
+    size_t position = 0;
+    Uint32 instruction_count = 0;
+
+    while (true) {
+        if (position >= code_length) {
+            if (call_stack.empty()) {
+                return true;
+            }
+            return fail("Function ran past the end of its program");
+        }
+
+        if (++instruction_count > MAX_INSTRUCTION_COUNT) {
+            return fail("Too many instructions; the program is probably stuck in a loop");
+        }
+
+        Uint8 opcode = code[position];
+        Uint8 effect = STACK_EFFECTS.effects[opcode];
+        size_t pop_count = effect >> 4;
+        // Outside FreeType's pedantic mode missing arguments read as zeros,
+        // and an instruction looping over more points than the stack holds
+        // does nothing. Shipping fonts rely on both.
+        if (stack_top < pop_count) {
+            if (stack_capacity < pop_count) {
+                return fail("Stack overflow");
+            }
+            std::fill(stack_base, stack_base + pop_count, 0);
+            stack_top = pop_count;
+        }
+
+        Sint32* args = stack_base + stack_top - pop_count;
+        size_t new_top = stack_top - pop_count + (effect & 0x0F);
+        if (new_top > stack_capacity) {
+            return fail("Stack overflow");
+        }
+
+        size_t next_position = position + 1;
+
+        switch (opcode) {
+
+            // --- vectors ---
+
+            case 0x00: case 0x01: case 0x02: case 0x03: case 0x04: case 0x05: {
+                // SVTCA, SPVTCA, SFVTCA: the odd opcodes pick the x axis.
+                HintingVector axis = (opcode & 1) ? HintingVector{ONE_2DOT14, 0} : HintingVector{0, ONE_2DOT14};
+                if (opcode < 0x04) {
+                    gs.projection_vector = axis;
+                    gs.dual_projection_vector = axis;
+                }
+                if (opcode < 0x02 || opcode >= 0x04) {
+                    gs.freedom_vector = axis;
+                }
+                update_freedom_dot_projection();
+                break;
+            }
+
+            case 0x06: case 0x07:
+                // SPVTL
+                if (set_vector_to_line(opcode, args[0], args[1], false, gs.projection_vector)) {
+                    gs.dual_projection_vector = gs.projection_vector;
+                    update_freedom_dot_projection();
+                }
+                break;
+
+            case 0x08: case 0x09:
+                // SFVTL
+                if (set_vector_to_line(opcode, args[0], args[1], false, gs.freedom_vector)) {
+                    update_freedom_dot_projection();
+                }
+                break;
+
+            case 0x0A:
+                // SPVFS
+                normalize(static_cast<Sint16>(args[0]), static_cast<Sint16>(args[1]), gs.projection_vector);
+                gs.dual_projection_vector = gs.projection_vector;
+                update_freedom_dot_projection();
+                break;
+
+            case 0x0B:
+                // SFVFS
+                normalize(static_cast<Sint16>(args[0]), static_cast<Sint16>(args[1]), gs.freedom_vector);
+                update_freedom_dot_projection();
+                break;
+
+            case 0x0C:
+                // GPV
+                args[0] = gs.projection_vector.x;
+                args[1] = gs.projection_vector.y;
+                break;
+
+            case 0x0D:
+                // GFV
+                args[0] = gs.freedom_vector.x;
+                args[1] = gs.freedom_vector.y;
+                break;
+
+            case 0x0E:
+                // SFVTPV
+                gs.freedom_vector = gs.projection_vector;
+                update_freedom_dot_projection();
+                break;
+
+            case 0x86: case 0x87: {
+                // SDPVTL: the dual vector from the original outline, the
+                // projection vector from the current one.
+                if (set_vector_to_line(opcode, args[0], args[1], true, gs.dual_projection_vector)) {
+                    set_vector_to_line(opcode, args[0], args[1], false, gs.projection_vector);
+                    update_freedom_dot_projection();
+                }
+                break;
+            }
+
+            case 0x0F: {
+                // ISECT: move a point to where lines a0-a1 and b0-b1 cross.
+                HintingZone& zone_a = get_zone(1);
+                HintingZone& zone_b = get_zone(0);
+                HintingZone& zone = get_zone(2);
+                if (!is_valid_point(zone, args[0]) || !is_valid_point(zone_a, args[1]) || !is_valid_point(zone_a, args[2]) ||
+                    !is_valid_point(zone_b, args[3]) || !is_valid_point(zone_b, args[4])) {
+                    break;
+                }
+
+                HintingVector a0 = zone_a.current[args[1]];
+                HintingVector a1 = zone_a.current[args[2]];
+                HintingVector b0 = zone_b.current[args[3]];
+                HintingVector b1 = zone_b.current[args[4]];
+                HintingVector& point = zone.current[args[0]];
+
+                Sint32 dbx = b1.x - b0.x;
+                Sint32 dby = b1.y - b0.y;
+                Sint32 dax = a1.x - a0.x;
+                Sint32 day = a1.y - a0.y;
+                Sint32 dx = b0.x - a0.x;
+                Sint32 dy = b0.y - a0.y;
+
+                Sint32 discriminant = mul_div(dax, -dby, 0x40) + mul_div(day, dbx, 0x40);
+                Sint32 dot_product = mul_div(dax, dbx, 0x40) + mul_div(day, dby, 0x40);
+
+                // Lines within about 3 degrees of parallel meet too far off
+                // to trust; use the middle of the four points instead.
+                if (19 * static_cast<Sint64>(std::abs(discriminant)) > std::abs(static_cast<Sint64>(dot_product))) {
+                    Sint32 value = mul_div(dx, -dby, 0x40) + mul_div(dy, dbx, 0x40);
+                    point.x = a0.x + mul_div(value, dax, discriminant);
+                    point.y = a0.y + mul_div(value, day, discriminant);
+                } else {
+                    point.x = (a0.x + a1.x + b0.x + b1.x) / 4;
+                    point.y = (a0.y + a1.y + b0.y + b1.y) / 4;
+                }
+                zone.flags[args[0]] |= HintingZone::TOUCHED_X | HintingZone::TOUCHED_Y;
+                break;
+            }
+
+            // --- graphics state ---
+
+            case 0x10: case 0x11: case 0x12:
+                // SRP0, SRP1, SRP2
+                gs.reference_points[opcode - 0x10] = static_cast<Uint32>(args[0]);
+                break;
+
+            case 0x13: case 0x14: case 0x15: case 0x16:
+                // SZP0, SZP1, SZP2, SZPS
+                if (args[0] != 0 && args[0] != 1) {
+                    return fail("Invalid zone");
+                }
+                if (opcode == 0x16) {
+                    gs.zone_pointers[0] = gs.zone_pointers[1] = gs.zone_pointers[2] = static_cast<Uint8>(args[0]);
+                } else {
+                    gs.zone_pointers[opcode - 0x13] = static_cast<Uint8>(args[0]);
+                }
+                break;
+
+            case 0x17:
+                // SLOOP
+                if (args[0] < 0) {
+                    return fail("Negative loop count");
+                }
+                gs.loop = args[0] < 0xFFFF ? args[0] : 0xFFFF;
+                break;
+
+            case 0x18:
+                gs.round_state = HintingRoundState::TO_GRID;
+                break;
+
+            case 0x19:
+                gs.round_state = HintingRoundState::TO_HALF_GRID;
+                break;
+
+            case 0x3D:
+                gs.round_state = HintingRoundState::TO_DOUBLE_GRID;
+                break;
+
+            case 0x7A:
+                gs.round_state = HintingRoundState::OFF;
+                break;
+
+            case 0x7C:
+                gs.round_state = HintingRoundState::UP_TO_GRID;
+                break;
+
+            case 0x7D:
+                gs.round_state = HintingRoundState::DOWN_TO_GRID;
+                break;
+
+            case 0x76:
+                // SROUND
+                set_super_round(0x4000, args[0]);
+                gs.round_state = HintingRoundState::SUPER;
+                break;
+
+            case 0x77:
+                // S45ROUND: the period is sqrt(2)/2 of a pixel.
+                set_super_round(0x2D41, args[0]);
+                gs.round_state = HintingRoundState::SUPER_45;
+                break;
+
+            case 0x1A:
+                // SMD
+                gs.minimum_distance = args[0];
+                break;
+
+            case 0x1D:
+                // SCVTCI
+                gs.control_value_cut_in = args[0];
+                break;
+
+            case 0x1E:
+                // SSWCI
+                gs.single_width_cut_in = args[0];
+                break;
+
+            case 0x1F:
+                // SSW, given in font units.
+                gs.single_width_value = scale_font_units(args[0], state->scale);
+                break;
+
+            case 0x4D:
+                gs.auto_flip = true;
+                break;
+
+            case 0x4E:
+                gs.auto_flip = false;
+                break;
+
+            case 0x5E:
+                // SDB
+                gs.delta_base = args[0];
+                break;
+
+            case 0x5F:
+                // SDS
+                if (args[0] < 0 || args[0] > 6) {
+                    return fail("Invalid delta shift");
+                }
+                gs.delta_shift = args[0];
+                break;
+
+            case 0x8E: {
+                // INSTCTRL, which only the control value program may use.
+                Sint32 selector = args[1];
+                if (program == Program::CONTROL_VALUE && selector >= 1 && selector <= 3) {
+                    Uint8 bit = static_cast<Uint8>(1 << (selector - 1));
+                    gs.instruct_control = static_cast<Uint8>((gs.instruct_control & ~bit) | (args[0] != 0 ? bit : 0));
+                }
+                break;
+            }
+
+            case 0x4F: case 0x7E: case 0x7F: case 0x85: case 0x8D:
+                // DEBUG, SANGW, AA, SCANCTRL and SCANTYPE. The rasterizer
+                // always anti-aliases, so dropout control has nothing to do.
+                break;
+
+            // --- stack ---
+
+            case 0x20:
+                // DUP
+                args[1] = args[0];
+                break;
+
+            case 0x21:
+                // POP
+                break;
+
+            case 0x22:
+                // CLEAR
+                new_top = 0;
+                break;
+
+            case 0x23:
+                // SWAP
+                std::swap(args[0], args[1]);
+                break;
+
+            case 0x24:
+                // DEPTH
+                args[0] = static_cast<Sint32>(stack_top);
+                break;
+
+            case 0x25: {
+                // CINDEX: copy the kth element to the top.
+                Sint32 k = args[0];
+                args[0] = k > 0 && static_cast<size_t>(k) <= stack_top - 1 ? stack_base[stack_top - 1 - k] : 0;
+                break;
+            }
+
+            case 0x26: {
+                // MINDEX: move the kth element to the top.
+                Sint32 k = args[0];
+                if (k <= 0 || static_cast<size_t>(k) > new_top) {
+                    return fail("Invalid stack index");
+                }
+                Sint32 value = stack_base[new_top - k];
+                std::memmove(stack_base + new_top - k, stack_base + new_top - k + 1, (k - 1) * sizeof(Sint32));
+                stack_base[new_top - 1] = value;
+                break;
+            }
+
+            case 0x8A: {
+                // ROLL: the third element comes to the top.
+                Sint32 a = args[0];
+                args[0] = args[1];
+                args[1] = args[2];
+                args[2] = a;
+                break;
+            }
+
+            case 0x40: case 0x41: case 0xB0: case 0xB1: case 0xB2: case 0xB3: case 0xB4: case 0xB5: case 0xB6: case 0xB7:
+            case 0xB8: case 0xB9: case 0xBA: case 0xBB: case 0xBC: case 0xBD: case 0xBE: case 0xBF: {
+                // NPUSHB, NPUSHW, PUSHB and PUSHW
+                size_t length = get_instruction_length(code, code_length, position);
+                if (length == 0) {
+                    return fail("Push runs past the end of the program");
+                }
+
+                bool are_words = opcode == 0x41 || opcode >= 0xB8;
+                size_t data_start = position + ((opcode == 0x40 || opcode == 0x41) ? 2 : 1);
+                size_t count = (position + length - data_start) / (are_words ? 2 : 1);
+                if (new_top + count > stack_capacity) {
+                    return fail("Stack overflow");
+                }
+
+                const Uint8* data = code + data_start;
+                if (are_words) {
+                    for (size_t i = 0; i < count; i++) {
+                        stack_base[new_top++] = static_cast<Sint16>((data[2 * i] << 8) | data[2 * i + 1]);
+                    }
+                } else {
+                    for (size_t i = 0; i < count; i++) {
+                        stack_base[new_top++] = data[i];
+                    }
+                }
+
+                next_position = position + length;
+                break;
+            }
+
+            // --- storage and control values ---
+
+            case 0x42:
+                // WS
+                if (args[0] >= 0 && static_cast<size_t>(args[0]) < state->storage.size()) {
+                    state->storage[args[0]] = args[1];
+                }
+                break;
+
+            case 0x43:
+                // RS
+                args[0] = args[0] >= 0 && static_cast<size_t>(args[0]) < state->storage.size() ? state->storage[args[0]] : 0;
+                break;
+
+            case 0x44: case 0x70:
+                // WCVTP in pixels, WCVTF in font units.
+                if (args[0] >= 0 && static_cast<size_t>(args[0]) < state->control_values.size()) {
+                    state->control_values[args[0]] = opcode == 0x44 ? args[1] : scale_font_units(args[1], state->scale);
+                }
+                break;
+
+            case 0x45:
+                // RCVT
+                args[0] = get_control_value(args[0]);
+                break;
+
+            // --- flow control ---
+
+            case 0x58: case 0x1B: {
+                // IF with a false condition skips to its ELSE or EIF; an ELSE
+                // reached by running the IF branch skips to the EIF.
+                if (opcode == 0x58 && args[0] != 0) {
+                    break;
+                }
+
+                int nesting = 1;
+                size_t scan = next_position;
+                while (nesting > 0) {
+                    if (scan >= code_length) {
+                        return fail("IF without EIF");
+                    }
+
+                    Uint8 skipped_opcode = code[scan];
+                    size_t length = get_instruction_length(code, code_length, scan);
+                    if (length == 0) {
+                        return fail("IF without EIF");
+                    }
+                    scan += length;
+
+                    if (skipped_opcode == 0x58) {
+                        nesting++;
+                    } else if (skipped_opcode == 0x59) {
+                        nesting--;
+                    } else if (skipped_opcode == 0x1B && nesting == 1 && opcode == 0x58) {
+                        break;
+                    }
+                }
+
+                next_position = scan;
+                break;
+            }
+
+            case 0x59:
+                // EIF
+                break;
+
+            case 0x1C: case 0x78: case 0x79: {
+                // JMPR, JROT and JROF, relative to the jump itself.
+                Sint32 offset = args[0];
+                if (opcode == 0x78 && args[1] == 0) {
+                    break;
+                }
+                if (opcode == 0x79 && args[1] != 0) {
+                    break;
+                }
+
+                Sint64 target = static_cast<Sint64>(position) + offset;
+                if (target < 0 || static_cast<size_t>(target) > code_length) {
+                    return fail("Jump out of the program");
+                }
+                next_position = static_cast<size_t>(target);
+                break;
+            }
+
+            case 0x2C: case 0x89: {
+                // FDEF and IDEF record where the body starts and skip it.
+                if (writable_functions == nullptr) {
+                    return fail("Function definition in a glyph program");
+                }
+
+                std::vector<HintingFunction>& table = opcode == 0x2C ? writable_functions->functions : writable_functions->instructions;
+                Sint32 number = args[0];
+                if (number < 0 || number > (opcode == 0x2C ? 0xFFFF : 0xFF)) {
+                    return fail("Invalid function number");
+                }
+                if (static_cast<size_t>(number) >= table.size()) {
+                    table.resize(number + 1, HintingFunction{nullptr, 0, 0});
+                }
+                table[number] = {code, static_cast<Uint32>(code_length), static_cast<Uint32>(next_position)};
+
+                size_t scan = next_position;
+                while (true) {
+                    if (scan >= code_length) {
+                        return fail("Function without ENDF");
+                    }
+
+                    Uint8 body_opcode = code[scan];
+                    if (body_opcode == 0x2C || body_opcode == 0x89) {
+                        return fail("Nested function definition");
+                    }
+
+                    size_t length = get_instruction_length(code, code_length, scan);
+                    if (length == 0) {
+                        return fail("Function without ENDF");
+                    }
+                    scan += length;
+
+                    if (body_opcode == 0x2D) {
+                        break;
+                    }
+                }
+
+                next_position = scan;
+                break;
+            }
+
+            case 0x2D: {
+                // ENDF: go round again for LOOPCALL, otherwise return.
+                if (call_stack.empty()) {
+                    return fail("ENDF outside a function");
+                }
+
+                CallFrame& frame = call_stack.back();
+                if (--frame.remaining_count > 0) {
+                    next_position = frame.function.start;
+                    break;
+                }
+
+                code = frame.return_code;
+                code_length = frame.return_code_length;
+                next_position = frame.return_position;
+                call_stack.pop_back();
+                break;
+            }
+
+            case 0x2A: case 0x2B: {
+                // LOOPCALL takes a count under the function number; CALL is
+                // a single call.
+                Sint32 count = opcode == 0x2A ? args[0] : 1;
+                Sint32 number = opcode == 0x2A ? args[1] : args[0];
+                if (number < 0 || static_cast<size_t>(number) >= functions->functions.size() || functions->functions[number].code == nullptr) {
+                    return fail("Call to an undefined function");
+                }
+                if (count <= 0) {
+                    break;
+                }
+                if (call_stack.size() >= MAX_CALL_DEPTH) {
+                    return fail("Calls nested too deeply");
+                }
+
+                const HintingFunction& function = functions->functions[number];
+                call_stack.push_back({code, code_length, next_position, function, count});
+                code = function.code;
+                code_length = function.code_length;
+                next_position = function.start;
+                break;
+            }
+
+            // --- arithmetic and logic ---
+
+            case 0x50:
+                args[0] = args[0] < args[1];
+                break;
+
+            case 0x51:
+                args[0] = args[0] <= args[1];
+                break;
+
+            case 0x52:
+                args[0] = args[0] > args[1];
+                break;
+
+            case 0x53:
+                args[0] = args[0] >= args[1];
+                break;
+
+            case 0x54:
+                args[0] = args[0] == args[1];
+                break;
+
+            case 0x55:
+                args[0] = args[0] != args[1];
+                break;
+
+            case 0x56:
+                // ODD and EVEN look at the value after rounding.
+                args[0] = (round(args[0]) & 127) == 64;
+                break;
+
+            case 0x57:
+                args[0] = (round(args[0]) & 127) == 0;
+                break;
+
+            case 0x5A:
+                args[0] = args[0] != 0 && args[1] != 0;
+                break;
+
+            case 0x5B:
+                args[0] = args[0] != 0 || args[1] != 0;
+                break;
+
+            case 0x5C:
+                args[0] = args[0] == 0;
+                break;
+
+            case 0x60:
+                args[0] = add_wrapping(args[0], args[1]);
+                break;
+
+            case 0x61:
+                args[0] = subtract_wrapping(args[0], args[1]);
+                break;
+
+            case 0x62:
+                // DIV and MUL work in 26.6.
+                if (args[1] == 0) {
+                    return fail("Division by zero");
+                }
+                args[0] = mul_div_no_round(args[0], 64, args[1]);
+                break;
+
+            case 0x63:
+                args[0] = mul_div(args[0], args[1], 64);
+                break;
+
+            case 0x64:
+                args[0] = args[0] < 0 ? subtract_wrapping(0, args[0]) : args[0];
+                break;
+
+            case 0x65:
+                args[0] = subtract_wrapping(0, args[0]);
+                break;
+
+            case 0x66:
+                args[0] = args[0] & -64;
+                break;
+
+            case 0x67:
+                args[0] = add_wrapping(args[0], 63) & -64;
+                break;
+
+            case 0x8B:
+                args[0] = args[0] > args[1] ? args[0] : args[1];
+                break;
+
+            case 0x8C:
+                args[0] = args[0] < args[1] ? args[0] : args[1];
+                break;
+
+            case 0x68: case 0x69: case 0x6A: case 0x6B:
+                // ROUND. Engine compensation is zero for every distance
+                // type, so the opcode's low bits make no difference here or
+                // to NROUND, which leaves the value as it is.
+                args[0] = round(args[0]);
+                break;
+
+            case 0x6C: case 0x6D: case 0x6E: case 0x6F:
+                break;
+
+            // --- measurement ---
+
+            case 0x46: case 0x47: {
+                // GC: the current position, or the original one for GC[1].
+                HintingZone& zone = get_zone(2);
+                if (!is_valid_point(zone, args[0])) {
+                    args[0] = 0;
+                } else if (opcode == 0x46) {
+                    args[0] = project(zone.current[args[0]].x, zone.current[args[0]].y);
+                } else {
+                    args[0] = dual_project(zone.original[args[0]].x, zone.original[args[0]].y);
+                }
+                break;
+            }
+
+            case 0x48: {
+                // SCFS
+                HintingZone& zone = get_zone(2);
+                if (!is_valid_point(zone, args[0])) {
+                    break;
+                }
+                Uint32 point = args[0];
+                move_point(zone, point, subtract_wrapping(args[1], project(zone.current[point].x, zone.current[point].y)));
+
+                // Twilight points are moved in both outlines, as Windows does.
+                if (gs.zone_pointers[2] == 0) {
+                    zone.original[point] = zone.current[point];
+                }
+                break;
+            }
+
+            case 0x49: case 0x4A: {
+                // MD[0] measures the current outline and MD[1] the original,
+                // the reverse of what the old Apple spec says but what both
+                // FreeType and Windows do.
+                HintingZone& zone_0 = get_zone(0);
+                HintingZone& zone_1 = get_zone(1);
+                Sint32 point_0 = args[0];
+                Sint32 point_1 = args[1];
+                if (!is_valid_point(zone_0, point_0) || !is_valid_point(zone_1, point_1)) {
+                    args[0] = 0;
+                } else if (opcode == 0x49) {
+                    const HintingVector& a = zone_0.current[point_0];
+                    const HintingVector& b = zone_1.current[point_1];
+                    args[0] = project(a.x - b.x, a.y - b.y);
+                } else if (gs.zone_pointers[0] == 0 || gs.zone_pointers[1] == 0) {
+                    const HintingVector& a = zone_0.original[point_0];
+                    const HintingVector& b = zone_1.original[point_1];
+                    args[0] = dual_project(a.x - b.x, a.y - b.y);
+                } else {
+                    const HintingVector& a = zone_0.original_units[point_0];
+                    const HintingVector& b = zone_1.original_units[point_1];
+                    args[0] = scale_font_units(dual_project(a.x - b.x, a.y - b.y), state->units_scale);
+                }
+                break;
+            }
+
+            case 0x4B: case 0x4C:
+                // MPPEM and MPS. Pixels are square, so the point size at
+                // 72 dpi and the ppem are the same number.
+                args[0] = state->ppem;
+                break;
+
+            case 0x88: {
+                // GETINFO: version 35, greyscale.
+                Sint32 result = 0;
+                if (args[0] & 1) {
+                    result = 35;
+                }
+                if (args[0] & 32) {
+                    result |= 1 << 12;
+                }
+                args[0] = result;
+                break;
+            }
+
+            // --- moving points ---
+
+            case 0x2E: case 0x2F: {
+                // MDAP, rounding the point's position for MDAP[1].
+                HintingZone& zone = get_zone(0);
+                Sint32 point = args[0];
+                if (!is_valid_point(zone, point)) {
+                    break;
+                }
+
+                Sint32 distance = 0;
+                if (opcode & 1) {
+                    Sint32 position_on_vector = project(zone.current[point].x, zone.current[point].y);
+                    distance = round(position_on_vector) - position_on_vector;
+                }
+                move_point(zone, point, distance);
+
+                gs.reference_points[0] = point;
+                gs.reference_points[1] = point;
+                break;
+            }
+
+            case 0x3E: case 0x3F: {
+                // MIAP: move a point to a control value, for MIAP[1] rounded
+                // and only if it is within the cut-in of where it already is.
+                HintingZone& zone = get_zone(0);
+                Sint32 point = args[0];
+                Sint32 control_value_index = args[1];
+                if (!is_valid_point(zone, point) || control_value_index < 0 || static_cast<size_t>(control_value_index) >= state->control_values.size()) {
+                    gs.reference_points[0] = point;
+                    gs.reference_points[1] = point;
+                    break;
+                }
+
+                Sint32 distance = state->control_values[control_value_index];
+                if (gs.zone_pointers[0] == 0) {
+                    zone.original[point].x = mul_2dot14(distance, gs.freedom_vector.x);
+                    zone.original[point].y = mul_2dot14(distance, gs.freedom_vector.y);
+                    zone.current[point] = zone.original[point];
+                }
+
+                Sint32 original_distance = project(zone.current[point].x, zone.current[point].y);
+                if (opcode & 1) {
+                    if (std::abs(distance - original_distance) > gs.control_value_cut_in) {
+                        distance = original_distance;
+                    }
+                    distance = round(distance);
+                }
+                move_point(zone, point, distance - original_distance);
+
+                gs.reference_points[0] = point;
+                gs.reference_points[1] = point;
+                break;
+            }
+
+            case 0xC0: case 0xC1: case 0xC2: case 0xC3: case 0xC4: case 0xC5: case 0xC6: case 0xC7:
+            case 0xC8: case 0xC9: case 0xCA: case 0xCB: case 0xCC: case 0xCD: case 0xCE: case 0xCF:
+            case 0xD0: case 0xD1: case 0xD2: case 0xD3: case 0xD4: case 0xD5: case 0xD6: case 0xD7:
+            case 0xD8: case 0xD9: case 0xDA: case 0xDB: case 0xDC: case 0xDD: case 0xDE: case 0xDF: {
+                // MDRP[abcde]: keep a point at its original distance from
+                // rp0. a sets rp0 to the point afterwards, b keeps the
+                // minimum distance, c rounds; de is the distance type.
+                HintingZone& reference_zone = get_zone(0);
+                HintingZone& zone = get_zone(1);
+                Sint32 point = args[0];
+                Uint32 reference_point = gs.reference_points[0];
+                if (is_valid_point(zone, point) && reference_point < reference_zone.get_point_count()) {
+                    Sint32 original_distance;
+                    if (gs.zone_pointers[0] == 0 || gs.zone_pointers[1] == 0) {
+                        const HintingVector& a = zone.original[point];
+                        const HintingVector& b = reference_zone.original[reference_point];
+                        original_distance = dual_project(a.x - b.x, a.y - b.y);
+                    } else {
+                        const HintingVector& a = zone.original_units[point];
+                        const HintingVector& b = reference_zone.original_units[reference_point];
+                        original_distance = scale_font_units(dual_project(a.x - b.x, a.y - b.y), state->units_scale);
+                    }
+
+                    if (std::abs(original_distance - gs.single_width_value) < gs.single_width_cut_in) {
+                        original_distance = original_distance >= 0 ? gs.single_width_value : -gs.single_width_value;
+                    }
+
+                    Sint32 distance = (opcode & 4) ? round(original_distance) : original_distance;
+                    if (opcode & 8) {
+                        if (original_distance >= 0) {
+                            distance = distance < gs.minimum_distance ? gs.minimum_distance : distance;
+                        } else {
+                            distance = distance > -gs.minimum_distance ? -gs.minimum_distance : distance;
+                        }
+                    }
+
+                    const HintingVector& a = zone.current[point];
+                    const HintingVector& b = reference_zone.current[reference_point];
+                    move_point(zone, point, distance - project(a.x - b.x, a.y - b.y));
+                }
+
+                gs.reference_points[1] = gs.reference_points[0];
+                gs.reference_points[2] = point;
+                if (opcode & 16) {
+                    gs.reference_points[0] = point;
+                }
+                break;
+            }
+
+            case 0xE0: case 0xE1: case 0xE2: case 0xE3: case 0xE4: case 0xE5: case 0xE6: case 0xE7:
+            case 0xE8: case 0xE9: case 0xEA: case 0xEB: case 0xEC: case 0xED: case 0xEE: case 0xEF:
+            case 0xF0: case 0xF1: case 0xF2: case 0xF3: case 0xF4: case 0xF5: case 0xF6: case 0xF7:
+            case 0xF8: case 0xF9: case 0xFA: case 0xFB: case 0xFC: case 0xFD: case 0xFE: case 0xFF: {
+                // MIRP[abcde]: like MDRP, but the distance comes from a
+                // control value, which the original distance overrides if
+                // they are further apart than the cut-in.
+                HintingZone& reference_zone = get_zone(0);
+                HintingZone& zone = get_zone(1);
+                Sint32 point = args[0];
+                Sint32 control_value_index = args[1];
+                Uint32 reference_point = gs.reference_points[0];
+                bool is_valid_control_value = control_value_index >= -1 && control_value_index < static_cast<Sint64>(state->control_values.size());
+                if (is_valid_point(zone, point) && reference_point < reference_zone.get_point_count() && is_valid_control_value) {
+                    Sint32 control_value_distance = control_value_index == -1 ? 0 : state->control_values[control_value_index];
+                    if (std::abs(control_value_distance - gs.single_width_value) < gs.single_width_cut_in) {
+                        control_value_distance = control_value_distance >= 0 ? gs.single_width_value : -gs.single_width_value;
+                    }
+
+                    // A twilight point is first placed at the control value's
+                    // distance from rp0, as Windows does.
+                    if (gs.zone_pointers[1] == 0) {
+                        zone.original[point].x = reference_zone.original[reference_point].x + mul_2dot14(control_value_distance, gs.freedom_vector.x);
+                        zone.original[point].y = reference_zone.original[reference_point].y + mul_2dot14(control_value_distance, gs.freedom_vector.y);
+                        zone.current[point] = zone.original[point];
+                    }
+
+                    const HintingVector& original_a = zone.original[point];
+                    const HintingVector& original_b = reference_zone.original[reference_point];
+                    Sint32 original_distance = dual_project(original_a.x - original_b.x, original_a.y - original_b.y);
+                    const HintingVector& current_a = zone.current[point];
+                    const HintingVector& current_b = reference_zone.current[reference_point];
+                    Sint32 current_distance = project(current_a.x - current_b.x, current_a.y - current_b.y);
+
+                    if (gs.auto_flip && (original_distance ^ control_value_distance) < 0) {
+                        control_value_distance = -control_value_distance;
+                    }
+
+                    Sint32 distance = control_value_distance;
+                    if (opcode & 4) {
+                        // The cut-in only applies when both points are in
+                        // the same zone.
+                        if (gs.zone_pointers[0] == gs.zone_pointers[1] && std::abs(control_value_distance - original_distance) > gs.control_value_cut_in) {
+                            distance = original_distance;
+                        }
+                        distance = round(distance);
+                    }
+
+                    if (opcode & 8) {
+                        if (original_distance >= 0) {
+                            distance = distance < gs.minimum_distance ? gs.minimum_distance : distance;
+                        } else {
+                            distance = distance > -gs.minimum_distance ? -gs.minimum_distance : distance;
+                        }
+                    }
+
+                    move_point(zone, point, distance - current_distance);
+                }
+
+                gs.reference_points[1] = gs.reference_points[0];
+                if (opcode & 16) {
+                    gs.reference_points[0] = point;
+                }
+                gs.reference_points[2] = point;
+                break;
+            }
+
+            case 0x3A: case 0x3B: {
+                // MSIRP: put a point distance away from rp0.
+                HintingZone& reference_zone = get_zone(0);
+                HintingZone& zone = get_zone(1);
+                Sint32 point = args[0];
+                Uint32 reference_point = gs.reference_points[0];
+                if (!is_valid_point(zone, point) || reference_point >= reference_zone.get_point_count()) {
+                    break;
+                }
+
+                if (gs.zone_pointers[1] == 0) {
+                    zone.original[point] = reference_zone.original[reference_point];
+                    move_original_point(zone, point, args[1]);
+                    zone.current[point] = zone.original[point];
+                }
+
+                const HintingVector& a = zone.current[point];
+                const HintingVector& b = reference_zone.current[reference_point];
+                move_point(zone, point, subtract_wrapping(args[1], project(a.x - b.x, a.y - b.y)));
+
+                gs.reference_points[1] = gs.reference_points[0];
+                gs.reference_points[2] = point;
+                if (opcode & 1) {
+                    gs.reference_points[0] = point;
+                }
+                break;
+            }
+
+            case 0x3C: {
+                // ALIGNRP: move loop points onto rp0 along the projection.
+                HintingZone& reference_zone = get_zone(0);
+                HintingZone& zone = get_zone(1);
+                Uint32 reference_point = gs.reference_points[0];
+                bool is_reference_valid = reference_point < reference_zone.get_point_count();
+
+                if (new_top < static_cast<size_t>(gs.loop)) {
+                    gs.loop = 1;
+                    break;
+                }
+                for (; gs.loop > 0; gs.loop--) {
+                    Sint32 point = stack_base[--new_top];
+                    if (is_reference_valid && is_valid_point(zone, point)) {
+                        const HintingVector& a = zone.current[point];
+                        const HintingVector& b = reference_zone.current[reference_point];
+                        move_point(zone, point, -project(a.x - b.x, a.y - b.y));
+                    }
+                }
+                gs.loop = 1;
+                break;
+            }
+
+            case 0x27: {
+                // ALIGNPTS: move two points halfway towards each other.
+                HintingZone& zone_0 = get_zone(0);
+                HintingZone& zone_1 = get_zone(1);
+                Sint32 point_1 = args[0];
+                Sint32 point_2 = args[1];
+                if (!is_valid_point(zone_1, point_1) || !is_valid_point(zone_0, point_2)) {
+                    break;
+                }
+
+                const HintingVector& a = zone_0.current[point_2];
+                const HintingVector& b = zone_1.current[point_1];
+                Sint32 distance = project(a.x - b.x, a.y - b.y) / 2;
+                move_point(zone_1, point_1, distance);
+                move_point(zone_0, point_2, -distance);
+                break;
+            }
+
+            case 0x39: {
+                // IP: keep loop points at the same relative position between
+                // rp1 and rp2 as they had in the original outline.
+                HintingZone& zone_0 = get_zone(0);
+                HintingZone& zone_1 = get_zone(1);
+                HintingZone& zone_2 = get_zone(2);
+                Uint32 reference_1 = gs.reference_points[1];
+                Uint32 reference_2 = gs.reference_points[2];
+
+                // Twilight points have no font units, so measure scaled
+                // originals whenever one is involved.
+                bool is_twilight = gs.zone_pointers[0] == 0 || gs.zone_pointers[1] == 0 || gs.zone_pointers[2] == 0;
+                bool are_references_valid = reference_1 < zone_0.get_point_count() && reference_2 < zone_1.get_point_count();
+
+                HintingVector original_base = {0, 0};
+                HintingVector current_base = {0, 0};
+                Sint32 original_range = 0;
+                Sint32 current_range = 0;
+                if (are_references_valid) {
+                    original_base = is_twilight ? zone_0.original[reference_1] : zone_0.original_units[reference_1];
+                    current_base = zone_0.current[reference_1];
+
+                    const HintingVector& original_end = is_twilight ? zone_1.original[reference_2] : zone_1.original_units[reference_2];
+                    original_range = dual_project(original_end.x - original_base.x, original_end.y - original_base.y);
+
+                    const HintingVector& current_end = zone_1.current[reference_2];
+                    current_range = project(current_end.x - current_base.x, current_end.y - current_base.y);
+                }
+
+                if (new_top < static_cast<size_t>(gs.loop)) {
+                    gs.loop = 1;
+                    break;
+                }
+                for (; gs.loop > 0; gs.loop--) {
+                    Sint32 point = stack_base[--new_top];
+                    if (!is_valid_point(zone_2, point)) {
+                        continue;
+                    }
+
+                    const HintingVector& original_point = is_twilight ? zone_2.original[point] : zone_2.original_units[point];
+                    Sint32 original_distance = dual_project(original_point.x - original_base.x, original_point.y - original_base.y);
+                    Sint32 current_distance = project(zone_2.current[point].x - current_base.x, zone_2.current[point].y - current_base.y);
+
+                    Sint32 new_distance = 0;
+                    if (original_distance != 0) {
+                        if (original_range != 0) {
+                            new_distance = mul_div(original_distance, current_range, original_range);
+                        } else {
+                            // With both references in the same place the
+                            // point keeps its original distance. FreeType
+                            // takes that distance in font units, unscaled,
+                            // and fonts hinted against it expect as much.
+                            new_distance = original_distance;
+                        }
+                    }
+                    move_point(zone_2, point, new_distance - current_distance);
+                }
+                gs.loop = 1;
+                break;
+            }
+
+            case 0x29: {
+                // UTP
+                HintingZone& zone = get_zone(0);
+                if (!is_valid_point(zone, args[0])) {
+                    break;
+                }
+                if (gs.freedom_vector.x != 0) {
+                    zone.flags[args[0]] &= ~HintingZone::TOUCHED_X;
+                }
+                if (gs.freedom_vector.y != 0) {
+                    zone.flags[args[0]] &= ~HintingZone::TOUCHED_Y;
+                }
+                break;
+            }
+
+            case 0x30: case 0x31:
+                // IUP[y], IUP[x]
+                interpolate_untouched_points(opcode == 0x31);
+                break;
+
+            case 0x32: case 0x33: {
+                // SHP
+                HintingZone* reference_zone = nullptr;
+                Uint32 reference_point = 0;
+                Sint32 dx = 0;
+                Sint32 dy = 0;
+                bool is_reference_valid = get_reference_shift(opcode, reference_zone, reference_point, dx, dy);
+
+                HintingZone& zone = get_zone(2);
+                if (new_top < static_cast<size_t>(gs.loop)) {
+                    gs.loop = 1;
+                    break;
+                }
+                for (; gs.loop > 0; gs.loop--) {
+                    Sint32 point = stack_base[--new_top];
+                    if (is_reference_valid && is_valid_point(zone, point)) {
+                        shift_point(zone, point, dx, dy, true);
+                    }
+                }
+                gs.loop = 1;
+                break;
+            }
+
+            case 0x34: case 0x35: {
+                // SHC: shift a contour, leaving the reference point alone.
+                HintingZone* reference_zone = nullptr;
+                Uint32 reference_point = 0;
+                Sint32 dx = 0;
+                Sint32 dy = 0;
+                HintingZone& zone = get_zone(2);
+                Sint32 contour = args[0];
+                if (!get_reference_shift(opcode, reference_zone, reference_point, dx, dy) || contour < 0 || static_cast<size_t>(contour) >= zone.end_point_indices.size()) {
+                    break;
+                }
+
+                size_t first_point = contour == 0 ? 0 : zone.end_point_indices[contour - 1] + 1;
+                size_t last_point = zone.end_point_indices[contour];
+                for (size_t point = first_point; point <= last_point && point < zone.get_point_count(); point++) {
+                    if (&zone != reference_zone || point != reference_point) {
+                        shift_point(zone, static_cast<Uint32>(point), dx, dy, true);
+                    }
+                }
+                break;
+            }
+
+            case 0x36: case 0x37: {
+                // SHZ: shift a whole zone except the reference point and the
+                // glyph's phantom points. The zone argument is only checked;
+                // FreeType and Windows both shift the zone zp2 points at.
+                if (args[0] != 0 && args[0] != 1) {
+                    return fail("Invalid zone");
+                }
+
+                HintingZone* reference_zone = nullptr;
+                Uint32 reference_point = 0;
+                Sint32 dx = 0;
+                Sint32 dy = 0;
+                if (!get_reference_shift(opcode, reference_zone, reference_point, dx, dy)) {
+                    break;
+                }
+
+                // The glyph zone's phantom points come after its last contour.
+                HintingZone& zone = get_zone(2);
+                size_t point_count = zone.get_point_count();
+                if (gs.zone_pointers[2] == 1) {
+                    point_count = zone.end_point_indices.empty() ? 0 : std::min<size_t>(point_count, zone.end_point_indices.back() + 1);
+                }
+                for (size_t point = 0; point < point_count; point++) {
+                    if (&zone != reference_zone || point != reference_point) {
+                        shift_point(zone, static_cast<Uint32>(point), dx, dy, false);
+                    }
+                }
+                break;
+            }
+
+            case 0x38: {
+                // SHPIX: shift loop points by a distance along the freedom
+                // vector.
+                Sint32 dx = mul_2dot14(args[0], gs.freedom_vector.x);
+                Sint32 dy = mul_2dot14(args[0], gs.freedom_vector.y);
+                HintingZone& zone = get_zone(2);
+                if (new_top < static_cast<size_t>(gs.loop)) {
+                    gs.loop = 1;
+                    break;
+                }
+                for (; gs.loop > 0; gs.loop--) {
+                    Sint32 point = stack_base[--new_top];
+                    if (is_valid_point(zone, point)) {
+                        shift_point(zone, point, dx, dy, true);
+                    }
+                }
+                gs.loop = 1;
+                break;
+            }
+
+            case 0x5D: case 0x71: case 0x72: case 0x73: case 0x74: case 0x75: {
+                // DELTAP1-3 move points and DELTAC1-3 adjust control values,
+                // each by its own amount and only at one ppem. Every entry
+                // is an (argument, point or control value) pair.
+                bool is_point_delta = opcode == 0x5D || opcode == 0x71 || opcode == 0x72;
+                Sint32 ppem_offset = (opcode == 0x5D || opcode == 0x73) ? 0 : ((opcode == 0x71 || opcode == 0x74) ? 16 : 32);
+                HintingZone& zone = get_zone(0);
+
+                Sint32 pair_count = args[0];
+                for (Sint32 k = 0; k < pair_count; k++) {
+                    if (new_top < 2) {
+                        new_top = 0;
+                        break;
+                    }
+                    new_top -= 2;
+                    Sint32 target = stack_base[new_top + 1];
+                    Sint32 argument = stack_base[new_top];
+
+                    Sint32 ppem = ((argument & 0xF0) >> 4) + ppem_offset + gs.delta_base;
+                    if (ppem != state->ppem) {
+                        continue;
+                    }
+
+                    Sint32 step = (argument & 0x0F) - 8;
+                    if (step >= 0) {
+                        step++;
+                    }
+                    Sint32 distance = step * (1 << (6 - gs.delta_shift));
+
+                    if (is_point_delta) {
+                        if (is_valid_point(zone, target)) {
+                            move_point(zone, target, distance);
+                        }
+                    } else if (target >= 0 && static_cast<size_t>(target) < state->control_values.size()) {
+                        state->control_values[target] += distance;
+                    }
+                }
+                break;
+            }
+
+            case 0x80: {
+                // FLIPPT
+                HintingZone& zone = get_zone(0);
+                if (new_top < static_cast<size_t>(gs.loop)) {
+                    gs.loop = 1;
+                    break;
+                }
+                for (; gs.loop > 0; gs.loop--) {
+                    Sint32 point = stack_base[--new_top];
+                    if (is_valid_point(zone, point)) {
+                        zone.flags[point] ^= HintingZone::ON_CURVE;
+                    }
+                }
+                gs.loop = 1;
+                break;
+            }
+
+            case 0x81: case 0x82: {
+                // FLIPRGON, FLIPRGOFF
+                HintingZone& zone = get_zone(0);
+                Sint32 first_point = args[0];
+                Sint32 last_point = args[1];
+                if (!is_valid_point(zone, first_point) || !is_valid_point(zone, last_point)) {
+                    break;
+                }
+                for (Sint32 point = first_point; point <= last_point; point++) {
+                    if (opcode == 0x81) {
+                        zone.flags[point] |= HintingZone::ON_CURVE;
+                    } else {
+                        zone.flags[point] &= ~HintingZone::ON_CURVE;
+                    }
+                }
+                break;
+            }
+
+            default: {
+                // Opcodes the instruction set leaves undefined run whatever
+                // IDEF gave them.
+                if (opcode >= functions->instructions.size() || functions->instructions[opcode].code == nullptr) {
+                    return fail("Unknown instruction");
+                }
+                if (call_stack.size() >= MAX_CALL_DEPTH) {
+                    return fail("Calls nested too deeply");
+                }
+
+                const HintingFunction& instruction = functions->instructions[opcode];
+                call_stack.push_back({code, code_length, next_position, instruction, 1});
+                code = instruction.code;
+                code_length = instruction.code_length;
+                next_position = instruction.start;
+                break;
+            }
+        }
+
+        stack_top = new_top;
+        position = next_position;
+    }
+}
+
+// --------------------------------------------------------------------------
+
+void HintingInterpreter::update_freedom_dot_projection() {
+    const HintingGraphicsState& gs = *graphics_state;
+    Sint64 dot_product = static_cast<Sint64>(gs.projection_vector.x) * gs.freedom_vector.x + static_cast<Sint64>(gs.projection_vector.y) * gs.freedom_vector.y;
+    freedom_dot_projection = static_cast<Sint32>(dot_product >> 14);
+
+    // Nearly perpendicular vectors would move points almost infinitely far.
+    if (std::abs(freedom_dot_projection) < 0x400) {
+        freedom_dot_projection = ONE_2DOT14;
+    }
+}
+
+// --------------------------------------------------------------------------
+
+Sint32 HintingInterpreter::project(Sint32 dx, Sint32 dy) const {
+    const HintingVector& vector = graphics_state->projection_vector;
+    Sint64 dot_product = static_cast<Sint64>(dx) * vector.x + static_cast<Sint64>(dy) * vector.y;
+    return static_cast<Sint32>((dot_product + 0x2000 + (dot_product < 0 ? -1 : 0)) >> 14);
+}
+
+// --------------------------------------------------------------------------
+
+Sint32 HintingInterpreter::dual_project(Sint32 dx, Sint32 dy) const {
+    const HintingVector& vector = graphics_state->dual_projection_vector;
+    Sint64 dot_product = static_cast<Sint64>(dx) * vector.x + static_cast<Sint64>(dy) * vector.y;
+    return static_cast<Sint32>((dot_product + 0x2000 + (dot_product < 0 ? -1 : 0)) >> 14);
+}
+
+// --------------------------------------------------------------------------
+
+Sint32 HintingInterpreter::round(Sint32 distance) const {
+    const HintingGraphicsState& gs = *graphics_state;
+    Sint64 value = distance;
+    Sint64 magnitude = value < 0 ? -value : value;
+    Sint64 rounded = 0;
+
+    switch (gs.round_state) {
+        case HintingRoundState::TO_HALF_GRID:
+            rounded = (magnitude & -64) + 32;
+            break;
+        case HintingRoundState::TO_GRID:
+            rounded = (magnitude + 32) & -64;
+            break;
+        case HintingRoundState::TO_DOUBLE_GRID:
+            rounded = (magnitude + 16) & -32;
+            break;
+        case HintingRoundState::DOWN_TO_GRID:
+            rounded = magnitude & -64;
+            break;
+        case HintingRoundState::UP_TO_GRID:
+            rounded = (magnitude + 63) & -64;
+            break;
+        case HintingRoundState::OFF:
+            return distance;
+        case HintingRoundState::SUPER:
+        case HintingRoundState::SUPER_45: {
+            // Round to phase plus a multiple of the period, with the
+            // threshold deciding where values tip over to the next one. A
+            // result on the wrong side of zero snaps to the phase.
+            Sint64 shifted = magnitude - gs.round_phase + gs.round_threshold;
+            if (gs.round_state == HintingRoundState::SUPER) {
+                rounded = (shifted & -static_cast<Sint64>(gs.round_period)) + gs.round_phase;
+            } else {
+                rounded = (shifted / gs.round_period) * gs.round_period + gs.round_phase;
+            }
+            if (rounded < 0) {
+                rounded = gs.round_phase;
+            }
+            break;
+        }
+    }
+
+    return clamp_to_sint32(value < 0 ? -rounded : rounded);
+}
+
+// --------------------------------------------------------------------------
+
+void HintingInterpreter::set_super_round(Sint32 grid_period, Sint32 selector) {
+    HintingGraphicsState& gs = *graphics_state;
+
+    Sint32 period = grid_period;
+    switch (selector & 0xC0) {
+        case 0x00:
+            period = grid_period / 2;
+            break;
+        case 0x80:
+            period = grid_period * 2;
+            break;
+    }
+
+    Sint32 phase = 0;
+    switch (selector & 0x30) {
+        case 0x10:
+            phase = period / 4;
+            break;
+        case 0x20:
+            phase = period / 2;
+            break;
+        case 0x30:
+            phase = period * 3 / 4;
+            break;
+    }
+
+    Sint32 threshold = (selector & 0x0F) == 0 ? period - 1 : ((selector & 0x0F) - 4) * period / 8;
+
+    // The grid periods are 2.14 fractions of a pixel; bring them to 26.6.
+    gs.round_period = period >> 8;
+    gs.round_phase = phase >> 8;
+    gs.round_threshold = threshold >> 8;
+}
+
+// --------------------------------------------------------------------------
+
+void HintingInterpreter::move_point(HintingZone& zone, Uint32 point, Sint32 distance) {
+    const HintingVector& freedom_vector = graphics_state->freedom_vector;
+    HintingVector& position = zone.current[point];
+
+    if (freedom_vector.x != 0) {
+        position.x += freedom_vector.x == freedom_dot_projection ? distance : mul_div(distance, freedom_vector.x, freedom_dot_projection);
+        zone.flags[point] |= HintingZone::TOUCHED_X;
+    }
+
+    if (freedom_vector.y != 0) {
+        position.y += freedom_vector.y == freedom_dot_projection ? distance : mul_div(distance, freedom_vector.y, freedom_dot_projection);
+        zone.flags[point] |= HintingZone::TOUCHED_Y;
+    }
+}
+
+// --------------------------------------------------------------------------
+
+void HintingInterpreter::move_original_point(HintingZone& zone, Uint32 point, Sint32 distance) {
+    const HintingVector& freedom_vector = graphics_state->freedom_vector;
+    HintingVector& position = zone.original[point];
+
+    if (freedom_vector.x != 0) {
+        position.x += mul_div(distance, freedom_vector.x, freedom_dot_projection);
+    }
+
+    if (freedom_vector.y != 0) {
+        position.y += mul_div(distance, freedom_vector.y, freedom_dot_projection);
+    }
+}
+
+// --------------------------------------------------------------------------
+
+bool HintingInterpreter::get_reference_shift(Uint8 opcode, HintingZone*& reference_zone, Uint32& reference_point, Sint32& dx, Sint32& dy) {
+    // The odd opcodes measure rp1 in zp0, the even ones rp2 in zp1.
+    const HintingGraphicsState& gs = *graphics_state;
+    reference_zone = (opcode & 1) ? &get_zone(0) : &get_zone(1);
+    reference_point = (opcode & 1) ? gs.reference_points[1] : gs.reference_points[2];
+    if (reference_point >= reference_zone->get_point_count()) {
+        return false;
+    }
+
+    const HintingVector& current = reference_zone->current[reference_point];
+    const HintingVector& original = reference_zone->original[reference_point];
+    Sint32 distance = project(current.x - original.x, current.y - original.y);
+    dx = mul_div(distance, gs.freedom_vector.x, freedom_dot_projection);
+    dy = mul_div(distance, gs.freedom_vector.y, freedom_dot_projection);
+    return true;
+}
+
+// --------------------------------------------------------------------------
+
+void HintingInterpreter::shift_point(HintingZone& zone, Uint32 point, Sint32 dx, Sint32 dy, bool touch) {
+    const HintingVector& freedom_vector = graphics_state->freedom_vector;
+
+    if (freedom_vector.x != 0) {
+        zone.current[point].x += dx;
+        if (touch) {
+            zone.flags[point] |= HintingZone::TOUCHED_X;
+        }
+    }
+
+    if (freedom_vector.y != 0) {
+        zone.current[point].y += dy;
+        if (touch) {
+            zone.flags[point] |= HintingZone::TOUCHED_Y;
+        }
+    }
+}
+
+// --------------------------------------------------------------------------
+
+bool HintingInterpreter::set_vector_to_line(Uint8 opcode, Sint32 point_1, Sint32 point_2, bool is_original, HintingVector& vector) {
+    // The line runs from point_2 in zp2 to point_1 in zp1; the odd opcodes
+    // want the perpendicular, rotated counter-clockwise.
+    HintingZone& zone_1 = get_zone(1);
+    HintingZone& zone_2 = get_zone(2);
+    if (!is_valid_point(zone_1, point_1) || !is_valid_point(zone_2, point_2)) {
+        return false;
+    }
+
+    const HintingVector& a = is_original ? zone_1.original[point_1] : zone_1.current[point_1];
+    const HintingVector& b = is_original ? zone_2.original[point_2] : zone_2.current[point_2];
+    Sint32 dx = a.x - b.x;
+    Sint32 dy = a.y - b.y;
+
+    // Coincident points give the x axis, whichever way round was asked for.
+    if (dx == 0 && dy == 0) {
+        vector = {ONE_2DOT14, 0};
+        return true;
+    }
+
+    if (opcode & 1) {
+        Sint32 rotated_x = -dy;
+        dy = dx;
+        dx = rotated_x;
+    }
+
+    normalize(dx, dy, vector);
+    return true;
+}
+
+// --------------------------------------------------------------------------
+
+Sint32 HintingInterpreter::get_control_value(Sint32 index) const {
+    return index >= 0 && static_cast<size_t>(index) < state->control_values.size() ? state->control_values[index] : 0;
+}
+
+// --------------------------------------------------------------------------
+
+void HintingInterpreter::interpolate_untouched_points(bool is_x_axis) {
+    HintingZone& zone = *zones[1];
+    if (zone.end_point_indices.empty() || zone.get_point_count() == 0) {
+        return;
+    }
+
+    Sint32 HintingVector::* axis = is_x_axis ? &HintingVector::x : &HintingVector::y;
+    Uint8 touched_flag = is_x_axis ? HintingZone::TOUCHED_X : HintingZone::TOUCHED_Y;
+    int point_count = static_cast<int>(zone.get_point_count());
+
+    int point = 0;
+    for (Uint16 end_point_index : zone.end_point_indices) {
+        int last_point = end_point_index < point_count ? end_point_index : point_count - 1;
+        int first_point = point;
+
+        while (point <= last_point && (zone.flags[point] & touched_flag) == 0) {
+            point++;
+        }
+
+        if (point <= last_point) {
+            int first_touched = point;
+            int previous_touched = point;
+
+            for (point++; point <= last_point; point++) {
+                if (zone.flags[point] & touched_flag) {
+                    interpolate_points(axis, previous_touched + 1, point - 1, previous_touched, point);
+                    previous_touched = point;
+                }
+            }
+
+            // A contour with one touched point moves rigidly with it;
+            // otherwise the run wrapping round from the last touched point
+            // to the first is interpolated too.
+            if (previous_touched == first_touched) {
+                shift_contour_points(axis, first_point, last_point, previous_touched);
+            } else {
+                interpolate_points(axis, previous_touched + 1, last_point, previous_touched, first_touched);
+                if (first_touched > first_point) {
+                    interpolate_points(axis, first_point, first_touched - 1, previous_touched, first_touched);
+                }
+            }
+        }
+
+        point = last_point + 1;
+    }
+}
+
+// --------------------------------------------------------------------------
+
+void HintingInterpreter::interpolate_points(Sint32 HintingVector::* axis, int first_point, int last_point, int reference_1, int reference_2) {
+    if (first_point > last_point) {
+        return;
+    }
+
+    HintingZone& zone = *zones[1];
+    Sint32 units_1 = zone.original_units[reference_1].*axis;
+    Sint32 units_2 = zone.original_units[reference_2].*axis;
+    if (units_1 > units_2) {
+        std::swap(units_1, units_2);
+        std::swap(reference_1, reference_2);
+    }
+
+    Sint32 original_1 = zone.original[reference_1].*axis;
+    Sint32 original_2 = zone.original[reference_2].*axis;
+    Sint32 current_1 = zone.current[reference_1].*axis;
+    Sint32 current_2 = zone.current[reference_2].*axis;
+    Sint32 delta_1 = current_1 - original_1;
+    Sint32 delta_2 = current_2 - original_2;
+
+    // Points outside the two references move with the nearer one; points
+    // between them keep their relative position, measured in font units so
+    // scaling rounding doesn't creep in.
+    bool can_interpolate = current_1 != current_2 && units_1 != units_2;
+    Sint32 scale = can_interpolate ? mul_div(current_2 - current_1, 0x10000, units_2 - units_1) : 0;
+
+    for (int i = first_point; i <= last_point; i++) {
+        Sint32 value = zone.original[i].*axis;
+        if (value <= original_1) {
+            value += delta_1;
+        } else if (value >= original_2) {
+            value += delta_2;
+        } else if (can_interpolate) {
+            value = current_1 + mul_div(zone.original_units[i].*axis - units_1, scale, 0x10000);
+        } else {
+            value = current_1;
+        }
+        zone.current[i].*axis = value;
+    }
+}
+
+// --------------------------------------------------------------------------
+
+void HintingInterpreter::shift_contour_points(Sint32 HintingVector::* axis, int first_point, int last_point, int reference) {
+    HintingZone& zone = *zones[1];
+    Sint32 delta = zone.current[reference].*axis - zone.original[reference].*axis;
+    if (delta == 0) {
+        return;
+    }
+
+    for (int i = first_point; i <= last_point; i++) {
+        if (i != reference) {
+            zone.current[i].*axis += delta;
+        }
+    }
+}
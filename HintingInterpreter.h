@@ -0,0 +1,210 @@
+#ifndef HINTING_INTERPRETER_H
+#define HINTING_INTERPRETER_H
+
+#include <SDL3/SDL.h>
+#include <cstddef>
+#include <vector>
+
+// Points are in 26.6 fixed point pixels (64 to the pixel), the unit the
+// TrueType instruction set works in. The same pair holds the projection,
+// freedom and dual vectors as 2.14 unit vectors.
+struct HintingVector {
+    Sint32 x;
+    Sint32 y;
+};
+
+// Points the programs can address. Zone 1 is the glyph being hinted, its
+// outline followed by the four phantom points that carry its horizontal and
+// vertical metrics. Zone 0, the twilight zone, holds points that only exist
+// while hinting and start out at the origin.
+struct HintingZone {
+    static const Uint8 ON_CURVE = 0x01;
+    static const Uint8 TOUCHED_X = 0x02;
+    static const Uint8 TOUCHED_Y = 0x04;
+
+    // Unscaled font units (zero in the twilight zone), scaled to the pixel
+    // size before any hinting, and where the programs have moved them.
+    std::vector<HintingVector> original_units;
+    std::vector<HintingVector> original;
+    std::vector<HintingVector> current;
+    std::vector<Uint8> flags;
+    std::vector<Uint16> end_point_indices;
+
+    void clear();
+    void resize(size_t point_count);
+    size_t get_point_count() const { return current.size(); }
+};
+
+enum class HintingRoundState : Uint8 {
+    TO_HALF_GRID,
+    TO_GRID,
+    TO_DOUBLE_GRID,
+    DOWN_TO_GRID,
+    UP_TO_GRID,
+    OFF,
+    SUPER,
+    SUPER_45,
+};
+
+struct HintingGraphicsState {
+    HintingVector projection_vector;
+    HintingVector freedom_vector;
+    HintingVector dual_projection_vector;
+
+    Uint32 reference_points[3];
+    Uint8 zone_pointers[3];
+    Sint32 loop;
+
+    HintingRoundState round_state;
+    Sint32 round_period;
+    Sint32 round_phase;
+    Sint32 round_threshold;
+
+    Sint32 minimum_distance;
+    Sint32 control_value_cut_in;
+    Sint32 single_width_cut_in;
+    Sint32 single_width_value;
+    Sint32 delta_base;
+    Sint32 delta_shift;
+    bool auto_flip;
+    Uint8 instruct_control;
+
+    // The defaults every font program starts from.
+    HintingGraphicsState();
+
+    // What a glyph program starts from: this state with the vectors, zone
+    // pointers, reference points, loop and rounding put back to defaults.
+    void reset_for_glyph();
+};
+
+// A function or instruction defined by FDEF or IDEF: where its body starts
+// in the program that defined it. Programs come straight out of the font
+// file, so the pointer stays valid as long as the file is open.
+struct HintingFunction {
+    const Uint8* code;
+    Uint32 code_length;
+    Uint32 start;
+};
+
+struct HintingFunctionTable {
+    std::vector<HintingFunction> functions;
+    std::vector<HintingFunction> instructions;
+};
+
+// Everything a program leaves behind for the next one: the control value
+// table and storage area as the font and control value programs set them
+// up, the graphics state defaults, and the twilight zone.
+struct HintingState {
+    int ppem;
+
+    // Font units to 26.6 pixels, as 16.16 fixed point.
+    Sint32 scale;
+
+    // The same for the glyph zone's original_units, which a composite's
+    // program sees already scaled, so 1.0 there.
+    Sint32 units_scale;
+
+    HintingGraphicsState graphics_state;
+    std::vector<Sint32> control_values;
+    std::vector<Sint32> storage;
+    HintingZone twilight_zone;
+};
+
+// Executes TrueType instructions. This is the classic interpreter FreeType
+// calls v35, without the subpixel compatibility modes: GETINFO reports
+// version 35 with greyscale rendering, and dropout control settings are
+// accepted and ignored since the rasterizer always anti-aliases.
+//
+// Each opcode's stack effect comes from a table, so one bounds check covers
+// an instruction's arguments and results before a single switch dispatches
+// it. An interpreter keeps its stacks between runs and isn't thread-safe;
+// use one per thread.
+class HintingInterpreter {
+
+public:
+
+    enum class Program {
+        FONT,
+        CONTROL_VALUE,
+        GLYPH,
+    };
+
+    HintingInterpreter();
+
+    // Run code against state, with glyph_zone as zone 1. Font and control
+    // value programs may define functions into writable_functions; glyph
+    // programs only call them and pass nullptr. Returns false, with
+    // get_error() saying why, if the program did something invalid; state
+    // then holds whatever it had done up to that point.
+    bool execute(
+        const Uint8* code,
+        size_t code_length,
+        Program program,
+        int max_stack_depth,
+        const HintingFunctionTable& functions,
+        HintingFunctionTable* writable_functions,
+        HintingState& state,
+        HintingZone& glyph_zone
+    );
+
+    const char* get_error() const;
+
+    // Font units to 26.6 pixels with the scale in state, rounded to nearest.
+    static Sint32 scale_font_units(Sint32 value, Sint32 scale);
+
+private:
+
+    // The function is copied in because a font program defining more
+    // functions can move the table it came from.
+    struct CallFrame {
+        const Uint8* return_code;
+        size_t return_code_length;
+        size_t return_position;
+        HintingFunction function;
+        Sint32 remaining_count;
+    };
+
+    std::vector<Sint32> stack;
+    std::vector<CallFrame> call_stack;
+    const char* error;
+
+    // The run in progress.
+    Program program;
+    const HintingFunctionTable* functions;
+    HintingFunctionTable* writable_functions;
+    HintingState* state;
+    HintingGraphicsState* graphics_state;
+    HintingZone* zones[2];
+    Sint32 freedom_dot_projection;
+
+    bool run(const Uint8* code, size_t code_length);
+    bool fail(const char* message);
+
+    void update_freedom_dot_projection();
+    Sint32 project(Sint32 dx, Sint32 dy) const;
+    Sint32 dual_project(Sint32 dx, Sint32 dy) const;
+    Sint32 round(Sint32 distance) const;
+    void set_super_round(Sint32 grid_period, Sint32 selector);
+
+    // Move a point by distance as measured along the projection vector,
+    // travelling along the freedom vector, and mark it touched.
+    void move_point(HintingZone& zone, Uint32 point, Sint32 distance);
+    void move_original_point(HintingZone& zone, Uint32 point, Sint32 distance);
+
+    // SHP, SHC and SHZ move points by however far a reference point has
+    // moved since it was scaled.
+    bool get_reference_shift(Uint8 opcode, HintingZone*& reference_zone, Uint32& reference_point, Sint32& dx, Sint32& dy);
+    void shift_point(HintingZone& zone, Uint32 point, Sint32 dx, Sint32 dy, bool touch);
+
+    bool set_vector_to_line(Uint8 opcode, Sint32 point_1, Sint32 point_2, bool is_original, HintingVector& vector);
+    HintingZone& get_zone(int zone_pointer) { return *zones[graphics_state->zone_pointers[zone_pointer]]; }
+    Sint32 get_control_value(Sint32 index) const;
+
+    // IUP: move each untouched outline point along one axis the way the
+    // touched points either side of it on its contour moved.
+    void interpolate_untouched_points(bool is_x_axis);
+    void interpolate_points(Sint32 HintingVector::* axis, int first_point, int last_point, int reference_1, int reference_2);
+    void shift_contour_points(Sint32 HintingVector::* axis, int first_point, int last_point, int reference);
+};
+
+#endif
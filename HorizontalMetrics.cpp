@@ -0,0 +1,74 @@
+#include "HorizontalMetrics.h"
+
+#include "BigEndianReader.h"
+
+#include <algorithm>
+
+HorizontalMetrics::HorizontalMetrics()
+    : ascender(0),
+      descender(0),
+      line_gap(0) {
+}
+
+// --------------------------------------------------------------------------
+
+// hmtx holds an (advance width, left side bearing) pair for the first
+// numberOfHMetrics glyphs, then bare left side bearings for the rest, which
+// all share the last advance width.
+void HorizontalMetrics::initialize(const Uint8* hhea_data, size_t hhea_length, const Uint8* hmtx_data, size_t hmtx_length, Uint16 glyph_count) {
+    ascender = 0;
+    descender = 0;
+    line_gap = 0;
+    advance_widths.assign(glyph_count, 0);
+    left_side_bearings.assign(glyph_count, 0);
+
+    if (hhea_data == nullptr || hhea_length < 36) {
+        return;
+    }
+
+    BigEndianReader hhea_reader(hhea_data, hhea_length);
+    ascender = static_cast<Sint16>(hhea_reader.peek_u16(4));
+    descender = static_cast<Sint16>(hhea_reader.peek_u16(6));
+    line_gap = static_cast<Sint16>(hhea_reader.peek_u16(8));
+    Uint16 number_of_h_metrics = hhea_reader.peek_u16(34);
+
+    if (hmtx_data == nullptr || number_of_h_metrics == 0) {
+        return;
+    }
+
+    BigEndianReader reader(hmtx_data, hmtx_length);
+    size_t long_metric_count = std::min<size_t>(number_of_h_metrics, glyph_count);
+    Uint16 advance_width = 0;
+    for (size_t i = 0; i < glyph_count; i++) {
+        size_t location = i < long_metric_count ? 4 * i : 4 * long_metric_count + 2 * (i - long_metric_count);
+        if (location + (i < long_metric_count ? 4 : 2) > hmtx_length) {
+            break;
+        }
+
+        if (i < long_metric_count) {
+            advance_width = reader.peek_u16(location);
+            location += 2;
+        }
+
+        advance_widths[i] = advance_width;
+        left_side_bearings[i] = static_cast<Sint16>(reader.peek_u16(location));
+    }
+}
+
+// --------------------------------------------------------------------------
+
+Sint16 HorizontalMetrics::get_ascender() const {
+    return ascender;
+}
+
+// --------------------------------------------------------------------------
+
+Sint16 HorizontalMetrics::get_descender() const {
+    return descender;
+}
+
+// --------------------------------------------------------------------------
+
+Sint16 HorizontalMetrics::get_line_gap() const {
+    return line_gap;
+}
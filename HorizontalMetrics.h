@@ -0,0 +1,41 @@
+#ifndef HORIZONTAL_METRICS_H
+#define HORIZONTAL_METRICS_H
+
+#include <SDL3/SDL.h>
+#include <cstddef>
+#include <vector>
+
+// Line metrics from hhea and per-glyph advance widths and left side bearings
+// from hmtx, all in font units, decoded into arrays when the font loads.
+class HorizontalMetrics {
+
+public:
+
+    HorizontalMetrics();
+
+    // Either table may be null; whatever is missing reads as zero.
+    void initialize(const Uint8* hhea_data, size_t hhea_length, const Uint8* hmtx_data, size_t hmtx_length, Uint16 glyph_count);
+
+    // Descender is negative below the baseline.
+    Sint16 get_ascender() const;
+    Sint16 get_descender() const;
+    Sint16 get_line_gap() const;
+
+    Uint16 get_advance_width(Uint16 glyph_index) const {
+        return glyph_index < advance_widths.size() ? advance_widths[glyph_index] : 0;
+    }
+
+    Sint16 get_left_side_bearing(Uint16 glyph_index) const {
+        return glyph_index < left_side_bearings.size() ? left_side_bearings[glyph_index] : 0;
+    }
+
+private:
+
+    Sint16 ascender;
+    Sint16 descender;
+    Sint16 line_gap;
+    std::vector<Uint16> advance_widths;
+    std::vector<Sint16> left_side_bearings;
+};
+
+#endif
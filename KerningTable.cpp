@@ -0,0 +1,128 @@
+#include "KerningTable.h"
+
+#include "BigEndianReader.h"
+
+#include <algorithm>
+#include <utility>
+
+namespace {
+    const Uint16 WINDOWS_COVERAGE_HORIZONTAL = 0x0001;
+    const Uint16 WINDOWS_COVERAGE_MINIMUM = 0x0002;
+    const Uint16 WINDOWS_COVERAGE_CROSS_STREAM = 0x0004;
+
+    const Uint16 APPLE_COVERAGE_VERTICAL = 0x8000;
+    const Uint16 APPLE_COVERAGE_CROSS_STREAM = 0x4000;
+    const Uint16 APPLE_COVERAGE_VARIATION = 0x2000;
+}
+
+// --------------------------------------------------------------------------
+
+KerningTable::KerningTable() {
+}
+
+// --------------------------------------------------------------------------
+
+void KerningTable::initialize(const Uint8* kern_data, size_t kern_length) {
+    pair_keys.clear();
+    pair_values.clear();
+
+    if (kern_data == nullptr || kern_length < 4) {
+        return;
+    }
+
+    BigEndianReader reader(kern_data, kern_length);
+    std::vector<std::pair<Uint32, Sint16>> pairs;
+
+    // The Windows table starts with a 16-bit version of 0, Apple's with a
+    // 32-bit 1.0. The subtable headers differ to match.
+    bool is_apple_layout = reader.peek_u16(0) == 1;
+    size_t subtable_count = is_apple_layout ? reader.peek_u32(4) : reader.peek_u16(2);
+    size_t location = is_apple_layout ? 8 : 4;
+
+    for (size_t subtable = 0; subtable < subtable_count; subtable++) {
+        size_t header_size = is_apple_layout ? 8 : 6;
+        if (location + header_size > kern_length) {
+            break;
+        }
+
+        size_t subtable_length;
+        Uint16 format;
+        bool is_horizontal_kerning;
+        if (is_apple_layout) {
+            subtable_length = reader.peek_u32(location);
+            Uint16 coverage = reader.peek_u16(location + 4);
+            format = coverage & 0xFF;
+            is_horizontal_kerning = (coverage & (APPLE_COVERAGE_VERTICAL | APPLE_COVERAGE_CROSS_STREAM | APPLE_COVERAGE_VARIATION)) == 0;
+        } else {
+            subtable_length = reader.peek_u16(location + 2);
+            Uint16 coverage = reader.peek_u16(location + 4);
+            format = coverage >> 8;
+            is_horizontal_kerning =
+                (coverage & WINDOWS_COVERAGE_HORIZONTAL) != 0 &&
+                (coverage & (WINDOWS_COVERAGE_MINIMUM | WINDOWS_COVERAGE_CROSS_STREAM)) == 0;
+        }
+
+        size_t pairs_location = location + header_size + 8;
+        if (format == 0 && pairs_location <= kern_length) {
+            size_t pair_count = std::min(static_cast<size_t>(reader.peek_u16(location + header_size)), (kern_length - pairs_location) / 6);
+            if (is_horizontal_kerning) {
+                read_format_0(kern_data + pairs_location, pair_count, pairs);
+            }
+
+            // The Windows length field is only 16 bits and overflows on big
+            // tables, so step over format 0 subtables by their pair count.
+            subtable_length = header_size + 8 + pair_count * 6;
+        }
+
+        if (subtable_length == 0) {
+            break;
+        }
+
+        location += subtable_length;
+    }
+
+    // Subtables add up, so duplicate pairs are summed.
+    std::sort(pairs.begin(), pairs.end(), [](const std::pair<Uint32, Sint16>& a, const std::pair<Uint32, Sint16>& b) {
+        return a.first < b.first;
+    });
+
+    for (const std::pair<Uint32, Sint16>& pair : pairs) {
+        if (!pair_keys.empty() && pair_keys.back() == pair.first) {
+            pair_values.back() = static_cast<Sint16>(pair_values.back() + pair.second);
+        } else {
+            pair_keys.push_back(pair.first);
+            pair_values.push_back(pair.second);
+        }
+    }
+}
+
+// --------------------------------------------------------------------------
+
+void KerningTable::read_format_0(const Uint8* pairs_data, size_t pair_count, std::vector<std::pair<Uint32, Sint16>>& pairs) {
+    BigEndianReader reader(pairs_data, pair_count * 6);
+    for (size_t i = 0; i < pair_count; i++) {
+        Uint32 key = reader.read_u32();
+        Sint16 value = reader.read_s16();
+        if (value != 0) {
+            pairs.push_back({key, value});
+        }
+    }
+}
+
+// --------------------------------------------------------------------------
+
+Sint16 KerningTable::get_kerning(Uint16 left_glyph_index, Uint16 right_glyph_index) const {
+    Uint32 key = (static_cast<Uint32>(left_glyph_index) << 16) | right_glyph_index;
+    auto found = std::lower_bound(pair_keys.begin(), pair_keys.end(), key);
+    if (found == pair_keys.end() || *found != key) {
+        return 0;
+    }
+
+    return pair_values[found - pair_keys.begin()];
+}
+
+// --------------------------------------------------------------------------
+
+size_t KerningTable::get_pair_count() const {
+    return pair_keys.size();
+}
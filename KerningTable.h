@@ -0,0 +1,35 @@
+#ifndef KERNING_TABLE_H
+#define KERNING_TABLE_H
+
+#include <SDL3/SDL.h>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+// Horizontal pair kerning from the kern table's format 0 subtables, in both
+// the Windows and the Apple table layouts. Pairs from every subtable are
+// merged into one array sorted by (left << 16 | right) and looked up by
+// binary search.
+class KerningTable {
+
+public:
+
+    KerningTable();
+
+    // Leaves the table empty if kern_data is null or nothing usable is found.
+    void initialize(const Uint8* kern_data, size_t kern_length);
+
+    // Adjustment in font units to add to the left glyph's advance.
+    Sint16 get_kerning(Uint16 left_glyph_index, Uint16 right_glyph_index) const;
+
+    size_t get_pair_count() const;
+
+private:
+
+    std::vector<Uint32> pair_keys;
+    std::vector<Sint16> pair_values;
+
+    void read_format_0(const Uint8* pairs_data, size_t pair_count, std::vector<std::pair<Uint32, Sint16>>& pairs);
+};
+
+#endif
@@ -0,0 +1,142 @@
+#include "LocaTable.h"
+
+#include "BigEndianReader.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+LocaTable::LocaTable()
+    : loca_data(nullptr),
+      glyph_count(0),
+      are_offsets_short(true),
+      mode(Mode::LAZY) {
+}
+
+// --------------------------------------------------------------------------
+
+void LocaTable::initialize(const Uint8* loca_data, Uint16 glyph_count, bool are_offsets_short, Mode mode) {
+    this->loca_data = loca_data;
+    this->glyph_count = glyph_count;
+    this->are_offsets_short = are_offsets_short;
+    this->mode = mode;
+
+    decoded_offsets.clear();
+    if (mode == Mode::EAGER) {
+        size_t entry_count = static_cast<size_t>(glyph_count) + 1;
+        decoded_offsets.resize(entry_count);
+
+        if (are_offsets_short) {
+            decode_short_loca_offsets(loca_data, decoded_offsets.data(), entry_count);
+        } else {
+            decode_long_loca_offsets(loca_data, decoded_offsets.data(), entry_count);
+        }
+    }
+}
+
+// --------------------------------------------------------------------------
+
+Uint32 LocaTable::read_offset(Uint32 entry_index) const {
+    if (mode == Mode::EAGER) {
+        return decoded_offsets[entry_index];
+    }
+
+    BigEndianReader reader(loca_data, 0);
+    if (are_offsets_short) {
+        return static_cast<Uint32>(reader.peek_u16(entry_index * 2)) * 2;
+    } else {
+        return reader.peek_u32(entry_index * 4);
+    }
+}
+
+// --------------------------------------------------------------------------
+
+Uint32 LocaTable::get_glyph_offset(Uint16 glyph_index) const {
+    return read_offset(glyph_index);
+}
+
+// --------------------------------------------------------------------------
+
+Uint32 LocaTable::get_glyph_length(Uint16 glyph_index) const {
+    Uint32 offset = read_offset(glyph_index);
+    Uint32 next_offset = read_offset(static_cast<Uint32>(glyph_index) + 1);
+    return next_offset > offset ? next_offset - offset : 0;
+}
+
+// --------------------------------------------------------------------------
+
+void decode_short_loca_offsets(const Uint8* source, Uint32* destination, size_t count) {
+    size_t i = 0;
+
+#if defined(__AVX2__)
+    const __m128i swap_bytes = _mm_setr_epi8(1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14);
+    for (; i + 8 <= count; i += 8) {
+        __m128i entries = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i * 2));
+        entries = _mm_shuffle_epi8(entries, swap_bytes);
+
+        __m256i offsets = _mm256_slli_epi32(_mm256_cvtepu16_epi32(entries), 1);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(destination + i), offsets);
+    }
+#elif defined(__SSE2__)
+    const __m128i zero = _mm_setzero_si128();
+    for (; i + 8 <= count; i += 8) {
+        __m128i entries = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i * 2));
+        entries = _mm_or_si128(_mm_slli_epi16(entries, 8), _mm_srli_epi16(entries, 8));
+
+        __m128i low_offsets = _mm_slli_epi32(_mm_unpacklo_epi16(entries, zero), 1);
+        __m128i high_offsets = _mm_slli_epi32(_mm_unpackhi_epi16(entries, zero), 1);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(destination + i), low_offsets);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(destination + i + 4), high_offsets);
+    }
+#elif defined(__ARM_NEON)
+    for (; i + 8 <= count; i += 8) {
+        uint16x8_t entries = vreinterpretq_u16_u8(vrev16q_u8(vld1q_u8(source + i * 2)));
+
+        vst1q_u32(destination + i, vshlq_n_u32(vmovl_u16(vget_low_u16(entries)), 1));
+        vst1q_u32(destination + i + 4, vshlq_n_u32(vmovl_u16(vget_high_u16(entries)), 1));
+    }
+#endif
+
+    BigEndianReader reader(source, count * 2);
+    for (; i < count; i++) {
+        destination[i] = static_cast<Uint32>(reader.peek_u16(i * 2)) * 2;
+    }
+}
+
+// --------------------------------------------------------------------------
+
+void decode_long_loca_offsets(const Uint8* source, Uint32* destination, size_t count) {
+    size_t i = 0;
+
+#if defined(__AVX2__)
+    const __m256i swap_bytes = _mm256_setr_epi8(
+        3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12,
+        3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12
+    );
+    for (; i + 8 <= count; i += 8) {
+        __m256i entries = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(source + i * 4));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(destination + i), _mm256_shuffle_epi8(entries, swap_bytes));
+    }
+#elif defined(__SSE2__)
+    for (; i + 4 <= count; i += 4) {
+        __m128i entries = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i * 4));
+        entries = _mm_or_si128(_mm_slli_epi16(entries, 8), _mm_srli_epi16(entries, 8));
+        entries = _mm_shufflehi_epi16(_mm_shufflelo_epi16(entries, 0xB1), 0xB1);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(destination + i), entries);
+    }
+#elif defined(__ARM_NEON)
+    for (; i + 4 <= count; i += 4) {
+        uint32x4_t entries = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(source + i * 4)));
+        vst1q_u32(destination + i, entries);
+    }
+#endif
+
+    BigEndianReader reader(source, count * 4);
+    for (; i < count; i++) {
+        destination[i] = reader.peek_u32(i * 4);
+    }
+}
@@ -0,0 +1,45 @@
+#ifndef LOCA_TABLE_H
+#define LOCA_TABLE_H
+
+#include <SDL3/SDL.h>
+#include <cstddef>
+#include <vector>
+
+// Glyph offsets into the glyf table. In lazy mode offsets are read straight
+// out of the loca table when asked for, so opening a font costs nothing per
+// glyph; in eager mode the whole table is decoded up front into an array.
+class LocaTable {
+
+public:
+
+    enum Mode {
+        LAZY,
+        EAGER,
+    };
+
+    LocaTable();
+
+    void initialize(const Uint8* loca_data, Uint16 glyph_count, bool are_offsets_short, Mode mode);
+
+    Uint32 get_glyph_offset(Uint16 glyph_index) const;
+    Uint32 get_glyph_length(Uint16 glyph_index) const;
+
+private:
+
+    const Uint8* loca_data;
+    Uint16 glyph_count;
+    bool are_offsets_short;
+    Mode mode;
+
+    // glyph_count + 1 entries so that every glyph's length is known.
+    std::vector<Uint32> decoded_offsets;
+
+    Uint32 read_offset(Uint32 entry_index) const;
+};
+
+// Decode big-endian loca entries into native offsets. Short entries are
+// stored halved in the file and are doubled here.
+void decode_short_loca_offsets(const Uint8* source, Uint32* destination, size_t count);
+void decode_long_loca_offsets(const Uint8* source, Uint32* destination, size_t count);
+
+#endif
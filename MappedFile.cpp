@@ -0,0 +1,156 @@
+#include "MappedFile.h"
+
+#include <fstream>
+#include <utility>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define MAPPED_FILE_HAS_MMAP 1
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile()
+    : data(nullptr),
+      size(0),
+      mapping(nullptr),
+      mapping_size(0) {
+}
+
+// --------------------------------------------------------------------------
+
+MappedFile::~MappedFile() {
+    close();
+}
+
+// --------------------------------------------------------------------------
+
+bool MappedFile::open(const std::string& file_name, bool should_map) {
+    close();
+
+    if (should_map && map(file_name)) {
+        return true;
+    }
+
+    return read(file_name);
+}
+
+// --------------------------------------------------------------------------
+
+bool MappedFile::open(std::vector<Uint8> contents) {
+    close();
+
+    if (contents.empty()) {
+        return false;
+    }
+
+    file_contents = std::move(contents);
+    data = file_contents.data();
+    size = file_contents.size();
+    return true;
+}
+
+// --------------------------------------------------------------------------
+
+void MappedFile::close() {
+#ifdef MAPPED_FILE_HAS_MMAP
+    if (mapping != nullptr) {
+        munmap(mapping, mapping_size);
+    }
+#endif
+
+    data = nullptr;
+    size = 0;
+    mapping = nullptr;
+    mapping_size = 0;
+    file_contents.clear();
+    file_contents.shrink_to_fit();
+}
+
+// --------------------------------------------------------------------------
+
+const Uint8* MappedFile::get_data() const {
+    return data;
+}
+
+// --------------------------------------------------------------------------
+
+size_t MappedFile::get_size() const {
+    return size;
+}
+
+// --------------------------------------------------------------------------
+
+bool MappedFile::is_mapped() const {
+    return mapping != nullptr;
+}
+
+// --------------------------------------------------------------------------
+
+bool MappedFile::map(const std::string& file_name) {
+#ifdef MAPPED_FILE_HAS_MMAP
+    int file_descriptor = ::open(file_name.c_str(), O_RDONLY);
+    if (file_descriptor < 0) {
+        return false;
+    }
+
+    struct stat file_status;
+    if (fstat(file_descriptor, &file_status) != 0 || file_status.st_size <= 0) {
+        ::close(file_descriptor);
+        return false;
+    }
+
+    size_t file_size = static_cast<size_t>(file_status.st_size);
+    void* new_mapping = mmap(nullptr, file_size, PROT_READ, MAP_PRIVATE, file_descriptor, 0);
+
+    // The mapping keeps its own reference to the file.
+    ::close(file_descriptor);
+
+    if (new_mapping == MAP_FAILED) {
+        return false;
+    }
+
+    // Lookups jump around the file, so don't let the kernel read ahead and
+    // pull in the whole thing on the first fault.
+    madvise(new_mapping, file_size, MADV_RANDOM);
+
+    mapping = new_mapping;
+    mapping_size = file_size;
+    data = static_cast<const Uint8*>(new_mapping);
+    size = file_size;
+    return true;
+#else
+    (void)file_name;
+    return false;
+#endif
+}
+
+// --------------------------------------------------------------------------
+
+bool MappedFile::read(const std::string& file_name) {
+    std::ifstream file(file_name, std::ifstream::binary);
+    if (!file) {
+        return false;
+    }
+
+    file.unsetf(std::ios::skipws);
+
+    file.seekg(0, std::ios::end);
+    std::streampos file_size = file.tellg();
+    file.seekg(0, std::ios::beg);
+
+    if (file_size <= 0) {
+        return false;
+    }
+
+    file_contents.resize(file_size);
+    if (!file.read(reinterpret_cast<char*>(file_contents.data()), file_contents.size())) {
+        file_contents.clear();
+        return false;
+    }
+
+    data = file_contents.data();
+    size = file_contents.size();
+    return true;
+}
@@ -0,0 +1,48 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <SDL3/SDL.h>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// The read-only bytes of a file, memory-mapped where the platform supports it
+// and read into a buffer otherwise.
+class MappedFile {
+
+public:
+
+    MappedFile();
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    // With should_map false, or when mapping fails, the file is read into
+    // memory instead. Returns false if it can't be read either way.
+    bool open(const std::string& file_name, bool should_map = true);
+
+    // Takes over bytes that are already in memory. Returns false if there
+    // are none.
+    bool open(std::vector<Uint8> contents);
+    void close();
+
+    const Uint8* get_data() const;
+    size_t get_size() const;
+    bool is_mapped() const;
+
+private:
+
+    // Points at either the mapping or file_contents.
+    const Uint8* data;
+    size_t size;
+
+    void* mapping;
+    size_t mapping_size;
+    std::vector<Uint8> file_contents;
+
+    bool map(const std::string& file_name);
+    bool read(const std::string& file_name);
+};
+
+#endif
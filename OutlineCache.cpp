@@ -0,0 +1,415 @@
+#include "OutlineCache.h"
+
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <type_traits>
+
+#include "Font.h"
+#include "ThreadPool.h"
+
+namespace {
+    const size_t GLYPHS_PER_CHUNK = 64;
+    const size_t SECTION_ALIGNMENT = 8;
+
+    static_assert(std::is_trivially_copyable<OutlineCache::Record>::value, "Records are mapped straight out of the cache file");
+    static_assert(sizeof(OutlineCache::Record) == 48, "Record layout is part of the cache file format");
+
+    // Glyphs decoded and compiled by one task, with record offsets relative
+    // to the start of the chunk.
+    struct CompiledChunk {
+        std::vector<OutlineCache::Record> records;
+        std::vector<Uint16> end_point_indices;
+        std::vector<Sint16> x_coordinates;
+        std::vector<Sint16> y_coordinates;
+        std::vector<Uint8> on_curve_bits;
+        std::vector<Uint8> verbs;
+        std::vector<SDL_FPoint> segment_points;
+        std::vector<Uint32> contour_ends;
+    };
+
+    void compile_chunk(Font& font, size_t first_glyph_index, size_t glyph_count, CompiledChunk& chunk) {
+        chunk.records.reserve(glyph_count);
+
+        GlyphOutline outline;
+        for (size_t i = 0; i < glyph_count; i++) {
+            Glyph glyph = font.get_glyph(static_cast<Uint16>(first_glyph_index + i));
+            outline.compile(glyph);
+
+            OutlineCache::Record record;
+            record.min_extents = glyph.min_extents;
+            record.max_extents = glyph.max_extents;
+            record.num_end_point_indices = glyph.num_end_point_indices;
+            record.num_points = glyph.num_points;
+            record.first_end_point_index = static_cast<Uint32>(chunk.end_point_indices.size());
+            record.first_point_index = static_cast<Uint32>(chunk.x_coordinates.size());
+            record.first_on_curve_byte = static_cast<Uint32>(chunk.on_curve_bits.size());
+            record.first_verb = static_cast<Uint32>(chunk.verbs.size());
+            record.verb_count = static_cast<Uint32>(outline.verbs.size());
+            record.first_segment_point = static_cast<Uint32>(chunk.segment_points.size());
+            record.segment_point_count = static_cast<Uint32>(outline.points.size());
+            record.first_contour_end = static_cast<Uint32>(chunk.contour_ends.size());
+            record.contour_count = static_cast<Uint32>(outline.contour_ends.size());
+            chunk.records.push_back(record);
+
+            chunk.end_point_indices.insert(chunk.end_point_indices.end(), glyph.end_point_indices, glyph.end_point_indices + glyph.num_end_point_indices);
+            chunk.x_coordinates.insert(chunk.x_coordinates.end(), glyph.x_coordinates, glyph.x_coordinates + glyph.num_points);
+            chunk.y_coordinates.insert(chunk.y_coordinates.end(), glyph.y_coordinates, glyph.y_coordinates + glyph.num_points);
+            chunk.on_curve_bits.insert(chunk.on_curve_bits.end(), glyph.on_curve_bits, glyph.on_curve_bits + (glyph.num_points + 7) / 8);
+            chunk.verbs.insert(chunk.verbs.end(), outline.verbs.begin(), outline.verbs.end());
+            chunk.segment_points.insert(chunk.segment_points.end(), outline.points.begin(), outline.points.end());
+            for (size_t contour_end : outline.contour_ends) {
+                chunk.contour_ends.push_back(static_cast<Uint32>(contour_end));
+            }
+        }
+    }
+
+    size_t align_section_offset(size_t offset) {
+        return (offset + SECTION_ALIGNMENT - 1) / SECTION_ALIGNMENT * SECTION_ALIGNMENT;
+    }
+
+    template<typename T>
+    void copy_into(Uint8* destination, const std::vector<T>& source) {
+        if (!source.empty()) {
+            std::memcpy(destination, source.data(), source.size() * sizeof(T));
+        }
+    }
+}
+
+// --------------------------------------------------------------------------
+
+OutlineCache::OutlineCache()
+    : data(nullptr),
+      size(0),
+      header(nullptr),
+      records(nullptr),
+      end_point_indices(nullptr),
+      x_coordinates(nullptr),
+      y_coordinates(nullptr),
+      on_curve_bits(nullptr),
+      verbs(nullptr),
+      segment_points(nullptr),
+      contour_ends(nullptr) {
+}
+
+// --------------------------------------------------------------------------
+
+std::shared_ptr<const OutlineCache> OutlineCache::build(Font& font, ThreadPool& thread_pool, const std::atomic<bool>* cancel_flag) {
+    std::shared_ptr<OutlineCache> cache(new OutlineCache());
+
+    size_t glyph_count = font.get_glyph_count();
+    size_t chunk_count = (glyph_count + GLYPHS_PER_CHUNK - 1) / GLYPHS_PER_CHUNK;
+    std::vector<CompiledChunk> chunks(chunk_count);
+
+    auto is_cancelled = [cancel_flag]() {
+        return cancel_flag != nullptr && cancel_flag->load(std::memory_order_relaxed);
+    };
+
+    thread_pool.parallel_for(glyph_count, GLYPHS_PER_CHUNK, [&](size_t begin, size_t end) {
+        if (!is_cancelled()) {
+            compile_chunk(font, begin, end - begin, chunks[begin / GLYPHS_PER_CHUNK]);
+        }
+    });
+
+    // Hashing reads the whole file, so it is skipped too if the build has
+    // been cancelled in the meantime.
+    if (is_cancelled()) {
+        return nullptr;
+    }
+
+    std::shared_ptr<FontFile> font_file = font.get_file();
+    Uint64 content_hash = font_file != nullptr ? font_file->get_content_hash() : 0;
+    if (is_cancelled()) {
+        return nullptr;
+    }
+
+    // Each chunk's place in every section is the running total of the chunks
+    // before it.
+    std::vector<SectionEntry> chunk_starts(chunk_count * SECTION_COUNT);
+    Uint64 section_counts[SECTION_COUNT] = {};
+    for (size_t i = 0; i < chunk_count; i++) {
+        const CompiledChunk& chunk = chunks[i];
+        const size_t chunk_counts[SECTION_COUNT] = {
+            chunk.records.size(),
+            chunk.end_point_indices.size(),
+            chunk.x_coordinates.size(),
+            chunk.y_coordinates.size(),
+            chunk.on_curve_bits.size(),
+            chunk.verbs.size(),
+            chunk.segment_points.size(),
+            chunk.contour_ends.size(),
+        };
+
+        for (int section = 0; section < SECTION_COUNT; section++) {
+            chunk_starts[i * SECTION_COUNT + section] = {section_counts[section], chunk_counts[section]};
+            section_counts[section] += chunk_counts[section];
+        }
+    }
+
+    Header file_header;
+    std::memset(&file_header, 0, sizeof(file_header));
+    file_header.magic = CACHE_FILE_MAGIC;
+    file_header.version = CACHE_FILE_VERSION;
+    file_header.font_key = font_file != nullptr ? font_file->get_cache_key() : 0;
+    file_header.content_hash = content_hash;
+    file_header.face_index = static_cast<Uint32>(font.get_face_index());
+    file_header.glyph_count = static_cast<Uint32>(glyph_count);
+
+    size_t file_size = align_section_offset(sizeof(Header));
+    for (int section = 0; section < SECTION_COUNT; section++) {
+        file_header.sections[section] = {file_size, section_counts[section]};
+        file_size = align_section_offset(file_size + section_counts[section] * get_element_size(static_cast<Section>(section)));
+    }
+
+    cache->built_bytes.assign(file_size, 0);
+    Uint8* bytes = cache->built_bytes.data();
+    std::memcpy(bytes, &file_header, sizeof(file_header));
+
+    thread_pool.parallel_for(chunk_count, 1, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            CompiledChunk& chunk = chunks[i];
+            const SectionEntry* starts = &chunk_starts[i * SECTION_COUNT];
+
+            for (Record& record : chunk.records) {
+                record.first_end_point_index += static_cast<Uint32>(starts[END_POINT_INDICES].offset);
+                record.first_point_index += static_cast<Uint32>(starts[X_COORDINATES].offset);
+                record.first_on_curve_byte += static_cast<Uint32>(starts[ON_CURVE_BITS].offset);
+                record.first_verb += static_cast<Uint32>(starts[VERBS].offset);
+                record.first_segment_point += static_cast<Uint32>(starts[SEGMENT_POINTS].offset);
+                record.first_contour_end += static_cast<Uint32>(starts[CONTOUR_ENDS].offset);
+            }
+
+            auto destination = [&](Section section) {
+                return bytes + file_header.sections[section].offset + starts[section].offset * get_element_size(section);
+            };
+
+            copy_into(destination(RECORDS), chunk.records);
+            copy_into(destination(END_POINT_INDICES), chunk.end_point_indices);
+            copy_into(destination(X_COORDINATES), chunk.x_coordinates);
+            copy_into(destination(Y_COORDINATES), chunk.y_coordinates);
+            copy_into(destination(ON_CURVE_BITS), chunk.on_curve_bits);
+            copy_into(destination(VERBS), chunk.verbs);
+            copy_into(destination(SEGMENT_POINTS), chunk.segment_points);
+            copy_into(destination(CONTOUR_ENDS), chunk.contour_ends);
+
+            chunk = CompiledChunk();
+        }
+    });
+
+    cache->attach(cache->built_bytes.data(), cache->built_bytes.size());
+    return cache;
+}
+
+// --------------------------------------------------------------------------
+
+std::shared_ptr<const OutlineCache> OutlineCache::load(const std::string& file_name, Uint64 font_key, int face_index) {
+    std::shared_ptr<OutlineCache> cache(new OutlineCache());
+    if (!cache->mapped_file.open(file_name)) {
+        return nullptr;
+    }
+
+    if (!cache->attach(cache->mapped_file.get_data(), cache->mapped_file.get_size())) {
+        return nullptr;
+    }
+
+    const Header& file_header = *cache->header;
+    if (file_header.magic != CACHE_FILE_MAGIC ||
+        file_header.version != CACHE_FILE_VERSION ||
+        file_header.font_key != font_key ||
+        static_cast<int>(file_header.face_index) != face_index
+    ) {
+        return nullptr;
+    }
+
+    return cache;
+}
+
+// --------------------------------------------------------------------------
+
+bool OutlineCache::save(const std::string& file_name) const {
+    // Write to a temporary file and rename it into place, so a reader never
+    // maps a half-written cache.
+    std::string temporary_file_name = file_name + ".tmp";
+    std::FILE* file = std::fopen(temporary_file_name.c_str(), "wb");
+    if (file == nullptr) {
+        std::cerr << "[ERROR] Could not write outline cache: " << temporary_file_name << std::endl;
+        return false;
+    }
+
+    bool is_written = std::fwrite(data, 1, size, file) == size;
+
+    is_written = std::fclose(file) == 0 && is_written;
+    if (!is_written || std::rename(temporary_file_name.c_str(), file_name.c_str()) != 0) {
+        std::cerr << "[ERROR] Could not write outline cache: " << file_name << std::endl;
+        std::remove(temporary_file_name.c_str());
+        return false;
+    }
+
+    return true;
+}
+
+// --------------------------------------------------------------------------
+
+std::string OutlineCache::get_cache_file_name(const std::string& cache_directory, Uint64 font_key, int face_index) {
+    char name[64];
+    std::snprintf(name, sizeof(name), "/%016llx-%d.outlines", static_cast<unsigned long long>(font_key), face_index);
+    return cache_directory + name;
+}
+
+// --------------------------------------------------------------------------
+
+size_t OutlineCache::get_glyph_count() const {
+    return header != nullptr ? header->glyph_count : 0;
+}
+
+// --------------------------------------------------------------------------
+
+Uint64 OutlineCache::get_content_hash() const {
+    return header != nullptr ? header->content_hash : 0;
+}
+
+// --------------------------------------------------------------------------
+
+bool OutlineCache::find_outline(Uint16 glyph_index, OutlineView& outline) const {
+    if (glyph_index >= get_glyph_count() || !is_record_valid(records[glyph_index])) {
+        return false;
+    }
+
+    const Record& record = records[glyph_index];
+    outline.glyph_index = glyph_index;
+    outline.min_extents = record.min_extents;
+    outline.max_extents = record.max_extents;
+    outline.num_end_point_indices = record.num_end_point_indices;
+    outline.end_point_indices = end_point_indices + record.first_end_point_index;
+    outline.num_points = record.num_points;
+    outline.x_coordinates = x_coordinates + record.first_point_index;
+    outline.y_coordinates = y_coordinates + record.first_point_index;
+    outline.on_curve_bits = on_curve_bits + record.first_on_curve_byte;
+    return true;
+}
+
+// --------------------------------------------------------------------------
+
+bool OutlineCache::find_compiled_outline(Uint16 glyph_index, GlyphOutline& outline) const {
+    if (glyph_index >= get_glyph_count() || !is_record_valid(records[glyph_index])) {
+        return false;
+    }
+
+    const Record& record = records[glyph_index];
+    const Uint8* glyph_verbs = verbs + record.first_verb;
+    const Uint32* glyph_contour_ends = contour_ends + record.first_contour_end;
+
+    // Drawing walks the verbs and takes points as it goes, so make sure they
+    // account for exactly the points that are there, and that every contour
+    // starts with a move.
+    size_t point_count = 0;
+    for (Uint32 i = 0; i < record.verb_count; i++) {
+        if (glyph_verbs[i] > GlyphOutline::QUAD_TO || (i == 0 && glyph_verbs[i] != GlyphOutline::MOVE_TO)) {
+            return false;
+        }
+
+        point_count += glyph_verbs[i] == GlyphOutline::QUAD_TO ? 2 : 1;
+    }
+
+    if (point_count != record.segment_point_count) {
+        return false;
+    }
+
+    Uint32 previous_contour_end = 0;
+    for (Uint32 i = 0; i < record.contour_count; i++) {
+        if (glyph_contour_ends[i] < previous_contour_end || glyph_contour_ends[i] > record.segment_point_count) {
+            return false;
+        }
+
+        previous_contour_end = glyph_contour_ends[i];
+    }
+
+    outline.min_extents = record.min_extents;
+    outline.max_extents = record.max_extents;
+    outline.verbs.assign(glyph_verbs, glyph_verbs + record.verb_count);
+    outline.points.assign(segment_points + record.first_segment_point, segment_points + record.first_segment_point + record.segment_point_count);
+    outline.contour_ends.assign(glyph_contour_ends, glyph_contour_ends + record.contour_count);
+    return true;
+}
+
+// --------------------------------------------------------------------------
+
+size_t OutlineCache::get_file_size() const {
+    return size;
+}
+
+// --------------------------------------------------------------------------
+
+size_t OutlineCache::get_element_size(Section section) {
+    switch (section) {
+        case RECORDS: return sizeof(Record);
+        case END_POINT_INDICES: return sizeof(Uint16);
+        case X_COORDINATES: return sizeof(Sint16);
+        case Y_COORDINATES: return sizeof(Sint16);
+        case ON_CURVE_BITS: return sizeof(Uint8);
+        case VERBS: return sizeof(Uint8);
+        case SEGMENT_POINTS: return sizeof(SDL_FPoint);
+        case CONTOUR_ENDS: return sizeof(Uint32);
+        default: return 0;
+    }
+}
+
+// --------------------------------------------------------------------------
+
+bool OutlineCache::attach(const Uint8* bytes, size_t byte_count) {
+    if (bytes == nullptr || byte_count < sizeof(Header)) {
+        return false;
+    }
+
+    const Header* file_header = reinterpret_cast<const Header*>(bytes);
+    for (int section = 0; section < SECTION_COUNT; section++) {
+        const SectionEntry& entry = file_header->sections[section];
+        size_t element_size = get_element_size(static_cast<Section>(section));
+        if (entry.offset % SECTION_ALIGNMENT != 0 || entry.offset > byte_count || entry.count > (byte_count - entry.offset) / element_size) {
+            return false;
+        }
+    }
+
+    if (file_header->sections[RECORDS].count != file_header->glyph_count ||
+        file_header->sections[X_COORDINATES].count != file_header->sections[Y_COORDINATES].count
+    ) {
+        return false;
+    }
+
+    data = bytes;
+    size = byte_count;
+    header = file_header;
+    records = get_section<Record>(RECORDS);
+    end_point_indices = get_section<Uint16>(END_POINT_INDICES);
+    x_coordinates = get_section<Sint16>(X_COORDINATES);
+    y_coordinates = get_section<Sint16>(Y_COORDINATES);
+    on_curve_bits = get_section<Uint8>(ON_CURVE_BITS);
+    verbs = get_section<Uint8>(VERBS);
+    segment_points = get_section<SDL_FPoint>(SEGMENT_POINTS);
+    contour_ends = get_section<Uint32>(CONTOUR_ENDS);
+    return true;
+}
+
+// --------------------------------------------------------------------------
+
+bool OutlineCache::is_record_valid(const Record& record) const {
+    auto fits = [this](Section section, Uint64 first, Uint64 count) {
+        return first + count <= header->sections[section].count;
+    };
+
+    return
+        fits(END_POINT_INDICES, record.first_end_point_index, record.num_end_point_indices) &&
+        fits(X_COORDINATES, record.first_point_index, record.num_points) &&
+        fits(ON_CURVE_BITS, record.first_on_curve_byte, (record.num_points + 7) / 8) &&
+        fits(VERBS, record.first_verb, record.verb_count) &&
+        fits(SEGMENT_POINTS, record.first_segment_point, record.segment_point_count) &&
+        fits(CONTOUR_ENDS, record.first_contour_end, record.contour_count)
+    ;
+}
+
+// --------------------------------------------------------------------------
+
+template<typename T>
+const T* OutlineCache::get_section(Section section) const {
+    return reinterpret_cast<const T*>(data + header->sections[section].offset);
+}
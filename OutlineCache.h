@@ -0,0 +1,134 @@
+#ifndef OUTLINE_CACHE_H
+#define OUTLINE_CACHE_H
+
+#include <SDL3/SDL.h>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "GlyphOutline.h"
+#include "MappedFile.h"
+#include "OutlineDatabase.h"
+
+class ThreadPool;
+
+// Every glyph of one face, decoded and compiled, in a flat file that is
+// memory-mapped back in as it is. The file is a header with an offset table
+// followed by one 8-byte aligned section per array: a record per glyph,
+// indexed by glyph index, then the decoded points as OutlineDatabase stores
+// them and the compiled segments as GlyphOutline stores them. Loading a
+// cache is a mmap and a header check, so a relaunch can draw its first glyph
+// without parsing the font at all.
+//
+// Values are in host byte order; a cache written on a machine of the other
+// endianness fails the magic check and is rebuilt.
+class OutlineCache {
+
+public:
+
+    struct Record {
+        Coordinate min_extents;
+        Coordinate max_extents;
+        Uint16 num_end_point_indices;
+        Uint16 num_points;
+        Uint32 first_end_point_index;
+        Uint32 first_point_index;
+        Uint32 first_on_curve_byte;
+        Uint32 first_verb;
+        Uint32 verb_count;
+        Uint32 first_segment_point;
+        Uint32 segment_point_count;
+        Uint32 first_contour_end;
+        Uint32 contour_count;
+    };
+
+    // Keyed by the font file's cache key and the face's index in it. The
+    // hash of the whole file goes in too, for checking the key against once
+    // the cache is in use. Returns nullptr if cancel_flag is set before it
+    // finishes.
+    static std::shared_ptr<const OutlineCache> build(Font& font, ThreadPool& thread_pool, const std::atomic<bool>* cancel_flag = nullptr);
+
+    // Returns nullptr if the file is missing, damaged or was built from a
+    // different font or face.
+    static std::shared_ptr<const OutlineCache> load(const std::string& file_name, Uint64 font_key, int face_index);
+    bool save(const std::string& file_name) const;
+
+    static std::string get_cache_file_name(const std::string& cache_directory, Uint64 font_key, int face_index);
+
+    size_t get_glyph_count() const;
+
+    // FontFile::get_content_hash of the file the cache was built from.
+    Uint64 get_content_hash() const;
+
+    // The glyph's points exactly as Font::get_glyph decodes them. Returns
+    // false if the glyph is out of range or its record is damaged.
+    bool find_outline(Uint16 glyph_index, OutlineView& outline) const;
+
+    // The glyph compiled as by GlyphOutline::compile, copied into outline.
+    bool find_compiled_outline(Uint16 glyph_index, GlyphOutline& outline) const;
+
+    size_t get_file_size() const;
+
+private:
+
+    static const Uint32 CACHE_FILE_MAGIC = 0x4F465454; // "TTFO"
+    static const Uint32 CACHE_FILE_VERSION = 2;
+
+    enum Section {
+        RECORDS,
+        END_POINT_INDICES,
+        X_COORDINATES,
+        Y_COORDINATES,
+        ON_CURVE_BITS,
+        VERBS,
+        SEGMENT_POINTS,
+        CONTOUR_ENDS,
+        SECTION_COUNT,
+    };
+
+    struct SectionEntry {
+        Uint64 offset;
+        Uint64 count;
+    };
+
+    struct Header {
+        Uint32 magic;
+        Uint32 version;
+        Uint64 font_key;
+        Uint64 content_hash;
+        Uint32 face_index;
+        Uint32 glyph_count;
+        SectionEntry sections[SECTION_COUNT];
+    };
+
+    // The bytes of the file: mapped when loaded, built in memory otherwise.
+    MappedFile mapped_file;
+    std::vector<Uint8> built_bytes;
+    const Uint8* data;
+    size_t size;
+
+    const Header* header;
+    const Record* records;
+    const Uint16* end_point_indices;
+    const Sint16* x_coordinates;
+    const Sint16* y_coordinates;
+    const Uint8* on_curve_bits;
+    const Uint8* verbs;
+    const SDL_FPoint* segment_points;
+    const Uint32* contour_ends;
+
+    OutlineCache();
+
+    static size_t get_element_size(Section section);
+
+    // Point the section pointers into data; false if the header or offset
+    // table don't describe the bytes that are there.
+    bool attach(const Uint8* bytes, size_t byte_count);
+    bool is_record_valid(const Record& record) const;
+
+    template<typename T>
+    const T* get_section(Section section) const;
+};
+
+#endif
@@ -0,0 +1,202 @@
+#include "OutlineDatabase.h"
+
+#include "ThreadPool.h"
+
+#include <cstring>
+
+namespace {
+    const size_t GLYPHS_PER_CHUNK = 64;
+
+    // Outlines decoded by one task, laid out exactly like the final arrays
+    // but with offsets relative to the start of the chunk.
+    struct DecodedChunk {
+        std::vector<OutlineDatabase::Record> records;
+        std::vector<Uint16> end_point_indices;
+        std::vector<Sint16> x_coordinates;
+        std::vector<Sint16> y_coordinates;
+        std::vector<Uint8> on_curve_bits;
+    };
+
+    void decode_chunk(Font& font, const Uint16* glyph_indices, size_t glyph_count, DecodedChunk& chunk) {
+        chunk.records.reserve(glyph_count);
+
+        for (size_t i = 0; i < glyph_count; i++) {
+            Glyph glyph = font.get_glyph(glyph_indices[i]);
+
+            OutlineDatabase::Record record;
+            record.glyph_index = glyph_indices[i];
+            record.min_extents = glyph.min_extents;
+            record.max_extents = glyph.max_extents;
+            record.num_end_point_indices = glyph.num_end_point_indices;
+            record.num_points = glyph.num_points;
+            record.first_end_point_index = static_cast<Uint32>(chunk.end_point_indices.size());
+            record.first_point_index = static_cast<Uint32>(chunk.x_coordinates.size());
+            record.first_on_curve_byte = static_cast<Uint32>(chunk.on_curve_bits.size());
+            chunk.records.push_back(record);
+
+            chunk.end_point_indices.insert(chunk.end_point_indices.end(), glyph.end_point_indices, glyph.end_point_indices + glyph.num_end_point_indices);
+            chunk.x_coordinates.insert(chunk.x_coordinates.end(), glyph.x_coordinates, glyph.x_coordinates + glyph.num_points);
+            chunk.y_coordinates.insert(chunk.y_coordinates.end(), glyph.y_coordinates, glyph.y_coordinates + glyph.num_points);
+            chunk.on_curve_bits.insert(chunk.on_curve_bits.end(), glyph.on_curve_bits, glyph.on_curve_bits + (glyph.num_points + 7) / 8);
+        }
+    }
+
+    template<typename T>
+    void copy_into(std::vector<T>& destination, size_t offset, const std::vector<T>& source) {
+        if (!source.empty()) {
+            std::memcpy(destination.data() + offset, source.data(), source.size() * sizeof(T));
+        }
+    }
+}
+
+// --------------------------------------------------------------------------
+
+std::shared_ptr<const OutlineDatabase> OutlineDatabase::build(Font& font, ThreadPool& thread_pool) {
+    return build(font, thread_pool, 0, font.get_glyph_count());
+}
+
+// --------------------------------------------------------------------------
+
+std::shared_ptr<const OutlineDatabase> OutlineDatabase::build(Font& font, ThreadPool& thread_pool, Uint16 first_glyph_index, Uint16 glyph_count) {
+    std::vector<Uint16> glyph_indices;
+    glyph_indices.reserve(glyph_count);
+    for (Uint32 glyph_index = first_glyph_index; glyph_index < static_cast<Uint32>(first_glyph_index) + glyph_count; glyph_index++) {
+        if (glyph_index >= font.get_glyph_count()) {
+            break;
+        }
+
+        glyph_indices.push_back(static_cast<Uint16>(glyph_index));
+    }
+
+    return build(font, thread_pool, glyph_indices);
+}
+
+// --------------------------------------------------------------------------
+
+std::shared_ptr<const OutlineDatabase> OutlineDatabase::build(Font& font, ThreadPool& thread_pool, const std::vector<Uint16>& requested_glyph_indices) {
+    std::shared_ptr<OutlineDatabase> database(new OutlineDatabase());
+
+    // Indices the font doesn't have are dropped here, as the range overload
+    // does, since glyph_index_to_outline_index only covers the font's glyphs.
+    std::vector<Uint16> glyph_indices;
+    glyph_indices.reserve(requested_glyph_indices.size());
+    for (Uint16 glyph_index : requested_glyph_indices) {
+        if (glyph_index < font.get_glyph_count()) {
+            glyph_indices.push_back(glyph_index);
+        }
+    }
+
+    size_t chunk_count = (glyph_indices.size() + GLYPHS_PER_CHUNK - 1) / GLYPHS_PER_CHUNK;
+    std::vector<DecodedChunk> chunks(chunk_count);
+
+    thread_pool.parallel_for(glyph_indices.size(), GLYPHS_PER_CHUNK, [&](size_t begin, size_t end) {
+        decode_chunk(font, glyph_indices.data() + begin, end - begin, chunks[begin / GLYPHS_PER_CHUNK]);
+    });
+
+    // Each chunk's final position is the running total of the chunks before it.
+    size_t record_total = 0;
+    size_t end_point_total = 0;
+    size_t point_total = 0;
+    size_t on_curve_byte_total = 0;
+    std::vector<size_t> record_offsets(chunk_count);
+    std::vector<size_t> end_point_offsets(chunk_count);
+    std::vector<size_t> point_offsets(chunk_count);
+    std::vector<size_t> on_curve_byte_offsets(chunk_count);
+    for (size_t i = 0; i < chunk_count; i++) {
+        record_offsets[i] = record_total;
+        end_point_offsets[i] = end_point_total;
+        point_offsets[i] = point_total;
+        on_curve_byte_offsets[i] = on_curve_byte_total;
+
+        record_total += chunks[i].records.size();
+        end_point_total += chunks[i].end_point_indices.size();
+        point_total += chunks[i].x_coordinates.size();
+        on_curve_byte_total += chunks[i].on_curve_bits.size();
+    }
+
+    database->records.resize(record_total);
+    database->end_point_indices.resize(end_point_total);
+    database->x_coordinates.resize(point_total);
+    database->y_coordinates.resize(point_total);
+    database->on_curve_bits.resize(on_curve_byte_total);
+
+    thread_pool.parallel_for(chunk_count, 1, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            DecodedChunk& chunk = chunks[i];
+
+            for (Record& record : chunk.records) {
+                record.first_end_point_index += static_cast<Uint32>(end_point_offsets[i]);
+                record.first_point_index += static_cast<Uint32>(point_offsets[i]);
+                record.first_on_curve_byte += static_cast<Uint32>(on_curve_byte_offsets[i]);
+            }
+
+            copy_into(database->records, record_offsets[i], chunk.records);
+            copy_into(database->end_point_indices, end_point_offsets[i], chunk.end_point_indices);
+            copy_into(database->x_coordinates, point_offsets[i], chunk.x_coordinates);
+            copy_into(database->y_coordinates, point_offsets[i], chunk.y_coordinates);
+            copy_into(database->on_curve_bits, on_curve_byte_offsets[i], chunk.on_curve_bits);
+
+            chunk = DecodedChunk();
+        }
+    });
+
+    database->glyph_index_to_outline_index.assign(font.get_glyph_count(), -1);
+    for (size_t i = 0; i < database->records.size(); i++) {
+        database->glyph_index_to_outline_index[database->records[i].glyph_index] = static_cast<Sint32>(i);
+    }
+
+    return database;
+}
+
+// --------------------------------------------------------------------------
+
+size_t OutlineDatabase::get_outline_count() const {
+    return records.size();
+}
+
+// --------------------------------------------------------------------------
+
+OutlineView OutlineDatabase::get_outline(size_t outline_index) const {
+    const Record& record = records[outline_index];
+
+    OutlineView outline;
+    outline.glyph_index = record.glyph_index;
+    outline.min_extents = record.min_extents;
+    outline.max_extents = record.max_extents;
+    outline.num_end_point_indices = record.num_end_point_indices;
+    outline.end_point_indices = end_point_indices.data() + record.first_end_point_index;
+    outline.num_points = record.num_points;
+    outline.x_coordinates = x_coordinates.data() + record.first_point_index;
+    outline.y_coordinates = y_coordinates.data() + record.first_point_index;
+    outline.on_curve_bits = on_curve_bits.data() + record.first_on_curve_byte;
+    return outline;
+}
+
+// --------------------------------------------------------------------------
+
+bool OutlineDatabase::find_outline(Uint16 glyph_index, OutlineView& outline) const {
+    if (glyph_index >= glyph_index_to_outline_index.size() || glyph_index_to_outline_index[glyph_index] < 0) {
+        return false;
+    }
+
+    outline = get_outline(glyph_index_to_outline_index[glyph_index]);
+    return true;
+}
+
+// --------------------------------------------------------------------------
+
+size_t OutlineDatabase::get_total_point_count() const {
+    return x_coordinates.size();
+}
+
+// --------------------------------------------------------------------------
+
+size_t OutlineDatabase::get_memory_size() const {
+    return
+        records.size() * sizeof(Record) +
+        end_point_indices.size() * sizeof(Uint16) +
+        x_coordinates.size() * sizeof(Sint16) * 2 +
+        on_curve_bits.size() +
+        glyph_index_to_outline_index.size() * sizeof(Sint32)
+    ;
+}
@@ -0,0 +1,82 @@
+#ifndef OUTLINE_DATABASE_H
+#define OUTLINE_DATABASE_H
+
+#include <SDL3/SDL.h>
+#include <memory>
+#include <vector>
+
+#include "Font.h"
+
+class ThreadPool;
+
+// Read-only view of one outline inside an OutlineDatabase. Field names match
+// Glyph so code can move between the two freely.
+struct OutlineView {
+    Uint16 glyph_index;
+    Coordinate min_extents;
+    Coordinate max_extents;
+    Uint16 num_end_point_indices;
+    const Uint16* end_point_indices;
+    Uint16 num_points;
+    const Sint16* x_coordinates;
+    const Sint16* y_coordinates;
+    const Uint8* on_curve_bits;
+
+    bool is_on_curve(int point_index) const {
+        return ((on_curve_bits[point_index >> 3] >> (point_index & 7)) & 0x01) != 0;
+    }
+
+    GlyphPoint get_point(int point_index) const {
+        return {x_coordinates[point_index], y_coordinates[point_index], is_on_curve(point_index)};
+    }
+};
+
+// Every requested outline of a font packed into a handful of flat arrays with
+// a per-outline record of offsets into them. Built once by decoding glyphs in
+// parallel, never modified afterwards, so it can be shared between threads
+// without locking.
+class OutlineDatabase {
+
+public:
+
+    struct Record {
+        Uint16 glyph_index;
+        Coordinate min_extents;
+        Coordinate max_extents;
+        Uint16 num_end_point_indices;
+        Uint16 num_points;
+        Uint32 first_end_point_index;
+        Uint32 first_point_index;
+        Uint32 first_on_curve_byte;
+    };
+
+    static std::shared_ptr<const OutlineDatabase> build(Font& font, ThreadPool& thread_pool);
+    static std::shared_ptr<const OutlineDatabase> build(Font& font, ThreadPool& thread_pool, Uint16 first_glyph_index, Uint16 glyph_count);
+    // Glyph indices past the end of the font are skipped.
+    static std::shared_ptr<const OutlineDatabase> build(Font& font, ThreadPool& thread_pool, const std::vector<Uint16>& glyph_indices);
+
+    size_t get_outline_count() const;
+    OutlineView get_outline(size_t outline_index) const;
+
+    // Returns false if glyph_index was not part of the build.
+    bool find_outline(Uint16 glyph_index, OutlineView& outline) const;
+
+    size_t get_total_point_count() const;
+    size_t get_memory_size() const;
+
+private:
+
+    OutlineDatabase() = default;
+
+    std::vector<Record> records;
+    std::vector<Uint16> end_point_indices;
+    std::vector<Sint16> x_coordinates;
+    std::vector<Sint16> y_coordinates;
+    std::vector<Uint8> on_curve_bits;
+
+    // Outline index for each glyph index, or -1; only filled in for glyphs
+    // that were built.
+    std::vector<Sint32> glyph_index_to_outline_index;
+};
+
+#endif
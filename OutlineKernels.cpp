@@ -0,0 +1,144 @@
+#include "OutlineKernels.h"
+
+#include <cmath>
+#include <cstring>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+void prefix_sum_int16(Sint16* values, size_t count) {
+    size_t i = 0;
+    Sint16 running_sum = 0;
+
+#if defined(__SSE2__)
+    __m128i carry = _mm_setzero_si128();
+    for (; i + 8 <= count; i += 8) {
+        __m128i lanes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(values + i));
+        lanes = _mm_add_epi16(lanes, _mm_slli_si128(lanes, 2));
+        lanes = _mm_add_epi16(lanes, _mm_slli_si128(lanes, 4));
+        lanes = _mm_add_epi16(lanes, _mm_slli_si128(lanes, 8));
+        lanes = _mm_add_epi16(lanes, carry);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(values + i), lanes);
+
+        __m128i last_lane = _mm_shufflehi_epi16(lanes, 0xFF);
+        carry = _mm_unpackhi_epi64(last_lane, last_lane);
+    }
+
+    if (i > 0) {
+        running_sum = values[i - 1];
+    }
+#elif defined(__ARM_NEON)
+    const int16x8_t zero = vdupq_n_s16(0);
+    int16x8_t carry = zero;
+    for (; i + 8 <= count; i += 8) {
+        int16x8_t lanes = vld1q_s16(values + i);
+        lanes = vaddq_s16(lanes, vextq_s16(zero, lanes, 7));
+        lanes = vaddq_s16(lanes, vextq_s16(zero, lanes, 6));
+        lanes = vaddq_s16(lanes, vextq_s16(zero, lanes, 4));
+        lanes = vaddq_s16(lanes, carry);
+        vst1q_s16(values + i, lanes);
+
+        carry = vdupq_n_s16(vgetq_lane_s16(lanes, 7));
+    }
+
+    if (i > 0) {
+        running_sum = values[i - 1];
+    }
+#endif
+
+    for (; i < count; i++) {
+        running_sum = static_cast<Sint16>(running_sum + values[i]);
+        values[i] = running_sum;
+    }
+}
+
+// --------------------------------------------------------------------------
+
+void pack_on_curve_bits(const Uint8* flags, Uint8* bits, size_t count) {
+    size_t i = 0;
+
+#if defined(__SSE2__)
+    for (; i + 16 <= count; i += 16) {
+        __m128i flag_lanes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(flags + i));
+        int mask = _mm_movemask_epi8(_mm_slli_epi16(flag_lanes, 7));
+        bits[i / 8] = static_cast<Uint8>(mask & 0xFF);
+        bits[i / 8 + 1] = static_cast<Uint8>((mask >> 8) & 0xFF);
+    }
+#endif
+
+    if (i < count) {
+        std::memset(bits + i / 8, 0, (count - i + 7) / 8);
+    }
+
+    for (; i < count; i++) {
+        bits[i / 8] |= static_cast<Uint8>((flags[i] & 0x01) << (i % 8));
+    }
+}
+
+// --------------------------------------------------------------------------
+
+void accumulate_coverage(const float* area_deltas, Uint8* coverage, size_t count) {
+    size_t i = 0;
+    float running_sum = 0.0f;
+
+#if defined(__SSE2__)
+    const __m128 sign_mask = _mm_set1_ps(-0.0f);
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 scale = _mm_set1_ps(255.0f);
+    const __m128 half = _mm_set1_ps(0.5f);
+    __m128 carry = _mm_setzero_ps();
+    for (; i + 4 <= count; i += 4) {
+        __m128 lanes = _mm_loadu_ps(area_deltas + i);
+        lanes = _mm_add_ps(lanes, _mm_castsi128_ps(_mm_slli_si128(_mm_castps_si128(lanes), 4)));
+        lanes = _mm_add_ps(lanes, _mm_castsi128_ps(_mm_slli_si128(_mm_castps_si128(lanes), 8)));
+        lanes = _mm_add_ps(lanes, carry);
+        carry = _mm_shuffle_ps(lanes, lanes, _MM_SHUFFLE(3, 3, 3, 3));
+
+        __m128 levels = _mm_min_ps(_mm_andnot_ps(sign_mask, lanes), one);
+        __m128i values = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(levels, scale), half));
+        values = _mm_packs_epi32(values, values);
+        values = _mm_packus_epi16(values, values);
+
+        Uint32 packed = static_cast<Uint32>(_mm_cvtsi128_si32(values));
+        std::memcpy(coverage + i, &packed, sizeof(packed));
+    }
+
+    if (i > 0) {
+        running_sum = _mm_cvtss_f32(carry);
+    }
+#elif defined(__ARM_NEON)
+    const float32x4_t zero = vdupq_n_f32(0.0f);
+    const float32x4_t one = vdupq_n_f32(1.0f);
+    const float32x4_t scale = vdupq_n_f32(255.0f);
+    const float32x4_t half = vdupq_n_f32(0.5f);
+    float32x4_t carry = zero;
+    for (; i + 4 <= count; i += 4) {
+        float32x4_t lanes = vld1q_f32(area_deltas + i);
+        lanes = vaddq_f32(lanes, vextq_f32(zero, lanes, 3));
+        lanes = vaddq_f32(lanes, vextq_f32(zero, lanes, 2));
+        lanes = vaddq_f32(lanes, carry);
+        carry = vdupq_n_f32(vgetq_lane_f32(lanes, 3));
+
+        float32x4_t levels = vminq_f32(vabsq_f32(lanes), one);
+        uint32x4_t values = vcvtq_u32_f32(vaddq_f32(vmulq_f32(levels, scale), half));
+        uint16x4_t narrowed = vmovn_u32(values);
+        uint8x8_t bytes = vmovn_u16(vcombine_u16(narrowed, narrowed));
+
+        Uint32 packed = vget_lane_u32(vreinterpret_u32_u8(bytes), 0);
+        std::memcpy(coverage + i, &packed, sizeof(packed));
+    }
+
+    if (i > 0) {
+        running_sum = vgetq_lane_f32(carry, 0);
+    }
+#endif
+
+    for (; i < count; i++) {
+        running_sum += area_deltas[i];
+        float level = std::fmin(std::fabs(running_sum), 1.0f);
+        coverage[i] = static_cast<Uint8>(level * 255.0f + 0.5f);
+    }
+}
@@ -0,0 +1,19 @@
+#ifndef OUTLINE_KERNELS_H
+#define OUTLINE_KERNELS_H
+
+#include <SDL3/SDL.h>
+#include <cstddef>
+
+// Turn per-point deltas into absolute coordinates in place. Arithmetic wraps
+// at 16 bits, the same as summing into Sint16 one point at a time.
+void prefix_sum_int16(Sint16* values, size_t count);
+
+// Pack bit 0 of each glyf flag into a little-endian bitset, one bit per point.
+// bits must hold (count + 7) / 8 bytes.
+void pack_on_curve_bits(const Uint8* flags, Uint8* bits, size_t count);
+
+// Running-sum signed area deltas into 8-bit coverage: each output is the
+// absolute value of the sum so far, clamped to 1 and scaled to 0-255.
+void accumulate_coverage(const float* area_deltas, Uint8* coverage, size_t count);
+
+#endif
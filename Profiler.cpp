@@ -0,0 +1,167 @@
+#include "Profiler.h"
+
+#ifdef TTF_VIEWER_PROFILING
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <mutex>
+#include <vector>
+
+namespace {
+    // A long capture is cut off here rather than growing without bound.
+    const size_t MAX_TRACE_EVENT_COUNT = 1 << 20;
+
+    const char* const ZONE_NAMES[PROFILE_ZONE_COUNT] = {
+        "font_load",
+        "get_glyph",
+        "hint_glyph",
+        "flatten",
+        "draw_points",
+        "draw_lines",
+        "draw_contours",
+        "draw_filled",
+        "draw_atlas",
+        "draw_grid",
+        "draw_text",
+        "submit",
+        "frame",
+    };
+
+    struct TraceEvent {
+        ProfileZone zone;
+        int thread_index;
+        Uint64 start_ns;
+        Uint64 duration_ns;
+    };
+
+    const std::chrono::steady_clock::time_point profile_epoch = std::chrono::steady_clock::now();
+
+    std::atomic<Uint64> zone_ns[PROFILE_ZONE_COUNT];
+    std::atomic<Uint64> zone_calls[PROFILE_ZONE_COUNT];
+    std::atomic<Uint64> counters[PROFILE_COUNTER_COUNT];
+
+    std::atomic<bool> is_trace_active(false);
+    std::atomic<int> next_thread_index(0);
+    std::mutex trace_mutex;
+    std::vector<TraceEvent> trace_events;
+    size_t dropped_trace_event_count = 0;
+
+    int get_thread_index() {
+        thread_local int thread_index = next_thread_index++;
+        return thread_index;
+    }
+}
+
+// --------------------------------------------------------------------------
+
+const char* Profiler::get_zone_name(ProfileZone zone) {
+    return zone >= 0 && zone < PROFILE_ZONE_COUNT ? ZONE_NAMES[zone] : "unknown";
+}
+
+// --------------------------------------------------------------------------
+
+Uint64 Profiler::get_time_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - profile_epoch).count();
+}
+
+// --------------------------------------------------------------------------
+
+void Profiler::record(ProfileZone zone, Uint64 start_ns, Uint64 end_ns) {
+    zone_ns[zone].fetch_add(end_ns - start_ns, std::memory_order_relaxed);
+    zone_calls[zone].fetch_add(1, std::memory_order_relaxed);
+
+    if (!is_trace_active.load(std::memory_order_relaxed)) {
+        return;
+    }
+
+    TraceEvent event = {zone, get_thread_index(), start_ns, end_ns - start_ns};
+
+    std::lock_guard<std::mutex> lock(trace_mutex);
+    if (trace_events.size() < MAX_TRACE_EVENT_COUNT) {
+        trace_events.push_back(event);
+    } else {
+        dropped_trace_event_count++;
+    }
+}
+
+// --------------------------------------------------------------------------
+
+void Profiler::add(ProfileCounter counter, Uint64 amount) {
+    counters[counter].fetch_add(amount, std::memory_order_relaxed);
+}
+
+// --------------------------------------------------------------------------
+
+void Profiler::end_frame(ProfileFrameStats& stats) {
+    for (int i = 0; i < PROFILE_ZONE_COUNT; i++) {
+        stats.zone_ns[i] = zone_ns[i].exchange(0, std::memory_order_relaxed);
+        stats.zone_calls[i] = zone_calls[i].exchange(0, std::memory_order_relaxed);
+    }
+
+    for (int i = 0; i < PROFILE_COUNTER_COUNT; i++) {
+        stats.counters[i] = counters[i].exchange(0, std::memory_order_relaxed);
+    }
+}
+
+// --------------------------------------------------------------------------
+
+void Profiler::start_trace() {
+    std::lock_guard<std::mutex> lock(trace_mutex);
+    trace_events.clear();
+    dropped_trace_event_count = 0;
+    is_trace_active = true;
+}
+
+// --------------------------------------------------------------------------
+
+bool Profiler::stop_trace(const std::string& file_name) {
+    std::vector<TraceEvent> events;
+    size_t dropped_event_count = 0;
+    {
+        std::lock_guard<std::mutex> lock(trace_mutex);
+        is_trace_active = false;
+        events.swap(trace_events);
+        dropped_event_count = dropped_trace_event_count;
+    }
+
+    std::FILE* file = std::fopen(file_name.c_str(), "w");
+    if (file == nullptr) {
+        std::cerr << "[ERROR] Could not write trace: " << file_name << std::endl;
+        return false;
+    }
+
+    // Complete ("X") events with times in microseconds, which is what
+    // chrome://tracing and Perfetto expect.
+    std::fprintf(file, "{\"traceEvents\":[\n");
+    for (size_t i = 0; i < events.size(); i++) {
+        const TraceEvent& event = events[i];
+        std::fprintf(
+            file,
+            "{\"name\":\"%s\",\"cat\":\"ttf-viewer\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}%s\n",
+            get_zone_name(event.zone),
+            event.thread_index,
+            event.start_ns / 1000.0,
+            event.duration_ns / 1000.0,
+            i + 1 < events.size() ? "," : ""
+        );
+    }
+    std::fprintf(file, "],\"displayTimeUnit\":\"ms\",\"otherData\":{\"dropped_events\":%zu}}\n", dropped_event_count);
+
+    bool is_written = std::ferror(file) == 0;
+    is_written = std::fclose(file) == 0 && is_written;
+    if (!is_written) {
+        std::cerr << "[ERROR] Could not write trace: " << file_name << std::endl;
+    }
+
+    return is_written;
+}
+
+// --------------------------------------------------------------------------
+
+bool Profiler::is_tracing() {
+    return is_trace_active.load(std::memory_order_relaxed);
+}
+
+#endif
@@ -0,0 +1,99 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+// Scoped timers and counters for the viewer's debug build. Every scope adds
+// its time to a per-zone total that the overlay reads once a frame, and
+// while a trace is being captured it is also recorded as a Chrome trace
+// event. Without TTF_VIEWER_PROFILING, as in release and bench builds, the
+// macros expand to nothing and none of this is compiled.
+
+#ifdef TTF_VIEWER_PROFILING
+
+#include <SDL3/SDL.h>
+#include <string>
+
+enum ProfileZone {
+    FONT_LOAD,
+    GET_GLYPH,
+    HINT_GLYPH,
+    FLATTEN,
+    DRAW_POINTS,
+    DRAW_LINES,
+    DRAW_CONTOURS,
+    DRAW_FILLED,
+    DRAW_ATLAS,
+    DRAW_GRID,
+    DRAW_TEXT,
+    SUBMIT,
+    FRAME,
+    PROFILE_ZONE_COUNT,
+};
+
+enum ProfileCounter {
+    SEGMENTS,
+    RENDERER_CALLS,
+    PROFILE_COUNTER_COUNT,
+};
+
+// Totals since the previous Profiler::end_frame, over every thread.
+struct ProfileFrameStats {
+    Uint64 zone_ns[PROFILE_ZONE_COUNT];
+    Uint64 zone_calls[PROFILE_ZONE_COUNT];
+    Uint64 counters[PROFILE_COUNTER_COUNT];
+};
+
+class Profiler {
+
+public:
+
+    static const char* get_zone_name(ProfileZone zone);
+
+    static Uint64 get_time_ns();
+    static void record(ProfileZone zone, Uint64 start_ns, Uint64 end_ns);
+    static void add(ProfileCounter counter, Uint64 amount);
+
+    // Hand back the totals gathered since the last call and start over.
+    static void end_frame(ProfileFrameStats& stats);
+
+    // Events are kept in memory from start_trace until stop_trace writes
+    // them out in Chrome's trace event format.
+    static void start_trace();
+    static bool stop_trace(const std::string& file_name);
+    static bool is_tracing();
+};
+
+class ProfileScope {
+
+public:
+
+    explicit ProfileScope(ProfileZone zone)
+        : zone(zone),
+          start_ns(Profiler::get_time_ns()) {
+    }
+
+    ~ProfileScope() {
+        Profiler::record(zone, start_ns, Profiler::get_time_ns());
+    }
+
+    ProfileScope(const ProfileScope&) = delete;
+    ProfileScope& operator=(const ProfileScope&) = delete;
+
+private:
+
+    ProfileZone zone;
+    Uint64 start_ns;
+};
+
+#define PROFILE_CONCATENATE_INNER(a, b) a##b
+#define PROFILE_CONCATENATE(a, b) PROFILE_CONCATENATE_INNER(a, b)
+#define PROFILE_SCOPE(zone) ProfileScope PROFILE_CONCATENATE(profile_scope_, __LINE__)(zone)
+#define PROFILE_COUNT(counter, amount) Profiler::add(counter, amount)
+
+#else
+
+#define PROFILE_SCOPE(zone) do {} while (0)
+#define PROFILE_COUNT(counter, amount) do {} while (0)
+
+#endif
+
+#endif
@@ -0,0 +1,109 @@
+#include "SkylinePacker.h"
+
+#include <algorithm>
+
+SkylinePacker::SkylinePacker(int width, int height)
+    : bin_width(width),
+      bin_height(height) {
+    skyline.push_back({0, 0, width});
+}
+
+// --------------------------------------------------------------------------
+
+int SkylinePacker::fit_at(size_t segment_index, int width, int height) const {
+    int x = skyline[segment_index].x;
+    if (x + width > bin_width) {
+        return -1;
+    }
+
+    // The rectangle rests on the highest segment it spans.
+    int y = 0;
+    int remaining_width = width;
+    for (size_t i = segment_index; remaining_width > 0; i++) {
+        y = std::max(y, skyline[i].y);
+        if (y + height > bin_height) {
+            return -1;
+        }
+
+        remaining_width -= skyline[i].width;
+    }
+
+    return y;
+}
+
+// --------------------------------------------------------------------------
+
+bool SkylinePacker::pack(int width, int height, int& x, int& y) {
+    if (width <= 0 || height <= 0) {
+        return false;
+    }
+
+    int best_top = -1;
+    int best_width = 0;
+    size_t best_index = 0;
+    for (size_t i = 0; i < skyline.size(); i++) {
+        int fit_y = fit_at(i, width, height);
+        if (fit_y < 0) {
+            continue;
+        }
+
+        int top = fit_y + height;
+        if (best_top < 0 || top < best_top || (top == best_top && skyline[i].width < best_width)) {
+            best_top = top;
+            best_width = skyline[i].width;
+            best_index = i;
+        }
+    }
+
+    if (best_top < 0) {
+        return false;
+    }
+
+    x = skyline[best_index].x;
+    y = best_top - height;
+
+    // Raise the skyline under the new rectangle: insert its top edge and trim
+    // or drop the segments it now covers.
+    skyline.insert(skyline.begin() + best_index, {x, best_top, width});
+
+    size_t i = best_index + 1;
+    while (i < skyline.size()) {
+        Segment& segment = skyline[i];
+        int covered_end = x + width;
+        if (segment.x >= covered_end) {
+            break;
+        }
+
+        int shrink = covered_end - segment.x;
+        if (shrink >= segment.width) {
+            skyline.erase(skyline.begin() + i);
+        } else {
+            segment.x += shrink;
+            segment.width -= shrink;
+            break;
+        }
+    }
+
+    // Neighbouring segments at the same height are one segment.
+    for (size_t j = 0; j + 1 < skyline.size();) {
+        if (skyline[j].y == skyline[j + 1].y) {
+            skyline[j].width += skyline[j + 1].width;
+            skyline.erase(skyline.begin() + j + 1);
+        } else {
+            j++;
+        }
+    }
+
+    return true;
+}
+
+// --------------------------------------------------------------------------
+
+int SkylinePacker::get_used_height() const {
+    int used_height = 0;
+    for (const Segment& segment : skyline) {
+        used_height = std::max(used_height, segment.y);
+    }
+
+    return used_height;
+}
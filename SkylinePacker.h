@@ -0,0 +1,41 @@
+#ifndef SKYLINE_PACKER_H
+#define SKYLINE_PACKER_H
+
+#include <cstddef>
+#include <vector>
+
+// Packs rectangles into a fixed-size bin by tracking the bin's filled
+// "skyline" as a list of horizontal segments. Each rectangle goes wherever
+// its top edge ends up lowest, breaking ties by the narrowest fit, which
+// works well when rectangles arrive sorted by decreasing height.
+class SkylinePacker {
+
+public:
+
+    SkylinePacker(int width, int height);
+
+    // Find room for a width x height rectangle and reserve it. Returns false,
+    // leaving the packer unchanged, if it doesn't fit anywhere.
+    bool pack(int width, int height, int& x, int& y);
+
+    // Height of the tallest column used so far.
+    int get_used_height() const;
+
+private:
+
+    struct Segment {
+        int x;
+        int y;
+        int width;
+    };
+
+    int bin_width;
+    int bin_height;
+    std::vector<Segment> skyline;
+
+    // The y a rectangle would sit at if placed at the start of segment
+    // segment_index, or -1 if it doesn't fit there.
+    int fit_at(size_t segment_index, int width, int height) const;
+};
+
+#endif
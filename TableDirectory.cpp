@@ -0,0 +1,124 @@
+#include "TableDirectory.h"
+
+#include "BigEndianReader.h"
+
+#include <algorithm>
+
+namespace {
+    const size_t OFFSET_TABLE_SIZE = 12;
+    const size_t TABLE_RECORD_SIZE = 16;
+    const size_t COLLECTION_HEADER_SIZE = 12;
+}
+
+// --------------------------------------------------------------------------
+
+TableDirectory::TableDirectory()
+    : header{0, 0, 0, 0, 0},
+      out_of_bounds_entry_count(0) {
+}
+
+// --------------------------------------------------------------------------
+
+bool TableDirectory::read(const Uint8* data, size_t size, size_t offset_table_location) {
+    header = {0, 0, 0, 0, 0};
+    entries.clear();
+    out_of_bounds_entry_count = 0;
+
+    if (offset_table_location > size || size - offset_table_location < OFFSET_TABLE_SIZE) {
+        return false;
+    }
+
+    BigEndianReader reader(data, size, offset_table_location);
+    header.scaler_type = reader.read_u32();
+    header.num_tables = reader.read_u16();
+    header.search_range = reader.read_u16();
+    header.entry_selector = reader.read_u16();
+    header.range_shift = reader.read_u16();
+
+    if (size - reader.get_position() < TABLE_RECORD_SIZE * header.num_tables) {
+        header.num_tables = 0;
+        return false;
+    }
+
+    entries.reserve(header.num_tables);
+    for (int i = 0; i < header.num_tables; i++) {
+        Entry entry;
+        entry.tag = reader.read_tag();
+        entry.checksum = reader.read_u32();
+        entry.offset = reader.read_u32();
+        entry.length = reader.read_u32();
+
+        if (entry.offset > size || entry.length > size - entry.offset) {
+            out_of_bounds_entry_count++;
+            continue;
+        }
+
+        entries.push_back(entry);
+    }
+
+    // The spec already asks for ascending tags; sorting here just means a
+    // font that ignores it still looks up correctly.
+    std::stable_sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) {
+        return a.tag < b.tag;
+    });
+
+    return true;
+}
+
+// --------------------------------------------------------------------------
+
+const TableDirectory::Entry* TableDirectory::find(Uint32 tag) const {
+    auto entry = std::lower_bound(entries.begin(), entries.end(), tag, [](const Entry& a, Uint32 tag) {
+        return a.tag < tag;
+    });
+
+    return entry != entries.end() && entry->tag == tag ? &*entry : nullptr;
+}
+
+// --------------------------------------------------------------------------
+
+const TableDirectory::Header& TableDirectory::get_header() const {
+    return header;
+}
+
+// --------------------------------------------------------------------------
+
+const std::vector<TableDirectory::Entry>& TableDirectory::get_entries() const {
+    return entries;
+}
+
+// --------------------------------------------------------------------------
+
+size_t TableDirectory::get_out_of_bounds_entry_count() const {
+    return out_of_bounds_entry_count;
+}
+
+// --------------------------------------------------------------------------
+
+std::vector<Uint32> TableDirectory::read_face_offsets(const Uint8* data, size_t size) {
+    std::vector<Uint32> face_offsets;
+    if (data == nullptr || size < 4) {
+        return face_offsets;
+    }
+
+    BigEndianReader reader(data, size);
+    if (reader.peek_u32(0) != TableTag::TTCF) {
+        face_offsets.push_back(0);
+        return face_offsets;
+    }
+
+    // Collection header: tag, version, face count, then one offset per face.
+    if (size < COLLECTION_HEADER_SIZE) {
+        return face_offsets;
+    }
+
+    Uint32 face_count = reader.peek_u32(8);
+    if ((size - COLLECTION_HEADER_SIZE) / 4 < face_count) {
+        return face_offsets;
+    }
+
+    face_offsets.resize(face_count);
+    reader.seek(COLLECTION_HEADER_SIZE);
+    reader.read_u32_array(face_offsets.data(), face_count);
+    return face_offsets;
+}
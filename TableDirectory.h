@@ -0,0 +1,81 @@
+#ifndef TABLE_DIRECTORY_H
+#define TABLE_DIRECTORY_H
+
+#include <SDL3/SDL.h>
+#include <cstddef>
+#include <vector>
+
+// Table tags as they read big-endian out of the file, so 'glyf' is 0x676C7966.
+constexpr Uint32 make_table_tag(char a, char b, char c, char d) {
+    return
+        (static_cast<Uint32>(static_cast<Uint8>(a)) << 24) |
+        (static_cast<Uint32>(static_cast<Uint8>(b)) << 16) |
+        (static_cast<Uint32>(static_cast<Uint8>(c)) << 8) |
+        static_cast<Uint32>(static_cast<Uint8>(d))
+    ;
+}
+
+namespace TableTag {
+    constexpr Uint32 CMAP = make_table_tag('c', 'm', 'a', 'p');
+    constexpr Uint32 CVT = make_table_tag('c', 'v', 't', ' ');
+    constexpr Uint32 FPGM = make_table_tag('f', 'p', 'g', 'm');
+    constexpr Uint32 GLYF = make_table_tag('g', 'l', 'y', 'f');
+    constexpr Uint32 HEAD = make_table_tag('h', 'e', 'a', 'd');
+    constexpr Uint32 HHEA = make_table_tag('h', 'h', 'e', 'a');
+    constexpr Uint32 HMTX = make_table_tag('h', 'm', 't', 'x');
+    constexpr Uint32 KERN = make_table_tag('k', 'e', 'r', 'n');
+    constexpr Uint32 LOCA = make_table_tag('l', 'o', 'c', 'a');
+    constexpr Uint32 MAXP = make_table_tag('m', 'a', 'x', 'p');
+    constexpr Uint32 OS2 = make_table_tag('O', 'S', '/', '2');
+    constexpr Uint32 PREP = make_table_tag('p', 'r', 'e', 'p');
+    constexpr Uint32 TTCF = make_table_tag('t', 't', 'c', 'f');
+}
+
+// One face's table directory, held as a flat array sorted by tag with each
+// table's offset and length, and searched by binary search.
+class TableDirectory {
+
+public:
+
+    struct Header {
+        Uint32 scaler_type;
+        Uint16 num_tables;
+        Uint16 search_range;
+        Uint16 entry_selector;
+        Uint16 range_shift;
+    };
+
+    struct Entry {
+        Uint32 tag;
+        Uint32 checksum;
+        Uint32 offset;
+        Uint32 length;
+    };
+
+    TableDirectory();
+
+    // Read the offset table at offset_table_location. Returns false if the
+    // offset table and its records don't fit in the data. Tables that run
+    // past the end of the data are left out and counted instead.
+    bool read(const Uint8* data, size_t size, size_t offset_table_location);
+
+    // Null if the face has no such table.
+    const Entry* find(Uint32 tag) const;
+
+    const Header& get_header() const;
+    const std::vector<Entry>& get_entries() const;
+    size_t get_out_of_bounds_entry_count() const;
+
+    // Where each face's offset table starts: the offsets from a 'ttcf'
+    // collection header, or just 0 for a single font. Empty if the collection
+    // header doesn't fit in the data.
+    static std::vector<Uint32> read_face_offsets(const Uint8* data, size_t size);
+
+private:
+
+    Header header;
+    std::vector<Entry> entries;
+    size_t out_of_bounds_entry_count;
+};
+
+#endif
@@ -0,0 +1,193 @@
+#include "TextLayout.h"
+
+#include <algorithm>
+#include <functional>
+#include <utility>
+
+#include "Profiler.h"
+
+namespace {
+    const float FLATTEN_TOLERANCE = 0.25f;
+}
+
+// --------------------------------------------------------------------------
+
+size_t TextLayout::KeyHash::operator()(const Key& key) const {
+    size_t text_hash = std::hash<std::string>()(key.text);
+    size_t size_hash = std::hash<float>()(key.pixel_size);
+    return text_hash ^ (size_hash + 0x9E3779B97F4A7C15ull + (text_hash << 6) + (text_hash >> 2));
+}
+
+// --------------------------------------------------------------------------
+
+TextLayout::TextLayout(Font& font, size_t capacity)
+    : font(font),
+      capacity(std::max<size_t>(capacity, 1)),
+      hit_count(0),
+      miss_count(0),
+      glyph_shapes_pixel_size(0.0f) {
+}
+
+// --------------------------------------------------------------------------
+
+std::shared_ptr<const GlyphRun> TextLayout::shape(const std::string& text, float pixel_size) {
+    Key key = {text, pixel_size};
+
+    auto entry = entries.find(key);
+    if (entry != entries.end()) {
+        hit_count++;
+        lru_order.splice(lru_order.begin(), lru_order, entry->second.lru_position);
+        return entry->second.run;
+    }
+
+    miss_count++;
+
+    std::shared_ptr<GlyphRun> run = std::make_shared<GlyphRun>();
+    shape_uncached(text, pixel_size, *run);
+
+    if (entries.size() >= capacity) {
+        entries.erase(lru_order.back());
+        lru_order.pop_back();
+    }
+
+    lru_order.push_front(key);
+    Entry& new_entry = entries[std::move(key)];
+    new_entry.run = run;
+    new_entry.lru_position = lru_order.begin();
+
+    return run;
+}
+
+// --------------------------------------------------------------------------
+
+void TextLayout::shape_uncached(const std::string& text, float pixel_size, GlyphRun& run) {
+    float scale = font.get_units_per_em() > 0 ? pixel_size / font.get_units_per_em() : 0.0f;
+    float ascent = font.get_ascender() * scale;
+
+    run.glyphs.clear();
+    run.pixel_size = pixel_size;
+    run.ascent = ascent;
+    run.line_height = (font.get_ascender() - font.get_descender() + font.get_line_gap()) * scale;
+    run.width = 0.0f;
+
+    float pen_x = 0.0f;
+    float baseline = ascent;
+
+    // Map each line on its own so that kerning never reaches across a line
+    // break.
+    size_t line_start = 0;
+    while (true) {
+        size_t line_end = text.find('\n', line_start);
+        size_t line_length = (line_end == std::string::npos ? text.size() : line_end) - line_start;
+
+        glyph_indices.resize(line_length);
+        size_t glyph_count = font.get_character_map().map_utf8(text.data() + line_start, line_length, glyph_indices.data());
+
+        pen_x = 0.0f;
+        Sint32 pen_units = 0;
+        for (size_t i = 0; i < glyph_count; i++) {
+            Uint16 glyph_index = glyph_indices[i];
+            Sint32 advance_units = font.get_advance_width(glyph_index);
+            if (i + 1 < glyph_count) {
+                advance_units += font.get_kerning(glyph_index, glyph_indices[i + 1]);
+            }
+
+            // Accumulate in font units so rounding never builds up along the
+            // line.
+            PositionedGlyph glyph;
+            glyph.glyph_index = glyph_index;
+            glyph.x = pen_units * scale;
+            glyph.y = baseline;
+            glyph.advance = advance_units * scale;
+            run.glyphs.push_back(glyph);
+
+            pen_units += advance_units;
+        }
+
+        pen_x = pen_units * scale;
+        run.width = std::max(run.width, pen_x);
+
+        if (line_end == std::string::npos) {
+            break;
+        }
+
+        line_start = line_end + 1;
+        baseline += run.line_height;
+    }
+
+    run.end_x = pen_x;
+    run.end_y = baseline;
+    run.height = baseline - ascent + run.line_height;
+}
+
+// --------------------------------------------------------------------------
+
+const FlattenedOutline& TextLayout::get_glyph_shape(Uint16 glyph_index, float pixel_size) {
+    if (pixel_size != glyph_shapes_pixel_size) {
+        glyph_shapes.clear();
+        glyph_shapes_pixel_size = pixel_size;
+    }
+
+    auto found = glyph_shapes.find(glyph_index);
+    if (found != glyph_shapes.end()) {
+        return found->second;
+    }
+
+    FlattenedOutline& shape = glyph_shapes[glyph_index];
+
+    Glyph glyph = font.get_glyph(glyph_index);
+    glyph_outline.compile(glyph);
+
+    float width = glyph_outline.max_extents.x - glyph_outline.min_extents.x;
+    float height = glyph_outline.max_extents.y - glyph_outline.min_extents.y;
+    if (glyph_outline.verbs.empty() || width <= 0.0f || height <= 0.0f || font.get_units_per_em() == 0) {
+        return shape;
+    }
+
+    // The left side bearing places the outline's left edge relative to the
+    // pen, and y is up from the baseline.
+    float scale = pixel_size / font.get_units_per_em();
+    SDL_FRect glyph_render_bounds;
+    glyph_render_bounds.x = font.get_left_side_bearing(glyph_index) * scale;
+    glyph_render_bounds.y = -glyph_outline.max_extents.y * scale;
+    glyph_render_bounds.w = width * scale + 1;
+    glyph_render_bounds.h = height * scale + 1;
+
+    flatten_glyph_contours(glyph_outline, glyph_render_bounds, FLATTEN_TOLERANCE, shape);
+    return shape;
+}
+
+// --------------------------------------------------------------------------
+
+void TextLayout::draw(DrawList& draw_list, const GlyphRun& run, float x, float y, const SDL_Color& color) {
+    PROFILE_SCOPE(DRAW_TEXT);
+
+    for (const PositionedGlyph& glyph : run.glyphs) {
+        const FlattenedOutline& shape = get_glyph_shape(glyph.glyph_index, run.pixel_size);
+        PROFILE_COUNT(SEGMENTS, shape.get_segment_count());
+
+        size_t contour_start = 0;
+        for (size_t contour_end : shape.contour_ends) {
+            draw_list.add_polyline(shape.points.data() + contour_start, contour_end - contour_start, x + glyph.x, y + glyph.y, color);
+            contour_start = contour_end;
+        }
+    }
+}
+
+// --------------------------------------------------------------------------
+
+Uint64 TextLayout::get_hit_count() const {
+    return hit_count;
+}
+
+// --------------------------------------------------------------------------
+
+Uint64 TextLayout::get_miss_count() const {
+    return miss_count;
+}
+
+// --------------------------------------------------------------------------
+
+size_t TextLayout::get_cached_run_count() const {
+    return entries.size();
+}
@@ -0,0 +1,102 @@
+#ifndef TEXT_LAYOUT_H
+#define TEXT_LAYOUT_H
+
+#include <SDL3/SDL.h>
+#include <list>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "DrawList.h"
+#include "Font.h"
+#include "GlyphDrawing.h"
+#include "GlyphOutline.h"
+
+// A glyph placed on a line. x is the pen position and y the baseline, both in
+// pixels from the top left of the run.
+struct PositionedGlyph {
+    Uint16 glyph_index;
+    float x;
+    float y;
+    float advance;
+};
+
+struct GlyphRun {
+    std::vector<PositionedGlyph> glyphs;
+    float pixel_size;
+    float width;
+    float height;
+    float line_height;
+
+    // Distance from the top of a line down to its baseline.
+    float ascent;
+
+    // Pen position just after the last glyph, where a caret would go.
+    float end_x;
+    float end_y;
+};
+
+// Turns UTF-8 strings into positioned glyph runs using the font's advance
+// widths and pair kerning. Shaped runs are kept in a bounded LRU cache keyed
+// by (text, pixel size), so laying out the same label again is one hash
+// lookup. Runs are handed out as shared pointers and stay valid after
+// eviction.
+class TextLayout {
+
+public:
+
+    TextLayout(Font& font, size_t capacity);
+
+    std::shared_ptr<const GlyphRun> shape(const std::string& text, float pixel_size);
+
+    // Lay out without touching the cache.
+    void shape_uncached(const std::string& text, float pixel_size, GlyphRun& run);
+
+    // Outline every glyph of run with its top left corner at (x, y).
+    void draw(DrawList& draw_list, const GlyphRun& run, float x, float y, const SDL_Color& color);
+
+    Uint64 get_hit_count() const;
+    Uint64 get_miss_count() const;
+    size_t get_cached_run_count() const;
+
+private:
+
+    struct Key {
+        std::string text;
+        float pixel_size;
+
+        bool operator==(const Key& other) const {
+            return pixel_size == other.pixel_size && text == other.text;
+        }
+    };
+
+    struct KeyHash {
+        size_t operator()(const Key& key) const;
+    };
+
+    struct Entry {
+        std::shared_ptr<const GlyphRun> run;
+        std::list<Key>::iterator lru_position;
+    };
+
+    Font& font;
+    size_t capacity;
+
+    std::unordered_map<Key, Entry, KeyHash> entries;
+    std::list<Key> lru_order;
+    Uint64 hit_count;
+    Uint64 miss_count;
+
+    std::vector<Uint16> glyph_indices;
+
+    // Flattened outlines relative to the pen position on the baseline, for
+    // glyph_shapes_pixel_size only.
+    std::unordered_map<Uint16, FlattenedOutline> glyph_shapes;
+    float glyph_shapes_pixel_size;
+    GlyphOutline glyph_outline;
+
+    const FlattenedOutline& get_glyph_shape(Uint16 glyph_index, float pixel_size);
+};
+
+#endif
@@ -0,0 +1,206 @@
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <utility>
+
+namespace {
+    // Lets submit() push onto the calling worker's own queue, which keeps
+    // follow-up work on the thread that produced it.
+    thread_local const ThreadPool* current_pool = nullptr;
+    thread_local int current_worker_index = -1;
+}
+
+ThreadPool::ThreadPool(int thread_count)
+    : queued_job_count(0),
+      next_queue_index(0),
+      is_stopping(false) {
+    if (thread_count <= 0) {
+        thread_count = static_cast<int>(std::thread::hardware_concurrency());
+    }
+
+    if (thread_count <= 0) {
+        thread_count = 1;
+    }
+
+    for (int i = 0; i < thread_count; i++) {
+        queues.push_back(std::make_unique<WorkerQueue>());
+    }
+
+    for (int i = 0; i < thread_count; i++) {
+        workers.emplace_back(&ThreadPool::run_worker, this, i);
+    }
+}
+
+// --------------------------------------------------------------------------
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(sleep_mutex);
+        is_stopping = true;
+    }
+
+    sleep_condition.notify_all();
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+}
+
+// --------------------------------------------------------------------------
+
+int ThreadPool::get_thread_count() const {
+    return static_cast<int>(workers.size());
+}
+
+// --------------------------------------------------------------------------
+
+void ThreadPool::submit(std::function<void()> job) {
+    size_t queue_index;
+    if (current_pool == this) {
+        queue_index = current_worker_index;
+    } else {
+        queue_index = next_queue_index++ % queues.size();
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(queues[queue_index]->mutex);
+        queues[queue_index]->jobs.push_back(std::move(job));
+    }
+
+    {
+        // Taking the sleep mutex orders the count update against a worker
+        // that is about to go to sleep, so the wakeup can't be missed.
+        std::lock_guard<std::mutex> lock(sleep_mutex);
+        queued_job_count++;
+    }
+
+    sleep_condition.notify_one();
+}
+
+// --------------------------------------------------------------------------
+
+bool ThreadPool::try_pop_job(int worker_index, std::function<void()>& job) {
+    int queue_count = static_cast<int>(queues.size());
+
+    {
+        WorkerQueue& own_queue = *queues[worker_index];
+        std::lock_guard<std::mutex> lock(own_queue.mutex);
+        if (!own_queue.jobs.empty()) {
+            job = std::move(own_queue.jobs.back());
+            own_queue.jobs.pop_back();
+            queued_job_count--;
+            return true;
+        }
+    }
+
+    for (int i = 1; i < queue_count; i++) {
+        int victim_index = (worker_index + i) % queue_count;
+
+        WorkerQueue& victim_queue = *queues[victim_index];
+        std::lock_guard<std::mutex> lock(victim_queue.mutex);
+        if (!victim_queue.jobs.empty()) {
+            job = std::move(victim_queue.jobs.front());
+            victim_queue.jobs.pop_front();
+            queued_job_count--;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+// --------------------------------------------------------------------------
+
+void ThreadPool::run_worker(int worker_index) {
+    current_pool = this;
+    current_worker_index = worker_index;
+
+    while (true) {
+        std::function<void()> job;
+        if (try_pop_job(worker_index, job)) {
+            job();
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(sleep_mutex);
+        sleep_condition.wait(lock, [&] {
+            return is_stopping || queued_job_count > 0;
+        });
+
+        if (is_stopping && queued_job_count == 0) {
+            return;
+        }
+    }
+}
+
+// --------------------------------------------------------------------------
+
+void ThreadPool::parallel_for(size_t count, size_t chunk_size, const std::function<void(size_t begin, size_t end)>& task) {
+    if (count == 0) {
+        return;
+    }
+
+    if (chunk_size == 0) {
+        chunk_size = 1;
+    }
+
+    // Chunks are claimed from a shared counter rather than queued one by
+    // one, so the calling thread can help with its own chunks without
+    // picking up unrelated jobs. Jobs that only start once every chunk has
+    // been claimed find nothing to do, and by then the call may have
+    // returned, so what they touch lives on the heap.
+    struct ParallelFor {
+        std::atomic<size_t> next_chunk_index;
+        size_t chunk_count;
+        size_t count;
+        size_t chunk_size;
+        const std::function<void(size_t begin, size_t end)>* task;
+
+        std::mutex done_mutex;
+        std::condition_variable done_condition;
+        size_t remaining_chunk_count;
+    };
+
+    std::shared_ptr<ParallelFor> state = std::make_shared<ParallelFor>();
+    state->next_chunk_index = 0;
+    state->chunk_count = (count + chunk_size - 1) / chunk_size;
+    state->count = count;
+    state->chunk_size = chunk_size;
+    state->task = &task;
+    state->remaining_chunk_count = state->chunk_count;
+
+    auto run_chunks = [](ParallelFor& state) {
+        while (true) {
+            size_t chunk_index = state.next_chunk_index++;
+            if (chunk_index >= state.chunk_count) {
+                return;
+            }
+
+            size_t begin = chunk_index * state.chunk_size;
+            size_t end = begin + state.chunk_size < state.count ? begin + state.chunk_size : state.count;
+            (*state.task)(begin, end);
+
+            std::lock_guard<std::mutex> lock(state.done_mutex);
+            state.remaining_chunk_count--;
+            if (state.remaining_chunk_count == 0) {
+                state.done_condition.notify_all();
+            }
+        }
+    };
+
+    // The calling thread takes chunks too, so one job fewer than there are
+    // chunks is enough to keep every worker busy.
+    size_t job_count = std::min(state->chunk_count - 1, workers.size());
+    for (size_t i = 0; i < job_count; i++) {
+        submit([state, run_chunks] {
+            run_chunks(*state);
+        });
+    }
+
+    run_chunks(*state);
+
+    // Nothing left to claim; the remaining chunks are running elsewhere.
+    std::unique_lock<std::mutex> lock(state->done_mutex);
+    state->done_condition.wait(lock, [&] {
+        return state->remaining_chunk_count == 0;
+    });
+}
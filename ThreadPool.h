@@ -0,0 +1,59 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed-size pool of worker threads. Each worker has its own job queue: it
+// takes new work from the back of its own queue and, once that is empty,
+// steals from the front of the other workers' queues.
+class ThreadPool {
+
+public:
+
+    // A thread_count of 0 uses one worker per hardware thread.
+    explicit ThreadPool(int thread_count = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    int get_thread_count() const;
+
+    void submit(std::function<void()> job);
+
+    // Split [0, count) into chunks of chunk_size and run task(begin, end) on
+    // them across the pool. Blocks until every chunk has finished; the calling
+    // thread runs chunks too while it waits, so nested calls are fine. It
+    // only ever runs this call's chunks, never other jobs on the pool, so a
+    // long job submitted elsewhere can't stall the caller.
+    void parallel_for(size_t count, size_t chunk_size, const std::function<void(size_t begin, size_t end)>& task);
+
+private:
+
+    struct WorkerQueue {
+        std::mutex mutex;
+        std::deque<std::function<void()>> jobs;
+    };
+
+    std::vector<std::unique_ptr<WorkerQueue>> queues;
+    std::vector<std::thread> workers;
+
+    std::mutex sleep_mutex;
+    std::condition_variable sleep_condition;
+    std::atomic<size_t> queued_job_count;
+    std::atomic<size_t> next_queue_index;
+    bool is_stopping;
+
+    bool try_pop_job(int worker_index, std::function<void()>& job);
+    void run_worker(int worker_index);
+};
+
+#endif
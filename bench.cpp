@@ -0,0 +1,1399 @@
+// Headless benchmark of the parse -> flatten -> draw pipeline. Build it with
+// `make bench` and run
+//
+//     ttf-viewer-bench TTF_FONT_FILE [--render] [--rasterize] [--atlas PIXELS] [--grid] [--tiled] [--cmap] [--shape] [--face N] [--faces] [--database] [--components] [--outline-cache] [--glyph-cache] [--navigate] [--hint] [--check-allocations] [--size PIXELS] [--tolerance PIXELS] [--iterations N]
+//
+// Every glyph is decoded with Font::get_glyph, compiled into a GlyphOutline
+// and flattened the same way the CONTOURS draw mode does it. With --render it
+// is also drawn through a DrawList into an offscreen SDL software surface,
+// and with --rasterize it is filled by the GlyphRasterizer at 16, 48 and 256
+// pixels. --atlas builds a GlyphAtlas at the given size and times writing it
+// to a disk cache and loading it back. --grid scrolls a GlyphGridView from the
+// first glyph to the last at a steady speed and times each frame. --tiled
+// fills a sample of glyphs fitted to 500x500, 2560x1440 and 3840x2160 frames
+// with GlyphRasterizer::rasterize_tiled on thread pools of 1 up to one
+// worker per hardware thread, next to a single rasterize() call over the
+// whole frame. --cmap converts generated ASCII, CJK and emoji-heavy text to
+// glyph indices through the font's CharacterMap, from both UTF-8 and UTF-32.
+// --shape lays out generated ASCII labels with TextLayout, once bypassing the
+// shaping cache and once as repeated lookups of labels already in it.
+// --face picks the face of a TrueType collection to benchmark, and --faces
+// compares opening the file with just its first face against opening every
+// face in it. --database builds an OutlineDatabase of every glyph on thread
+// pools of 1 up to one worker per hardware thread, next to decoding them one
+// after another on a single thread. --components decodes every glyph with
+// the font's component cache on, starting empty each pass, and with it off.
+// --outline-cache builds an OutlineCache and compares getting
+// the first glyph ready straight from the font (cold) with mapping the cache
+// back in (warm). --glyph-cache steps through the glyphs in order through a
+// GlyphCache with prefetching, once with a budget far smaller than the font
+// and once with one it fits in, and counts hits, misses and evictions.
+// --navigate posts a step to the next glyph every 60 Hz frame straight to
+// the loader, faster than the viewer navigates since it ignores key repeat,
+// starting from a cold glyph cache: once decoding each
+// glyph on the frame thread and once through a GlyphLoader, drawing whatever
+// glyph is ready in CONTOURS mode either way, and times each frame. --hint
+// runs the font's fpgm and prep at 9, 12, 16, 24 and 48 pixels and then
+// loads every glyph at each size through a GlyphHinter, hinted and not.
+// --check-allocations decodes every glyph twice before anything else runs and
+// exits with status 1 if the second, warm pass allocates at all.
+// Every run also times the validation pass FontFile runs when it opens a file.
+// Results go to stdout as one JSON object.
+
+#include <SDL3/SDL.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sys/resource.h>
+#include <time.h>
+
+#include "DrawList.h"
+#include "Font.h"
+#include "FontValidation.h"
+#include "GlyphAtlas.h"
+#include "GlyphDrawing.h"
+#include "GlyphCache.h"
+#include "GlyphGridView.h"
+#include "GlyphHinter.h"
+#include "GlyphLoader.h"
+#include "GlyphOutline.h"
+#include "GlyphRasterizer.h"
+#include "OutlineCache.h"
+#include "OutlineDatabase.h"
+#include "TextLayout.h"
+#include "ThreadPool.h"
+
+namespace {
+    std::atomic<Uint64> allocation_count(0);
+    std::atomic<Uint64> allocated_bytes(0);
+
+    // Every replaced operator new allocates here and every operator delete
+    // frees with std::free, so each pair matches.
+    void* counted_malloc(size_t size) {
+        allocation_count.fetch_add(1, std::memory_order_relaxed);
+        allocated_bytes.fetch_add(size, std::memory_order_relaxed);
+        return std::malloc(size == 0 ? 1 : size);
+    }
+
+    void* counted_malloc_or_throw(size_t size) {
+        void* memory = counted_malloc(size);
+        if (memory == nullptr) {
+            throw std::bad_alloc();
+        }
+
+        return memory;
+    }
+}
+
+void* operator new(size_t size) {
+    return counted_malloc_or_throw(size);
+}
+
+void* operator new[](size_t size) {
+    return counted_malloc_or_throw(size);
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+    return counted_malloc(size);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept {
+    return counted_malloc(size);
+}
+
+void operator delete(void* memory) noexcept {
+    std::free(memory);
+}
+
+void operator delete[](void* memory) noexcept {
+    std::free(memory);
+}
+
+void operator delete(void* memory, size_t) noexcept {
+    std::free(memory);
+}
+
+void operator delete[](void* memory, size_t) noexcept {
+    std::free(memory);
+}
+
+void operator delete(void* memory, const std::nothrow_t&) noexcept {
+    std::free(memory);
+}
+
+void operator delete[](void* memory, const std::nothrow_t&) noexcept {
+    std::free(memory);
+}
+
+// --------------------------------------------------------------------------
+
+struct StageResult {
+    std::vector<double> samples_ns;
+    Uint64 allocations = 0;
+    Uint64 segments = 0;
+    Uint64 renderer_calls = 0;
+    Uint64 pixels = 0;
+};
+
+// Optional per-stage fields for write_stage_json.
+enum StageFields {
+    STAGE_SEGMENTS = 1 << 0,
+    STAGE_RENDERER_CALLS = 1 << 1,
+    STAGE_THROUGHPUT = 1 << 2,
+};
+
+const int RASTERIZE_SIZES[] = {16, 48, 256};
+const int RASTERIZE_SIZE_COUNT = sizeof(RASTERIZE_SIZES) / sizeof(RASTERIZE_SIZES[0]);
+
+// Matches the viewer's grid; the scroll speed is a brisk 2880 px/s at 60 Hz.
+const int GRID_CELL_SIZE = 64;
+const int GRID_SCROLL_PIXELS_PER_FRAME = 48;
+const double FRAME_BUDGET_NS = 1e9 / 60.0;
+
+struct FrameSize {
+    int width;
+    int height;
+};
+
+const FrameSize TILED_FRAME_SIZES[] = {{500, 500}, {2560, 1440}, {3840, 2160}};
+const int TILED_FRAME_SIZE_COUNT = sizeof(TILED_FRAME_SIZES) / sizeof(TILED_FRAME_SIZES[0]);
+const int TILED_SAMPLE_GLYPH_COUNT = 64;
+
+enum TextKind {
+    ASCII_TEXT,
+    CJK_TEXT,
+    EMOJI_TEXT,
+    TEXT_KIND_COUNT,
+};
+
+const char* const TEXT_KIND_NAMES[TEXT_KIND_COUNT] = {"ascii", "cjk", "emoji"};
+const size_t CMAP_TEXT_CODEPOINT_COUNT = 1 << 20;
+const int CMAP_PASSES = 8;
+
+const int VALIDATION_PASSES = 8;
+
+const int FACE_OPEN_PASSES = 16;
+
+const int OUTLINE_CACHE_PASSES = 16;
+
+const int DATABASE_PASSES = 4;
+
+const int COMPONENT_CACHE_PASSES = 4;
+
+// Each step asks for the next glyph and prefetches after it, then leaves the
+// prefetcher a millisecond before the next step.
+const int GLYPH_CACHE_STEPS = 200;
+const int GLYPH_CACHE_PREFETCH_DISTANCE = 8;
+const size_t GLYPH_CACHE_BUDGETS[] = {8 * 1024, 16 * 1024 * 1024};
+const int GLYPH_CACHE_BUDGET_COUNT = sizeof(GLYPH_CACHE_BUDGETS) / sizeof(GLYPH_CACHE_BUDGETS[0]);
+const auto GLYPH_CACHE_STEP_INTERVAL = std::chrono::milliseconds(1);
+
+// Four seconds of one step per frame.
+const int NAVIGATE_FRAME_COUNT = 240;
+
+enum NavigateMode {
+    NAVIGATE_SYNCHRONOUS,
+    NAVIGATE_ASYNCHRONOUS,
+    NAVIGATE_MODE_COUNT,
+};
+
+const char* const NAVIGATE_MODE_NAMES[NAVIGATE_MODE_COUNT] = {"synchronous", "asynchronous"};
+
+const size_t SHAPE_TEXT_CODEPOINT_COUNT = 1 << 18;
+const size_t SHAPE_LABEL_LENGTH = 32;
+const size_t SHAPE_CACHED_LABEL_COUNT = 256;
+const int SHAPE_CACHED_PASSES = 64;
+const float SHAPE_PIXEL_SIZE = 16.0f;
+
+const int HINT_SIZES[] = {9, 12, 16, 24, 48};
+const int HINT_SIZE_COUNT = sizeof(HINT_SIZES) / sizeof(HINT_SIZES[0]);
+
+// --------------------------------------------------------------------------
+
+double nanoseconds_since(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+}
+
+// --------------------------------------------------------------------------
+
+// CPU time the calling thread has used, which unlike wall time doesn't count
+// time spent preempted by other threads.
+double get_thread_cpu_ns() {
+    struct timespec time;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &time);
+    return time.tv_sec * 1e9 + time.tv_nsec;
+}
+
+// --------------------------------------------------------------------------
+
+double percentile(const std::vector<double>& sorted_samples, double fraction) {
+    if (sorted_samples.empty()) {
+        return 0.0;
+    }
+
+    size_t index = static_cast<size_t>(fraction * (sorted_samples.size() - 1) + 0.5);
+    return sorted_samples[index];
+}
+
+// --------------------------------------------------------------------------
+
+long get_peak_rss_bytes() {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+
+#ifdef __APPLE__
+    return usage.ru_maxrss;
+#else
+    return usage.ru_maxrss * 1024L;
+#endif
+}
+
+// --------------------------------------------------------------------------
+
+std::string escape_json(const std::string& text) {
+    std::string escaped;
+    for (char c : text) {
+        if (c == '"' || c == '\\') {
+            escaped += '\\';
+            escaped += c;
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            char code[8];
+            std::snprintf(code, sizeof(code), "\\u%04x", c);
+            escaped += code;
+        } else {
+            escaped += c;
+        }
+    }
+
+    return escaped;
+}
+
+// --------------------------------------------------------------------------
+
+void append_utf8(Uint32 codepoint, std::string& text) {
+    if (codepoint < 0x80) {
+        text += static_cast<char>(codepoint);
+    } else if (codepoint < 0x800) {
+        text += static_cast<char>(0xC0 | (codepoint >> 6));
+        text += static_cast<char>(0x80 | (codepoint & 0x3F));
+    } else if (codepoint < 0x10000) {
+        text += static_cast<char>(0xE0 | (codepoint >> 12));
+        text += static_cast<char>(0x80 | ((codepoint >> 6) & 0x3F));
+        text += static_cast<char>(0x80 | (codepoint & 0x3F));
+    } else {
+        text += static_cast<char>(0xF0 | (codepoint >> 18));
+        text += static_cast<char>(0x80 | ((codepoint >> 12) & 0x3F));
+        text += static_cast<char>(0x80 | ((codepoint >> 6) & 0x3F));
+        text += static_cast<char>(0x80 | (codepoint & 0x3F));
+    }
+}
+
+// --------------------------------------------------------------------------
+
+// Deterministic pseudo-random text: printable ASCII with plenty of spaces,
+// CJK ideographs with the odd ideographic punctuation mark, or emoji mixed
+// with zero-width joiners, variation selectors and spaces.
+void generate_text(TextKind kind, size_t codepoint_count, std::vector<Uint32>& codepoints) {
+    Uint32 state = 0x2545F491;
+    auto next_random = [&state](Uint32 range) {
+        state = state * 1664525u + 1013904223u;
+        return (state >> 8) % range;
+    };
+
+    codepoints.clear();
+    for (size_t i = 0; i < codepoint_count; i++) {
+        Uint32 roll = next_random(100);
+        Uint32 codepoint;
+        if (kind == TextKind::ASCII_TEXT) {
+            codepoint = roll < 15 ? ' ' : 0x21 + next_random(0x7E - 0x21 + 1);
+        } else if (kind == TextKind::CJK_TEXT) {
+            codepoint = roll < 8 ? 0x3001 + next_random(2) : 0x4E00 + next_random(0x9FFF - 0x4E00 + 1);
+        } else if (roll < 50) {
+            codepoint = 0x1F300 + next_random(0x1F64F - 0x1F300 + 1);
+        } else if (roll < 70) {
+            codepoint = 0x1F900 + next_random(0x1F9FF - 0x1F900 + 1);
+        } else if (roll < 80) {
+            codepoint = 0x200D;
+        } else if (roll < 90) {
+            codepoint = 0xFE0F;
+        } else {
+            codepoint = ' ';
+        }
+
+        codepoints.push_back(codepoint);
+    }
+}
+
+// --------------------------------------------------------------------------
+
+void write_stage_json(std::ostream& out, const std::string& name, StageResult& stage, size_t glyph_samples, int fields) {
+    std::vector<double> sorted_samples = stage.samples_ns;
+    std::sort(sorted_samples.begin(), sorted_samples.end());
+
+    double total_ns = 0.0;
+    for (double sample : sorted_samples) {
+        total_ns += sample;
+    }
+
+    double per_glyph = glyph_samples > 0 ? 1.0 / glyph_samples : 0.0;
+
+    out << "    \"" << name << "\": {\n";
+    out << "      \"mean_ns_per_glyph\": " << total_ns * per_glyph << ",\n";
+    out << "      \"p50_ns\": " << percentile(sorted_samples, 0.50) << ",\n";
+    out << "      \"p90_ns\": " << percentile(sorted_samples, 0.90) << ",\n";
+    out << "      \"p99_ns\": " << percentile(sorted_samples, 0.99) << ",\n";
+    out << "      \"max_ns\": " << (sorted_samples.empty() ? 0.0 : sorted_samples.back()) << ",\n";
+    if (fields & STAGE_SEGMENTS) {
+        out << "      \"segments_per_glyph\": " << stage.segments * per_glyph << ",\n";
+    }
+    if (fields & STAGE_RENDERER_CALLS) {
+        out << "      \"renderer_calls_per_glyph\": " << stage.renderer_calls * per_glyph << ",\n";
+    }
+    if (fields & STAGE_THROUGHPUT) {
+        double seconds = total_ns / 1e9;
+        out << "      \"glyphs_per_second\": " << (seconds > 0.0 ? glyph_samples / seconds : 0.0) << ",\n";
+        out << "      \"megapixels_per_second\": " << (seconds > 0.0 ? stage.pixels / 1e6 / seconds : 0.0) << ",\n";
+    }
+    out << "      \"allocations_per_glyph\": " << stage.allocations * per_glyph << "\n";
+    out << "    }";
+}
+
+// --------------------------------------------------------------------------
+
+int main(int argc, char** argv) {
+    std::string font_file_name;
+    bool should_render = false;
+    bool should_rasterize = false;
+    bool should_scroll_grid = false;
+    bool should_rasterize_tiled = false;
+    bool should_map_text = false;
+    bool should_shape_text = false;
+    bool should_open_faces = false;
+    bool should_build_database = false;
+    bool should_compare_component_cache = false;
+    bool should_cache_outlines = false;
+    bool should_cache_glyphs = false;
+    bool should_navigate = false;
+    bool should_hint = false;
+    bool should_check_allocations = false;
+    int face_index = 0;
+    int atlas_size = 0;
+    int window_size = 500;
+    float tolerance = 0.25f;
+    int iterations = 1;
+
+    for (int i = 1; i < argc; i++) {
+        std::string argument = argv[i];
+        if (argument == "--render") {
+            should_render = true;
+        } else if (argument == "--rasterize") {
+            should_rasterize = true;
+        } else if (argument == "--atlas" && i + 1 < argc) {
+            atlas_size = std::atoi(argv[++i]);
+        } else if (argument == "--grid") {
+            should_scroll_grid = true;
+        } else if (argument == "--tiled") {
+            should_rasterize_tiled = true;
+        } else if (argument == "--cmap") {
+            should_map_text = true;
+        } else if (argument == "--shape") {
+            should_shape_text = true;
+        } else if (argument == "--face" && i + 1 < argc) {
+            face_index = std::atoi(argv[++i]);
+        } else if (argument == "--faces") {
+            should_open_faces = true;
+        } else if (argument == "--database") {
+            should_build_database = true;
+        } else if (argument == "--components") {
+            should_compare_component_cache = true;
+        } else if (argument == "--outline-cache") {
+            should_cache_outlines = true;
+        } else if (argument == "--glyph-cache") {
+            should_cache_glyphs = true;
+        } else if (argument == "--navigate") {
+            should_navigate = true;
+        } else if (argument == "--hint") {
+            should_hint = true;
+        } else if (argument == "--check-allocations") {
+            should_check_allocations = true;
+        } else if (argument == "--size" && i + 1 < argc) {
+            window_size = std::atoi(argv[++i]);
+        } else if (argument == "--tolerance" && i + 1 < argc) {
+            tolerance = static_cast<float>(std::atof(argv[++i]));
+        } else if (argument == "--iterations" && i + 1 < argc) {
+            iterations = std::atoi(argv[++i]);
+        } else if (font_file_name.empty()) {
+            font_file_name = argument;
+        } else {
+            font_file_name.clear();
+            break;
+        }
+    }
+
+    if (font_file_name.empty() || face_index < 0 || window_size <= 0 || tolerance <= 0.0f || iterations <= 0) {
+        std::cerr << "Usage: " << argv[0] << " TTF_FONT_FILE [--render] [--rasterize] [--atlas PIXELS] [--grid] [--tiled] [--cmap] [--shape] [--face N] [--faces] [--database] [--components] [--outline-cache] [--glyph-cache] [--navigate] [--hint] [--check-allocations] [--size PIXELS] [--tolerance PIXELS] [--iterations N]" << std::endl;
+        return 1;
+    }
+
+    const int padding = 20;
+
+    // Font prints its table directory while loading; keep stdout for JSON.
+    std::stringstream discarded_output;
+    std::streambuf* stdout_buffer = std::cout.rdbuf(discarded_output.rdbuf());
+
+    Uint64 allocations_before_load = allocation_count.load();
+    auto load_start = std::chrono::steady_clock::now();
+    Font font(FontFile::open(font_file_name), face_index);
+    double load_ns = nanoseconds_since(load_start);
+    Uint64 load_allocations = allocation_count.load() - allocations_before_load;
+
+    std::cout.rdbuf(stdout_buffer);
+
+    // Validation on its own, over the same bytes Font checked while loading.
+    std::ifstream font_file(font_file_name, std::ifstream::binary);
+    std::vector<Uint8> font_file_contents((std::istreambuf_iterator<char>(font_file)), std::istreambuf_iterator<char>());
+    std::vector<FontValidationReport> validation_reports;
+    auto validation_start = std::chrono::steady_clock::now();
+    for (int pass = 0; pass < VALIDATION_PASSES * iterations; pass++) {
+        validation_reports = validate_font_file(font_file_contents.data(), font_file_contents.size());
+    }
+    double validation_ns = nanoseconds_since(validation_start) / (VALIDATION_PASSES * iterations);
+    double font_file_megabytes = font_file_contents.size() / 1048576.0;
+    FontValidationReport validation_report;
+    if (face_index < static_cast<int>(validation_reports.size())) {
+        validation_report = validation_reports[face_index];
+    }
+
+    Uint16 glyph_count = font.get_glyph_count();
+    size_t glyph_samples = static_cast<size_t>(glyph_count) * iterations;
+
+    // Decoding recycles the arena blocks and scratch buffers the cold pass
+    // set up, so once every glyph has been decoded once, decoding them
+    // again shouldn't touch the heap.
+    Uint64 cold_decode_allocations = 0;
+    Uint64 warm_decode_allocations = 0;
+    if (should_check_allocations) {
+        for (int pass = 0; pass < 2; pass++) {
+            Uint64 allocations_before = allocation_count.load();
+            for (Uint32 glyph_index = 0; glyph_index < glyph_count; glyph_index++) {
+                Glyph glyph = font.get_glyph(static_cast<Uint16>(glyph_index));
+            }
+
+            Uint64 pass_allocations = allocation_count.load() - allocations_before;
+            (pass == 0 ? cold_decode_allocations : warm_decode_allocations) = pass_allocations;
+        }
+    }
+
+    StageResult decode_stage;
+    StageResult compile_stage;
+    StageResult flatten_stage;
+    StageResult render_stage;
+    decode_stage.samples_ns.reserve(glyph_samples);
+    compile_stage.samples_ns.reserve(glyph_samples);
+    flatten_stage.samples_ns.reserve(glyph_samples);
+
+    SDL_Surface* surface = nullptr;
+    SDL_Renderer* renderer = nullptr;
+    if (should_render || should_scroll_grid) {
+        surface = SDL_CreateSurface(window_size, window_size, SDL_PIXELFORMAT_XRGB8888);
+        renderer = surface != nullptr ? SDL_CreateSoftwareRenderer(surface) : nullptr;
+        if (renderer == nullptr) {
+            std::cerr << "[ERROR] Could not create software renderer: " << SDL_GetError() << std::endl;
+            return 1;
+        }
+
+    }
+
+    if (should_render) {
+        render_stage.samples_ns.reserve(glyph_samples);
+    }
+
+    GlyphOutline glyph_outline;
+    FlattenedOutline outline;
+    GlyphRasterizer rasterizer;
+    std::vector<Uint8> coverage;
+    StageResult rasterize_stages[RASTERIZE_SIZE_COUNT];
+    DrawList draw_list;
+    const SDL_Color glyph_color = {255, 255, 255, 255};
+
+    for (int iteration = 0; iteration < iterations; iteration++) {
+        for (Uint32 glyph_index = 0; glyph_index < glyph_count; glyph_index++) {
+            Uint64 allocations_before = allocation_count.load();
+            auto decode_start = std::chrono::steady_clock::now();
+            Glyph glyph = font.get_glyph(static_cast<Uint16>(glyph_index));
+            decode_stage.samples_ns.push_back(nanoseconds_since(decode_start));
+            decode_stage.allocations += allocation_count.load() - allocations_before;
+
+            allocations_before = allocation_count.load();
+            auto compile_start = std::chrono::steady_clock::now();
+            glyph_outline.compile(glyph);
+            compile_stage.samples_ns.push_back(nanoseconds_since(compile_start));
+            compile_stage.allocations += allocation_count.load() - allocations_before;
+
+            allocations_before = allocation_count.load();
+            auto flatten_start = std::chrono::steady_clock::now();
+            SDL_FRect glyph_render_bounds;
+            calculate_glyph_render_bounds(glyph_outline, window_size, window_size, padding, glyph_render_bounds);
+            outline.clear();
+            flatten_glyph_contours(glyph_outline, glyph_render_bounds, tolerance, outline);
+            flatten_stage.samples_ns.push_back(nanoseconds_since(flatten_start));
+            flatten_stage.allocations += allocation_count.load() - allocations_before;
+            flatten_stage.segments += outline.get_segment_count();
+
+            if (should_render) {
+                allocations_before = allocation_count.load();
+                auto render_start = std::chrono::steady_clock::now();
+                SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
+                SDL_RenderClear(renderer);
+                draw_list.clear();
+                draw_glyph_contours(draw_list, glyph_outline, window_size, window_size, padding, tolerance, glyph_color);
+                draw_list.submit(renderer);
+                SDL_RenderPresent(renderer);
+                render_stage.samples_ns.push_back(nanoseconds_since(render_start));
+                render_stage.allocations += allocation_count.load() - allocations_before;
+                render_stage.renderer_calls += draw_list.get_renderer_call_count();
+            }
+
+            if (should_rasterize) {
+                for (int size_index = 0; size_index < RASTERIZE_SIZE_COUNT; size_index++) {
+                    int size = RASTERIZE_SIZES[size_index];
+                    StageResult& stage = rasterize_stages[size_index];
+
+                    SDL_FRect bounds;
+                    calculate_glyph_render_bounds(glyph_outline, size, size, 0, bounds);
+                    outline.clear();
+                    flatten_glyph_contours(glyph_outline, bounds, tolerance, outline);
+
+                    int bitmap_width = static_cast<int>(std::ceil(bounds.w));
+                    int bitmap_height = static_cast<int>(std::ceil(bounds.h));
+                    if (outline.points.empty()) {
+                        bitmap_width = 0;
+                        bitmap_height = 0;
+                    }
+
+                    allocations_before = allocation_count.load();
+                    auto rasterize_start = std::chrono::steady_clock::now();
+                    rasterizer.rasterize(outline, std::floor(bounds.x), std::floor(bounds.y), bitmap_width, bitmap_height, coverage);
+                    stage.samples_ns.push_back(nanoseconds_since(rasterize_start));
+                    stage.allocations += allocation_count.load() - allocations_before;
+                    stage.pixels += static_cast<Uint64>(bitmap_width) * bitmap_height;
+                }
+            }
+        }
+    }
+
+    // One frame per sample; the cell counts are totals over every frame.
+    StageResult grid_stage;
+    Uint64 grid_cells_decoded = 0;
+    Uint64 grid_cells_drawn = 0;
+    int max_grid_cells_decoded_per_frame = 0;
+    if (should_scroll_grid) {
+        GlyphGridView grid_view(font, GRID_CELL_SIZE);
+        grid_view.set_viewport_size(window_size, window_size);
+
+        int column_count = grid_view.get_column_count();
+        int row_count = (glyph_count + column_count - 1) / column_count;
+        int scroll_distance = std::max(0, row_count * GRID_CELL_SIZE - window_size);
+        int frame_count = scroll_distance / GRID_SCROLL_PIXELS_PER_FRAME + 1;
+        grid_stage.samples_ns.reserve(frame_count);
+
+        for (int frame = 0; frame < frame_count; frame++) {
+            Uint64 allocations_before = allocation_count.load();
+            auto frame_start = std::chrono::steady_clock::now();
+            SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
+            SDL_RenderClear(renderer);
+            draw_list.clear();
+            grid_view.draw(draw_list, 0, glyph_color, OFF_CURVE_POINT_COLOR);
+            draw_list.submit(renderer);
+            SDL_RenderPresent(renderer);
+            grid_stage.samples_ns.push_back(nanoseconds_since(frame_start));
+            grid_stage.allocations += allocation_count.load() - allocations_before;
+            grid_stage.renderer_calls += draw_list.get_renderer_call_count();
+
+            grid_cells_decoded += grid_view.get_cells_decoded();
+            grid_cells_drawn += grid_view.get_cells_drawn();
+            max_grid_cells_decoded_per_frame = std::max(max_grid_cells_decoded_per_frame, grid_view.get_cells_decoded());
+
+            grid_view.scroll_by(static_cast<float>(GRID_SCROLL_PIXELS_PER_FRAME));
+        }
+    }
+
+    // Mean ns per frame: one untiled entry per frame size, then one entry per
+    // frame size and pool size.
+    std::vector<int> tiled_thread_counts;
+    double untiled_frame_ns[TILED_FRAME_SIZE_COUNT] = {};
+    std::vector<double> tiled_frame_ns;
+    int tiled_glyph_count = 0;
+    if (should_rasterize_tiled) {
+        int hardware_thread_count = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+        for (int thread_count = 1; thread_count < hardware_thread_count; thread_count *= 2) {
+            tiled_thread_counts.push_back(thread_count);
+        }
+        tiled_thread_counts.push_back(hardware_thread_count);
+        tiled_frame_ns.assign(TILED_FRAME_SIZE_COUNT * tiled_thread_counts.size(), 0.0);
+
+        std::vector<Uint16> sample_glyph_indices;
+        int glyph_step = std::max(1, glyph_count / TILED_SAMPLE_GLYPH_COUNT);
+        for (int glyph_index = 0; glyph_index < glyph_count && static_cast<int>(sample_glyph_indices.size()) < TILED_SAMPLE_GLYPH_COUNT; glyph_index += glyph_step) {
+            sample_glyph_indices.push_back(static_cast<Uint16>(glyph_index));
+        }
+        tiled_glyph_count = static_cast<int>(sample_glyph_indices.size());
+
+        for (size_t pool_index = 0; pool_index < tiled_thread_counts.size(); pool_index++) {
+            ThreadPool thread_pool(tiled_thread_counts[pool_index]);
+
+            for (int size_index = 0; size_index < TILED_FRAME_SIZE_COUNT; size_index++) {
+                const FrameSize& frame_size = TILED_FRAME_SIZES[size_index];
+
+                for (Uint16 glyph_index : sample_glyph_indices) {
+                    Glyph glyph = font.get_glyph(glyph_index);
+                    glyph_outline.compile(glyph);
+
+                    SDL_FRect glyph_render_bounds;
+                    calculate_glyph_render_bounds(glyph_outline, frame_size.width, frame_size.height, padding, glyph_render_bounds);
+                    outline.clear();
+                    flatten_glyph_contours(glyph_outline, glyph_render_bounds, tolerance, outline);
+
+                    for (int iteration = 0; iteration < iterations; iteration++) {
+                        if (pool_index == 0) {
+                            auto untiled_start = std::chrono::steady_clock::now();
+                            rasterizer.rasterize(outline, 0.0f, 0.0f, frame_size.width, frame_size.height, coverage);
+                            untiled_frame_ns[size_index] += nanoseconds_since(untiled_start);
+                        }
+
+                        auto tiled_start = std::chrono::steady_clock::now();
+                        rasterizer.rasterize_tiled(outline, 0.0f, 0.0f, frame_size.width, frame_size.height, thread_pool, coverage);
+                        tiled_frame_ns[size_index * tiled_thread_counts.size() + pool_index] += nanoseconds_since(tiled_start);
+                    }
+                }
+            }
+        }
+
+        double frames_per_size = static_cast<double>(tiled_glyph_count) * iterations;
+        for (double& frame_ns : untiled_frame_ns) {
+            frame_ns /= frames_per_size;
+        }
+        for (double& frame_ns : tiled_frame_ns) {
+            frame_ns /= frames_per_size;
+        }
+    }
+
+    // Codepoints per second through each path, and the share that mapped to
+    // a real glyph.
+    double utf8_lookups_per_second[TEXT_KIND_COUNT] = {};
+    double utf32_lookups_per_second[TEXT_KIND_COUNT] = {};
+    double mapped_fraction[TEXT_KIND_COUNT] = {};
+    size_t utf8_bytes[TEXT_KIND_COUNT] = {};
+    if (should_map_text) {
+        const CharacterMap& character_map = font.get_character_map();
+        std::vector<Uint32> codepoints;
+        std::string utf8_text;
+        std::vector<Uint16> glyph_indices(CMAP_TEXT_CODEPOINT_COUNT);
+
+        for (int kind = 0; kind < TEXT_KIND_COUNT; kind++) {
+            generate_text(static_cast<TextKind>(kind), CMAP_TEXT_CODEPOINT_COUNT, codepoints);
+            utf8_text.clear();
+            for (Uint32 codepoint : codepoints) {
+                append_utf8(codepoint, utf8_text);
+            }
+            utf8_bytes[kind] = utf8_text.size();
+            glyph_indices.resize(std::max(utf8_text.size(), codepoints.size()));
+
+            int pass_count = CMAP_PASSES * iterations;
+            double utf8_ns = 0.0;
+            double utf32_ns = 0.0;
+            size_t mapped_count = 0;
+            for (int pass = 0; pass < pass_count; pass++) {
+                auto utf8_start = std::chrono::steady_clock::now();
+                size_t glyph_index_count = character_map.map_utf8(utf8_text.data(), utf8_text.size(), glyph_indices.data());
+                utf8_ns += nanoseconds_since(utf8_start);
+
+                auto utf32_start = std::chrono::steady_clock::now();
+                character_map.map_utf32(codepoints.data(), codepoints.size(), glyph_indices.data());
+                utf32_ns += nanoseconds_since(utf32_start);
+
+                if (pass == 0) {
+                    mapped_count = glyph_index_count - std::count(glyph_indices.begin(), glyph_indices.begin() + glyph_index_count, 0);
+                }
+            }
+
+            double lookup_count = static_cast<double>(codepoints.size()) * pass_count;
+            utf8_lookups_per_second[kind] = utf8_ns > 0.0 ? lookup_count / (utf8_ns / 1e9) : 0.0;
+            utf32_lookups_per_second[kind] = utf32_ns > 0.0 ? lookup_count / (utf32_ns / 1e9) : 0.0;
+            mapped_fraction[kind] = static_cast<double>(mapped_count) / codepoints.size();
+        }
+    }
+
+    // Uncached shaping covers cmap lookup, advances and kerning for every
+    // label; cached shaping is the hash lookup a repeated label costs.
+    double uncached_glyphs_per_second = 0.0;
+    double cached_runs_per_second = 0.0;
+    double cached_glyphs_per_second = 0.0;
+    size_t shape_label_count = 0;
+    if (should_shape_text) {
+        std::vector<Uint32> codepoints;
+        generate_text(TextKind::ASCII_TEXT, SHAPE_TEXT_CODEPOINT_COUNT, codepoints);
+
+        std::vector<std::string> labels(SHAPE_TEXT_CODEPOINT_COUNT / SHAPE_LABEL_LENGTH);
+        for (size_t i = 0; i < codepoints.size(); i++) {
+            append_utf8(codepoints[i], labels[i / SHAPE_LABEL_LENGTH]);
+        }
+        shape_label_count = labels.size();
+
+        TextLayout text_layout(font, SHAPE_CACHED_LABEL_COUNT);
+        GlyphRun run;
+        size_t shaped_glyph_count = 0;
+        auto uncached_start = std::chrono::steady_clock::now();
+        for (int iteration = 0; iteration < iterations; iteration++) {
+            for (const std::string& label : labels) {
+                text_layout.shape_uncached(label, SHAPE_PIXEL_SIZE, run);
+                shaped_glyph_count += run.glyphs.size();
+            }
+        }
+        double uncached_ns = nanoseconds_since(uncached_start);
+        uncached_glyphs_per_second = uncached_ns > 0.0 ? shaped_glyph_count / (uncached_ns / 1e9) : 0.0;
+
+        size_t cached_label_count = std::min(SHAPE_CACHED_LABEL_COUNT, labels.size());
+        for (size_t i = 0; i < cached_label_count; i++) {
+            text_layout.shape(labels[i], SHAPE_PIXEL_SIZE);
+        }
+
+        size_t cached_run_count = 0;
+        size_t cached_glyph_count = 0;
+        auto cached_start = std::chrono::steady_clock::now();
+        for (int pass = 0; pass < SHAPE_CACHED_PASSES * iterations; pass++) {
+            for (size_t i = 0; i < cached_label_count; i++) {
+                cached_glyph_count += text_layout.shape(labels[i], SHAPE_PIXEL_SIZE)->glyphs.size();
+                cached_run_count++;
+            }
+        }
+        double cached_ns = nanoseconds_since(cached_start);
+        cached_runs_per_second = cached_ns > 0.0 ? cached_run_count / (cached_ns / 1e9) : 0.0;
+        cached_glyphs_per_second = cached_ns > 0.0 ? cached_glyph_count / (cached_ns / 1e9) : 0.0;
+    }
+
+    // Opening a collection with every face against opening it with just the
+    // first one; faces that share tables should only add their own directory
+    // and loca on top of that.
+    int file_face_count = 0;
+    StageResult first_face_stage;
+    StageResult all_faces_stage;
+    Uint64 first_face_bytes = 0;
+    Uint64 all_faces_bytes = 0;
+    if (should_open_faces) {
+        stdout_buffer = std::cout.rdbuf(discarded_output.rdbuf());
+
+        for (int pass = 0; pass < FACE_OPEN_PASSES * iterations; pass++) {
+            Uint64 allocations_before = allocation_count.load();
+            Uint64 bytes_before = allocated_bytes.load();
+            auto start = std::chrono::steady_clock::now();
+            {
+                Font first_face(FontFile::open(font_file_name), 0);
+            }
+            first_face_stage.samples_ns.push_back(nanoseconds_since(start));
+            first_face_stage.allocations += allocation_count.load() - allocations_before;
+            first_face_bytes += allocated_bytes.load() - bytes_before;
+
+            allocations_before = allocation_count.load();
+            bytes_before = allocated_bytes.load();
+            start = std::chrono::steady_clock::now();
+            {
+                std::shared_ptr<FontFile> file = FontFile::open(font_file_name);
+                file_face_count = file != nullptr ? file->get_face_count() : 0;
+
+                std::vector<std::unique_ptr<Font>> faces;
+                for (int i = 0; i < file_face_count; i++) {
+                    faces.emplace_back(new Font(file, i));
+                }
+            }
+            all_faces_stage.samples_ns.push_back(nanoseconds_since(start));
+            all_faces_stage.allocations += allocation_count.load() - allocations_before;
+            all_faces_bytes += allocated_bytes.load() - bytes_before;
+        }
+
+        std::cout.rdbuf(stdout_buffer);
+    }
+
+    // The whole font decoded into an OutlineDatabase, against the same glyphs
+    // decoded one at a time on this thread. The calling thread runs chunks
+    // too while it waits, so a pool of N workers decodes on N + 1 threads.
+    std::vector<int> database_thread_counts;
+    std::vector<double> database_build_ns;
+    double serial_decode_ns = 0.0;
+    size_t database_bytes = 0;
+    if (should_build_database && glyph_count > 0) {
+        int hardware_thread_count = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+        for (int thread_count = 1; thread_count < hardware_thread_count; thread_count *= 2) {
+            database_thread_counts.push_back(thread_count);
+        }
+        database_thread_counts.push_back(hardware_thread_count);
+
+        int pass_count = DATABASE_PASSES * iterations;
+        auto serial_start = std::chrono::steady_clock::now();
+        for (int pass = 0; pass < pass_count; pass++) {
+            for (Uint32 glyph_index = 0; glyph_index < glyph_count; glyph_index++) {
+                Glyph glyph = font.get_glyph(static_cast<Uint16>(glyph_index));
+            }
+        }
+        serial_decode_ns = nanoseconds_since(serial_start) / pass_count;
+
+        for (int thread_count : database_thread_counts) {
+            ThreadPool thread_pool(thread_count);
+
+            auto build_start = std::chrono::steady_clock::now();
+            for (int pass = 0; pass < pass_count; pass++) {
+                std::shared_ptr<const OutlineDatabase> database = OutlineDatabase::build(font, thread_pool);
+                database_bytes = database->get_memory_size();
+            }
+            database_build_ns.push_back(nanoseconds_since(build_start) / pass_count);
+        }
+    }
+
+    // Turning the component cache off and on again empties it, so every pass
+    // with it on pays for the first decode of each component once.
+    double component_cache_ns[2] = {};
+    Uint64 component_cache_allocations[2] = {};
+    Uint64 component_cache_hits = 0;
+    Uint64 component_cache_misses = 0;
+    if (should_compare_component_cache && glyph_count > 0) {
+        int pass_count = COMPONENT_CACHE_PASSES * iterations;
+        Uint64 hits_before = font.get_component_cache_hit_count();
+        Uint64 misses_before = font.get_component_cache_miss_count();
+
+        for (int is_cached = 0; is_cached < 2; is_cached++) {
+            for (int pass = 0; pass < pass_count; pass++) {
+                font.set_component_cache_enabled(false);
+                font.set_component_cache_enabled(is_cached != 0);
+
+                Uint64 allocations_before = allocation_count.load();
+                auto start = std::chrono::steady_clock::now();
+                for (Uint32 glyph_index = 0; glyph_index < glyph_count; glyph_index++) {
+                    Glyph glyph = font.get_glyph(static_cast<Uint16>(glyph_index));
+                }
+                component_cache_ns[is_cached] += nanoseconds_since(start) / pass_count;
+                component_cache_allocations[is_cached] += allocation_count.load() - allocations_before;
+            }
+        }
+
+        component_cache_hits = (font.get_component_cache_hit_count() - hits_before) / pass_count;
+        component_cache_misses = (font.get_component_cache_miss_count() - misses_before) / pass_count;
+        font.set_component_cache_enabled(true);
+    }
+
+    // Cold is everything the viewer does before it can draw glyph 0 without a
+    // cache: open and validate the file, parse the face, decode and compile
+    // the glyph. Warm maps the file only to read its cache key from the
+    // table directories, maps the cache and copies glyph 0 out of it.
+    std::vector<double> cold_start_samples;
+    std::vector<double> warm_start_samples;
+    double outline_cache_build_ns = 0.0;
+    double outline_cache_save_ns = 0.0;
+    size_t outline_cache_bytes = 0;
+    bool was_outline_cache_loaded = false;
+    if (should_cache_outlines && font.get_file() != nullptr) {
+        ThreadPool thread_pool;
+        std::error_code error;
+        std::filesystem::path cache_directory = std::filesystem::temp_directory_path(error) / "ttf-viewer-bench";
+        std::filesystem::create_directories(cache_directory, error);
+        std::string cache_file_name = OutlineCache::get_cache_file_name(cache_directory.string(), font.get_file()->get_cache_key(), face_index);
+
+        auto build_start = std::chrono::steady_clock::now();
+        std::shared_ptr<const OutlineCache> outline_cache = OutlineCache::build(font, thread_pool);
+        outline_cache_build_ns = nanoseconds_since(build_start);
+        outline_cache_bytes = outline_cache->get_file_size();
+
+        auto save_start = std::chrono::steady_clock::now();
+        outline_cache->save(cache_file_name);
+        outline_cache_save_ns = nanoseconds_since(save_start);
+
+        stdout_buffer = std::cout.rdbuf(discarded_output.rdbuf());
+
+        GlyphOutline outline;
+        for (int pass = 0; pass < OUTLINE_CACHE_PASSES * iterations; pass++) {
+            auto cold_start = std::chrono::steady_clock::now();
+            {
+                Font cold_font(FontFile::open(font_file_name), face_index);
+                Glyph glyph = cold_font.get_glyph(0);
+                outline.compile(glyph);
+            }
+            cold_start_samples.push_back(nanoseconds_since(cold_start));
+
+            auto warm_start = std::chrono::steady_clock::now();
+            {
+                std::shared_ptr<FontFile> file = FontFile::open(font_file_name);
+                std::shared_ptr<const OutlineCache> loaded_cache = file != nullptr ? OutlineCache::load(cache_file_name, file->get_cache_key(), face_index) : nullptr;
+                OutlineView points;
+                was_outline_cache_loaded =
+                    loaded_cache != nullptr &&
+                    loaded_cache->find_outline(0, points) &&
+                    loaded_cache->find_compiled_outline(0, outline);
+            }
+            warm_start_samples.push_back(nanoseconds_since(warm_start));
+        }
+
+        std::cout.rdbuf(stdout_buffer);
+
+        std::sort(cold_start_samples.begin(), cold_start_samples.end());
+        std::sort(warm_start_samples.begin(), warm_start_samples.end());
+        std::filesystem::remove(cache_file_name, error);
+    }
+
+    // The small budget holds only a few glyphs, so every prefetched glyph has
+    // to displace one already shown; prefetching should still turn almost
+    // every step into a hit.
+    Uint64 glyph_cache_hits[GLYPH_CACHE_BUDGET_COUNT] = {};
+    Uint64 glyph_cache_misses[GLYPH_CACHE_BUDGET_COUNT] = {};
+    Uint64 glyph_cache_evictions[GLYPH_CACHE_BUDGET_COUNT] = {};
+    size_t glyph_cache_memory_usage[GLYPH_CACHE_BUDGET_COUNT] = {};
+    int glyph_cache_steps = std::min(GLYPH_CACHE_STEPS, static_cast<int>(glyph_count));
+    if (should_cache_glyphs && glyph_count > 0) {
+        for (int budget_index = 0; budget_index < GLYPH_CACHE_BUDGET_COUNT; budget_index++) {
+            GlyphCache glyph_cache(font, GLYPH_CACHE_BUDGETS[budget_index], GLYPH_CACHE_PREFETCH_DISTANCE);
+            for (int step = 0; step < glyph_cache_steps; step++) {
+                glyph_cache.prefetch(static_cast<Uint16>(step), 1);
+                glyph_cache.get_glyph(static_cast<Uint16>(step));
+                std::this_thread::sleep_for(GLYPH_CACHE_STEP_INTERVAL);
+            }
+
+            glyph_cache_hits[budget_index] = glyph_cache.get_hit_count();
+            glyph_cache_misses[budget_index] = glyph_cache.get_miss_count();
+            glyph_cache_evictions[budget_index] = glyph_cache.get_eviction_count();
+            glyph_cache_memory_usage[budget_index] = glyph_cache.get_memory_usage();
+        }
+    }
+
+    // The frame is what the viewer does between waking up and presenting:
+    // get the next glyph (or just ask for it) and build the draw list for
+    // whichever glyph is ready. Frames are paced at 60 Hz so the loader gets
+    // the time between them that it would get in the viewer. Wall time per
+    // frame depends on whether the workers have cores of their own, so the
+    // frame thread's own CPU time is recorded too, as is how many glyphs the
+    // one on screen trails the one navigated to.
+    StageResult navigate_stages[NAVIGATE_MODE_COUNT];
+    std::vector<double> navigate_cpu_samples[NAVIGATE_MODE_COUNT];
+    std::vector<double> navigate_glyph_cpu_samples[NAVIGATE_MODE_COUNT];
+    Uint64 navigate_glyphs_behind[NAVIGATE_MODE_COUNT] = {};
+    Uint64 navigate_cancelled_count = 0;
+    Uint64 navigate_skipped_count = 0;
+    if (should_navigate && glyph_count > 0) {
+        ThreadPool thread_pool;
+        int frame_count = NAVIGATE_FRAME_COUNT * iterations;
+        auto frame_interval = std::chrono::nanoseconds(static_cast<Sint64>(FRAME_BUDGET_NS));
+
+        for (int mode = 0; mode < NAVIGATE_MODE_COUNT; mode++) {
+            StageResult& stage = navigate_stages[mode];
+            stage.samples_ns.reserve(frame_count);
+            navigate_cpu_samples[mode].reserve(frame_count);
+            navigate_glyph_cpu_samples[mode].reserve(frame_count);
+
+            GlyphCache glyph_cache(font, 16 * 1024 * 1024, 16);
+            GlyphLoader glyph_loader(glyph_cache, nullptr, thread_pool, nullptr);
+            Uint16 glyph_index = 0;
+            std::unique_ptr<GlyphLoader::LoadedGlyph> shown_glyph = glyph_loader.load(glyph_index);
+
+            auto next_frame = std::chrono::steady_clock::now();
+            for (int frame = 0; frame < frame_count; frame++) {
+                std::this_thread::sleep_until(next_frame);
+                next_frame += frame_interval;
+
+                auto frame_start = std::chrono::steady_clock::now();
+                double frame_start_cpu_ns = get_thread_cpu_ns();
+                glyph_index = static_cast<Uint16>((glyph_index + 1) % glyph_count);
+                if (mode == NAVIGATE_SYNCHRONOUS) {
+                    shown_glyph = glyph_loader.load(glyph_index);
+                } else {
+                    glyph_loader.request(glyph_index, 1);
+                    std::unique_ptr<GlyphLoader::LoadedGlyph> loaded_glyph = glyph_loader.take_ready();
+                    if (loaded_glyph != nullptr) {
+                        shown_glyph = std::move(loaded_glyph);
+                    }
+                }
+                navigate_glyph_cpu_samples[mode].push_back(get_thread_cpu_ns() - frame_start_cpu_ns);
+
+                draw_list.clear();
+                draw_glyph_contours(draw_list, shown_glyph->outline, window_size, window_size, padding, tolerance, glyph_color);
+                navigate_cpu_samples[mode].push_back(get_thread_cpu_ns() - frame_start_cpu_ns);
+                stage.samples_ns.push_back(nanoseconds_since(frame_start));
+
+                navigate_glyphs_behind[mode] += (glyph_index - shown_glyph->glyph_index + glyph_count) % glyph_count;
+            }
+
+            if (mode == NAVIGATE_ASYNCHRONOUS) {
+                navigate_cancelled_count = glyph_loader.get_cancelled_count();
+                navigate_skipped_count = glyph_loader.get_skipped_count();
+            }
+
+            std::sort(stage.samples_ns.begin(), stage.samples_ns.end());
+            std::sort(navigate_cpu_samples[mode].begin(), navigate_cpu_samples[mode].end());
+            std::sort(navigate_glyph_cpu_samples[mode].begin(), navigate_glyph_cpu_samples[mode].end());
+        }
+    }
+
+    // Each size gets a fresh hinter so preparing it runs fpgm and prep from
+    // scratch; the glyph passes after it only run glyph programs. The
+    // unhinted pass scales the same points without running anything, which
+    // is the floor hinting adds to.
+    double hint_prepare_ns[HINT_SIZE_COUNT] = {};
+    bool is_hint_size_enabled[HINT_SIZE_COUNT] = {};
+    StageResult hinted_stages[HINT_SIZE_COUNT];
+    StageResult unhinted_stages[HINT_SIZE_COUNT];
+    Uint64 hinted_glyph_counts[HINT_SIZE_COUNT] = {};
+    Uint64 failed_program_counts[HINT_SIZE_COUNT] = {};
+    bool has_hinting_instructions = false;
+    if (should_hint) {
+        HintedGlyph hinted_glyph;
+        for (int size_index = 0; size_index < HINT_SIZE_COUNT; size_index++) {
+            int pixel_size = HINT_SIZES[size_index];
+            GlyphHinter hinter(font);
+            has_hinting_instructions = hinter.has_instructions();
+
+            auto prepare_start = std::chrono::steady_clock::now();
+            is_hint_size_enabled[size_index] = hinter.prepare_size(pixel_size);
+            hint_prepare_ns[size_index] = nanoseconds_since(prepare_start);
+
+            for (int pass = 0; pass < 2; pass++) {
+                bool is_hinted_pass = pass == 0;
+                StageResult& stage = is_hinted_pass ? hinted_stages[size_index] : unhinted_stages[size_index];
+                stage.samples_ns.reserve(glyph_samples);
+
+                for (int iteration = 0; iteration < iterations; iteration++) {
+                    for (Uint32 glyph_index = 0; glyph_index < glyph_count; glyph_index++) {
+                        Uint64 allocations_before = allocation_count.load();
+                        auto start = std::chrono::steady_clock::now();
+                        bool was_hinted = hinter.load_glyph(static_cast<Uint16>(glyph_index), pixel_size, is_hinted_pass, hinted_glyph);
+                        stage.samples_ns.push_back(nanoseconds_since(start));
+                        stage.allocations += allocation_count.load() - allocations_before;
+
+                        if (is_hinted_pass && was_hinted && iteration == 0) {
+                            hinted_glyph_counts[size_index]++;
+                        }
+                    }
+                }
+            }
+
+            failed_program_counts[size_index] = hinter.get_failed_program_count();
+        }
+    }
+
+    if (renderer != nullptr) {
+        SDL_DestroyRenderer(renderer);
+        SDL_DestroySurface(surface);
+    }
+
+    std::shared_ptr<const GlyphAtlas> atlas;
+    double atlas_build_ns = 0.0;
+    double atlas_save_ns = 0.0;
+    double atlas_load_ns = 0.0;
+    bool was_atlas_loaded = false;
+    if (atlas_size > 0) {
+        ThreadPool thread_pool;
+
+        auto build_start = std::chrono::steady_clock::now();
+        atlas = GlyphAtlas::build(font, thread_pool, atlas_size);
+        atlas_build_ns = nanoseconds_since(build_start);
+
+        std::error_code error;
+        std::filesystem::path cache_directory = std::filesystem::temp_directory_path(error) / "ttf-viewer-bench";
+        std::filesystem::create_directories(cache_directory, error);
+        std::string cache_file_name = GlyphAtlas::get_cache_file_name(cache_directory.string(), font.get_content_hash(), atlas_size);
+
+        auto save_start = std::chrono::steady_clock::now();
+        atlas->save(cache_file_name);
+        atlas_save_ns = nanoseconds_since(save_start);
+
+        auto load_start = std::chrono::steady_clock::now();
+        std::shared_ptr<const GlyphAtlas> loaded_atlas = GlyphAtlas::load(cache_file_name, font.get_content_hash(), atlas_size);
+        atlas_load_ns = nanoseconds_since(load_start);
+        was_atlas_loaded = loaded_atlas != nullptr;
+
+        std::filesystem::remove(cache_file_name, error);
+    }
+
+    std::cout << "{\n";
+    std::cout << "  \"font\": \"" << escape_json(font_file_name) << "\",\n";
+    std::cout << "  \"glyph_count\": " << glyph_count << ",\n";
+    std::cout << "  \"iterations\": " << iterations << ",\n";
+    std::cout << "  \"window_size\": " << window_size << ",\n";
+    std::cout << "  \"tolerance\": " << tolerance << ",\n";
+    std::cout << "  \"load\": {\n";
+    std::cout << "    \"ns\": " << load_ns << ",\n";
+    std::cout << "    \"allocations\": " << load_allocations << "\n";
+    std::cout << "  },\n";
+    std::cout << "  \"validation\": {\n";
+    std::cout << "    \"trusted\": " << (validation_report.is_trusted() ? "true" : "false") << ",\n";
+    std::cout << "    \"checksum_mismatches\": " << validation_report.checksum_mismatch_count << ",\n";
+    std::cout << "    \"invalid_glyphs\": " << validation_report.invalid_glyph_count << ",\n";
+    std::cout << "    \"file_bytes\": " << font_file_contents.size() << ",\n";
+    std::cout << "    \"ns\": " << validation_ns << ",\n";
+    std::cout << "    \"ns_per_mb\": " << (font_file_megabytes > 0.0 ? validation_ns / font_file_megabytes : 0.0) << "\n";
+    std::cout << "  },\n";
+    std::cout << "  \"stages\": {\n";
+    write_stage_json(std::cout, "decode", decode_stage, glyph_samples, 0);
+    std::cout << ",\n";
+    write_stage_json(std::cout, "compile", compile_stage, glyph_samples, 0);
+    std::cout << ",\n";
+    write_stage_json(std::cout, "flatten", flatten_stage, glyph_samples, STAGE_SEGMENTS);
+    if (should_render) {
+        std::cout << ",\n";
+        write_stage_json(std::cout, "render", render_stage, glyph_samples, STAGE_RENDERER_CALLS);
+    }
+    if (should_rasterize) {
+        for (int size_index = 0; size_index < RASTERIZE_SIZE_COUNT; size_index++) {
+            std::cout << ",\n";
+            std::string name = "rasterize_" + std::to_string(RASTERIZE_SIZES[size_index]) + "px";
+            write_stage_json(std::cout, name, rasterize_stages[size_index], glyph_samples, STAGE_THROUGHPUT);
+        }
+    }
+    std::cout << "\n  },\n";
+    if (should_scroll_grid) {
+        std::vector<double> sorted_samples = grid_stage.samples_ns;
+        std::sort(sorted_samples.begin(), sorted_samples.end());
+        size_t frame_count = sorted_samples.size();
+        double per_frame = frame_count > 0 ? 1.0 / frame_count : 0.0;
+        size_t frames_over_budget = sorted_samples.end() - std::upper_bound(sorted_samples.begin(), sorted_samples.end(), FRAME_BUDGET_NS);
+
+        std::cout << "  \"grid\": {\n";
+        std::cout << "    \"cell_size\": " << GRID_CELL_SIZE << ",\n";
+        std::cout << "    \"frames\": " << frame_count << ",\n";
+        std::cout << "    \"p50_frame_ns\": " << percentile(sorted_samples, 0.50) << ",\n";
+        std::cout << "    \"p90_frame_ns\": " << percentile(sorted_samples, 0.90) << ",\n";
+        std::cout << "    \"p99_frame_ns\": " << percentile(sorted_samples, 0.99) << ",\n";
+        std::cout << "    \"max_frame_ns\": " << (sorted_samples.empty() ? 0.0 : sorted_samples.back()) << ",\n";
+        std::cout << "    \"frames_over_60hz_budget\": " << frames_over_budget << ",\n";
+        std::cout << "    \"cells_decoded_per_frame\": " << grid_cells_decoded * per_frame << ",\n";
+        std::cout << "    \"max_cells_decoded_per_frame\": " << max_grid_cells_decoded_per_frame << ",\n";
+        std::cout << "    \"cells_drawn_per_frame\": " << grid_cells_drawn * per_frame << ",\n";
+        std::cout << "    \"renderer_calls_per_frame\": " << grid_stage.renderer_calls * per_frame << ",\n";
+        std::cout << "    \"allocations_per_frame\": " << grid_stage.allocations * per_frame << "\n";
+        std::cout << "  },\n";
+    }
+    if (should_rasterize_tiled) {
+        std::cout << "  \"tiled_rasterize\": {\n";
+        std::cout << "    \"tile_size\": " << GlyphRasterizer::TILE_SIZE << ",\n";
+        std::cout << "    \"sample_glyphs\": " << tiled_glyph_count << ",\n";
+        std::cout << "    \"frames\": [\n";
+        for (int size_index = 0; size_index < TILED_FRAME_SIZE_COUNT; size_index++) {
+            const FrameSize& frame_size = TILED_FRAME_SIZES[size_index];
+            double single_thread_ns = tiled_frame_ns[size_index * tiled_thread_counts.size()];
+
+            std::cout << "      {\n";
+            std::cout << "        \"width\": " << frame_size.width << ",\n";
+            std::cout << "        \"height\": " << frame_size.height << ",\n";
+            std::cout << "        \"untiled_ns_per_frame\": " << untiled_frame_ns[size_index] << ",\n";
+            std::cout << "        \"pools\": [\n";
+            for (size_t pool_index = 0; pool_index < tiled_thread_counts.size(); pool_index++) {
+                double frame_ns = tiled_frame_ns[size_index * tiled_thread_counts.size() + pool_index];
+                std::cout << "          {\"threads\": " << tiled_thread_counts[pool_index];
+                std::cout << ", \"ns_per_frame\": " << frame_ns;
+                std::cout << ", \"speedup\": " << (frame_ns > 0.0 ? single_thread_ns / frame_ns : 0.0) << "}";
+                std::cout << (pool_index + 1 < tiled_thread_counts.size() ? ",\n" : "\n");
+            }
+            std::cout << "        ]\n";
+            std::cout << "      }" << (size_index + 1 < TILED_FRAME_SIZE_COUNT ? ",\n" : "\n");
+        }
+        std::cout << "    ]\n";
+        std::cout << "  },\n";
+    }
+    if (should_map_text) {
+        std::cout << "  \"cmap\": {\n";
+        std::cout << "    \"mapped_codepoints\": " << font.get_character_map().get_mapped_codepoint_count() << ",\n";
+        for (int kind = 0; kind < TEXT_KIND_COUNT; kind++) {
+            std::cout << "    \"" << TEXT_KIND_NAMES[kind] << "\": {\n";
+            std::cout << "      \"codepoints\": " << CMAP_TEXT_CODEPOINT_COUNT << ",\n";
+            std::cout << "      \"utf8_bytes\": " << utf8_bytes[kind] << ",\n";
+            std::cout << "      \"mapped_fraction\": " << mapped_fraction[kind] << ",\n";
+            std::cout << "      \"utf8_lookups_per_second\": " << utf8_lookups_per_second[kind] << ",\n";
+            std::cout << "      \"utf32_lookups_per_second\": " << utf32_lookups_per_second[kind] << "\n";
+            std::cout << "    }" << (kind + 1 < TEXT_KIND_COUNT ? ",\n" : "\n");
+        }
+        std::cout << "  },\n";
+    }
+    if (should_shape_text) {
+        std::cout << "  \"shape\": {\n";
+        std::cout << "    \"kerning_pairs\": " << font.get_kerning_pair_count() << ",\n";
+        std::cout << "    \"pixel_size\": " << SHAPE_PIXEL_SIZE << ",\n";
+        std::cout << "    \"labels\": " << shape_label_count << ",\n";
+        std::cout << "    \"label_codepoints\": " << SHAPE_LABEL_LENGTH << ",\n";
+        std::cout << "    \"uncached_glyphs_per_second\": " << uncached_glyphs_per_second << ",\n";
+        std::cout << "    \"cached_runs_per_second\": " << cached_runs_per_second << ",\n";
+        std::cout << "    \"cached_glyphs_per_second\": " << cached_glyphs_per_second << "\n";
+        std::cout << "  },\n";
+    }
+    if (should_open_faces) {
+        const double per_pass = 1.0 / (FACE_OPEN_PASSES * iterations);
+        std::sort(first_face_stage.samples_ns.begin(), first_face_stage.samples_ns.end());
+        std::sort(all_faces_stage.samples_ns.begin(), all_faces_stage.samples_ns.end());
+        std::cout << "  \"faces\": {\n";
+        std::cout << "    \"count\": " << file_face_count << ",\n";
+        std::cout << "    \"first_face_p50_ns\": " << percentile(first_face_stage.samples_ns, 0.50) << ",\n";
+        std::cout << "    \"first_face_allocations\": " << first_face_stage.allocations * per_pass << ",\n";
+        std::cout << "    \"first_face_bytes\": " << first_face_bytes * per_pass << ",\n";
+        std::cout << "    \"all_faces_p50_ns\": " << percentile(all_faces_stage.samples_ns, 0.50) << ",\n";
+        std::cout << "    \"all_faces_allocations\": " << all_faces_stage.allocations * per_pass << ",\n";
+        std::cout << "    \"all_faces_bytes\": " << all_faces_bytes * per_pass << "\n";
+        std::cout << "  },\n";
+    }
+    if (should_build_database) {
+        std::cout << "  \"database\": {\n";
+        std::cout << "    \"bytes\": " << database_bytes << ",\n";
+        std::cout << "    \"serial_glyphs_per_second\": " << (serial_decode_ns > 0.0 ? glyph_count * 1e9 / serial_decode_ns : 0.0) << ",\n";
+        std::cout << "    \"pools\": [\n";
+        for (size_t pool_index = 0; pool_index < database_thread_counts.size(); pool_index++) {
+            double build_ns = database_build_ns[pool_index];
+            std::cout << "      {\"threads\": " << database_thread_counts[pool_index];
+            std::cout << ", \"build_ns\": " << build_ns;
+            std::cout << ", \"glyphs_per_second\": " << (build_ns > 0.0 ? glyph_count * 1e9 / build_ns : 0.0);
+            std::cout << ", \"speedup\": " << (build_ns > 0.0 ? serial_decode_ns / build_ns : 0.0) << "}";
+            std::cout << (pool_index + 1 < database_thread_counts.size() ? ",\n" : "\n");
+        }
+        std::cout << "    ]\n";
+        std::cout << "  },\n";
+    }
+    if (should_compare_component_cache) {
+        const double per_glyph = glyph_count > 0 ? 1.0 / (static_cast<double>(glyph_count) * COMPONENT_CACHE_PASSES * iterations) : 0.0;
+        std::cout << "  \"components\": {\n";
+        std::cout << "    \"hits_per_pass\": " << component_cache_hits << ",\n";
+        std::cout << "    \"misses_per_pass\": " << component_cache_misses << ",\n";
+        std::cout << "    \"uncached_glyphs_per_second\": " << (component_cache_ns[0] > 0.0 ? glyph_count * 1e9 / component_cache_ns[0] : 0.0) << ",\n";
+        std::cout << "    \"cached_glyphs_per_second\": " << (component_cache_ns[1] > 0.0 ? glyph_count * 1e9 / component_cache_ns[1] : 0.0) << ",\n";
+        std::cout << "    \"uncached_allocations_per_glyph\": " << component_cache_allocations[0] * per_glyph << ",\n";
+        std::cout << "    \"cached_allocations_per_glyph\": " << component_cache_allocations[1] * per_glyph << "\n";
+        std::cout << "  },\n";
+    }
+    if (should_cache_outlines) {
+        std::cout << "  \"outline_cache\": {\n";
+        std::cout << "    \"font_bytes\": " << font_file_contents.size() << ",\n";
+        std::cout << "    \"cache_bytes\": " << outline_cache_bytes << ",\n";
+        std::cout << "    \"cache_to_font_ratio\": " << (font_file_contents.empty() ? 0.0 : static_cast<double>(outline_cache_bytes) / font_file_contents.size()) << ",\n";
+        std::cout << "    \"build_ns\": " << outline_cache_build_ns << ",\n";
+        std::cout << "    \"save_ns\": " << outline_cache_save_ns << ",\n";
+        std::cout << "    \"cold_first_glyph_p50_ns\": " << percentile(cold_start_samples, 0.50) << ",\n";
+        std::cout << "    \"warm_first_glyph_p50_ns\": " << (was_outline_cache_loaded ? percentile(warm_start_samples, 0.50) : -1.0) << "\n";
+        std::cout << "  },\n";
+    }
+    if (should_cache_glyphs) {
+        std::cout << "  \"glyph_cache\": {\n";
+        std::cout << "    \"steps\": " << glyph_cache_steps << ",\n";
+        std::cout << "    \"prefetch_distance\": " << GLYPH_CACHE_PREFETCH_DISTANCE << ",\n";
+        std::cout << "    \"budgets\": [\n";
+        for (int budget_index = 0; budget_index < GLYPH_CACHE_BUDGET_COUNT; budget_index++) {
+            std::cout << "      {\"budget_bytes\": " << GLYPH_CACHE_BUDGETS[budget_index];
+            std::cout << ", \"hits\": " << glyph_cache_hits[budget_index];
+            std::cout << ", \"misses\": " << glyph_cache_misses[budget_index];
+            std::cout << ", \"evictions\": " << glyph_cache_evictions[budget_index];
+            std::cout << ", \"memory_usage_bytes\": " << glyph_cache_memory_usage[budget_index] << "}";
+            std::cout << (budget_index + 1 < GLYPH_CACHE_BUDGET_COUNT ? ",\n" : "\n");
+        }
+        std::cout << "    ]\n";
+        std::cout << "  },\n";
+    }
+    if (should_navigate) {
+        std::cout << "  \"navigate\": {\n";
+        std::cout << "    \"frames\": " << navigate_stages[0].samples_ns.size() << ",\n";
+        for (int mode = 0; mode < NAVIGATE_MODE_COUNT; mode++) {
+            const std::vector<double>& sorted_samples = navigate_stages[mode].samples_ns;
+            const std::vector<double>& sorted_cpu_samples = navigate_cpu_samples[mode];
+            const std::vector<double>& sorted_glyph_cpu_samples = navigate_glyph_cpu_samples[mode];
+            size_t frames_over_budget = sorted_samples.end() - std::upper_bound(sorted_samples.begin(), sorted_samples.end(), FRAME_BUDGET_NS);
+
+            std::cout << "    \"" << NAVIGATE_MODE_NAMES[mode] << "\": {\n";
+            std::cout << "      \"p50_frame_ns\": " << percentile(sorted_samples, 0.50) << ",\n";
+            std::cout << "      \"p99_frame_ns\": " << percentile(sorted_samples, 0.99) << ",\n";
+            std::cout << "      \"max_frame_ns\": " << (sorted_samples.empty() ? 0.0 : sorted_samples.back()) << ",\n";
+            std::cout << "      \"frames_over_60hz_budget\": " << frames_over_budget << ",\n";
+            std::cout << "      \"p99_frame_thread_cpu_ns\": " << percentile(sorted_cpu_samples, 0.99) << ",\n";
+            std::cout << "      \"max_frame_thread_cpu_ns\": " << (sorted_cpu_samples.empty() ? 0.0 : sorted_cpu_samples.back()) << ",\n";
+            std::cout << "      \"max_glyph_thread_cpu_ns\": " << (sorted_glyph_cpu_samples.empty() ? 0.0 : sorted_glyph_cpu_samples.back()) << ",\n";
+            std::cout << "      \"mean_glyphs_behind\": " << (sorted_samples.empty() ? 0.0 : static_cast<double>(navigate_glyphs_behind[mode]) / sorted_samples.size());
+            if (mode == NAVIGATE_ASYNCHRONOUS) {
+                std::cout << ",\n";
+                std::cout << "      \"cancelled\": " << navigate_cancelled_count << ",\n";
+                std::cout << "      \"skipped\": " << navigate_skipped_count << "\n";
+            } else {
+                std::cout << "\n";
+            }
+            std::cout << "    }" << (mode + 1 < NAVIGATE_MODE_COUNT ? ",\n" : "\n");
+        }
+        std::cout << "  },\n";
+    }
+    if (should_hint) {
+        std::cout << "  \"hint\": {\n";
+        std::cout << "    \"has_instructions\": " << (has_hinting_instructions ? "true" : "false") << ",\n";
+        std::cout << "    \"sizes\": [\n";
+        for (int size_index = 0; size_index < HINT_SIZE_COUNT; size_index++) {
+            double hinted_total_ns = 0.0;
+            for (double sample_ns : hinted_stages[size_index].samples_ns) {
+                hinted_total_ns += sample_ns;
+            }
+            double unhinted_total_ns = 0.0;
+            for (double sample_ns : unhinted_stages[size_index].samples_ns) {
+                unhinted_total_ns += sample_ns;
+            }
+            double hinted_ns_per_glyph = glyph_samples > 0 ? hinted_total_ns / glyph_samples : 0.0;
+            double unhinted_ns_per_glyph = glyph_samples > 0 ? unhinted_total_ns / glyph_samples : 0.0;
+
+            std::sort(hinted_stages[size_index].samples_ns.begin(), hinted_stages[size_index].samples_ns.end());
+            std::sort(unhinted_stages[size_index].samples_ns.begin(), unhinted_stages[size_index].samples_ns.end());
+
+            // What a glyph would cost if fpgm and prep ran for every one.
+            double uncached_ns_per_glyph = hint_prepare_ns[size_index] + hinted_ns_per_glyph;
+
+            std::cout << "      {\n";
+            std::cout << "        \"pixel_size\": " << HINT_SIZES[size_index] << ",\n";
+            std::cout << "        \"enabled\": " << (is_hint_size_enabled[size_index] ? "true" : "false") << ",\n";
+            std::cout << "        \"prepare_ns\": " << hint_prepare_ns[size_index] << ",\n";
+            std::cout << "        \"hinted_glyphs\": " << hinted_glyph_counts[size_index] << ",\n";
+            std::cout << "        \"failed_programs\": " << failed_program_counts[size_index] << ",\n";
+            std::cout << "        \"hinted_p50_ns\": " << percentile(hinted_stages[size_index].samples_ns, 0.50) << ",\n";
+            std::cout << "        \"hinted_p99_ns\": " << percentile(hinted_stages[size_index].samples_ns, 0.99) << ",\n";
+            std::cout << "        \"unhinted_p50_ns\": " << percentile(unhinted_stages[size_index].samples_ns, 0.50) << ",\n";
+            std::cout << "        \"hinted_glyphs_per_second\": " << (hinted_ns_per_glyph > 0.0 ? 1e9 / hinted_ns_per_glyph : 0.0) << ",\n";
+            std::cout << "        \"unhinted_glyphs_per_second\": " << (unhinted_ns_per_glyph > 0.0 ? 1e9 / unhinted_ns_per_glyph : 0.0) << ",\n";
+            std::cout << "        \"uncached_hinted_glyphs_per_second\": " << (uncached_ns_per_glyph > 0.0 ? 1e9 / uncached_ns_per_glyph : 0.0) << ",\n";
+            std::cout << "        \"hinted_allocations_per_glyph\": " << (glyph_samples > 0 ? static_cast<double>(hinted_stages[size_index].allocations) / glyph_samples : 0.0) << "\n";
+            std::cout << "      }" << (size_index + 1 < HINT_SIZE_COUNT ? ",\n" : "\n");
+        }
+        std::cout << "    ]\n";
+        std::cout << "  },\n";
+    }
+    if (atlas != nullptr) {
+        std::cout << "  \"atlas\": {\n";
+        std::cout << "    \"pixel_size\": " << atlas->get_pixel_size() << ",\n";
+        std::cout << "    \"page_size\": " << atlas->get_page_size() << ",\n";
+        std::cout << "    \"page_count\": " << atlas->get_page_count() << ",\n";
+        std::cout << "    \"pack_efficiency\": " << atlas->get_pack_efficiency() << ",\n";
+        std::cout << "    \"build_ns\": " << atlas_build_ns << ",\n";
+        std::cout << "    \"cache_save_ns\": " << atlas_save_ns << ",\n";
+        std::cout << "    \"cache_load_ns\": " << (was_atlas_loaded ? atlas_load_ns : -1.0) << "\n";
+        std::cout << "  },\n";
+    }
+    if (should_check_allocations) {
+        std::cout << "  \"check_allocations\": {\n";
+        std::cout << "    \"cold_allocations\": " << cold_decode_allocations << ",\n";
+        std::cout << "    \"warm_allocations\": " << warm_decode_allocations << "\n";
+        std::cout << "  },\n";
+    }
+    std::cout << "  \"peak_rss_bytes\": " << get_peak_rss_bytes() << "\n";
+    std::cout << "}" << std::endl;
+
+    if (warm_decode_allocations > 0) {
+        std::cerr << "[ERROR] Decoding every glyph a second time made " << warm_decode_allocations << " allocations" << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
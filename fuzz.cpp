@@ -0,0 +1,311 @@
+// Fuzzes everything that reads a font file's bytes. Build it with
+// `make fuzz`, which turns on AddressSanitizer and UndefinedBehaviorSanitizer,
+// and run
+//
+//     ttf-viewer-fuzz TTF_FONT_FILE... [--iterations N] [--seed N]
+//
+// Each iteration takes one of the given fonts, damages a copy of it with a
+// few random edits and opens the copy from memory. Half the time the table
+// checksums are then fixed up, so the damage gets past the checksum test
+// and validation's structural checks alone decide whether the unchecked
+// decoder runs. Every face is loaded, every glyph decoded, a sample of
+// glyphs hinted, and a line of text mapped through the cmap and shaped.
+//
+// Iteration i is seeded with seed + i, so `--seed S --iterations 1` replays
+// iteration 0 of a run started with seed S. When a sanitizer reports an
+// error, the input that caused it is written to fuzz-crash-SEED.ttf, where
+// SEED replays it.
+//
+// The same LLVMFuzzerTestOneInput works under libFuzzer: compile fuzz.cpp
+// with -DTTF_VIEWER_LIBFUZZER and -fsanitize=fuzzer, which supplies main.
+
+#include <SDL3/SDL.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#if defined(__SANITIZE_ADDRESS__)
+#define FUZZ_HAS_SANITIZER 1
+#elif defined(__has_feature)
+#if __has_feature(address_sanitizer)
+#define FUZZ_HAS_SANITIZER 1
+#endif
+#endif
+
+#ifdef FUZZ_HAS_SANITIZER
+#include <sanitizer/common_interface_defs.h>
+#endif
+
+#include "BigEndianReader.h"
+#include "Font.h"
+#include "FontFile.h"
+#include "FontValidation.h"
+#include "GlyphHinter.h"
+#include "TextLayout.h"
+
+namespace {
+    const char* const SAMPLE_TEXT = u8"The quick brown fox jumps over the lazy dog. 0123456789 \u00e9\u00df\u0416\u03a9\u2014\u20ac\ufb01";
+
+    // Hinting is far slower than decoding, so only this many glyphs are
+    // hinted, spread across the font.
+    const int HINTED_GLYPH_COUNT = 64;
+    const int HINTED_PIXEL_SIZE = 12;
+
+    void exercise_face(const std::shared_ptr<FontFile>& file, int face_index) {
+        Font font(file, face_index);
+        Uint16 glyph_count = font.get_glyph_count();
+
+        for (Uint16 glyph_index = 0; glyph_index < glyph_count; glyph_index++) {
+            Glyph glyph = font.get_glyph(glyph_index);
+            font.get_advance_width(glyph_index);
+            font.get_left_side_bearing(glyph_index);
+        }
+
+        GlyphHinter hinter(font);
+        HintedGlyph hinted_glyph;
+        int hinted_step = std::max(1, glyph_count / HINTED_GLYPH_COUNT);
+        for (int glyph_index = 0; glyph_index < glyph_count; glyph_index += hinted_step) {
+            hinter.load_glyph(static_cast<Uint16>(glyph_index), HINTED_PIXEL_SIZE, true, hinted_glyph);
+        }
+
+        TextLayout layout(font, 4);
+        layout.shape(SAMPLE_TEXT, 24.0f);
+        for (Uint32 codepoint = 0; codepoint < 0x3000; codepoint += 7) {
+            font.get_glyph_index(codepoint);
+        }
+    }
+}
+
+// --------------------------------------------------------------------------
+
+extern "C" int LLVMFuzzerTestOneInput(const Uint8* data, size_t size) {
+    // Font reports what it loads and every problem it finds; none of that
+    // is interesting here.
+    std::stringstream discarded_output;
+    std::streambuf* stdout_buffer = std::cout.rdbuf(discarded_output.rdbuf());
+    std::streambuf* stderr_buffer = std::cerr.rdbuf(discarded_output.rdbuf());
+
+    // Sized exactly, so the sanitizer catches a read one byte past the end.
+    std::shared_ptr<FontFile> file = FontFile::open(std::vector<Uint8>(data, data + size));
+    if (file != nullptr) {
+        for (int face_index = 0; face_index < file->get_face_count(); face_index++) {
+            exercise_face(file, face_index);
+        }
+    }
+
+    std::cout.rdbuf(stdout_buffer);
+    std::cerr.rdbuf(stderr_buffer);
+    return 0;
+}
+
+// --------------------------------------------------------------------------
+
+#ifndef TTF_VIEWER_LIBFUZZER
+namespace {
+    const int MAX_EDITS = 8;
+    const size_t TABLE_DIRECTORY_OFFSET = 12;
+    const size_t TABLE_DIRECTORY_ENTRY_SIZE = 16;
+
+    // Values that tend to sit on the edge of a bounds check.
+    const Uint32 INTERESTING_VALUES[] = {0, 1, 0x7F, 0x80, 0xFF, 0x7FFF, 0x8000, 0xFFFF, 0x7FFFFFFF, 0x80000000, 0xFFFFFFFF};
+
+    std::vector<Uint8> current_input;
+    Uint64 current_seed = 0;
+
+    void write_u16(std::vector<Uint8>& bytes, size_t offset, Uint16 value) {
+        if (offset + 2 <= bytes.size()) {
+            bytes[offset] = static_cast<Uint8>(value >> 8);
+            bytes[offset + 1] = static_cast<Uint8>(value);
+        }
+    }
+
+    void write_u32(std::vector<Uint8>& bytes, size_t offset, Uint32 value) {
+        if (offset + 4 <= bytes.size()) {
+            bytes[offset] = static_cast<Uint8>(value >> 24);
+            bytes[offset + 1] = static_cast<Uint8>(value >> 16);
+            bytes[offset + 2] = static_cast<Uint8>(value >> 8);
+            bytes[offset + 3] = static_cast<Uint8>(value);
+        }
+    }
+
+    // Where the tables of a single font start, read from the undamaged seed
+    // so edits can be aimed at table headers, where the offsets and counts
+    // live.
+    std::vector<size_t> find_table_offsets(const std::vector<Uint8>& bytes) {
+        std::vector<size_t> offsets;
+        BigEndianReader reader(bytes.data(), bytes.size());
+        if (bytes.size() < TABLE_DIRECTORY_OFFSET) {
+            return offsets;
+        }
+
+        Uint16 table_count = reader.peek_u16(4);
+        for (Uint16 i = 0; i < table_count; i++) {
+            size_t entry = TABLE_DIRECTORY_OFFSET + i * TABLE_DIRECTORY_ENTRY_SIZE;
+            if (entry + TABLE_DIRECTORY_ENTRY_SIZE > bytes.size()) {
+                break;
+            }
+            Uint32 offset = reader.peek_u32(entry + 8);
+            if (offset < bytes.size()) {
+                offsets.push_back(offset);
+            }
+        }
+        return offsets;
+    }
+
+    // Recompute every directory entry's checksum over whatever the table now
+    // holds, head's with its checkSumAdjustment left out.
+    void fix_table_checksums(std::vector<Uint8>& bytes) {
+        if (bytes.size() < TABLE_DIRECTORY_OFFSET) {
+            return;
+        }
+
+        BigEndianReader reader(bytes.data(), bytes.size());
+        Uint16 table_count = reader.peek_u16(4);
+        for (Uint16 i = 0; i < table_count; i++) {
+            size_t entry = TABLE_DIRECTORY_OFFSET + i * TABLE_DIRECTORY_ENTRY_SIZE;
+            if (entry + TABLE_DIRECTORY_ENTRY_SIZE > bytes.size()) {
+                break;
+            }
+
+            Uint32 tag = reader.peek_u32(entry);
+            Uint32 offset = reader.peek_u32(entry + 8);
+            Uint32 length = reader.peek_u32(entry + 12);
+            if (offset > bytes.size() || length > bytes.size() - offset) {
+                continue;
+            }
+
+            Uint32 checksum = calculate_table_checksum(bytes.data() + offset, length);
+            if (tag == TableTag::HEAD && length >= 12) {
+                checksum -= reader.peek_u32(offset + 8);
+            }
+            write_u32(bytes, entry + 4, checksum);
+        }
+    }
+
+    void mutate(std::vector<Uint8>& bytes, const std::vector<size_t>& table_offsets, std::mt19937_64& random) {
+        int edit_count = 1 + static_cast<int>(random() % MAX_EDITS);
+        for (int edit = 0; edit < edit_count && !bytes.empty(); edit++) {
+            // A quarter of edits land in the table directory, a quarter near
+            // the start of a table and the rest anywhere.
+            size_t position;
+            Uint64 target = random() % 4;
+            if (target == 0) {
+                position = random() % std::min(bytes.size(), TABLE_DIRECTORY_OFFSET + (table_offsets.size() + 1) * TABLE_DIRECTORY_ENTRY_SIZE);
+            } else if (target == 1 && !table_offsets.empty()) {
+                position = std::min(bytes.size() - 1, table_offsets[random() % table_offsets.size()] + random() % 64);
+            } else {
+                position = random() % bytes.size();
+            }
+
+            Uint32 value = INTERESTING_VALUES[random() % (sizeof(INTERESTING_VALUES) / sizeof(INTERESTING_VALUES[0]))];
+            switch (random() % 6) {
+                case 0:
+                    bytes[position] ^= static_cast<Uint8>(1 << (random() % 8));
+                    break;
+                case 1:
+                    bytes[position] = static_cast<Uint8>(random());
+                    break;
+                case 2:
+                    write_u16(bytes, position, static_cast<Uint16>(value));
+                    break;
+                case 3:
+                    write_u32(bytes, position, value);
+                    break;
+                case 4:
+                    write_u16(bytes, position, static_cast<Uint16>(random()));
+                    break;
+                default:
+                    // Cutting the file short moves every table's end.
+                    if (random() % 4 == 0) {
+                        bytes.resize(position);
+                    } else {
+                        write_u32(bytes, position, static_cast<Uint32>(random()));
+                    }
+                    break;
+            }
+        }
+    }
+
+#ifdef FUZZ_HAS_SANITIZER
+    void save_crashing_input() {
+        std::string file_name = "fuzz-crash-" + std::to_string(current_seed) + ".ttf";
+        std::ofstream file(file_name, std::ofstream::binary);
+        file.write(reinterpret_cast<const char*>(current_input.data()), current_input.size());
+        std::fprintf(stderr, "[ERROR] Input for seed %llu written to %s\n", static_cast<unsigned long long>(current_seed), file_name.c_str());
+    }
+#endif
+}
+
+int main(int argc, char** argv) {
+    std::vector<std::string> font_file_names;
+    long long iterations = 1000;
+    Uint64 seed = 1;
+
+    for (int i = 1; i < argc; i++) {
+        std::string argument = argv[i];
+        if (argument == "--iterations" && i + 1 < argc) {
+            iterations = std::atoll(argv[++i]);
+        } else if (argument == "--seed" && i + 1 < argc) {
+            seed = std::strtoull(argv[++i], nullptr, 10);
+        } else {
+            font_file_names.push_back(argument);
+        }
+    }
+
+    if (font_file_names.empty() || iterations <= 0) {
+        std::cerr << "Usage: " << argv[0] << " TTF_FONT_FILE... [--iterations N] [--seed N]" << std::endl;
+        return 1;
+    }
+
+    std::vector<std::vector<Uint8>> seeds;
+    std::vector<std::vector<size_t>> seed_table_offsets;
+    for (const std::string& font_file_name : font_file_names) {
+        std::ifstream font_file(font_file_name, std::ifstream::binary);
+        std::vector<Uint8> contents((std::istreambuf_iterator<char>(font_file)), std::istreambuf_iterator<char>());
+        if (contents.empty()) {
+            std::cerr << "[ERROR] Could not read font file: " << font_file_name << std::endl;
+            return 1;
+        }
+        seed_table_offsets.push_back(find_table_offsets(contents));
+        seeds.push_back(std::move(contents));
+    }
+
+#ifdef FUZZ_HAS_SANITIZER
+    __sanitizer_set_death_callback(save_crashing_input);
+#endif
+
+    // Every seed font goes through once undamaged first.
+    for (const std::vector<Uint8>& contents : seeds) {
+        current_input = contents;
+        LLVMFuzzerTestOneInput(current_input.data(), current_input.size());
+    }
+
+    for (long long iteration = 0; iteration < iterations; iteration++) {
+        current_seed = seed + static_cast<Uint64>(iteration);
+        std::mt19937_64 random(current_seed);
+
+        size_t seed_index = random() % seeds.size();
+        current_input = seeds[seed_index];
+        mutate(current_input, seed_table_offsets[seed_index], random);
+        if (random() % 2 == 0) {
+            fix_table_checksums(current_input);
+        }
+
+        LLVMFuzzerTestOneInput(current_input.data(), current_input.size());
+
+        if ((iteration + 1) % 100 == 0) {
+            std::cout << "Iteration " << iteration + 1 << " of " << iterations << std::endl;
+        }
+    }
+
+    std::cout << "No errors in " << iterations << " iterations from seed " << seed << std::endl;
+    return 0;
+}
+#endif
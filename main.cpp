@@ -1,409 +1,220 @@
 #include <SDL3/SDL.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <iomanip>
 #include <iostream>
+#include <memory>
+#include <sstream>
 #include <string>
 
+#include "DrawList.h"
 #include "Font.h"
+#include "GlyphAtlas.h"
+#include "GlyphCache.h"
+#include "GlyphDrawing.h"
+#include "GlyphGridView.h"
+#include "GlyphHinter.h"
+#include "GlyphLoader.h"
+#include "GlyphRasterizer.h"
+#include "OutlineCache.h"
+#include "Profiler.h"
+#include "TextLayout.h"
+#include "ThreadPool.h"
 
 enum DrawMethod {
     POINTS,
     LINES,
     CONTOURS,
+    FILLED,
+    ATLAS,
+    GRID,
+    TEXT,
+    HINTED,
 };
 
-// --------------------------------------------------------------------------
-
-// Linearly remap an input x in [a, b] to [u, v].
-float linear_remap(float x, float a, float b, float u, float v) {
-    return (v - u) / (b - a) * (x - a) + u;
-}
-
-// --------------------------------------------------------------------------
+const int ATLAS_PIXEL_SIZE = 48;
+const int GRID_CELL_SIZE = 64;
+const float TEXT_PIXEL_SIZE = 48.0f;
+const int TEXT_LAYOUT_CACHE_CAPACITY = 256;
+
+const int HINTED_PIXEL_SIZE = 12;
+const int MIN_HINTED_PIXEL_SIZE = 6;
+const int MAX_HINTED_PIXEL_SIZE = 72;
+
+// Fling speed in pixels per second for one notch of the mouse wheel.
+const float GRID_WHEEL_FLING_VELOCITY = 1500.0f;
+
+#ifdef TTF_VIEWER_PROFILING
+const char* const TRACE_FILE_NAME = "ttf-viewer-trace.json";
+#endif
+
+// Longest time step a fling is advanced by, so the first frame after the
+// loop sat idle doesn't jump.
+const Uint64 MAX_FRAME_STEP_NS = 50000000;
+
+// What the retained draw list was built for.
+struct RetainedGeometryKey {
+    Uint16 glyph_index;
+    int window_width;
+    int window_height;
+    DrawMethod draw_method;
+    Uint64 text_revision;
+    Uint64 hinting_revision;
+
+    bool operator==(const RetainedGeometryKey& other) const {
+        return glyph_index == other.glyph_index && window_width == other.window_width && window_height == other.window_height && draw_method == other.draw_method && text_revision == other.text_revision && hinting_revision == other.hinting_revision;
+    }
 
-void fit_rect_inside_another_rect(const SDL_FRect& inner_rect, const SDL_FRect& outer_rect, SDL_FRect& fitted_rect) {
-    float inner_width_to_height_ratio = inner_rect.w / inner_rect.h;
-    float inner_width_when_inner_height_is_maximized = inner_width_to_height_ratio * outer_rect.h;
-    if (inner_width_when_inner_height_is_maximized <= outer_rect.w) {
-        fitted_rect.w = inner_width_when_inner_height_is_maximized;
-        fitted_rect.h = outer_rect.h;
-
-        fitted_rect.x = outer_rect.x + (outer_rect.w - fitted_rect.w) / 2.0f;
-        fitted_rect.y = outer_rect.y;
-    } else {
-        fitted_rect.w = outer_rect.w;
-        fitted_rect.h = outer_rect.w / inner_width_to_height_ratio;
-
-        fitted_rect.x = outer_rect.x;
-        fitted_rect.y = outer_rect.y + (outer_rect.h - fitted_rect.h) / 2.0f;
+    bool operator!=(const RetainedGeometryKey& other) const {
+        return !(*this == other);
     }
-}
+};
 
 // --------------------------------------------------------------------------
 
-void calculate_glyph_render_bounds(const Glyph& glyph, int window_width, int window_height, int padding, SDL_FRect& glyph_render_bounds) {
-    SDL_FRect window_rect;
-    window_rect.x = padding;
-    window_rect.y = padding;
-    window_rect.w = window_width - 2 * padding + 1;
-    window_rect.h = window_height - 2 * padding + 1;
+void print_glyph_information(const Glyph& glyph, Uint16 glyph_index) {
+    std::cout << std::endl;
+    std::cout << "Glyph " << glyph_index << " data:" << std::endl;
+    std::cout << "Bounds: (" << glyph.min_extents.x << ", " << glyph.min_extents.y << ") => (";
+    std::cout << glyph.max_extents.x << ", " << glyph.max_extents.y << ")" << std::endl;
 
-    SDL_FRect glyph_rect;
-    glyph_rect.x = glyph.min_extents.x;
-    glyph_rect.y = glyph.max_extents.y;
-    glyph_rect.w = glyph.max_extents.x - glyph.min_extents.x + 1;
-    glyph_rect.h = glyph.max_extents.y - glyph.min_extents.y + 1;
+    std::cout << "End point indices: [";
+    for (int i = 0; i < glyph.num_end_point_indices; i++) {
+        std::cout << glyph.end_point_indices[i] << ((i == glyph.num_end_point_indices - 1) ? "]" : ", ");
+    }
+    std::cout << std::endl;
 
-    fit_rect_inside_another_rect(glyph_rect, window_rect, glyph_render_bounds);
+    for (int i = 0; i < glyph.num_points; i++) {
+        std::cout << "Point " << i << " is " << (glyph.is_on_curve(i) ? "ON curve : " : "OFF curve: ");
+        std::cout << "(" << glyph.x_coordinates[i] << ", " << glyph.y_coordinates[i] << ")" << std::endl;
+    }
 }
 
 // --------------------------------------------------------------------------
 
-void draw_glyph_points(SDL_Renderer* renderer, const Glyph& glyph, int window_width, int window_height, int padding) {
-    Uint8 draw_r, draw_g, draw_b, draw_a;
-    SDL_GetRenderDrawColor(renderer, &draw_r, &draw_g, &draw_b, &draw_a);
-
-    SDL_FRect glyph_render_bounds;
-    calculate_glyph_render_bounds(glyph, window_width, window_height, padding, glyph_render_bounds);
-
-    for (int i = 0; i < glyph.num_points; i++) {
-        float mapped_x = linear_remap(
-            glyph.points[i].x,
-            glyph.min_extents.x,
-            glyph.max_extents.x,
-            glyph_render_bounds.x,
-            glyph_render_bounds.x + glyph_render_bounds.w - 1
-        );
-        float mapped_y = linear_remap(
-            glyph.points[i].y,
-            glyph.max_extents.y,
-            glyph.min_extents.y,
-            glyph_render_bounds.y,
-            glyph_render_bounds.y + glyph_render_bounds.h - 1
-        );
-
-        if (!glyph.points[i].is_on_curve) {
-            SDL_SetRenderDrawColor(renderer, 255, 0, 0, 255);
-        } else {
-            SDL_SetRenderDrawColor(renderer, draw_r, draw_g, draw_b, draw_a);
-        }
-
-        SDL_FRect point_rect;
-        point_rect.x = mapped_x - 1;
-        point_rect.y = mapped_y - 1;
-        point_rect.w = 3;
-        point_rect.h = 3;
-        SDL_RenderRect(renderer, &point_rect);
+// Show the glyph index and the characters that map to it in the title bar.
+void update_window_title(SDL_Window* window, Font& font, Uint16 glyph_index) {
+    const CharacterMap& character_map = font.get_character_map();
+    size_t codepoint_count = character_map.get_codepoint_count(glyph_index);
+    const Uint32* codepoints = character_map.get_codepoints(glyph_index);
+
+    std::ostringstream title;
+    title << "TrueType Font Viewer - glyph " << glyph_index;
+    for (size_t i = 0; i < codepoint_count; i++) {
+        title << (i == 0 ? " (" : ", ");
+        title << "U+" << std::hex << std::uppercase << std::setw(4) << std::setfill('0') << codepoints[i] << std::dec;
     }
+    title << (codepoint_count > 0 ? ")" : "");
 
-    SDL_SetRenderDrawColor(renderer, draw_r, draw_g, draw_b, draw_a);
+    SDL_SetWindowTitle(window, title.str().c_str());
 }
 
 // --------------------------------------------------------------------------
 
-void draw_glyph_lines(SDL_Renderer* renderer, const Glyph& glyph, int window_width, int window_height, int padding) {
-    SDL_FRect glyph_render_bounds;
-    calculate_glyph_render_bounds(glyph, window_width, window_height, padding, glyph_render_bounds);
-
-    int current_first_point_index = 0;
-    for (int i = 1; i < glyph.num_points; i++) {
-        float mapped_x1 = linear_remap(
-            glyph.points[i - 1].x,
-            glyph.min_extents.x,
-            glyph.max_extents.x,
-            glyph_render_bounds.x,
-            glyph_render_bounds.x + glyph_render_bounds.w - 1
-        );
-        float mapped_y1 = linear_remap(
-            glyph.points[i - 1].y,
-            glyph.max_extents.y,
-            glyph.min_extents.y,
-            glyph_render_bounds.y,
-            glyph_render_bounds.y + glyph_render_bounds.h - 1
-        );
-
-        float mapped_x2 = linear_remap(
-            glyph.points[i].x,
-            glyph.min_extents.x,
-            glyph.max_extents.x,
-            glyph_render_bounds.x,
-            glyph_render_bounds.x + glyph_render_bounds.w - 1
-        );
-        float mapped_y2 = linear_remap(
-            glyph.points[i].y,
-            glyph.max_extents.y,
-            glyph.min_extents.y,
-            glyph_render_bounds.y,
-            glyph_render_bounds.y + glyph_render_bounds.h - 1
-        );
-
-        SDL_RenderLine(renderer, mapped_x1, mapped_y1, mapped_x2, mapped_y2);
-
-        bool is_last_point_in_current_contour = false;
-        for (int j = 0; j < glyph.num_end_point_indices; j++) {
-            if (glyph.end_point_indices[j] == i) {
-                is_last_point_in_current_contour = true;
-                break;
-            }
-        }
+void render_draw_list(SDL_Renderer* renderer, DrawList& draw_list) {
+    SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
+    SDL_RenderClear(renderer);
 
-        if (is_last_point_in_current_contour) {
-            mapped_x1 = linear_remap(
-                glyph.points[current_first_point_index].x,
-                glyph.min_extents.x,
-                glyph.max_extents.x,
-                glyph_render_bounds.x,
-                glyph_render_bounds.x + glyph_render_bounds.w - 1
-            );
-            mapped_y1 = linear_remap(
-                glyph.points[current_first_point_index].y,
-                glyph.max_extents.y,
-                glyph.min_extents.y,
-                glyph_render_bounds.y,
-                glyph_render_bounds.y + glyph_render_bounds.h - 1
-            );
-
-            SDL_RenderLine(renderer, mapped_x1, mapped_y1, mapped_x2, mapped_y2);
-
-            current_first_point_index = i + 1;
-            i = current_first_point_index;
-        }
-    }
+    draw_list.submit(renderer);
 }
 
 // --------------------------------------------------------------------------
 
-int wrap(int value, int min, int max) {
-    if (value < min) {
-        int delta = value - min;
-        return max + delta + 1;
-    } else if (value > max) {
-        int delta = value - max;
-        return min + delta - 1;
-    } else {
-        return value;
+#ifdef TTF_VIEWER_PROFILING
+// Where the previous frame's time went, in SDL's built-in 8x8 debug font
+// over the top-left corner. Times are summed over every thread, so decoding
+// on the prefetcher or the pool shows up too.
+void draw_profile_overlay(SDL_Renderer* renderer, const ProfileFrameStats& stats) {
+    auto milliseconds = [&stats](ProfileZone zone) {
+        return stats.zone_ns[zone] / 1e6;
+    };
+
+    double draw_ms = 0.0;
+    for (ProfileZone zone : {DRAW_POINTS, DRAW_LINES, DRAW_CONTOURS, DRAW_FILLED, DRAW_ATLAS, DRAW_GRID, DRAW_TEXT}) {
+        draw_ms += milliseconds(zone);
     }
-}
 
-// --------------------------------------------------------------------------
+    char lines[7][96];
+    int line_count = 0;
+    std::snprintf(lines[line_count++], sizeof(lines[0]), "frame   %7.2f ms", milliseconds(FRAME));
+    std::snprintf(lines[line_count++], sizeof(lines[0]), "decode  %7.2f ms  %llu glyphs", milliseconds(GET_GLYPH), static_cast<unsigned long long>(stats.zone_calls[GET_GLYPH]));
+    std::snprintf(lines[line_count++], sizeof(lines[0]), "flatten %7.2f ms  %llu segments", milliseconds(FLATTEN), static_cast<unsigned long long>(stats.counters[SEGMENTS]));
+    std::snprintf(lines[line_count++], sizeof(lines[0]), "hint    %7.2f ms  %llu glyphs", milliseconds(HINT_GLYPH), static_cast<unsigned long long>(stats.zone_calls[HINT_GLYPH]));
+    std::snprintf(lines[line_count++], sizeof(lines[0]), "draw    %7.2f ms", draw_ms);
+    std::snprintf(lines[line_count++], sizeof(lines[0]), "submit  %7.2f ms  %llu renderer calls", milliseconds(SUBMIT), static_cast<unsigned long long>(stats.counters[RENDERER_CALLS]));
+    if (Profiler::is_tracing()) {
+        std::snprintf(lines[line_count++], sizeof(lines[0]), "recording trace, T to stop");
+    }
 
-void draw_direct_line(SDL_Renderer* renderer, const Glyph& glyph, const SDL_FRect& glyph_render_bounds, const GlyphPoint& p1, const GlyphPoint& p2) {
-    float mapped_x1 = linear_remap(
-        p1.x,
-        glyph.min_extents.x,
-        glyph.max_extents.x,
-        glyph_render_bounds.x,
-        glyph_render_bounds.x + glyph_render_bounds.w - 1
-    );
-    float mapped_y1 = linear_remap(
-        p1.y,
-        glyph.max_extents.y,
-        glyph.min_extents.y,
-        glyph_render_bounds.y,
-        glyph_render_bounds.y + glyph_render_bounds.h - 1
-    );
-
-    float mapped_x2 = linear_remap(
-        p2.x,
-        glyph.min_extents.x,
-        glyph.max_extents.x,
-        glyph_render_bounds.x,
-        glyph_render_bounds.x + glyph_render_bounds.w - 1
-    );
-    float mapped_y2 = linear_remap(
-        p2.y,
-        glyph.max_extents.y,
-        glyph.min_extents.y,
-        glyph_render_bounds.y,
-        glyph_render_bounds.y + glyph_render_bounds.h - 1
-    );
-
-    SDL_RenderLine(renderer, mapped_x1, mapped_y1, mapped_x2, mapped_y2);
-}
+    const float line_height = SDL_DEBUG_TEXT_FONT_CHARACTER_SIZE + 2.0f;
+    SDL_FRect background = {0.0f, 0.0f, 40.0f * SDL_DEBUG_TEXT_FONT_CHARACTER_SIZE + 8.0f, line_count * line_height + 6.0f};
+    SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
+    SDL_RenderFillRect(renderer, &background);
 
-// --------------------------------------------------------------------------
-
-float lerp(float a, float b, float t) {
-    return a + (b - a) * t;
+    SDL_SetRenderDrawColor(renderer, 255, 255, 0, 255);
+    for (int i = 0; i < line_count; i++) {
+        SDL_RenderDebugText(renderer, 4.0f, 4.0f + i * line_height, lines[i]);
+    }
 }
+#endif
 
 // --------------------------------------------------------------------------
 
-void lerp_points(float x1, float y1, float x2, float y2, float t, SDL_FPoint& interpolated_point) {
-    interpolated_point.x = lerp(x1, x2, t);
-    interpolated_point.y = lerp(y1, y2, t);
+double milliseconds_since(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
 }
 
 // --------------------------------------------------------------------------
 
-void draw_quadratic_bezier_curve(SDL_Renderer* renderer, const Glyph& glyph, const SDL_FRect& glyph_render_bounds, const GlyphPoint& p1, const GlyphPoint& p2, const GlyphPoint& p3, int subdivisions) {
-    float mapped_x1 = linear_remap(
-        p1.x,
-        glyph.min_extents.x,
-        glyph.max_extents.x,
-        glyph_render_bounds.x,
-        glyph_render_bounds.x + glyph_render_bounds.w - 1
-    );
-    float mapped_y1 = linear_remap(
-        p1.y,
-        glyph.max_extents.y,
-        glyph.min_extents.y,
-        glyph_render_bounds.y,
-        glyph_render_bounds.y + glyph_render_bounds.h - 1
-    );
-
-    float mapped_x2 = linear_remap(
-        p2.x,
-        glyph.min_extents.x,
-        glyph.max_extents.x,
-        glyph_render_bounds.x,
-        glyph_render_bounds.x + glyph_render_bounds.w - 1
-    );
-    float mapped_y2 = linear_remap(
-        p2.y,
-        glyph.max_extents.y,
-        glyph.min_extents.y,
-        glyph_render_bounds.y,
-        glyph_render_bounds.y + glyph_render_bounds.h - 1
-    );
-
-    float mapped_x3 = linear_remap(
-        p3.x,
-        glyph.min_extents.x,
-        glyph.max_extents.x,
-        glyph_render_bounds.x,
-        glyph_render_bounds.x + glyph_render_bounds.w - 1
-    );
-    float mapped_y3 = linear_remap(
-        p3.y,
-        glyph.max_extents.y,
-        glyph.min_extents.y,
-        glyph_render_bounds.y,
-        glyph_render_bounds.y + glyph_render_bounds.h - 1
-    );
-
-    float increment = 1.0f / subdivisions;
-    for (float t = 0.0f; t < 1.0f; t += increment) {
-        SDL_FPoint p_1_to_2;
-        SDL_FPoint p_2_to_3;
-
-        lerp_points(mapped_x1, mapped_y1, mapped_x2, mapped_y2, t, p_1_to_2);
-        lerp_points(mapped_x2, mapped_y2, mapped_x3, mapped_y3, t, p_2_to_3);
-
-        SDL_FPoint current_curve_point;
-        lerp_points(p_1_to_2.x, p_1_to_2.y, p_2_to_3.x, p_2_to_3.y, t, current_curve_point);
-
-        float next_t = t + increment;
-        if (next_t > 1.0f) {
-            next_t = 1.0f;
+// Drop the last UTF-8 encoded codepoint from text.
+void erase_last_codepoint(std::string& text) {
+    while (!text.empty()) {
+        bool is_continuation_byte = (static_cast<Uint8>(text.back()) & 0xC0) == 0x80;
+        text.pop_back();
+        if (!is_continuation_byte) {
+            break;
         }
-
-        lerp_points(mapped_x1, mapped_y1, mapped_x2, mapped_y2, next_t, p_1_to_2);
-        lerp_points(mapped_x2, mapped_y2, mapped_x3, mapped_y3, next_t, p_2_to_3);
-
-        SDL_FPoint next_curve_point;
-        lerp_points(p_1_to_2.x, p_1_to_2.y, p_2_to_3.x, p_2_to_3.y, next_t, next_curve_point);
-
-        SDL_RenderLine(renderer, current_curve_point.x, current_curve_point.y, next_curve_point.x, next_curve_point.y);
     }
 }
 
 // --------------------------------------------------------------------------
 
-void draw_glyph_contours(SDL_Renderer* renderer, const Glyph& glyph, int window_width, int window_height, int padding, int subdivisions) {
-    SDL_FRect glyph_render_bounds;
-    calculate_glyph_render_bounds(glyph, window_width, window_height, padding, glyph_render_bounds);
-
-    int lower_index = 0;
-    for (int endpoint_index = 0; endpoint_index < glyph.num_end_point_indices; endpoint_index++) {
-        int upper_index = glyph.end_point_indices[endpoint_index];
-
-        for (int i = lower_index; i <= upper_index; i++) {
-            int first_index = -1;
-            int second_index = -1;
-            int third_index = -1;
-
-            GlyphPoint current_point = glyph.points[i];
-            if (current_point.is_on_curve) {
-                first_index = i;
-                second_index = wrap(i + 1, lower_index, upper_index);
-                third_index = wrap(i + 2, lower_index, upper_index);
-            } else {
-                first_index = wrap(i - 1, lower_index, upper_index);
-                second_index = i;
-                third_index = wrap(i + 1, lower_index, upper_index);
-            }
-
-            GlyphPoint first_point = glyph.points[first_index];
-            GlyphPoint second_point = glyph.points[second_index];
-            GlyphPoint third_point = glyph.points[third_index];
-
-            if (current_point.is_on_curve) {
-                if (second_point.is_on_curve) {
-                    draw_direct_line(renderer, glyph, glyph_render_bounds, first_point, second_point);
-                } else {
-                    if (third_point.is_on_curve) {
-                        draw_quadratic_bezier_curve(renderer, glyph, glyph_render_bounds, first_point, second_point, third_point, subdivisions);
-                    } else {
-                        GlyphPoint mid_point;
-                        mid_point.is_on_curve = true;
-                        mid_point.x = (second_point.x + third_point.x) / 2.0f;
-                        mid_point.y = (second_point.y + third_point.y) / 2.0f;
-
-                        draw_quadratic_bezier_curve(renderer, glyph, glyph_render_bounds, first_point, second_point, mid_point, subdivisions);
-                    }
-                }
-            } else {
-                if (!first_point.is_on_curve) {
-                    first_point.is_on_curve = true;
-                    first_point.x = (first_point.x + second_point.x) / 2.0f;
-                    first_point.y = (first_point.y + second_point.y) / 2.0f;
-                }
-
-                if (!third_point.is_on_curve) {
-                    third_point.is_on_curve = true;
-                    third_point.x = (second_point.x + third_point.x) / 2.0f;
-                    third_point.y = (second_point.y + third_point.y) / 2.0f;
-                }
-
-                // draw bezier first => second => third
-                draw_quadratic_bezier_curve(renderer, glyph, glyph_render_bounds, first_point, second_point, third_point, subdivisions);
-            }
-        }
+int main(int argc, char** argv) {
+    auto launch_start = std::chrono::steady_clock::now();
 
-        lower_index = upper_index + 1;
+    if (argc != 2 && argc != 3) {
+        std::cerr << "Usage: " << argv[0] << " TTF_FONT_FILE [FACE_INDEX]" << std::endl;
+        return 1;
     }
-}
-
-// --------------------------------------------------------------------------
-
-void print_glyph_information(const Glyph& glyph, Uint16 glyph_index) {
-    std::cout << std::endl;
-    std::cout << "Glyph " << glyph_index << " data:" << std::endl;
-    std::cout << "Bounds: (" << glyph.min_extents.x << ", " << glyph.min_extents.y << ") => (";
-    std::cout << glyph.max_extents.x << ", " << glyph.max_extents.y << ")" << std::endl;
 
-    std::cout << "End point indices: [";
-    for (int i = 0; i < glyph.num_end_point_indices; i++) {
-        std::cout << glyph.end_point_indices[i] << ((i == glyph.num_end_point_indices - 1) ? "]" : ", ");
-    }
-    std::cout << std::endl;
+    std::string font_file_name = argv[1];
+    int face_index = argc == 3 ? std::atoi(argv[2]) : 0;
 
-    for (int i = 0; i < glyph.num_points; i++) {
-        std::cout << "Point " << i << " is " << (glyph.points[i].is_on_curve ? "ON curve : " : "OFF curve: ");
-        std::cout << "(" << glyph.points[i].x << ", " << glyph.points[i].y << ")" << std::endl;
+    std::shared_ptr<FontFile> font_file = FontFile::open(font_file_name);
+    if (font_file == nullptr) {
+        std::cerr << "[ERROR] Could not read font file: " << font_file_name << std::endl;
+        return 1;
     }
-}
-
-// --------------------------------------------------------------------------
-
-int main(int argc, char** argv) {
 
-    if (argc != 2) {
-        std::cerr << "Usage: " << argv[0] << " TTF_FONT_FILE" << std::endl;
+    if (face_index < 0 || face_index >= font_file->get_face_count()) {
+        std::cerr << "[ERROR] " << font_file_name << " has no face " << face_index << std::endl;
         return 1;
     }
 
-    std::string font_file_name = argv[1];
-    Font font(font_file_name);
+    // An outline cache left by an earlier run lets the first frame go up
+    // before anything in the font has been parsed. It is found by the file's
+    // cheap cache key, so nothing past the table directories is read yet.
+    std::string cache_directory = GlyphAtlas::get_default_cache_directory();
+    std::string outline_cache_file_name;
+    std::shared_ptr<const OutlineCache> outline_cache;
+    if (!cache_directory.empty()) {
+        outline_cache_file_name = OutlineCache::get_cache_file_name(cache_directory, font_file->get_cache_key(), face_index);
+        outline_cache = OutlineCache::load(outline_cache_file_name, font_file->get_cache_key(), face_index);
+    }
 
     // --- setup ---
 
@@ -430,22 +241,181 @@ int main(int argc, char** argv) {
 
     SDL_SetRenderVSync(renderer, 1);
 
+    DrawMethod draw_method = DrawMethod::POINTS;
+
+    const SDL_Color glyph_color = {255, 255, 255, 255};
+
+    // Screen-space geometry is retained in the draw list and only rebuilt
+    // when the glyph, window size or draw mode it was built for changes.
+    DrawList draw_list;
+
+    OutlineView first_outline;
+    bool has_reported_startup = false;
+    if (outline_cache != nullptr && outline_cache->find_outline(0, first_outline)) {
+        draw_glyph_points(draw_list, first_outline, window_width, window_height, 20, glyph_color);
+        render_draw_list(renderer, draw_list);
+        SDL_RenderPresent(renderer);
+
+        std::cout << "Startup: first glyph drawn from the outline cache in " << milliseconds_since(launch_start) << " ms (";
+        std::cout << outline_cache->get_file_size() / 1024 << " KB cache, " << font_file->get_size() / 1024 << " KB font)" << std::endl;
+        has_reported_startup = true;
+    }
+
+    Font font(font_file, face_index);
+
+    // A damaged font can load with no glyphs at all, and there is nothing
+    // to show or navigate through then.
+    if (font.get_glyph_count() == 0) {
+        std::cerr << "[ERROR] " << font_file_name << " has no glyphs" << std::endl;
+        SDL_DestroyRenderer(renderer);
+        SDL_DestroyWindow(window);
+        SDL_Quit();
+        return 1;
+    }
+
     // --- main loop ---
 
-    DrawMethod draw_method = DrawMethod::POINTS;
+    GlyphCache glyph_cache(font, 16 * 1024 * 1024, 16);
+
+    // Set on the way out so background work on the pool stops early instead
+    // of holding up ~ThreadPool.
+    std::atomic<bool> is_shutting_down(false);
 
-    bool previous_was_left_arrow_pressed = false;
-    bool previous_was_right_arrow_pressed = false;
+    // FILLED mode rasterizes the whole window in tiles spread over the pool,
+    // which also builds the atlas and gets glyphs ready for the loader.
+    ThreadPool thread_pool;
+    GlyphRasterizer rasterizer;
 
+    // Navigating only posts a request; the glyph is decoded and compiled on
+    // the pool while the previous one stays on screen, and the loader wakes
+    // the event loop once it is ready.
+    Uint32 glyph_ready_event = SDL_RegisterEvents(1);
+    GlyphLoader glyph_loader(glyph_cache, outline_cache, thread_pool, [glyph_ready_event]() {
+        SDL_Event event;
+        SDL_zero(event);
+        event.type = glyph_ready_event;
+        SDL_PushEvent(&event);
+    });
+
+    // current_glyph_index is the glyph navigated to, shown_glyph the one on
+    // screen. Every mode except POINTS and HINTED draws shown_glyph's
+    // compiled outline; POINTS draws its decoded points, or looks them up in
+    // the outline cache if that is where it came from, and HINTED scales and
+    // hints the glyph itself.
     Uint16 current_glyph_index = 0;
-    Glyph current_glyph = font.get_glyph(current_glyph_index);
+    std::unique_ptr<GlyphLoader::LoadedGlyph> shown_glyph = glyph_loader.load(current_glyph_index);
+    update_window_title(window, font, current_glyph_index);
+
+    // Without a usable outline cache, build one in the background for the
+    // next launch. With one, check the whole file against the hash it was
+    // built from once the first glyph is up; a file whose size, time stamp
+    // and checksums all survived an edit is rare enough that the cache is
+    // only dropped for the next launch rather than swapped out now.
+    if (outline_cache == nullptr && !outline_cache_file_name.empty()) {
+        thread_pool.submit([&font, &thread_pool, &is_shutting_down, cache_directory, outline_cache_file_name, font_file]() {
+            auto build_start = std::chrono::steady_clock::now();
+            std::shared_ptr<const OutlineCache> built_cache = OutlineCache::build(font, thread_pool, &is_shutting_down);
+            double build_ms = milliseconds_since(build_start);
+            if (built_cache == nullptr) {
+                return;
+            }
+
+            std::error_code error;
+            std::filesystem::create_directories(cache_directory, error);
+            if (built_cache->save(outline_cache_file_name)) {
+                std::cout << "Outline cache: built " << built_cache->get_glyph_count() << " glyphs in " << build_ms << " ms, ";
+                std::cout << built_cache->get_file_size() / 1024 << " KB (" << font_file->get_size() / 1024 << " KB font)" << std::endl;
+            }
+        });
+    } else if (outline_cache != nullptr) {
+        thread_pool.submit([&is_shutting_down, outline_cache, outline_cache_file_name, font_file]() {
+            if (is_shutting_down.load(std::memory_order_relaxed)) {
+                return;
+            }
+
+            if (outline_cache->get_content_hash() != font_file->get_content_hash()) {
+                std::cerr << "[ERROR] Outline cache doesn't match the font, removed it: " << outline_cache_file_name << std::endl;
+                std::remove(outline_cache_file_name.c_str());
+            }
+        });
+    }
+    SDL_Texture* filled_texture = nullptr;
+
+    // The atlas is only built the first time ATLAS mode is shown.
+    std::shared_ptr<const GlyphAtlas> atlas;
+    std::vector<SDL_Texture*> atlas_page_textures;
+    RetainedGeometryKey built_geometry_key = {};
+    bool has_built_geometry = false;
+
+    // The grid scrolls, so unlike the single-glyph modes it is rebuilt every
+    // frame from its cached cells.
+    GlyphGridView grid_view(font, GRID_CELL_SIZE);
+    grid_view.set_viewport_size(window_width, window_height);
+    Uint64 last_frame_ticks = SDL_GetTicksNS();
+
+    // TEXT mode lays out whatever has been typed. Keys that would switch mode
+    // or quit go to the text instead while it is active; Escape leaves it.
+    TextLayout text_layout(font, TEXT_LAYOUT_CACHE_CAPACITY);
+    std::string entered_text;
+    Uint64 text_revision = 0;
+    DrawMethod draw_method_before_text = draw_method;
+
+    // HINTED mode shows the glyph grid-fitted at a small pixel size, one
+    // texel per pixel. H turns the instructions off and on, + and - change
+    // the size.
+    GlyphHinter hinter(font);
+    HintedGlyph hinted_glyph;
+    GlyphOutline hinted_outline;
+    SDL_Texture* hinted_texture = nullptr;
+    int hinted_pixel_size = HINTED_PIXEL_SIZE;
+    bool is_hinting_enabled = true;
+    Uint64 hinting_revision = 0;
+
+#ifdef TTF_VIEWER_PROFILING
+    // P shows the profile overlay and T starts and stops a trace capture.
+    bool is_profile_overlay_visible = false;
+    ProfileFrameStats profile_stats = {};
+#endif
+
+    // Worst case from waking up for an event to having the frame ready to
+    // present, which includes anything the event handlers did.
+    Uint64 frame_count = 0;
+    Uint64 slowest_frame_ns = 0;
+    Uint64 geometry_rebuild_count = 0;
+    Uint64 grid_cells_decoded = 0;
+    Uint64 grid_cells_drawn = 0;
+    int max_grid_cells_decoded_per_frame = 0;
 
     bool is_running = true;
+    bool needs_redraw = true;
     while (is_running) {
+        // Sleep until something happens, then drain whatever else queued up
+        // so a burst of events costs a single redraw.
         SDL_Event event;
-        while (SDL_PollEvent(&event)) {
+        bool has_event = needs_redraw ? SDL_PollEvent(&event) : SDL_WaitEvent(&event);
+        Uint64 wake_ticks = SDL_GetTicksNS();
+        while (has_event) {
+            int navigation_step = 0;
+
             if (event.type == SDL_EVENT_QUIT) {
                 is_running = false;
+            } else if (event.type == SDL_EVENT_KEY_DOWN && draw_method == DrawMethod::TEXT) {
+                if (event.key.scancode == SDL_SCANCODE_ESCAPE) {
+                    SDL_StopTextInput(window);
+                    draw_method = draw_method_before_text;
+                } else if (event.key.scancode == SDL_SCANCODE_BACKSPACE && !entered_text.empty()) {
+                    erase_last_codepoint(entered_text);
+                    text_revision++;
+                } else if (event.key.scancode == SDL_SCANCODE_RETURN) {
+                    entered_text += '\n';
+                    text_revision++;
+                }
+
+                needs_redraw = true;
+            } else if (event.type == SDL_EVENT_TEXT_INPUT && draw_method == DrawMethod::TEXT) {
+                entered_text += event.text.text;
+                text_revision++;
+                needs_redraw = true;
             } else if (event.type == SDL_EVENT_KEY_DOWN) {
                 if (event.key.scancode == SDL_SCANCODE_ESCAPE) {
                     is_running = false;
@@ -455,61 +425,231 @@ int main(int argc, char** argv) {
                     draw_method = DrawMethod::LINES;
                 } else if (event.key.scancode == SDL_SCANCODE_3) {
                     draw_method = DrawMethod::CONTOURS;
+                } else if (event.key.scancode == SDL_SCANCODE_4) {
+                    draw_method = DrawMethod::FILLED;
+                } else if (event.key.scancode == SDL_SCANCODE_5) {
+                    draw_method = DrawMethod::ATLAS;
+                } else if (event.key.scancode == SDL_SCANCODE_6) {
+                    draw_method = DrawMethod::GRID;
+                    grid_view.scroll_to_glyph(current_glyph_index);
+                } else if (event.key.scancode == SDL_SCANCODE_7) {
+                    draw_method_before_text = draw_method;
+                    draw_method = DrawMethod::TEXT;
+                    SDL_StartTextInput(window);
+                } else if (event.key.scancode == SDL_SCANCODE_8) {
+                    draw_method = DrawMethod::HINTED;
+                } else if (event.key.scancode == SDL_SCANCODE_H && draw_method == DrawMethod::HINTED) {
+                    is_hinting_enabled = !is_hinting_enabled;
+                    hinting_revision++;
+                } else if ((event.key.scancode == SDL_SCANCODE_EQUALS || event.key.scancode == SDL_SCANCODE_KP_PLUS) && draw_method == DrawMethod::HINTED) {
+                    hinted_pixel_size = std::min(hinted_pixel_size + 1, MAX_HINTED_PIXEL_SIZE);
+                    hinting_revision++;
+                } else if ((event.key.scancode == SDL_SCANCODE_MINUS || event.key.scancode == SDL_SCANCODE_KP_MINUS) && draw_method == DrawMethod::HINTED) {
+                    hinted_pixel_size = std::max(hinted_pixel_size - 1, MIN_HINTED_PIXEL_SIZE);
+                    hinting_revision++;
+#ifdef TTF_VIEWER_PROFILING
+                } else if (event.key.scancode == SDL_SCANCODE_P) {
+                    is_profile_overlay_visible = !is_profile_overlay_visible;
+                } else if (event.key.scancode == SDL_SCANCODE_T) {
+                    if (Profiler::is_tracing()) {
+                        if (Profiler::stop_trace(TRACE_FILE_NAME)) {
+                            std::cout << "Trace written to " << TRACE_FILE_NAME << std::endl;
+                        }
+                    } else {
+                        Profiler::start_trace();
+                    }
+#endif
+                } else if (event.key.scancode == SDL_SCANCODE_LEFT && !event.key.repeat) {
+                    navigation_step = -1;
+                } else if (event.key.scancode == SDL_SCANCODE_RIGHT && !event.key.repeat) {
+                    navigation_step = 1;
+                } else if (event.key.scancode == SDL_SCANCODE_UP && draw_method == DrawMethod::GRID) {
+                    navigation_step = -grid_view.get_column_count();
+                } else if (event.key.scancode == SDL_SCANCODE_DOWN && draw_method == DrawMethod::GRID) {
+                    navigation_step = grid_view.get_column_count();
+                } else if (event.key.scancode == SDL_SCANCODE_PAGEUP && draw_method == DrawMethod::GRID) {
+                    grid_view.scroll_by(static_cast<float>(-window_height));
+                } else if (event.key.scancode == SDL_SCANCODE_PAGEDOWN && draw_method == DrawMethod::GRID) {
+                    grid_view.scroll_by(static_cast<float>(window_height));
+                }
+
+                needs_redraw = true;
+            } else if (event.type == SDL_EVENT_MOUSE_WHEEL) {
+                if (draw_method == DrawMethod::GRID) {
+                    grid_view.fling(-event.wheel.y * GRID_WHEEL_FLING_VELOCITY);
+                    needs_redraw = true;
                 }
             } else if (event.type == SDL_EVENT_WINDOW_RESIZED) {
                 window_width = event.window.data1;
                 window_height = event.window.data2;
+                grid_view.set_viewport_size(window_width, window_height);
+                needs_redraw = true;
+            } else if (event.type == SDL_EVENT_WINDOW_EXPOSED) {
+                needs_redraw = true;
             }
-        }
 
-        Uint16 next_glyph_index = current_glyph_index;
+            if (navigation_step != 0) {
+                int glyph_count = font.get_glyph_count();
+                current_glyph_index = static_cast<Uint16>(((current_glyph_index + navigation_step) % glyph_count + glyph_count) % glyph_count);
+                glyph_loader.request(current_glyph_index, navigation_step < 0 ? -1 : 1);
 
-        const bool* keyboard = SDL_GetKeyboardState(nullptr);
-        bool current_was_left_arrow_pressed = keyboard[SDL_SCANCODE_LEFT];
-        bool current_was_right_arrow_pressed = keyboard[SDL_SCANCODE_RIGHT];
-        if (!previous_was_left_arrow_pressed && current_was_left_arrow_pressed) {
-            if (next_glyph_index == 0) {
-                next_glyph_index = font.get_glyph_count() - 1;
-            } else {
-                next_glyph_index--;
-            }
-        } else if (!previous_was_right_arrow_pressed && current_was_right_arrow_pressed) {
-            next_glyph_index++;
-            if (next_glyph_index >= font.get_glyph_count()) {
-                next_glyph_index = 0;
+                if (draw_method == DrawMethod::GRID) {
+                    grid_view.scroll_to_glyph(current_glyph_index);
+                }
             }
-        }
 
-        if (next_glyph_index != current_glyph_index) {
-            current_glyph_index = next_glyph_index;
+            has_event = SDL_PollEvent(&event);
+        }
 
-            current_glyph.destroy();
-            current_glyph = font.get_glyph(current_glyph_index);
+        std::unique_ptr<GlyphLoader::LoadedGlyph> loaded_glyph = glyph_loader.take_ready();
+        if (loaded_glyph != nullptr) {
+            shown_glyph = std::move(loaded_glyph);
+            update_window_title(window, font, shown_glyph->glyph_index);
+            needs_redraw = true;
+        }
 
+        if (!is_running || !needs_redraw) {
+            continue;
         }
 
-        previous_was_left_arrow_pressed = current_was_left_arrow_pressed;
-        previous_was_right_arrow_pressed = current_was_right_arrow_pressed;
+#ifdef TTF_VIEWER_PROFILING
+        // Everything since the last frame was drawn, including that frame's
+        // own FRAME zone, which closed at the end of the last iteration.
+        Profiler::end_frame(profile_stats);
+#endif
+        PROFILE_SCOPE(FRAME);
+
+        Uint64 frame_ticks = SDL_GetTicksNS();
+        Uint64 frame_step_ns = std::min(frame_ticks - last_frame_ticks, MAX_FRAME_STEP_NS);
+        last_frame_ticks = frame_ticks;
+
+        Uint16 shown_glyph_index = shown_glyph->glyph_index;
+        const GlyphOutline& shown_outline = shown_glyph->outline;
+
+        RetainedGeometryKey geometry_key = {shown_glyph_index, window_width, window_height, draw_method, text_revision, hinting_revision};
+        if (draw_method == DrawMethod::GRID) {
+            grid_view.advance(frame_step_ns / 1e9f);
+
+            draw_list.clear();
+            grid_view.draw(draw_list, current_glyph_index, glyph_color, OFF_CURVE_POINT_COLOR);
+
+            grid_cells_decoded += grid_view.get_cells_decoded();
+            grid_cells_drawn += grid_view.get_cells_drawn();
+            max_grid_cells_decoded_per_frame = std::max(max_grid_cells_decoded_per_frame, grid_view.get_cells_decoded());
+
+            // Forget the retained key so leaving the grid rebuilds whatever
+            // mode comes next.
+            has_built_geometry = false;
+            geometry_rebuild_count++;
+        } else if (!has_built_geometry || geometry_key != built_geometry_key) {
+            draw_list.clear();
+
+            OutlineView cached_points;
+            if (draw_method == DrawMethod::POINTS && shown_glyph->glyph != nullptr) {
+                draw_glyph_points(draw_list, *shown_glyph->glyph, window_width, window_height, 20, glyph_color);
+            } else if (draw_method == DrawMethod::POINTS && outline_cache->find_outline(shown_glyph_index, cached_points)) {
+                draw_glyph_points(draw_list, cached_points, window_width, window_height, 20, glyph_color);
+            } else if (draw_method == DrawMethod::LINES) {
+                draw_glyph_lines(draw_list, shown_outline, window_width, window_height, 20, glyph_color);
+            } else if (draw_method == DrawMethod::CONTOURS) {
+                draw_glyph_contours(draw_list, shown_outline, window_width, window_height, 20, 0.25f, glyph_color);
+            } else if (draw_method == DrawMethod::FILLED) {
+                draw_glyph_filled(draw_list, renderer, rasterizer, thread_pool, filled_texture, shown_outline, window_width, window_height, 20, 0.25f, glyph_color);
+            } else if (draw_method == DrawMethod::HINTED) {
+                hinter.load_glyph(shown_glyph_index, hinted_pixel_size, is_hinting_enabled, hinted_glyph);
+                hinted_outline.compile(hinted_glyph);
+                draw_glyph_hinted(draw_list, renderer, rasterizer, hinted_texture, hinted_outline, window_width, window_height, 20, 0.1f, glyph_color);
+            } else if (draw_method == DrawMethod::ATLAS) {
+                if (atlas == nullptr) {
+                    bool was_cache_hit = false;
+                    Uint64 build_start = SDL_GetTicks();
+                    atlas = GlyphAtlas::load_or_build(font, thread_pool, ATLAS_PIXEL_SIZE, GlyphAtlas::get_default_cache_directory(), &was_cache_hit);
+                    std::cout << "Glyph atlas at " << ATLAS_PIXEL_SIZE << "px: " << atlas->get_page_count() << " pages, ";
+                    std::cout << static_cast<int>(atlas->get_pack_efficiency() * 100.0 + 0.5) << "% packed, ";
+                    std::cout << (was_cache_hit ? "loaded from cache" : "built") << " in " << SDL_GetTicks() - build_start << " ms" << std::endl;
+
+                    atlas_page_textures.assign(atlas->get_page_count(), nullptr);
+                }
 
-        SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
-        SDL_RenderClear(renderer);
+                int page = atlas->get_glyph(shown_glyph_index).page;
+                if (page < atlas->get_page_count() && atlas_page_textures[page] == nullptr) {
+                    atlas_page_textures[page] = atlas->create_page_texture(renderer, page, glyph_color);
+                }
 
-        SDL_SetRenderDrawColor(renderer, 255, 255, 255, 255);
+                SDL_Texture* page_texture = page < atlas->get_page_count() ? atlas_page_textures[page] : nullptr;
+                draw_atlas_page(draw_list, page_texture, *atlas, shown_glyph_index, window_width, window_height, 20, OFF_CURVE_POINT_COLOR);
+            } else if (draw_method == DrawMethod::TEXT) {
+                std::shared_ptr<const GlyphRun> run = text_layout.shape(entered_text, TEXT_PIXEL_SIZE);
+                text_layout.draw(draw_list, *run, 20, 20, glyph_color);
 
-        if (draw_method == DrawMethod::POINTS) {
-            draw_glyph_points(renderer, current_glyph, window_width, window_height, 20);
-        } else if (draw_method == DrawMethod::LINES) {
-            draw_glyph_lines(renderer, current_glyph, window_width, window_height, 20);
-        } else if (draw_method == DrawMethod::CONTOURS) {
-            draw_glyph_contours(renderer, current_glyph, window_width, window_height, 20, 10);
+                float caret_x = 20 + run->end_x;
+                float caret_top = 20 + run->end_y - run->ascent;
+                draw_list.add_line(caret_x, caret_top, caret_x, caret_top + run->line_height, OFF_CURVE_POINT_COLOR);
+            }
+
+            built_geometry_key = geometry_key;
+            has_built_geometry = true;
+            geometry_rebuild_count++;
+        }
+
+        render_draw_list(renderer, draw_list);
+
+#ifdef TTF_VIEWER_PROFILING
+        if (is_profile_overlay_visible) {
+            draw_profile_overlay(renderer, profile_stats);
         }
+#endif
 
+        slowest_frame_ns = std::max(slowest_frame_ns, SDL_GetTicksNS() - wake_ticks);
         SDL_RenderPresent(renderer);
+
+        frame_count++;
+
+        if (!has_reported_startup) {
+            std::cout << "Startup: first glyph decoded and drawn in " << milliseconds_since(launch_start) << " ms" << std::endl;
+            has_reported_startup = true;
+        }
+
+        // Keep drawing while a fling is still coasting.
+        needs_redraw = draw_method == DrawMethod::GRID && grid_view.is_moving();
     }
 
     // --- cleanup ---
 
-    current_glyph.destroy();
+    is_shutting_down.store(true, std::memory_order_relaxed);
+
+    std::cout << "Glyph cache: " << glyph_cache.get_hit_count() << " hits, ";
+    std::cout << glyph_cache.get_miss_count() << " misses, ";
+    std::cout << glyph_cache.get_eviction_count() << " evictions" << std::endl;
+    std::cout << "Glyph loader: " << glyph_loader.get_loaded_count() << " shown, ";
+    std::cout << glyph_loader.get_cancelled_count() << " cancelled, ";
+    std::cout << glyph_loader.get_skipped_count() << " skipped" << std::endl;
+    std::cout << "Frames: " << frame_count << " drawn, " << geometry_rebuild_count << " geometry rebuilds, ";
+    std::cout << "slowest " << slowest_frame_ns / 1e6 << " ms before present" << std::endl;
+    std::cout << "Grid: " << grid_cells_decoded << " cells decoded (at most " << max_grid_cells_decoded_per_frame << " in one frame), ";
+    std::cout << grid_cells_drawn << " cells drawn" << std::endl;
+    std::cout << "Text layout: " << text_layout.get_hit_count() << " hits, " << text_layout.get_miss_count() << " misses" << std::endl;
+    std::cout << "Hinting: " << hinter.get_prepared_size_count() << " sizes prepared, " << hinter.get_failed_program_count() << " programs failed" << std::endl;
+
+#ifdef TTF_VIEWER_PROFILING
+    if (Profiler::is_tracing() && Profiler::stop_trace(TRACE_FILE_NAME)) {
+        std::cout << "Trace written to " << TRACE_FILE_NAME << std::endl;
+    }
+#endif
+
+    if (filled_texture != nullptr) {
+        SDL_DestroyTexture(filled_texture);
+    }
+
+    if (hinted_texture != nullptr) {
+        SDL_DestroyTexture(hinted_texture);
+    }
+
+    for (SDL_Texture* texture : atlas_page_textures) {
+        if (texture != nullptr) {
+            SDL_DestroyTexture(texture);
+        }
+    }
 
     SDL_DestroyRenderer(renderer);
     SDL_DestroyWindow(window);